@@ -87,6 +87,8 @@ class IdwInterpolation(QgisAlgorithm):
 
     INTERPOLATION_DATA = 'INTERPOLATION_DATA'
     DISTANCE_COEFFICIENT = 'DISTANCE_COEFFICIENT'
+    MAX_POINTS = 'MAX_POINTS'
+    SEARCH_RADIUS = 'SEARCH_RADIUS'
     COLUMNS = 'COLUMNS'
     ROWS = 'ROWS'
     CELLSIZE_X = 'CELLSIZE_X'
@@ -110,6 +112,12 @@ class IdwInterpolation(QgisAlgorithm):
         self.addParameter(QgsProcessingParameterNumber(self.DISTANCE_COEFFICIENT,
                                                        self.tr('Distance coefficient P'), type=QgsProcessingParameterNumber.Double,
                                                        minValue=0.0, maxValue=99.99, defaultValue=2.0))
+        self.addParameter(QgsProcessingParameterNumber(self.MAX_POINTS,
+                                                       self.tr('Maximum number of nearest points (0 = all points)'),
+                                                       minValue=0, defaultValue=0))
+        self.addParameter(QgsProcessingParameterNumber(self.SEARCH_RADIUS,
+                                                       self.tr('Search radius (0 = unlimited)'), type=QgsProcessingParameterNumber.Double,
+                                                       minValue=0.0, defaultValue=0.0))
         self.addParameter(QgsProcessingParameterNumber(self.COLUMNS,
                                                        self.tr('Number of columns'),
                                                        minValue=0, maxValue=10000000, defaultValue=300))
@@ -137,6 +145,8 @@ class IdwInterpolation(QgisAlgorithm):
     def processAlgorithm(self, parameters, context, feedback):
         interpolationData = ParameterInterpolationData.parseValue(parameters[self.INTERPOLATION_DATA])
         coefficient = self.parameterAsDouble(parameters, self.DISTANCE_COEFFICIENT, context)
+        maxPoints = self.parameterAsInt(parameters, self.MAX_POINTS, context)
+        searchRadius = self.parameterAsDouble(parameters, self.SEARCH_RADIUS, context)
         columns = self.parameterAsInt(parameters, self.COLUMNS, context)
         rows = self.parameterAsInt(parameters, self.ROWS, context)
         cellsizeX = self.parameterAsDouble(parameters, self.CELLSIZE_X, context)
@@ -171,6 +181,8 @@ class IdwInterpolation(QgisAlgorithm):
 
         interpolator = QgsIDWInterpolator(layerData)
         interpolator.setDistanceCoefficient(coefficient)
+        interpolator.setMaxNeighborCount(maxPoints)
+        interpolator.setSearchRadius(searchRadius)
 
         writer = QgsGridFileWriter(interpolator,
                                    output,
@@ -179,6 +191,8 @@ class IdwInterpolation(QgisAlgorithm):
                                    rows,
                                    cellsizeX,
                                    cellsizeY)
+        if os.path.splitext(output)[1].lower() in ('.tif', '.tiff'):
+            writer.setFormat(QgsGridFileWriter.GeoTiff)
 
         writer.writeFile(feedback)
         return {self.OUTPUT: output}
@@ -0,0 +1,270 @@
+# -*- coding: utf-8 -*-
+
+"""
+***************************************************************************
+    OdMatrixFromLayers.py
+    ---------------------
+    Date                 : October 2017
+    Copyright            : (C) 2017 by QGIS Development Team
+***************************************************************************
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+***************************************************************************
+"""
+
+__author__ = 'QGIS Development Team'
+__date__ = 'October 2017'
+__copyright__ = '(C) 2017, QGIS Development Team'
+
+# This will get replaced with a git SHA1 when you do a git archive
+
+__revision__ = '$Format:%H$'
+
+import os
+import math
+from collections import OrderedDict
+
+from qgis.PyQt.QtCore import QVariant
+from qgis.PyQt.QtGui import QIcon
+
+from qgis.core import (NULL,
+                       QgsWkbTypes,
+                       QgsUnitTypes,
+                       QgsFeature,
+                       QgsFeatureSink,
+                       QgsFeatureRequest,
+                       QgsFields,
+                       QgsField,
+                       QgsProcessing,
+                       QgsProcessingParameterEnum,
+                       QgsProcessingParameterField,
+                       QgsProcessingParameterNumber,
+                       QgsProcessingParameterString,
+                       QgsProcessingParameterFeatureSource,
+                       QgsProcessingParameterFeatureSink,
+                       QgsProcessingParameterDefinition)
+from qgis.analysis import (QgsVectorLayerDirector,
+                           QgsNetworkDistanceStrategy,
+                           QgsNetworkSpeedStrategy,
+                           QgsGraphBuilder,
+                           QgsCompactGraph
+                           )
+
+from processing.algs.qgis.QgisAlgorithm import QgisAlgorithm
+
+pluginPath = os.path.split(os.path.split(os.path.dirname(__file__))[0])[0]
+
+
+class OdMatrixFromLayers(QgisAlgorithm):
+
+    INPUT = 'INPUT'
+    ORIGINS = 'ORIGINS'
+    DESTINATIONS = 'DESTINATIONS'
+    STRATEGY = 'STRATEGY'
+    DIRECTION_FIELD = 'DIRECTION_FIELD'
+    VALUE_FORWARD = 'VALUE_FORWARD'
+    VALUE_BACKWARD = 'VALUE_BACKWARD'
+    VALUE_BOTH = 'VALUE_BOTH'
+    DEFAULT_DIRECTION = 'DEFAULT_DIRECTION'
+    SPEED_FIELD = 'SPEED_FIELD'
+    DEFAULT_SPEED = 'DEFAULT_SPEED'
+    TOLERANCE = 'TOLERANCE'
+    OUTPUT = 'OUTPUT'
+
+    def icon(self):
+        return QIcon(os.path.join(pluginPath, 'images', 'networkanalysis.svg'))
+
+    def group(self):
+        return self.tr('Network analysis')
+
+    def __init__(self):
+        super().__init__()
+
+    def initAlgorithm(self, config=None):
+        self.DIRECTIONS = OrderedDict([
+            (self.tr('Forward direction'), QgsVectorLayerDirector.DirectionForward),
+            (self.tr('Backward direction'), QgsVectorLayerDirector.DirectionBackward),
+            (self.tr('Both directions'), QgsVectorLayerDirector.DirectionBoth)])
+
+        self.STRATEGIES = [self.tr('Shortest'),
+                           self.tr('Fastest')
+                           ]
+
+        self.addParameter(QgsProcessingParameterFeatureSource(self.INPUT,
+                                                              self.tr('Vector layer representing network'),
+                                                              [QgsProcessing.TypeVectorLine]))
+        self.addParameter(QgsProcessingParameterFeatureSource(self.ORIGINS,
+                                                              self.tr('Vector layer with origin points'),
+                                                              [QgsProcessing.TypeVectorPoint]))
+        self.addParameter(QgsProcessingParameterFeatureSource(self.DESTINATIONS,
+                                                              self.tr('Vector layer with destination points'),
+                                                              [QgsProcessing.TypeVectorPoint]))
+        self.addParameter(QgsProcessingParameterEnum(self.STRATEGY,
+                                                     self.tr('Path type to calculate'),
+                                                     self.STRATEGIES,
+                                                     defaultValue=0))
+
+        params = []
+        params.append(QgsProcessingParameterField(self.DIRECTION_FIELD,
+                                                  self.tr('Direction field'),
+                                                  None,
+                                                  self.INPUT,
+                                                  optional=True))
+        params.append(QgsProcessingParameterString(self.VALUE_FORWARD,
+                                                   self.tr('Value for forward direction'),
+                                                   optional=True))
+        params.append(QgsProcessingParameterString(self.VALUE_BACKWARD,
+                                                   self.tr('Value for backward direction'),
+                                                   optional=True))
+        params.append(QgsProcessingParameterString(self.VALUE_BOTH,
+                                                   self.tr('Value for both directions'),
+                                                   optional=True))
+        params.append(QgsProcessingParameterEnum(self.DEFAULT_DIRECTION,
+                                                 self.tr('Default direction'),
+                                                 list(self.DIRECTIONS.keys()),
+                                                 defaultValue=2))
+        params.append(QgsProcessingParameterField(self.SPEED_FIELD,
+                                                  self.tr('Speed field'),
+                                                  None,
+                                                  self.INPUT,
+                                                  optional=True))
+        params.append(QgsProcessingParameterNumber(self.DEFAULT_SPEED,
+                                                   self.tr('Default speed (km/h)'),
+                                                   QgsProcessingParameterNumber.Double,
+                                                   5.0, False, 0, 99999999.99))
+        params.append(QgsProcessingParameterNumber(self.TOLERANCE,
+                                                   self.tr('Topology tolerance'),
+                                                   QgsProcessingParameterNumber.Double,
+                                                   0.0, False, 0, 99999999.99))
+
+        for p in params:
+            p.setFlags(p.flags() | QgsProcessingParameterDefinition.FlagAdvanced)
+            self.addParameter(p)
+
+        self.addParameter(QgsProcessingParameterFeatureSink(self.OUTPUT,
+                                                            self.tr('OD cost matrix'),
+                                                            QgsProcessing.TypeVector))
+
+    def name(self):
+        return 'odmatrixfromlayers'
+
+    def displayName(self):
+        return self.tr('OD cost matrix (layer to layer)')
+
+    def loadPoints(self, source, crs, feedback):
+        """
+        Returns feature ids and points of all features of source with a point geometry
+        """
+        request = QgsFeatureRequest()
+        request.setSubsetOfAttributes([])
+        request.setDestinationCrs(crs)
+
+        ids = []
+        points = []
+        for f in source.getFeatures(request):
+            if feedback.isCanceled():
+                break
+
+            if not f.hasGeometry():
+                continue
+
+            ids.append(f.id())
+            points.append(f.geometry().asPoint())
+
+        return ids, points
+
+    def processAlgorithm(self, parameters, context, feedback):
+        network = self.parameterAsSource(parameters, self.INPUT, context)
+        origins = self.parameterAsSource(parameters, self.ORIGINS, context)
+        destinations = self.parameterAsSource(parameters, self.DESTINATIONS, context)
+        strategy = self.parameterAsEnum(parameters, self.STRATEGY, context)
+
+        directionFieldName = self.parameterAsString(parameters, self.DIRECTION_FIELD, context)
+        forwardValue = self.parameterAsString(parameters, self.VALUE_FORWARD, context)
+        backwardValue = self.parameterAsString(parameters, self.VALUE_BACKWARD, context)
+        bothValue = self.parameterAsString(parameters, self.VALUE_BOTH, context)
+        defaultDirection = self.parameterAsEnum(parameters, self.DEFAULT_DIRECTION, context)
+        speedFieldName = self.parameterAsString(parameters, self.SPEED_FIELD, context)
+        defaultSpeed = self.parameterAsDouble(parameters, self.DEFAULT_SPEED, context)
+        tolerance = self.parameterAsDouble(parameters, self.TOLERANCE, context)
+
+        fields = QgsFields()
+        fields.append(QgsField('origin_id', QVariant.LongLong))
+        fields.append(QgsField('destination_id', QVariant.LongLong))
+        fields.append(QgsField('cost', QVariant.Double, '', 20, 7))
+
+        (sink, dest_id) = self.parameterAsSink(parameters, self.OUTPUT, context,
+                                               fields, QgsWkbTypes.NoGeometry, network.sourceCrs())
+
+        directionField = -1
+        if directionFieldName:
+            directionField = network.fields().lookupField(directionFieldName)
+        speedField = -1
+        if speedFieldName:
+            speedField = network.fields().lookupField(speedFieldName)
+
+        director = QgsVectorLayerDirector(network,
+                                          directionField,
+                                          forwardValue,
+                                          backwardValue,
+                                          bothValue,
+                                          list(self.DIRECTIONS.values())[defaultDirection])
+
+        distUnit = context.project().crs().mapUnits()
+        multiplier = QgsUnitTypes.fromUnitToUnitFactor(distUnit, QgsUnitTypes.DistanceMeters)
+        if strategy == 0:
+            strategy = QgsNetworkDistanceStrategy()
+        else:
+            strategy = QgsNetworkSpeedStrategy(speedField,
+                                               defaultSpeed,
+                                               multiplier * 1000.0 / 3600.0)
+            multiplier = 3600
+
+        director.addStrategy(strategy)
+        builder = QgsGraphBuilder(context.project().crs(),
+                                  True,
+                                  tolerance)
+
+        feedback.pushInfo(self.tr('Loading origin and destination points...'))
+        originIds, originPoints = self.loadPoints(origins, network.sourceCrs(), feedback)
+        destinationIds, destinationPoints = self.loadPoints(destinations, network.sourceCrs(), feedback)
+
+        feedback.pushInfo(self.tr('Building graph...'))
+        snappedPoints = director.makeGraph(builder, originPoints + destinationPoints, feedback)
+        if feedback.isCanceled():
+            return {self.OUTPUT: dest_id}
+
+        feedback.pushInfo(self.tr('Calculating cost matrix...'))
+        graph = builder.graph()
+
+        # snapped points are graph vertices, look them up all at once instead of using findVertex() for each
+        vertices = {}
+        for i in range(graph.vertexCount()):
+            p = graph.vertex(i).point()
+            vertices.setdefault((p.x(), p.y()), i)
+        snappedVertices = [vertices.get((p.x(), p.y()), -1) for p in snappedPoints]
+        originVertices = snappedVertices[:len(originPoints)]
+        destinationVertices = snappedVertices[len(originPoints):]
+
+        compactGraph = QgsCompactGraph(graph, [0])
+        matrix = compactGraph.costMatrix(originVertices, destinationVertices, 0, feedback)
+
+        destinationCount = len(destinationIds)
+        for i, originId in enumerate(originIds):
+            if feedback.isCanceled():
+                break
+
+            for j, destinationId in enumerate(destinationIds):
+                cost = matrix[i * destinationCount + j]
+
+                feat = QgsFeature(fields)
+                feat['origin_id'] = originId
+                feat['destination_id'] = destinationId
+                feat['cost'] = cost / multiplier if not math.isinf(cost) else NULL
+                sink.addFeature(feat, QgsFeatureSink.FastInsert)
+
+        return {self.OUTPUT: dest_id}
@@ -99,6 +99,7 @@ from .Merge import Merge
 from .MergeLines import MergeLines
 from .MinimumBoundingGeometry import MinimumBoundingGeometry
 from .NearestNeighbourAnalysis import NearestNeighbourAnalysis
+from .OdMatrixFromLayers import OdMatrixFromLayers
 from .OffsetLine import OffsetLine
 from .Orthogonalize import Orthogonalize
 from .PointDistance import PointDistance
@@ -246,6 +247,7 @@ class QGISAlgorithmProvider(QgsProcessingProvider):
                 MergeLines(),
                 MinimumBoundingGeometry(),
                 NearestNeighbourAnalysis(),
+                OdMatrixFromLayers(),
                 OffsetLine(),
                 Orthogonalize(),
                 PointDistance(),
@@ -210,6 +210,8 @@ class TinInterpolation(QgisAlgorithm):
                                    rows,
                                    cellsizeX,
                                    cellsizeY)
+        if os.path.splitext(output)[1].lower() in ('.tif', '.tiff'):
+            writer.setFormat(QgsGridFileWriter.GeoTiff)
 
         writer.writeFile(feedback)
         return {self.OUTPUT: output, self.TRIANGULATION: triangulation_dest_id}
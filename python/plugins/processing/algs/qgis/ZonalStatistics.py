@@ -74,6 +74,8 @@ class ZonalStatistics(QgisAlgorithm):
                                   (self.tr('Majority (mode)'), QgsZonalStatistics.Majority),
                                   (self.tr('Variety'), QgsZonalStatistics.Variety),
                                   (self.tr('Variance'), QgsZonalStatistics.Variance),
+                                  (self.tr('First quartile'), QgsZonalStatistics.FirstQuartile),
+                                  (self.tr('Third quartile'), QgsZonalStatistics.ThirdQuartile),
                                   (self.tr('All'), QgsZonalStatistics.All)])
 
         self.addParameter(QgsProcessingParameterRasterLayer(self.INPUT_RASTER,
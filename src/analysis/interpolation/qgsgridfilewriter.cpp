@@ -21,6 +21,27 @@
 #include "qgsfeedback.h"
 #include <QFile>
 #include <QFileInfo>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include "gdal.h"
+
+#include <algorithm>
+
+//! Value of cells which could not be interpolated
+static const double NODATA_VALUE = -9999;
+
+///@cond PRIVATE
+
+//! Rows of the grid which are interpolated together
+struct QgsGridFileWriterBand
+{
+  int firstRow;
+  int rowCount;
+  QVector< double > values;
+};
+
+///@endcond
 
 QgsGridFileWriter::QgsGridFileWriter( QgsInterpolator *i, const QString &outputPath, const QgsRectangle &extent, int nCols, int nRows, double cellSizeX, double cellSizeY )
   : mInterpolator( i )
@@ -46,61 +67,56 @@ QgsGridFileWriter::QgsGridFileWriter()
 
 int QgsGridFileWriter::writeFile( QgsFeedback *feedback )
 {
-  QFile outputFile( mOutputFilePath );
+  if ( !mInterpolator )
+  {
+    return 2;
+  }
 
-  if ( !outputFile.open( QFile::WriteOnly | QIODevice::Truncate ) )
+  switch ( mFormat )
   {
-    return 1;
+    case GeoTiff:
+      return writeGeoTiff( feedback );
+
+    case AsciiGrid:
+      break;
   }
+  return writeAsciiGrid( feedback );
+}
 
-  if ( !mInterpolator )
+int QgsGridFileWriter::writeAsciiGrid( QgsFeedback *feedback )
+{
+  QFile outputFile( mOutputFilePath );
+
+  if ( !outputFile.open( QFile::WriteOnly | QIODevice::Truncate ) )
   {
-    outputFile.remove();
-    return 2;
+    return 1;
   }
 
   QTextStream outStream( &outputFile );
   outStream.setRealNumberPrecision( 8 );
   writeHeader( outStream );
 
-  double currentYValue = mInterpolationExtent.yMaximum() - mCellSizeY / 2.0; //calculate value in the center of the cell
-  double currentXValue;
-  double interpolatedValue;
-
-  for ( int i = 0; i < mNumRows; ++i )
+  int result = interpolateBands( feedback, [this, &outStream]( int, int rowCount, const QVector< double > &values )
   {
-    currentXValue = mInterpolationExtent.xMinimum() + mCellSizeX / 2.0; //calculate value in the center of the cell
-    for ( int j = 0; j < mNumColumns; ++j )
+    const double *value = values.constData();
+    for ( int i = 0; i < rowCount; ++i )
     {
-      if ( mInterpolator->interpolatePoint( currentXValue, currentYValue, interpolatedValue ) == 0 )
-      {
-        outStream << interpolatedValue << ' ';
-      }
-      else
+      for ( int j = 0; j < mNumColumns; ++j )
       {
-        outStream << "-9999 ";
+        outStream << *value++ << ' ';
       }
-      currentXValue += mCellSizeX;
+      outStream << endl;
     }
-    outStream << endl;
-    currentYValue -= mCellSizeY;
+    return outStream.status() == QTextStream::Ok;
+  } );
 
-    if ( feedback )
-    {
-      if ( feedback->isCanceled() )
-      {
-        outputFile.remove();
-        return 3;
-      }
-      feedback->setProgress( 100.0 * i / static_cast< double >( mNumRows ) );
-    }
+  if ( result != 0 )
+  {
+    outputFile.remove();
+    return result;
   }
 
   // create prj file
-  QgsInterpolator::LayerData ld;
-  ld = mInterpolator->layerData().at( 0 );
-  QgsVectorLayer *vl = ld.vectorLayer;
-  QString crs = vl->crs().toWkt();
   QFileInfo fi( mOutputFilePath );
   QString fileName = fi.absolutePath() + '/' + fi.completeBaseName() + ".prj";
   QFile prjFile( fileName );
@@ -109,13 +125,143 @@ int QgsGridFileWriter::writeFile( QgsFeedback *feedback )
     return 1;
   }
   QTextStream prjStream( &prjFile );
-  prjStream << crs;
+  prjStream << crsWkt();
   prjStream << endl;
   prjFile.close();
 
   return 0;
 }
 
+int QgsGridFileWriter::writeGeoTiff( QgsFeedback *feedback )
+{
+  GDALAllRegister();
+  GDALDriverH outputDriver = GDALGetDriverByName( "GTiff" );
+  if ( !outputDriver )
+  {
+    return 1;
+  }
+
+  GDALDatasetH outputDataset = GDALCreate( outputDriver, mOutputFilePath.toUtf8().constData(), mNumColumns, mNumRows, 1, GDT_Float32, nullptr );
+  if ( !outputDataset )
+  {
+    return 1;
+  }
+
+  double geotransform[6] = { mInterpolationExtent.xMinimum(), mCellSizeX, 0, mInterpolationExtent.yMaximum(), 0, -mCellSizeY };
+  GDALSetGeoTransform( outputDataset, geotransform );
+  GDALSetProjection( outputDataset, crsWkt().toUtf8().constData() );
+
+  GDALRasterBandH outputRasterBand = GDALGetRasterBand( outputDataset, 1 );
+  GDALSetRasterNoDataValue( outputRasterBand, NODATA_VALUE );
+
+  int result = interpolateBands( feedback, [this, outputRasterBand]( int firstRow, int rowCount, const QVector< double > &values )
+  {
+    return GDALRasterIO( outputRasterBand, GF_Write, 0, firstRow, mNumColumns, rowCount, const_cast< double * >( values.constData() ),
+                         mNumColumns, rowCount, GDT_Float64, 0, 0 ) == CE_None;
+  } );
+
+  GDALClose( outputDataset );
+  if ( result != 0 )
+  {
+    GDALDeleteDataset( outputDriver, mOutputFilePath.toUtf8().constData() );
+  }
+  return result;
+}
+
+QString QgsGridFileWriter::crsWkt() const
+{
+  QList< QgsInterpolator::LayerData > layerData = mInterpolator->layerData();
+  if ( layerData.isEmpty() || !layerData.at( 0 ).vectorLayer )
+  {
+    return QString();
+  }
+  return layerData.at( 0 ).vectorLayer->crs().toWkt();
+}
+
+int QgsGridFileWriter::interpolateBands( QgsFeedback *feedback, const std::function< bool( int, int, const QVector< double > & ) > &writeBand )
+{
+  const bool concurrent = mInterpolator->prepareForConcurrentInterpolation();
+
+  // bands of roughly 64k cells, each thread works on a few bands of a batch
+  const int rowsPerBand = std::max( 1, std::min( 64, 65536 / std::max( 1, mNumColumns ) ) );
+  const int bandsPerBatch = concurrent ? std::max( 1, QThread::idealThreadCount() ) * 2 : 1;
+  QVector< QgsGridFileWriterBand > bands( bandsPerBatch );
+
+  auto interpolateBand = [this, concurrent, feedback]( QgsGridFileWriterBand & band )
+  {
+    interpolateRows( band.firstRow, band.rowCount, band.values, concurrent, feedback );
+  };
+
+  int row = 0;
+  while ( row < mNumRows )
+  {
+    int bandCount = 0;
+    for ( ; bandCount < bandsPerBatch && row < mNumRows; ++bandCount )
+    {
+      bands[ bandCount ].firstRow = row;
+      bands[ bandCount ].rowCount = std::min( rowsPerBand, mNumRows - row );
+      row += bands[ bandCount ].rowCount;
+    }
+
+    if ( concurrent && bandCount > 1 )
+      QtConcurrent::blockingMap( bands.begin(), bands.begin() + bandCount, interpolateBand );
+    else
+      std::for_each( bands.begin(), bands.begin() + bandCount, interpolateBand );
+
+    // write back in row order
+    for ( int i = 0; i < bandCount; ++i )
+    {
+      if ( feedback && feedback->isCanceled() )
+      {
+        return 3;
+      }
+      if ( !writeBand( bands.at( i ).firstRow, bands.at( i ).rowCount, bands.at( i ).values ) )
+      {
+        return 1;
+      }
+      if ( feedback )
+      {
+        feedback->setProgress( 100.0 * ( bands.at( i ).firstRow + bands.at( i ).rowCount ) / static_cast< double >( mNumRows ) );
+      }
+    }
+  }
+
+  return 0;
+}
+
+void QgsGridFileWriter::interpolateRows( int firstRow, int rowCount, QVector< double > &values, bool concurrent, QgsFeedback *feedback ) const
+{
+  values.resize( rowCount * mNumColumns );
+  double *value = values.data();
+  double interpolatedValue;
+
+  for ( int i = firstRow; i < firstRow + rowCount; ++i )
+  {
+    if ( feedback && feedback->isCanceled() )
+    {
+      return;
+    }
+
+    //calculate values in the center of the cells
+    const double currentYValue = mInterpolationExtent.yMaximum() - mCellSizeY / 2.0 - i * mCellSizeY;
+    for ( int j = 0; j < mNumColumns; ++j )
+    {
+      const double currentXValue = mInterpolationExtent.xMinimum() + mCellSizeX / 2.0 + j * mCellSizeX;
+      // interpolatePoint() may be implemented in Python, it is only called from the calling thread
+      const int result = concurrent ? mInterpolator->interpolatePointConcurrently( currentXValue, currentYValue, interpolatedValue )
+                         : mInterpolator->interpolatePoint( currentXValue, currentYValue, interpolatedValue );
+      if ( result == 0 )
+      {
+        *value++ = interpolatedValue;
+      }
+      else
+      {
+        *value++ = NODATA_VALUE;
+      }
+    }
+  }
+}
+
 int QgsGridFileWriter::writeHeader( QTextStream &outStream )
 {
   outStream << "NCOLS " << mNumColumns << endl;
@@ -131,7 +277,7 @@ int QgsGridFileWriter::writeHeader( QTextStream &outStream )
     outStream << "DX " << mCellSizeX << endl;
     outStream << "DY " << mCellSizeY << endl;
   }
-  outStream << "NODATA_VALUE -9999" << endl;
+  outStream << "NODATA_VALUE " << NODATA_VALUE << endl;
 
   return 0;
 }
@@ -21,30 +21,78 @@
 #include "qgsrectangle.h"
 #include <QString>
 #include <QTextStream>
+#include <QVector>
+#include "qgis_sip.h"
 #include "qgis_analysis.h"
 
+#include <functional>
+
 class QgsInterpolator;
 class QgsFeedback;
 
 /** \ingroup analysis
- * A class that does interpolation to a grid and writes the results to an ascii grid*/
-//todo: extend such that writing to other file types is possible
+ * A class that does interpolation to a grid and writes the results to an ascii grid or a GeoTIFF file.
+ *
+ * If the interpolator supports it (i.e. for interpolators implemented in C++ such as QgsIDWInterpolator),
+ * bands of rows are interpolated in parallel and written to the file in order.
+ */
 class ANALYSIS_EXPORT QgsGridFileWriter
 {
   public:
+
+    //! Output file formats
+    enum Format
+    {
+      AsciiGrid, //!< ESRI ASCII grid, with a .prj file for the CRS
+      GeoTiff, //!< GeoTIFF, written through GDAL
+    };
+
     QgsGridFileWriter( QgsInterpolator *i, const QString &outputPath, const QgsRectangle &extent, int nCols, int nRows, double cellSizeX, double cellSizeY );
 
     /** Writes the grid file.
      \param feedback optional feedback object for progress reports and cancelation support
     \returns 0 in case of success*/
 
-    int writeFile( QgsFeedback *feedback = nullptr );
+    int writeFile( QgsFeedback *feedback = nullptr ) SIP_RELEASEGIL;
+
+    /**
+     * Sets the \a format of the output file. The default is an ASCII grid.
+     * \see format()
+     * \since QGIS 3.0
+     */
+    void setFormat( Format format ) { mFormat = format; }
+
+    /**
+     * Returns the format of the output file.
+     * \see setFormat()
+     * \since QGIS 3.0
+     */
+    Format format() const { return mFormat; }
 
   private:
 
     QgsGridFileWriter(); //forbidden
     int writeHeader( QTextStream &outStream );
 
+    int writeAsciiGrid( QgsFeedback *feedback );
+    int writeGeoTiff( QgsFeedback *feedback );
+
+    //! Returns the WKT of the CRS of the interpolated data
+    QString crsWkt() const;
+
+    /**
+     * Interpolates all rows in bands and passes the values of each band in row order to \a writeBand,
+     * which returns false if writing failed.
+     * \returns 0 in case of success, 1 if writing failed and 3 if canceled
+     */
+    int interpolateBands( QgsFeedback *feedback, const std::function< bool( int firstRow, int rowCount, const QVector< double > &values ) > &writeBand );
+
+    /**
+     * Interpolates \a rowCount rows starting at \a firstRow into \a values. If \a concurrent is true,
+     * points are interpolated with QgsInterpolator::interpolatePointConcurrently().
+     */
+    void interpolateRows( int firstRow, int rowCount, QVector< double > &values, bool concurrent, QgsFeedback *feedback ) const;
+
     QgsInterpolator *mInterpolator = nullptr;
     QString mOutputFilePath;
     QgsRectangle mInterpolationExtent;
@@ -53,6 +101,8 @@ class ANALYSIS_EXPORT QgsGridFileWriter
 
     double mCellSizeX;
     double mCellSizeY;
+
+    Format mFormat = AsciiGrid;
 };
 
 #endif
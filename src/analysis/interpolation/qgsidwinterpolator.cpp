@@ -16,42 +16,194 @@
  ***************************************************************************/
 
 #include "qgsidwinterpolator.h"
+#include <algorithm>
 #include <cmath>
 #include <limits>
+#include <vector>
 
-QgsIDWInterpolator::QgsIDWInterpolator( const QList<LayerData> &layerData ): QgsInterpolator( layerData ), mDistanceCoefficient( 2.0 )
+///@cond PRIVATE
+
+//! Data points in kd-tree ranges with at most this many points are searched linearly
+static const int KD_TREE_LEAF_SIZE = 8;
+
+/**
+ * Sorts the vertices in [ \a begin, \a end ) into an implicit kd-tree: the median vertex of a range
+ * splits it at its x (even depth) or y (odd depth) coordinate into the ranges before and after it.
+ */
+static void buildKdTree( vertexData *begin, vertexData *end, int depth )
 {
+  while ( end - begin > KD_TREE_LEAF_SIZE )
+  {
+    vertexData *mid = begin + ( end - begin ) / 2;
+    if ( depth % 2 == 0 )
+      std::nth_element( begin, mid, end, []( const vertexData & a, const vertexData & b ) { return a.x < b.x; } );
+    else
+      std::nth_element( begin, mid, end, []( const vertexData & a, const vertexData & b ) { return a.y < b.y; } );
 
+    buildKdTree( begin, mid, depth + 1 );
+    begin = mid + 1;
+    ++depth;
+  }
 }
 
-QgsIDWInterpolator::QgsIDWInterpolator(): QgsInterpolator( QList<LayerData>() ), mDistanceCoefficient( 2.0 )
+/**
+ * Search for the data points closest to a location in a kd-tree built by buildKdTree(),
+ * limited by a maximum number of points and a maximum distance.
+ */
+class QgsIdwNeighborSearch
 {
+  public:
 
-}
+    QgsIdwNeighborSearch( const vertexData *data, double x, double y, int maxCount, double maxSqrDist )
+      : mData( data )
+      , mX( x )
+      , mY( y )
+      , mMaxCount( maxCount )
+      , mMaxSqrDist( maxSqrDist )
+    {}
 
-int QgsIDWInterpolator::interpolatePoint( double x, double y, double &result )
+    void search( int begin, int end, int depth )
+    {
+      while ( end - begin > KD_TREE_LEAF_SIZE )
+      {
+        const int mid = begin + ( end - begin ) / 2;
+        consider( mid );
+
+        const double diff = depth % 2 == 0 ? mX - mData[ mid ].x : mY - mData[ mid ].y;
+        const int nearBegin = diff < 0 ? begin : mid + 1;
+        const int nearEnd = diff < 0 ? mid : end;
+        const int farBegin = diff < 0 ? mid + 1 : begin;
+        const int farEnd = diff < 0 ? end : mid;
+
+        search( nearBegin, nearEnd, depth + 1 );
+        if ( diff * diff > bound() )
+          return;
+
+        begin = farBegin;
+        end = farEnd;
+        ++depth;
+      }
+
+      for ( int i = begin; i < end; ++i )
+        consider( i );
+    }
+
+    void indexes( QVector<int> &result ) const
+    {
+      result.resize( static_cast< int >( mNeighbors.size() ) );
+      for ( int i = 0; i < result.size(); ++i )
+        result[ i ] = mNeighbors[ i ].index;
+    }
+
+  private:
+
+    struct Neighbor
+    {
+      double sqrDist;
+      int index;
+
+      bool operator<( const Neighbor &other ) const
+      {
+        return sqrDist < other.sqrDist || ( sqrDist == other.sqrDist && index < other.index );
+      }
+    };
+
+    //! Returns the squared distance beyond which points can not be neighbors anymore
+    double bound() const
+    {
+      if ( mMaxCount > 0 && static_cast< int >( mNeighbors.size() ) == mMaxCount )
+        return std::min( mNeighbors.front().sqrDist, mMaxSqrDist );
+      return mMaxSqrDist;
+    }
+
+    void consider( int index )
+    {
+      const double dx = mData[ index ].x - mX;
+      const double dy = mData[ index ].y - mY;
+      const Neighbor neighbor{ dx * dx + dy * dy, index };
+      if ( neighbor.sqrDist > mMaxSqrDist )
+        return;
+
+      if ( mMaxCount <= 0 )
+      {
+        mNeighbors.push_back( neighbor );
+      }
+      else if ( static_cast< int >( mNeighbors.size() ) < mMaxCount )
+      {
+        // max-heap, the farthest neighbor is at the front
+        mNeighbors.push_back( neighbor );
+        std::push_heap( mNeighbors.begin(), mNeighbors.end() );
+      }
+      else if ( neighbor < mNeighbors.front() )
+      {
+        std::pop_heap( mNeighbors.begin(), mNeighbors.end() );
+        mNeighbors.back() = neighbor;
+        std::push_heap( mNeighbors.begin(), mNeighbors.end() );
+      }
+    }
+
+    const vertexData *mData = nullptr;
+    double mX;
+    double mY;
+    int mMaxCount;
+    double mMaxSqrDist;
+    std::vector< Neighbor > mNeighbors;
+};
+
+//! Weight 1 / d, computed from the squared distance
+struct QgsIdwInverseDistance
 {
-  if ( !mDataIsCached )
-  {
-    cacheBaseData();
-  }
+  double operator()( double sqrDist ) const { return 1.0 / std::sqrt( sqrDist ); }
+};
+
+//! Weight 1 / d^2, computed from the squared distance
+struct QgsIdwInverseSquaredDistance
+{
+  double operator()( double sqrDist ) const { return 1.0 / sqrDist; }
+};
+
+//! Weight 1 / d^3, computed from the squared distance
+struct QgsIdwInverseCubedDistance
+{
+  double operator()( double sqrDist ) const { return 1.0 / ( sqrDist * std::sqrt( sqrDist ) ); }
+};
 
-  double currentWeight;
-  double distance;
+//! Weight 1 / d^p for any power p, computed from the squared distance
+struct QgsIdwInversePowerDistance
+{
+  explicit QgsIdwInversePowerDistance( double power )
+    : mHalfPower( 0.5 * power )
+  {}
+
+  double operator()( double sqrDist ) const { return std::pow( sqrDist, -mHalfPower ); }
+
+  double mHalfPower;
+};
 
+/**
+ * Calculates the weighted average of the first \a count data points, or of the data points
+ * listed in \a indexes if it is not null.
+ * \returns 0 in case of success
+ */
+template <typename Weight>
+static int weightedAverage( const vertexData *data, const int *indexes, int count, double x, double y, Weight weight, double &result )
+{
   double sumCounter = 0;
   double sumDenominator = 0;
 
-  Q_FOREACH ( const vertexData &vertex_it, mCachedBaseData )
+  for ( int i = 0; i < count; ++i )
   {
-    distance = std::sqrt( ( vertex_it.x - x ) * ( vertex_it.x - x ) + ( vertex_it.y - y ) * ( vertex_it.y - y ) );
-    if ( ( distance - 0 ) < std::numeric_limits<double>::min() )
+    const vertexData &vertex = data[ indexes ? indexes[ i ] : i ];
+    const double dx = vertex.x - x;
+    const double dy = vertex.y - y;
+    const double sqrDist = dx * dx + dy * dy;
+    if ( sqrDist < std::numeric_limits<double>::min() )
     {
-      result = vertex_it.z;
+      result = vertex.z;
       return 0;
     }
-    currentWeight = 1 / ( std::pow( distance, mDistanceCoefficient ) );
-    sumCounter += ( currentWeight * vertex_it.z );
+    const double currentWeight = weight( sqrDist );
+    sumCounter += currentWeight * vertex.z;
     sumDenominator += currentWeight;
   }
 
@@ -63,3 +215,81 @@ int QgsIDWInterpolator::interpolatePoint( double x, double y, double &result )
   result = sumCounter / sumDenominator;
   return 0;
 }
+
+///@endcond
+
+QgsIDWInterpolator::QgsIDWInterpolator( const QList<LayerData> &layerData ): QgsInterpolator( layerData ), mDistanceCoefficient( 2.0 )
+{
+
+}
+
+QgsIDWInterpolator::QgsIDWInterpolator(): QgsInterpolator( QList<LayerData>() ), mDistanceCoefficient( 2.0 )
+{
+
+}
+
+int QgsIDWInterpolator::cacheBaseData()
+{
+  int result = QgsInterpolator::cacheBaseData();
+  // also after errors, to avoid caching again for every interpolated point
+  mDataIsCached = true;
+  buildKdTree( mCachedBaseData.data(), mCachedBaseData.data() + mCachedBaseData.size(), 0 );
+  return result;
+}
+
+bool QgsIDWInterpolator::prepareForConcurrentInterpolation()
+{
+  if ( !mDataIsCached )
+  {
+    cacheBaseData();
+  }
+  return mConcurrentInterpolationEnabled;
+}
+
+int QgsIDWInterpolator::interpolatePointConcurrently( double x, double y, double &result ) const
+{
+  return interpolateCachedPoint( x, y, result );
+}
+
+void QgsIDWInterpolator::collectNeighbors( double x, double y, QVector<int> &indexes ) const
+{
+  const double maxSqrDist = mSearchRadius > 0 ? mSearchRadius * mSearchRadius : std::numeric_limits<double>::infinity();
+  QgsIdwNeighborSearch search( mCachedBaseData.constData(), x, y, mMaxNeighborCount, maxSqrDist );
+  search.search( 0, mCachedBaseData.size(), 0 );
+  search.indexes( indexes );
+}
+
+int QgsIDWInterpolator::interpolatePoint( double x, double y, double &result )
+{
+  if ( !mDataIsCached )
+  {
+    cacheBaseData();
+  }
+
+  return interpolateCachedPoint( x, y, result );
+}
+
+int QgsIDWInterpolator::interpolateCachedPoint( double x, double y, double &result ) const
+{
+  const vertexData *data = mCachedBaseData.constData();
+  const int *indexes = nullptr;
+  int count = mCachedBaseData.size();
+
+  QVector<int> neighbors;
+  if ( mMaxNeighborCount > 0 || mSearchRadius > 0 )
+  {
+    collectNeighbors( x, y, neighbors );
+    indexes = neighbors.constData();
+    count = neighbors.size();
+  }
+
+  // integer powers avoid std::pow for every data point
+  if ( mDistanceCoefficient == 1.0 )
+    return weightedAverage( data, indexes, count, x, y, QgsIdwInverseDistance(), result );
+  else if ( mDistanceCoefficient == 2.0 )
+    return weightedAverage( data, indexes, count, x, y, QgsIdwInverseSquaredDistance(), result );
+  else if ( mDistanceCoefficient == 3.0 )
+    return weightedAverage( data, indexes, count, x, y, QgsIdwInverseCubedDistance(), result );
+  else
+    return weightedAverage( data, indexes, count, x, y, QgsIdwInversePowerDistance( mDistanceCoefficient ), result );
+}
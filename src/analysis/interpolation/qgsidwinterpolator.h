@@ -27,7 +27,17 @@
 class ANALYSIS_EXPORT QgsIDWInterpolator: public QgsInterpolator
 {
   public:
+#ifndef SIP_RUN
     QgsIDWInterpolator( const QList<QgsInterpolator::LayerData> &layerData );
+#else
+    QgsIDWInterpolator( const QList<QgsInterpolator::LayerData> &layerData );
+    % MethodCode
+    sipCpp = new sipQgsIDWInterpolator( *a0 );
+    // Python subclasses may reimplement interpolatePoint(), which must not be bypassed by concurrent interpolation
+    if ( Py_TYPE( sipSelf ) != sipTypeAsPyTypeObject( sipType_QgsIDWInterpolator ) )
+      sipCpp->setConcurrentInterpolationEnabled( false );
+    % End
+#endif
 
     /** Calculates interpolation value for map coordinates x, y
        \param x x-coordinate (in map units)
@@ -35,9 +45,72 @@ class ANALYSIS_EXPORT QgsIDWInterpolator: public QgsInterpolator
        \param result out: interpolation result
        \returns 0 in case of success*/
     int interpolatePoint( double x, double y, double &result ) override;
+#ifndef SIP_RUN
+
+    /**
+     * Caches the base data. Interpolation only reads the cached data afterwards, so it
+     * may run concurrently, unless it was disabled with setConcurrentInterpolationEnabled().
+     */
+    bool prepareForConcurrentInterpolation() override;
+
+    int interpolatePointConcurrently( double x, double y, double &result ) const override;
+
+    /**
+     * Sets whether points may be interpolated from several threads at the same time. Subclasses
+     * reimplementing interpolatePoint() must disable it, interpolatePointConcurrently() would bypass
+     * their implementation otherwise. It is disabled for Python subclasses.
+     * \see prepareForConcurrentInterpolation()
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    void setConcurrentInterpolationEnabled( bool enabled ) { mConcurrentInterpolationEnabled = enabled; }
+#endif
 
     void setDistanceCoefficient( double p ) {mDistanceCoefficient = p;}
 
+    /**
+     * Sets the maximum number of nearest data points used to interpolate a point.
+     * A value of 0 (the default) uses all data points.
+     * \see maxNeighborCount()
+     * \see setSearchRadius()
+     * \since QGIS 3.0
+     */
+    void setMaxNeighborCount( int count ) { mMaxNeighborCount = count; }
+
+    /**
+     * Returns the maximum number of nearest data points used to interpolate a point,
+     * or 0 if all data points are used.
+     * \see setMaxNeighborCount()
+     * \since QGIS 3.0
+     */
+    int maxNeighborCount() const { return mMaxNeighborCount; }
+
+    /**
+     * Sets the radius (in map units) around an interpolated point in which data points are used.
+     * Points without any data point within the radius can not be interpolated.
+     * A value of 0 (the default) uses data points at any distance.
+     * \see searchRadius()
+     * \see setMaxNeighborCount()
+     * \since QGIS 3.0
+     */
+    void setSearchRadius( double radius ) { mSearchRadius = radius; }
+
+    /**
+     * Returns the radius (in map units) around an interpolated point in which data points are used,
+     * or 0 if data points at any distance are used.
+     * \see setSearchRadius()
+     * \since QGIS 3.0
+     */
+    double searchRadius() const { return mSearchRadius; }
+
+  protected:
+
+    /**
+     * Caches the base data and sorts it into a kd-tree, which is used for
+     * nearest neighbor and search radius queries.
+     */
+    int cacheBaseData() override;
+
   private:
 
     QgsIDWInterpolator(); //forbidden
@@ -46,6 +119,19 @@ class ANALYSIS_EXPORT QgsIDWInterpolator: public QgsInterpolator
        Smaller values mean sharper peaks at the data points. The default is a
        value of 2*/
     double mDistanceCoefficient;
+
+    int mMaxNeighborCount = 0;
+    double mSearchRadius = 0.0;
+    bool mConcurrentInterpolationEnabled = true;
+
+    /**
+     * Collects the indexes of the data points used for the point at \a x, \a y from the kd-tree
+     * into \a indexes.
+     */
+    void collectNeighbors( double x, double y, QVector<int> &indexes ) const;
+
+    //! Interpolates the point at \a x, \a y from the cached base data
+    int interpolateCachedPoint( double x, double y, double &result ) const;
 };
 
 #endif
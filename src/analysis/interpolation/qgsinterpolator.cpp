@@ -35,6 +35,14 @@ QgsInterpolator::QgsInterpolator()
 
 }
 
+int QgsInterpolator::interpolatePointConcurrently( double x, double y, double &result ) const
+{
+  Q_UNUSED( x );
+  Q_UNUSED( y );
+  Q_UNUSED( result );
+  return 1;
+}
+
 int QgsInterpolator::cacheBaseData()
 {
   if ( mLayerData.size() < 1 )
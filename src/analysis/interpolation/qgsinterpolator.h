@@ -66,6 +66,28 @@ class ANALYSIS_EXPORT QgsInterpolator
        \param result out: interpolation result
        \returns 0 in case of success*/
     virtual int interpolatePoint( double x, double y, double &result ) = 0;
+#ifndef SIP_RUN
+
+    /**
+     * Prepares the interpolator for calls of interpolatePointConcurrently() from several threads at
+     * the same time, e.g. by caching the base data.
+     * \returns true if interpolatePointConcurrently() may be called afterwards. The default
+     * implementation returns false.
+     * \note not available in Python bindings, interpolators implemented in Python are never called
+     * from several threads
+     * \since QGIS 3.0
+     */
+    virtual bool prepareForConcurrentInterpolation() { return false; }
+
+    /**
+     * Calculates the interpolation value for map coordinates x, y like interpolatePoint(). It may be
+     * called from several threads at the same time once prepareForConcurrentInterpolation() returned true.
+     * \returns 0 in case of success. The default implementation returns 1.
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    virtual int interpolatePointConcurrently( double x, double y, double &result ) const;
+#endif
 
     //! \note not available in Python bindings
     QList<LayerData> layerData() const { return mLayerData; } SIP_SKIP
@@ -73,9 +95,10 @@ class ANALYSIS_EXPORT QgsInterpolator
   protected:
 
     /** Caches the vertex and value data from the provider. All the vertex data
-     will be held in virtual memory
+     will be held in virtual memory. Subclasses may override it to build additional
+     structures (e.g. spatial indexes) from the cached data.
     \returns 0 in case of success*/
-    int cacheBaseData();
+    virtual int cacheBaseData();
 
     QVector<vertexData> mCachedBaseData;
 
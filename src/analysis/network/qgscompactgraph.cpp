@@ -0,0 +1,369 @@
+/***************************************************************************
+  qgscompactgraph.cpp
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#include "qgscompactgraph.h"
+#include "qgsgraph.h"
+#include "qgsfeedback.h"
+
+#include <QMutex>
+#include <QPair>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+///@cond PRIVATE
+
+/**
+ * Indexed 4-ary min-heap of vertices keyed by their tentative cost.
+ * Keeps the heap position of every vertex so that keys can be decreased in place.
+ */
+class QgsVertexHeap
+{
+  public:
+
+    struct Entry
+    {
+      double cost;
+      int vertex;
+    };
+
+    explicit QgsVertexHeap( int vertexCount )
+      : mPosition( vertexCount, -1 )
+    {}
+
+    bool isEmpty() const { return mHeap.empty(); }
+
+    const std::vector< Entry > &entries() const { return mHeap; }
+
+    //! Inserts \a vertex, or decreases its cost if it is already queued
+    void push( int vertex, double cost )
+    {
+      int pos = mPosition[ vertex ];
+      if ( pos < 0 )
+      {
+        pos = static_cast< int >( mHeap.size() );
+        mHeap.push_back( Entry{ cost, vertex } );
+      }
+      else
+      {
+        mHeap[ pos ].cost = cost;
+      }
+      siftUp( pos );
+    }
+
+    //! Removes all entries, keeping allocated memory for the next search
+    void clear()
+    {
+      for ( const Entry &entry : mHeap )
+        mPosition[ entry.vertex ] = -1;
+      mHeap.clear();
+    }
+
+    //! Removes and returns the entry with the lowest cost
+    Entry pop()
+    {
+      const Entry top = mHeap.front();
+      mPosition[ top.vertex ] = -1;
+      const Entry last = mHeap.back();
+      mHeap.pop_back();
+      if ( !mHeap.empty() )
+      {
+        mHeap[ 0 ] = last;
+        siftDown( 0 );
+      }
+      return top;
+    }
+
+  private:
+
+    static const int ARITY = 4;
+
+    void siftUp( int pos )
+    {
+      const Entry entry = mHeap[ pos ];
+      while ( pos > 0 )
+      {
+        const int parent = ( pos - 1 ) / ARITY;
+        if ( mHeap[ parent ].cost <= entry.cost )
+          break;
+        mHeap[ pos ] = mHeap[ parent ];
+        mPosition[ mHeap[ pos ].vertex ] = pos;
+        pos = parent;
+      }
+      mHeap[ pos ] = entry;
+      mPosition[ entry.vertex ] = pos;
+    }
+
+    void siftDown( int pos )
+    {
+      const Entry entry = mHeap[ pos ];
+      const int size = static_cast< int >( mHeap.size() );
+      while ( true )
+      {
+        const int firstChild = pos * ARITY + 1;
+        if ( firstChild >= size )
+          break;
+        const int lastChild = std::min( firstChild + ARITY, size );
+        int best = firstChild;
+        for ( int child = firstChild + 1; child < lastChild; ++child )
+        {
+          if ( mHeap[ child ].cost < mHeap[ best ].cost )
+            best = child;
+        }
+        if ( entry.cost <= mHeap[ best ].cost )
+          break;
+        mHeap[ pos ] = mHeap[ best ];
+        mPosition[ mHeap[ pos ].vertex ] = pos;
+        pos = best;
+      }
+      mHeap[ pos ] = entry;
+      mPosition[ entry.vertex ] = pos;
+    }
+
+    std::vector< Entry > mHeap;
+    std::vector< int > mPosition;
+};
+
+/**
+ * Dijkstra search over the CSR arrays of a QgsCompactGraph.
+ *
+ * \a cost must be initialized to infinity for all vertices and \a heap must be empty.
+ * \a tree and \a touched are optional, when set \a touched collects all vertices with a finite cost.
+ * \a settled is called for every settled vertex and returns false to stop the search.
+ * Vertices which are not settled when the search stops are left in \a heap.
+ */
+template <typename SettledCallback>
+static void dijkstraSearch( const int *offsets, const int *heads, const int *edgeIds, const double *edgeCosts,
+                            int startVertex, double costLimit, QgsVertexHeap &heap, double *cost, int *tree,
+                            std::vector< int > *touched, SettledCallback settled )
+{
+  const double inf = std::numeric_limits<double>::infinity();
+
+  cost[ startVertex ] = 0.0;
+  if ( touched )
+    touched->push_back( startVertex );
+  heap.push( startVertex, 0.0 );
+
+  while ( !heap.isEmpty() )
+  {
+    const QgsVertexHeap::Entry current = heap.pop();
+    if ( current.cost > costLimit )
+    {
+      // keep it queued, as it is not settled either
+      heap.push( current.vertex, current.cost );
+      break;
+    }
+    if ( !settled( current.vertex ) )
+      break;
+
+    const int end = offsets[ current.vertex + 1 ];
+    for ( int pos = offsets[ current.vertex ]; pos < end; ++pos )
+    {
+      const int head = heads[ pos ];
+      const double newCost = current.cost + edgeCosts[ pos ];
+      if ( newCost < cost[ head ] )
+      {
+        if ( touched && cost[ head ] == inf )
+          touched->push_back( head );
+        cost[ head ] = newCost;
+        if ( tree )
+          tree[ head ] = edgeIds[ pos ];
+        heap.push( head, newCost );
+      }
+    }
+  }
+}
+
+///@endcond
+
+QgsCompactGraph::QgsCompactGraph( const QgsGraph *graph, const QList<int> &strategies )
+{
+  const int vertexCount = graph->vertexCount();
+  const int edgeCount = graph->edgeCount();
+
+  // count outgoing edges of each vertex, then turn the counts into row offsets
+  mOffsets.fill( 0, vertexCount + 1 );
+  for ( int i = 0; i < edgeCount; ++i )
+  {
+    mOffsets[ graph->edge( i ).outVertex() + 1 ]++;
+  }
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    mOffsets[ i + 1 ] += mOffsets[ i ];
+  }
+
+  const int strategyCount = edgeCount > 0 ? graph->edge( 0 ).strategies().size() : 0;
+  QVector< bool > convert( strategyCount, strategies.isEmpty() );
+  Q_FOREACH ( int strategy, strategies )
+  {
+    if ( strategy >= 0 && strategy < strategyCount )
+      convert[ strategy ] = true;
+  }
+
+  mCosts.resize( strategyCount );
+  for ( int s = 0; s < strategyCount; ++s )
+  {
+    if ( convert.at( s ) )
+      mCosts[ s ].resize( edgeCount );
+  }
+  mHeads.resize( edgeCount );
+  mEdgeIds.resize( edgeCount );
+
+  // edges are visited in index order, so the edges of each vertex keep the order of QgsGraphVertex::outEdges()
+  QVector<int> next = mOffsets;
+  for ( int i = 0; i < edgeCount; ++i )
+  {
+    const QgsGraphEdge &edge = graph->edge( i );
+    const int pos = next[ edge.outVertex()]++;
+    mHeads[ pos ] = edge.inVertex();
+    mEdgeIds[ pos ] = i;
+
+    const QVector< QVariant > edgeCosts = edge.strategies();
+    for ( int s = 0; s < strategyCount; ++s )
+    {
+      if ( convert.at( s ) )
+        mCosts[ s ][ pos ] = edgeCosts.at( s ).toDouble();
+    }
+  }
+}
+
+bool QgsCompactGraph::hasStrategy( int strategyIndex ) const
+{
+  if ( strategyIndex < 0 || strategyIndex >= mCosts.size() )
+    return false;
+
+  return mCosts.at( strategyIndex ).size() == mEdgeIds.size();
+}
+
+void QgsCompactGraph::dijkstra( int startVertexIdx, int strategyIndex, QVector<int> &resultTree, QVector<double> &resultCost, int targetVertexIdx, double costLimit ) const
+{
+  const int vertexCount = this->vertexCount();
+
+  resultCost.fill( std::numeric_limits<double>::infinity(), vertexCount );
+  resultTree.fill( -1, vertexCount );
+
+  if ( startVertexIdx < 0 || startVertexIdx >= vertexCount )
+    return;
+
+  resultCost[ startVertexIdx ] = 0.0;
+
+  if ( !hasStrategy( strategyIndex ) )
+    return;
+
+  if ( costLimit < 0 )
+    costLimit = std::numeric_limits<double>::infinity();
+
+  // work on raw pointers, to avoid the detach checks of QVector::operator[] in the inner loop
+  double *cost = resultCost.data();
+  int *tree = resultTree.data();
+
+  QgsVertexHeap heap( vertexCount );
+  dijkstraSearch( mOffsets.constData(), mHeads.constData(), mEdgeIds.constData(), mCosts.at( strategyIndex ).constData(),
+                  startVertexIdx, costLimit, heap, cost, tree, nullptr,
+                  [targetVertexIdx]( int vertex ) { return vertex != targetVertexIdx; } );
+
+  // vertices still queued were not settled when the search stopped early
+  for ( const QgsVertexHeap::Entry &entry : heap.entries() )
+  {
+    cost[ entry.vertex ] = std::numeric_limits<double>::infinity();
+    tree[ entry.vertex ] = -1;
+  }
+}
+
+QVector<double> QgsCompactGraph::costMatrix( const QVector<int> &origins, const QVector<int> &destinations, int strategyIndex, QgsFeedback *feedback ) const
+{
+  const int vertexCount = this->vertexCount();
+  const int destinationCount = destinations.size();
+  QVector<double> matrix( origins.size() * destinationCount, std::numeric_limits<double>::infinity() );
+  if ( origins.isEmpty() || destinations.isEmpty() || !hasStrategy( strategyIndex ) )
+    return matrix;
+
+  // shared by all workers, a search can stop once all destination vertices are settled
+  std::vector< char > isDestination( vertexCount, 0 );
+  int uniqueDestinations = 0;
+  for ( int destination : destinations )
+  {
+    if ( destination >= 0 && destination < vertexCount && !isDestination[ destination ] )
+    {
+      isDestination[ destination ] = 1;
+      ++uniqueDestinations;
+    }
+  }
+
+  // split origins into ranges, each range is processed sequentially with its own search buffers
+  const int chunkCount = std::min( origins.size(), std::max( 1, QThread::idealThreadCount() ) * 4 );
+  QList< QPair< int, int > > chunks;
+  for ( int chunk = 0; chunk < chunkCount; ++chunk )
+  {
+    chunks << qMakePair( origins.size() * chunk / chunkCount, origins.size() * ( chunk + 1 ) / chunkCount );
+  }
+
+  const int *offsets = mOffsets.constData();
+  const int *heads = mHeads.constData();
+  const int *edgeIds = mEdgeIds.constData();
+  const double *edgeCosts = mCosts.at( strategyIndex ).constData();
+  const double inf = std::numeric_limits<double>::infinity();
+  double *result = matrix.data();
+
+  int processed = 0;
+  QMutex feedbackMutex;
+
+  auto processChunk = [&]( const QPair< int, int > &chunk )
+  {
+    QgsVertexHeap heap( vertexCount );
+    std::vector< double > cost( vertexCount, inf );
+    std::vector< int > touched;
+
+    for ( int row = chunk.first; row < chunk.second; ++row )
+    {
+      if ( feedback && feedback->isCanceled() )
+        return;
+
+      const int origin = origins.at( row );
+      if ( origin >= 0 && origin < vertexCount )
+      {
+        int remaining = uniqueDestinations;
+        dijkstraSearch( offsets, heads, edgeIds, edgeCosts, origin, inf, heap, cost.data(), nullptr, &touched,
+                        [&isDestination, &remaining]( int vertex ) { return !isDestination[ vertex ] || --remaining > 0; } );
+
+        double *rowResult = result + static_cast< qint64 >( row ) * destinationCount;
+        for ( int column = 0; column < destinationCount; ++column )
+        {
+          const int destination = destinations.at( column );
+          if ( destination >= 0 && destination < vertexCount )
+            rowResult[ column ] = cost[ destination ];
+        }
+
+        // destinations are all settled, but queued vertices may have tentative costs
+        for ( int vertex : touched )
+          cost[ vertex ] = inf;
+        touched.clear();
+        heap.clear();
+      }
+
+      if ( feedback )
+      {
+        QMutexLocker locker( &feedbackMutex );
+        ++processed;
+        feedback->setProgress( 100.0 * processed / origins.size() );
+      }
+    }
+  };
+
+  QtConcurrent::blockingMap( chunks, processChunk );
+  return matrix;
+}
@@ -0,0 +1,117 @@
+/***************************************************************************
+  qgscompactgraph.h
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSCOMPACTGRAPH_H
+#define QGSCOMPACTGRAPH_H
+
+#include <QList>
+#include <QVector>
+
+#include "qgis.h"
+#include "qgis_analysis.h"
+
+class QgsGraph;
+class QgsFeedback;
+
+/**
+ * \ingroup analysis
+ * \class QgsCompactGraph
+ * \since QGIS 3.0
+ * \brief Read-only compact copy of a QgsGraph, optimized for shortest path searches.
+ *
+ * Outgoing edges of all vertices are stored in compressed sparse row (CSR) form and
+ * the edge costs of each strategy are converted once into a contiguous array of doubles,
+ * so that searches do not need to touch QgsGraphEdge or QVariant at all.
+ *
+ * Vertex and edge indexes are the same as in the source QgsGraph. The compact graph
+ * does not keep a reference to the source graph, which may be destroyed afterwards.
+ *
+ * A QgsCompactGraph is never modified after construction, so a single instance can be
+ * shared by searches running in several threads.
+ */
+class ANALYSIS_EXPORT QgsCompactGraph
+{
+  public:
+
+    /**
+     * Constructor for QgsCompactGraph, copying the topology of \a graph.
+     * Edge costs are converted for the strategy indexes listed in \a strategies only.
+     * If the list is empty, costs are converted for all strategies of the graph.
+     */
+    explicit QgsCompactGraph( const QgsGraph *graph, const QList<int> &strategies = QList<int>() );
+
+    /**
+     * Returns number of graph vertices
+     */
+    int vertexCount() const { return mOffsets.size() - 1; }
+
+    /**
+     * Returns number of graph edges
+     */
+    int edgeCount() const { return mEdgeIds.size(); }
+
+    /**
+     * Returns true if edge costs were converted for the strategy with index \a strategyIndex,
+     * i.e. if this strategy can be used for searches.
+     */
+    bool hasStrategy( int strategyIndex ) const;
+
+    /**
+     * Solves the shortest path problem starting from \a startVertexIdx with Dijkstra algorithm,
+     * using the costs of the strategy with index \a strategyIndex.
+     *
+     * On return \a resultTree contains for each vertex the index of the edge used to
+     * reach it, or -1 if the vertex is not reachable (and for the start vertex).
+     * \a resultCost contains the cost of the path to each vertex, or infinity if it is not reachable.
+     *
+     * If \a targetVertexIdx is not -1 the search stops as soon as the path to this vertex is known.
+     * If \a costLimit is not negative the search stops once all vertices reachable at a cost not
+     * greater than \a costLimit are found. Vertices not settled by a search which stopped early
+     * are reported as not reachable.
+     */
+    void dijkstra( int startVertexIdx, int strategyIndex, QVector<int> &resultTree SIP_OUT, QVector<double> &resultCost SIP_OUT,
+                   int targetVertexIdx = -1, double costLimit = -1 ) const;
+
+    /**
+     * Calculates the costs of the shortest paths from each vertex in \a origins to each vertex
+     * in \a destinations, using the costs of the strategy with index \a strategyIndex.
+     *
+     * The searches for different origins run in parallel on the global thread pool, sharing this graph.
+     * Every worker reuses its search buffers for all origins it processes, and each search stops as
+     * soon as all destinations are reached.
+     *
+     * An optional \a feedback object can be used for progress reports and cancelation.
+     *
+     * \returns matrix of costs in row-major order, i.e. the cost from origins[i] to destinations[j] is
+     * stored at index i * destinations.size() + j. Costs of unreachable destinations, of invalid vertex
+     * indexes and of origins not processed because of cancelation are infinity.
+     */
+    QVector<double> costMatrix( const QVector<int> &origins, const QVector<int> &destinations, int strategyIndex, QgsFeedback *feedback = nullptr ) const;
+
+  private:
+
+    //! Index of the first outgoing edge of each vertex in mHeads, mEdgeIds and the cost arrays, plus end marker
+    QVector<int> mOffsets;
+
+    //! Incoming vertex of each edge, sorted by outgoing vertex
+    QVector<int> mHeads;
+
+    //! Index of each edge in the source graph
+    QVector<int> mEdgeIds;
+
+    //! Edge costs per strategy, empty for strategies which were not converted
+    QVector< QVector<double> > mCosts;
+};
+
+#endif // QGSCOMPACTGRAPH_H
@@ -0,0 +1,541 @@
+/***************************************************************************
+  qgscontractionhierarchy.cpp
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#include "qgscontractionhierarchy.h"
+#include "qgsgraph.h"
+#include "qgsfeedback.h"
+
+#include <QDataStream>
+#include <QFile>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
+//! Magic number at the start of stored indexes ("QGCH")
+static const quint32 CH_FILE_MAGIC = 0x51474348;
+//! Version of the file format of stored indexes
+static const quint32 CH_FILE_VERSION = 1;
+
+//! Maximum number of vertices settled by a single witness search
+static const int WITNESS_SETTLE_LIMIT = 500;
+
+bool QgsContractionHierarchy::build( const QgsGraph *graph, int strategyIndex, QgsFeedback *feedback )
+{
+  *this = QgsContractionHierarchy();
+
+  const int vertexCount = graph->vertexCount();
+  const int edgeCount = graph->edgeCount();
+  if ( strategyIndex < 0 || ( edgeCount > 0 && strategyIndex >= graph->edge( 0 ).strategies().size() ) )
+    return false;
+
+  const double inf = std::numeric_limits<double>::infinity();
+
+  std::vector< Arc > arcs;
+  arcs.reserve( edgeCount );
+
+  // arcs between vertices which are not contracted yet
+  std::vector< std::vector< int > > outArcs( vertexCount );
+  std::vector< std::vector< int > > inArcs( vertexCount );
+
+  // returns the arc from -> to, or -1 if there is none
+  auto findArc = [&arcs, &outArcs]( int from, int to ) -> int
+  {
+    for ( int arc : outArcs[ from ] )
+    {
+      if ( arcs[ arc ].to == to )
+        return arc;
+    }
+    return -1;
+  };
+
+  for ( int i = 0; i < edgeCount; ++i )
+  {
+    const QgsGraphEdge &edge = graph->edge( i );
+    const int from = edge.outVertex();
+    const int to = edge.inVertex();
+    // loops are never part of a shortest path
+    if ( from == to )
+      continue;
+
+    const double cost = edge.cost( strategyIndex ).toDouble();
+    const int existing = findArc( from, to );
+    if ( existing >= 0 )
+    {
+      // only the cheapest of parallel edges can be used by shortest paths
+      if ( cost < arcs[ existing ].cost )
+      {
+        arcs[ existing ].cost = cost;
+        arcs[ existing ].edgeId = i;
+      }
+      continue;
+    }
+
+    arcs.push_back( Arc{ from, to, cost, i, -1, -1 } );
+    outArcs[ from ].push_back( static_cast< int >( arcs.size() ) - 1 );
+    inArcs[ to ].push_back( static_cast< int >( arcs.size() ) - 1 );
+  }
+
+  // local Dijkstra search from source which avoids the vertex being contracted
+  std::vector< double > witnessCost( vertexCount, inf );
+  std::vector< int > touched;
+  typedef std::pair< double, int > QueueItem;
+  typedef std::priority_queue< QueueItem, std::vector< QueueItem >, std::greater< QueueItem > > Queue;
+
+  auto witnessSearch = [&]( int source, int excluded, double maxCost )
+  {
+    for ( int vertex : touched )
+      witnessCost[ vertex ] = inf;
+    touched.clear();
+
+    Queue queue;
+    witnessCost[ source ] = 0.0;
+    touched.push_back( source );
+    queue.push( QueueItem( 0.0, source ) );
+
+    int settled = 0;
+    while ( !queue.empty() )
+    {
+      const QueueItem item = queue.top();
+      queue.pop();
+      if ( item.first > witnessCost[ item.second ] )
+        continue;
+      if ( item.first > maxCost || ++settled > WITNESS_SETTLE_LIMIT )
+        break;
+
+      for ( int arc : outArcs[ item.second ] )
+      {
+        const int to = arcs[ arc ].to;
+        if ( to == excluded )
+          continue;
+
+        const double cost = item.first + arcs[ arc ].cost;
+        if ( cost < witnessCost[ to ] )
+        {
+          if ( witnessCost[ to ] == inf )
+            touched.push_back( to );
+          witnessCost[ to ] = cost;
+          queue.push( QueueItem( cost, to ) );
+        }
+      }
+    }
+  };
+
+  // returns the number of shortcuts required to contract vertex, adding them if add is true
+  auto contract = [&]( int vertex, bool add ) -> int
+  {
+    int shortcuts = 0;
+    for ( int inArc : inArcs[ vertex ] )
+    {
+      const int from = arcs[ inArc ].from;
+      const double inCost = arcs[ inArc ].cost;
+
+      double maxCost = -1;
+      for ( int outArc : outArcs[ vertex ] )
+      {
+        if ( arcs[ outArc ].to != from )
+          maxCost = std::max( maxCost, inCost + arcs[ outArc ].cost );
+      }
+      if ( maxCost < 0 )
+        continue;
+
+      witnessSearch( from, vertex, maxCost );
+
+      for ( int outArc : outArcs[ vertex ] )
+      {
+        const int to = arcs[ outArc ].to;
+        if ( to == from )
+          continue;
+
+        const double viaCost = inCost + arcs[ outArc ].cost;
+        if ( witnessCost[ to ] <= viaCost )
+          continue;
+
+        ++shortcuts;
+        if ( !add )
+          continue;
+
+        // the witness search is limited, so an existing arc may be more expensive than the path via vertex
+        const int existing = findArc( from, to );
+        if ( existing >= 0 )
+        {
+          if ( viaCost < arcs[ existing ].cost )
+          {
+            arcs[ existing ].cost = viaCost;
+            arcs[ existing ].edgeId = -1;
+            arcs[ existing ].first = inArc;
+            arcs[ existing ].second = outArc;
+          }
+        }
+        else
+        {
+          arcs.push_back( Arc{ from, to, viaCost, -1, inArc, outArc } );
+          outArcs[ from ].push_back( static_cast< int >( arcs.size() ) - 1 );
+          inArcs[ to ].push_back( static_cast< int >( arcs.size() ) - 1 );
+        }
+      }
+    }
+    return shortcuts;
+  };
+
+  // vertices adding few shortcuts and with few contracted neighbours are contracted first
+  std::vector< int > contractedNeighbours( vertexCount, 0 );
+  auto priority = [&]( int vertex ) -> int
+  {
+    const int degree = static_cast< int >( inArcs[ vertex ].size() + outArcs[ vertex ].size() );
+    return contract( vertex, false ) - degree + contractedNeighbours[ vertex ];
+  };
+
+  typedef std::pair< int, int > PriorityItem;
+  std::priority_queue< PriorityItem, std::vector< PriorityItem >, std::greater< PriorityItem > > order;
+  for ( int vertex = 0; vertex < vertexCount; ++vertex )
+  {
+    order.push( PriorityItem( priority( vertex ), vertex ) );
+    if ( feedback && vertex % 1000 == 0 )
+    {
+      if ( feedback->isCanceled() )
+        return false;
+      feedback->setProgress( 10.0 * vertex / vertexCount );
+    }
+  }
+
+  QVector<int> rank( vertexCount, -1 );
+  int nextRank = 0;
+  while ( !order.empty() )
+  {
+    const int vertex = order.top().second;
+    order.pop();
+
+    // priorities are updated lazily, contract the vertex only if it is still the least important one
+    const int currentPriority = priority( vertex );
+    if ( !order.empty() && currentPriority > order.top().first )
+    {
+      order.push( PriorityItem( currentPriority, vertex ) );
+      continue;
+    }
+
+    contract( vertex, true );
+    rank[ vertex ] = nextRank++;
+
+    // detach vertex from the remaining graph
+    for ( int arc : inArcs[ vertex ] )
+    {
+      std::vector< int > &list = outArcs[ arcs[ arc ].from ];
+      list.erase( std::remove( list.begin(), list.end(), arc ), list.end() );
+      contractedNeighbours[ arcs[ arc ].from ]++;
+    }
+    for ( int arc : outArcs[ vertex ] )
+    {
+      std::vector< int > &list = inArcs[ arcs[ arc ].to ];
+      list.erase( std::remove( list.begin(), list.end(), arc ), list.end() );
+      contractedNeighbours[ arcs[ arc ].to ]++;
+    }
+    std::vector< int >().swap( inArcs[ vertex ] );
+    std::vector< int >().swap( outArcs[ vertex ] );
+
+    if ( feedback && nextRank % 1000 == 0 )
+    {
+      if ( feedback->isCanceled() )
+        return false;
+      feedback->setProgress( 10.0 + 90.0 * nextRank / vertexCount );
+    }
+  }
+
+  mStrategyIndex = strategyIndex;
+  mSourceEdgeCount = edgeCount;
+  mRank = rank;
+  mArcs = QVector< Arc >::fromStdVector( arcs );
+  buildSearchGraph();
+  mValid = true;
+
+  if ( feedback )
+    feedback->setProgress( 100.0 );
+
+  return true;
+}
+
+int QgsContractionHierarchy::shortcutCount() const
+{
+  int count = 0;
+  for ( const Arc &arc : mArcs )
+  {
+    if ( arc.edgeId < 0 )
+      ++count;
+  }
+  return count;
+}
+
+void QgsContractionHierarchy::buildSearchGraph()
+{
+  const int vertexCount = mRank.size();
+
+  mUpOffsets.fill( 0, vertexCount + 1 );
+  mDownOffsets.fill( 0, vertexCount + 1 );
+  for ( int i = 0; i < mArcs.size(); ++i )
+  {
+    const Arc &arc = mArcs.at( i );
+    if ( mRank.at( arc.to ) > mRank.at( arc.from ) )
+      mUpOffsets[ arc.from + 1 ]++;
+    else
+      mDownOffsets[ arc.to + 1 ]++;
+  }
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    mUpOffsets[ i + 1 ] += mUpOffsets[ i ];
+    mDownOffsets[ i + 1 ] += mDownOffsets[ i ];
+  }
+
+  mUpArcs.resize( mUpOffsets.at( vertexCount ) );
+  mDownArcs.resize( mDownOffsets.at( vertexCount ) );
+  QVector<int> nextUp = mUpOffsets;
+  QVector<int> nextDown = mDownOffsets;
+  for ( int i = 0; i < mArcs.size(); ++i )
+  {
+    const Arc &arc = mArcs.at( i );
+    if ( mRank.at( arc.to ) > mRank.at( arc.from ) )
+      mUpArcs[ nextUp[ arc.from ]++ ] = i;
+    else
+      mDownArcs[ nextDown[ arc.to ]++ ] = i;
+  }
+}
+
+int QgsContractionHierarchy::search( int fromVertexIdx, int toVertexIdx, QHash<int, Label> &forward, QHash<int, Label> &backward, double &cost ) const
+{
+  cost = std::numeric_limits<double>::infinity();
+  if ( !mValid || fromVertexIdx < 0 || fromVertexIdx >= vertexCount() || toVertexIdx < 0 || toVertexIdx >= vertexCount() )
+    return -1;
+
+  typedef std::pair< double, int > QueueItem;
+  typedef std::priority_queue< QueueItem, std::vector< QueueItem >, std::greater< QueueItem > > Queue;
+  Queue forwardQueue;
+  Queue backwardQueue;
+
+  forward.insert( fromVertexIdx, Label{ 0.0, -1 } );
+  forwardQueue.push( QueueItem( 0.0, fromVertexIdx ) );
+  backward.insert( toVertexIdx, Label{ 0.0, -1 } );
+  backwardQueue.push( QueueItem( 0.0, toVertexIdx ) );
+
+  int meeting = -1;
+  bool forwardTurn = true;
+  while ( true )
+  {
+    // a direction is done once it can not lead to a cheaper path anymore
+    const bool forwardDone = forwardQueue.empty() || forwardQueue.top().first >= cost;
+    const bool backwardDone = backwardQueue.empty() || backwardQueue.top().first >= cost;
+    if ( forwardDone && backwardDone )
+      break;
+    if ( forwardDone )
+      forwardTurn = false;
+    else if ( backwardDone )
+      forwardTurn = true;
+
+    Queue &queue = forwardTurn ? forwardQueue : backwardQueue;
+    QHash<int, Label> &labels = forwardTurn ? forward : backward;
+    const QHash<int, Label> &otherLabels = forwardTurn ? backward : forward;
+    const QVector<int> &offsets = forwardTurn ? mUpOffsets : mDownOffsets;
+    const QVector<int> &searchArcs = forwardTurn ? mUpArcs : mDownArcs;
+
+    const QueueItem item = queue.top();
+    queue.pop();
+    const int vertex = item.second;
+
+    if ( item.first <= labels.value( vertex ).cost )
+    {
+      QHash<int, Label>::const_iterator other = otherLabels.constFind( vertex );
+      if ( other != otherLabels.constEnd() && item.first + other->cost < cost )
+      {
+        cost = item.first + other->cost;
+        meeting = vertex;
+      }
+
+      const int end = offsets.at( vertex + 1 );
+      for ( int i = offsets.at( vertex ); i < end; ++i )
+      {
+        const int arcIndex = searchArcs.at( i );
+        const Arc &arc = mArcs.at( arcIndex );
+        const int next = forwardTurn ? arc.to : arc.from;
+        const double nextCost = item.first + arc.cost;
+
+        QHash<int, Label>::iterator it = labels.find( next );
+        if ( it == labels.end() )
+        {
+          labels.insert( next, Label{ nextCost, arcIndex } );
+          queue.push( QueueItem( nextCost, next ) );
+        }
+        else if ( nextCost < it->cost )
+        {
+          it->cost = nextCost;
+          it->arc = arcIndex;
+          queue.push( QueueItem( nextCost, next ) );
+        }
+      }
+    }
+
+    forwardTurn = !forwardTurn;
+  }
+
+  return meeting;
+}
+
+void QgsContractionHierarchy::unpackArc( int arc, QVector<int> &edges ) const
+{
+  QVector<int> stack;
+  stack << arc;
+  while ( !stack.isEmpty() )
+  {
+    const Arc &current = mArcs.at( stack.takeLast() );
+    if ( current.edgeId >= 0 )
+    {
+      edges << current.edgeId;
+    }
+    else
+    {
+      stack << current.second << current.first;
+    }
+  }
+}
+
+double QgsContractionHierarchy::shortestPathCost( int fromVertexIdx, int toVertexIdx ) const
+{
+  QHash<int, Label> forward;
+  QHash<int, Label> backward;
+  double cost;
+  search( fromVertexIdx, toVertexIdx, forward, backward, cost );
+  return cost;
+}
+
+QVector<int> QgsContractionHierarchy::shortestPath( int fromVertexIdx, int toVertexIdx, double &cost ) const
+{
+  QHash<int, Label> forward;
+  QHash<int, Label> backward;
+  const int meeting = search( fromVertexIdx, toVertexIdx, forward, backward, cost );
+
+  QVector<int> edges;
+  if ( meeting < 0 )
+    return edges;
+
+  // arcs from the start vertex up to the meeting vertex, collected backwards
+  QVector<int> upArcs;
+  for ( int vertex = meeting; forward.value( vertex ).arc >= 0; vertex = mArcs.at( forward.value( vertex ).arc ).from )
+  {
+    upArcs << forward.value( vertex ).arc;
+  }
+  for ( int i = upArcs.size() - 1; i >= 0; --i )
+  {
+    unpackArc( upArcs.at( i ), edges );
+  }
+
+  // arcs from the meeting vertex down to the end vertex
+  for ( int vertex = meeting; backward.value( vertex ).arc >= 0; vertex = mArcs.at( backward.value( vertex ).arc ).to )
+  {
+    unpackArc( backward.value( vertex ).arc, edges );
+  }
+
+  return edges;
+}
+
+bool QgsContractionHierarchy::writeToFile( const QString &path ) const
+{
+  if ( !mValid )
+    return false;
+
+  QFile file( path );
+  if ( !file.open( QIODevice::WriteOnly ) )
+    return false;
+
+  QDataStream out( &file );
+  out.setVersion( QDataStream::Qt_5_0 );
+  out << CH_FILE_MAGIC << CH_FILE_VERSION;
+  out << static_cast< qint32 >( mStrategyIndex ) << static_cast< qint32 >( mSourceEdgeCount );
+  out << mRank;
+  out << static_cast< qint32 >( mArcs.size() );
+  for ( const Arc &arc : mArcs )
+  {
+    out << static_cast< qint32 >( arc.from ) << static_cast< qint32 >( arc.to ) << arc.cost
+        << static_cast< qint32 >( arc.edgeId ) << static_cast< qint32 >( arc.first ) << static_cast< qint32 >( arc.second );
+  }
+
+  return out.status() == QDataStream::Ok;
+}
+
+bool QgsContractionHierarchy::readFromFile( const QString &path )
+{
+  *this = QgsContractionHierarchy();
+
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QDataStream in( &file );
+  in.setVersion( QDataStream::Qt_5_0 );
+
+  quint32 magic = 0;
+  quint32 version = 0;
+  in >> magic >> version;
+  if ( magic != CH_FILE_MAGIC || version != CH_FILE_VERSION )
+    return false;
+
+  qint32 strategyIndex = -1;
+  qint32 sourceEdgeCount = 0;
+  QVector<int> rank;
+  qint32 arcCount = 0;
+  in >> strategyIndex >> sourceEdgeCount >> rank >> arcCount;
+  if ( in.status() != QDataStream::Ok || arcCount < 0 )
+    return false;
+
+  const int vertexCount = rank.size();
+  QVector< Arc > arcs( arcCount );
+  for ( int i = 0; i < arcCount; ++i )
+  {
+    qint32 from, to, edgeId, first, second;
+    double cost;
+    in >> from >> to >> cost >> edgeId >> first >> second;
+    if ( in.status() != QDataStream::Ok )
+      return false;
+
+    // refuse arcs with vertices or children out of range instead of crashing on queries
+    if ( from < 0 || from >= vertexCount || to < 0 || to >= vertexCount || edgeId >= sourceEdgeCount
+         || ( edgeId < 0 && ( first < 0 || first >= arcCount || second < 0 || second >= arcCount ) ) )
+      return false;
+
+    arcs[ i ] = Arc{ from, to, cost, edgeId, first, second };
+  }
+
+  // a shortcut replaces the path from -> middle -> to through a vertex contracted before both of
+  // its ends, so the lowest rank of the ends of its arcs is lower than its own. Refuse shortcuts
+  // which do not follow this, as cycles of shortcuts would never be unpacked.
+  for ( int i = 0; i < arcCount; ++i )
+  {
+    const Arc &arc = arcs.at( i );
+    if ( arc.edgeId >= 0 )
+      continue;
+
+    const Arc &first = arcs.at( arc.first );
+    const Arc &second = arcs.at( arc.second );
+    const int middle = first.to;
+    if ( first.from != arc.from || second.from != middle || second.to != arc.to
+         || rank.at( middle ) >= std::min( rank.at( arc.from ), rank.at( arc.to ) ) )
+      return false;
+  }
+
+  mStrategyIndex = strategyIndex;
+  mSourceEdgeCount = sourceEdgeCount;
+  mRank = rank;
+  mArcs = arcs;
+  buildSearchGraph();
+  mValid = true;
+  return true;
+}
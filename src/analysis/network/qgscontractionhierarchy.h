@@ -0,0 +1,164 @@
+/***************************************************************************
+  qgscontractionhierarchy.h
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSCONTRACTIONHIERARCHY_H
+#define QGSCONTRACTIONHIERARCHY_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include "qgis.h"
+#include "qgis_analysis.h"
+
+class QgsGraph;
+class QgsFeedback;
+
+/**
+ * \ingroup analysis
+ * \class QgsContractionHierarchy
+ * \since QGIS 3.0
+ * \brief Contraction hierarchy index for fast point to point shortest path queries on a QgsGraph.
+ *
+ * The index is built once for a graph and one of its strategies (i.e. one QgsNetworkStrategy
+ * used by the QgsGraphDirector which created the graph). Vertices are contracted one after another
+ * in order of importance, adding shortcut edges which preserve the shortest path costs between the
+ * remaining vertices. Queries then run a bidirectional search which only follows edges towards more
+ * important vertices, so that only a tiny part of the graph is visited.
+ *
+ * Query results are the same as running QgsGraphAnalyzer::dijkstra() on the source graph and
+ * paths are reported as indexes of edges of the source graph. Queries do not modify the index,
+ * so a single index may be queried from several threads at the same time.
+ *
+ * Building the index is expensive. It can be stored with writeToFile() and loaded with readFromFile()
+ * to reuse it between sessions, as long as the source graph does not change.
+ */
+class ANALYSIS_EXPORT QgsContractionHierarchy
+{
+  public:
+
+    /**
+     * Constructor for an empty, invalid QgsContractionHierarchy. Call build() or readFromFile()
+     * to create the index.
+     */
+    QgsContractionHierarchy() = default;
+
+    /**
+     * Builds the index for \a graph, using the costs of the strategy with index \a strategyIndex.
+     * An optional \a feedback object can be used for progress reports and cancelation.
+     * \returns false if the strategy index is not valid or if building was canceled
+     */
+    bool build( const QgsGraph *graph, int strategyIndex, QgsFeedback *feedback = nullptr );
+
+    /**
+     * Returns true if the index was built or read successfully.
+     */
+    bool isValid() const { return mValid; }
+
+    /**
+     * Returns the index of the strategy used for edge costs.
+     */
+    int strategyIndex() const { return mStrategyIndex; }
+
+    /**
+     * Returns number of vertices of the indexed graph.
+     */
+    int vertexCount() const { return mRank.size(); }
+
+    /**
+     * Returns number of shortcut edges added while building the index.
+     */
+    int shortcutCount() const;
+
+    /**
+     * Returns the cost of the shortest path from \a fromVertexIdx to \a toVertexIdx,
+     * or infinity if there is no path.
+     */
+    double shortestPathCost( int fromVertexIdx, int toVertexIdx ) const;
+
+    /**
+     * Returns the shortest path from \a fromVertexIdx to \a toVertexIdx as a list of
+     * indexes of edges of the source graph, ordered from start to end. The path cost is
+     * stored in \a cost and is infinity if there is no path (the returned list is empty then).
+     */
+    QVector<int> shortestPath( int fromVertexIdx, int toVertexIdx, double &cost SIP_OUT ) const;
+
+    /**
+     * Writes the index to the file at \a path.
+     * \returns true on success
+     * \see readFromFile()
+     */
+    bool writeToFile( const QString &path ) const;
+
+    /**
+     * Reads an index previously stored with writeToFile() from the file at \a path.
+     * Damaged files, e.g. with shortcuts which cannot be unpacked, are refused.
+     * \returns true on success, the index is invalid otherwise
+     * \see writeToFile()
+     */
+    bool readFromFile( const QString &path );
+
+  private:
+
+    //! Edge of the hierarchy, either an edge of the source graph or a shortcut
+    struct Arc
+    {
+      int from;
+      int to;
+      double cost;
+      //! Index of the source graph edge, or -1 for shortcuts
+      int edgeId;
+      //! Arcs replaced by a shortcut, -1 for source graph edges
+      int first;
+      int second;
+    };
+
+    //! Label of a vertex reached by a query
+    struct Label
+    {
+      double cost;
+      int arc;
+    };
+
+    bool mValid = false;
+    int mStrategyIndex = -1;
+    int mSourceEdgeCount = 0;
+
+    //! Contraction order of each vertex, higher ranked vertices are more important
+    QVector<int> mRank;
+
+    QVector<Arc> mArcs;
+
+    //! Arcs leading to higher ranked vertices, grouped by outgoing vertex in CSR form
+    QVector<int> mUpOffsets;
+    QVector<int> mUpArcs;
+
+    //! Arcs coming from higher ranked vertices, grouped by incoming vertex in CSR form
+    QVector<int> mDownOffsets;
+    QVector<int> mDownArcs;
+
+    //! Builds the upward and downward search graphs from mRank and mArcs
+    void buildSearchGraph();
+
+    /**
+     * Runs a bidirectional upward search, filling the labels of both directions.
+     * \returns the vertex where the searches meet on the shortest path, or -1 if there is no path
+     */
+    int search( int fromVertexIdx, int toVertexIdx, QHash<int, Label> &forward, QHash<int, Label> &backward, double &cost ) const;
+
+    //! Appends the source graph edges represented by \a arc to \a edges
+    void unpackArc( int arc, QVector<int> &edges ) const;
+};
+
+#endif // QGSCONTRACTIONHIERARCHY_H
@@ -13,74 +13,20 @@
 *                                                                          *
 ***************************************************************************/
 
-#include <limits>
-
-#include <QMap>
 #include <QVector>
-#include <QPair>
 
 #include "qgsgraph.h"
 #include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
 
 void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int criterionNum, QVector<int> *resultTree, QVector<double> *resultCost )
 {
-  QVector< double > *result = nullptr;
-  if ( resultCost )
-  {
-    result = resultCost;
-  }
-  else
-  {
-    result = new QVector<double>();
-  }
-
-  result->clear();
-  result->insert( result->begin(), source->vertexCount(), std::numeric_limits<double>::infinity() );
-  ( *result )[ startPointIdx ] = 0.0;
-
-  if ( resultTree )
-  {
-    resultTree->clear();
-    resultTree->insert( resultTree->begin(), source->vertexCount(), -1 );
-  }
-
-  // QMultiMap< cost, vertexIdx > not_begin
-  // I use it and don't create any struct or class
-  QMultiMap< double, int > not_begin;
-  QMultiMap< double, int >::iterator it;
+  // only the costs of the requested strategy are needed
+  const QgsCompactGraph graph( source, QList<int>() << criterionNum );
 
-  not_begin.insert( 0.0, startPointIdx );
-
-  while ( !not_begin.empty() )
-  {
-    it = not_begin.begin();
-    double curCost = it.key();
-    int curVertex = it.value();
-    not_begin.erase( it );
-
-    // edge index list
-    QgsGraphEdgeIds l = source->vertex( curVertex ).outEdges();
-    QgsGraphEdgeIds::iterator arcIt;
-    for ( arcIt = l.begin(); arcIt != l.end(); ++arcIt )
-    {
-      const QgsGraphEdge arc = source->edge( *arcIt );
-      double cost = arc.cost( criterionNum ).toDouble() + curCost;
-
-      if ( cost < ( *result )[ arc.inVertex()] )
-      {
-        ( *result )[ arc.inVertex()] = cost;
-        if ( resultTree )
-        {
-          ( *resultTree )[ arc.inVertex()] = *arcIt;
-        }
-        not_begin.insert( cost, arc.inVertex() );
-      }
-    }
-  }
-  if ( !resultCost )
-  {
-    delete result;
-  }
+  QVector<int> tree;
+  QVector<double> cost;
+  graph.dijkstra( startPointIdx, criterionNum, resultTree ? *resultTree : tree, resultCost ? *resultCost : cost );
 }
 
 QgsGraph *QgsGraphAnalyzer::shortestTree( const QgsGraph *source, int startVertexIdx, int criterionNum )
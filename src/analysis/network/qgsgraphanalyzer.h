@@ -34,6 +34,9 @@ class ANALYSIS_EXPORT QgsGraphAnalyzer
 
     /**
      * Solve shortest path problem using Dijkstra algorithm
+     *
+     * A QgsCompactGraph is built from \a source for every call. When several searches are run
+     * on the same graph it is faster to build it once and use QgsCompactGraph::dijkstra() directly.
      * \param source source graph
      * \param startVertexIdx index of the start vertex
      * \param criterionNum index of the optimization strategy
@@ -28,79 +28,145 @@
 #include "qgsgeometry.h"
 #include "qgsdistancearea.h"
 #include "qgswkbtypes.h"
+#include "qgsspatialindex.h"
 
+#include <QMultiHash>
+#include <QPair>
 #include <QString>
 #include <QtAlgorithms>
 
-/** \ingroup analysis
- * \class QgsPointCompare
+#include <cstring>
+
+///@cond PRIVATE
+
+//! Returns a hash of the exact value of \a value
+static uint hashDouble( double value )
+{
+  // adding zero turns -0.0 into 0.0, which compare equal
+  value += 0.0;
+  quint64 bits;
+  memcpy( &bits, &value, sizeof( bits ) );
+  return qHash( bits );
+}
+
+//! Line segment of the network, identified by its exact end points
+struct QgsNetworkSegment
+{
+  QgsPointXY first;
+  QgsPointXY last;
+
+  bool operator==( const QgsNetworkSegment &other ) const
+  {
+    return first.x() == other.first.x() && first.y() == other.first.y() &&
+           last.x() == other.last.x() && last.y() == other.last.y();
+  }
+
+  //! Returns the squared distance from \a point to the segment and stores the closest point in \a tiedPoint
+  double sqrDist( const QgsPointXY &point, QgsPointXY &tiedPoint ) const
+  {
+    if ( first.x() == last.x() && first.y() == last.y() )
+    {
+      tiedPoint = first;
+      return point.sqrDist( first );
+    }
+    return point.sqrDistToSegment( first.x(), first.y(), last.x(), last.y(), tiedPoint );
+  }
+};
+
+static uint qHash( const QgsNetworkSegment &segment )
+{
+  uint hash = hashDouble( segment.first.x() );
+  hash = hash * 31 + hashDouble( segment.first.y() );
+  hash = hash * 31 + hashDouble( segment.last.x() );
+  return hash * 31 + hashDouble( segment.last.y() );
+}
+
+/**
+ * Merges points into graph vertices, using a hash of grid cells with the size of the topology tolerance.
+ *
+ * A point is merged into the closest existing vertex within the tolerance, or becomes a new vertex.
+ * With a tolerance of 0 only points with equal coordinates are merged.
  */
-class QgsPointCompare
+class QgsVertexGrid
 {
   public:
-    explicit QgsPointCompare( double tolerance )
+
+    explicit QgsVertexGrid( double tolerance )
       : mTolerance( tolerance )
-    {  }
+    {}
+
+    //! Returns the index of the vertex \a point is merged into, adding a new vertex if required
+    int addPoint( const QgsPointXY &point )
+    {
+      int vertex = findVertex( point );
+      if ( vertex < 0 )
+      {
+        vertex = mVertices.size();
+        mVertices.push_back( point );
+        mCells.insert( cell( point ), vertex );
+      }
+      return vertex;
+    }
 
-    bool operator()( const QgsPointXY &p1, const QgsPointXY &p2 ) const
+    //! Returns the index of the vertex \a point was merged into, or -1 if there is none
+    int findVertex( const QgsPointXY &point ) const
     {
+      const Cell center = cell( point );
       if ( mTolerance <= 0 )
-        return p1.x() == p2.x() ? p1.y() < p2.y() : p1.x() < p2.x();
+      {
+        // cells are exact coordinates
+        return mCells.value( center, -1 );
+      }
 
-      double tx1 = std::ceil( p1.x() / mTolerance );
-      double tx2 = std::ceil( p2.x() / mTolerance );
-      if ( tx1 == tx2 )
-        return std::ceil( p1.y() / mTolerance ) < std::ceil( p2.y() / mTolerance );
-      return tx1 < tx2;
+      int closest = -1;
+      double closestDist = mTolerance * mTolerance;
+      for ( qint64 x = center.first - 1; x <= center.first + 1; ++x )
+      {
+        for ( qint64 y = center.second - 1; y <= center.second + 1; ++y )
+        {
+          const Cell key = qMakePair( x, y );
+          QMultiHash< Cell, int >::const_iterator it = mCells.constFind( key );
+          for ( ; it != mCells.constEnd() && it.key() == key; ++it )
+          {
+            const double dist = point.sqrDist( mVertices.at( it.value() ) );
+            if ( dist < closestDist || ( dist == closestDist && ( closest < 0 || it.value() < closest ) ) )
+            {
+              closest = it.value();
+              closestDist = dist;
+            }
+          }
+        }
+      }
+      return closest;
     }
 
+    const QVector< QgsPointXY > &vertices() const { return mVertices; }
+
   private:
-    double mTolerance;
-};
 
-template <typename RandIter, typename Type, typename CompareOp > RandIter my_binary_search( RandIter begin, RandIter end, Type val, CompareOp comp )
-{
-  // result if not found
-  RandIter not_found = end;
+    typedef QPair< qint64, qint64 > Cell;
 
-  while ( true )
-  {
-    RandIter avg = begin + ( end - begin ) / 2;
-    if ( begin == avg || end == avg )
+    Cell cell( const QgsPointXY &point ) const
     {
-      if ( !comp( *begin, val ) && !comp( val, *begin ) )
-        return begin;
-      if ( !comp( *end, val ) && !comp( val, *end ) )
-        return end;
-
-      return not_found;
+      if ( mTolerance <= 0 )
+      {
+        double x = point.x() + 0.0;
+        double y = point.y() + 0.0;
+        qint64 cellX, cellY;
+        memcpy( &cellX, &x, sizeof( cellX ) );
+        memcpy( &cellY, &y, sizeof( cellY ) );
+        return qMakePair( cellX, cellY );
+      }
+      return qMakePair( static_cast< qint64 >( std::floor( point.x() / mTolerance ) ),
+                        static_cast< qint64 >( std::floor( point.y() / mTolerance ) ) );
     }
-    if ( comp( val, *avg ) )
-      end = avg;
-    else if ( comp( *avg, val ) )
-      begin = avg;
-    else
-      return avg;
-  }
 
-  return not_found;
-}
-
-struct TiePointInfo
-{
-  QgsPointXY mTiedPoint;
-  double mLength;
-  QgsPointXY mFirstPoint;
-  QgsPointXY mLastPoint;
+    double mTolerance;
+    QVector< QgsPointXY > mVertices;
+    QMultiHash< Cell, int > mCells;
 };
 
-bool TiePointInfoCompare( const TiePointInfo &a, const TiePointInfo &b )
-{
-  if ( a.mFirstPoint == b.mFirstPoint )
-    return a.mLastPoint.x() == b.mLastPoint.x() ? a.mLastPoint.y() < b.mLastPoint.y() : a.mLastPoint.x() < b.mLastPoint.x();
-
-  return a.mFirstPoint.x() == b.mFirstPoint.x() ? a.mFirstPoint.y() < b.mFirstPoint.y() : a.mFirstPoint.x() < b.mFirstPoint.x();
-}
+///@endcond
 
 QgsVectorLayerDirector::QgsVectorLayerDirector( QgsFeatureSource *source,
     int directionFieldId,
@@ -126,7 +192,7 @@ QString QgsVectorLayerDirector::name() const
 void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const QVector< QgsPointXY > &additionalPoints,
                                         QVector< QgsPointXY > &snappedPoints, QgsFeedback *feedback ) const
 {
-  int featureCount = ( int ) mSource->featureCount() * 2;
+  int featureCount = ( int ) mSource->featureCount() * 2 + additionalPoints.size();
   int step = 0;
 
   QgsCoordinateTransform ct;
@@ -142,18 +208,16 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
 
   snappedPoints = QVector< QgsPointXY >( additionalPoints.size(), QgsPointXY( 0.0, 0.0 ) );
 
-  TiePointInfo tmpInfo;
-  tmpInfo.mLength = std::numeric_limits<double>::infinity();
-
-  QVector< TiePointInfo > pointLengthMap( additionalPoints.size(), tmpInfo );
-  QVector< TiePointInfo >::iterator pointLengthIt;
+  // graph's points, merged within the topology tolerance
+  QgsVertexGrid vertexGrid( builder->topologyTolerance() );
 
-  //Graph's points;
-  QVector< QgsPointXY > points;
+  // all segments of the network, indexed by their position in the vector
+  QVector< QgsNetworkSegment > segments;
+  QgsSpatialIndex segmentIndex;
 
   QgsFeatureIterator fit = mSource->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) );
 
-  // begin: tie points to the graph
+  // begin: collect network segments
   QgsAttributeList la;
   QgsFeature feature;
   while ( fit.nextFeature( feature ) )
@@ -178,35 +242,15 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
       for ( pointIt = mplIt->begin(); pointIt != mplIt->end(); ++pointIt )
       {
         pt2 = ct.transform( *pointIt );
-        points.push_back( pt2 );
+        vertexGrid.addPoint( pt2 );
 
-        if ( !isFirstPoint )
+        if ( !isFirstPoint && !additionalPoints.isEmpty() )
         {
-          int i = 0;
-          for ( i = 0; i != additionalPoints.size(); ++i )
-          {
-            TiePointInfo info;
-            if ( pt1 == pt2 )
-            {
-              info.mLength = additionalPoints[ i ].sqrDist( pt1 );
-              info.mTiedPoint = pt1;
-            }
-            else
-            {
-              info.mLength = additionalPoints[ i ].sqrDistToSegment( pt1.x(), pt1.y(),
-                             pt2.x(), pt2.y(), info.mTiedPoint );
-            }
-
-            if ( pointLengthMap[ i ].mLength > info.mLength )
-            {
-              Q_UNUSED( info.mTiedPoint );
-              info.mFirstPoint = pt1;
-              info.mLastPoint = pt2;
-
-              pointLengthMap[ i ] = info;
-              snappedPoints[ i ] = info.mTiedPoint;
-            }
-          }
+          QgsNetworkSegment segment;
+          segment.first = pt1;
+          segment.last = pt2;
+          segmentIndex.insertFeature( segments.size(), QgsRectangle( pt1, pt2 ) );
+          segments.push_back( segment );
         }
         pt1 = pt2;
         isFirstPoint = false;
@@ -218,32 +262,71 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
     }
 
   }
+  // end: collect network segments
+
+  // begin: tie points to the graph
+  // points tied to each segment, a segment may occur in several features
+  QMultiHash< QgsNetworkSegment, QgsPointXY > tiedPoints;
+  int i = 0;
+  for ( i = 0; i < additionalPoints.size(); ++i )
+  {
+    if ( feedback && feedback->isCanceled() )
+    {
+      return;
+    }
+
+    const QgsPointXY &point = additionalPoints.at( i );
+
+    // the segment with the nearest bounding box gives an upper bound for the distance to the closest segment,
+    // which can only be one of the segments with a bounding box within that distance
+    const QList< QgsFeatureId > nearest = segmentIndex.nearestNeighbor( point, 1 );
+    if ( !nearest.isEmpty() )
+    {
+      int closest = static_cast< int >( nearest.at( 0 ) );
+      QgsPointXY tiedPoint;
+      double closestDist = segments.at( closest ).sqrDist( point, tiedPoint );
+
+      const double radius = std::sqrt( closestDist );
+      const QgsRectangle searchRect( point.x() - radius, point.y() - radius, point.x() + radius, point.y() + radius );
+      Q_FOREACH ( QgsFeatureId id, segmentIndex.intersects( searchRect ) )
+      {
+        QgsPointXY candidate;
+        const double dist = segments.at( id ).sqrDist( point, candidate );
+        // prefer the first segment of the layer for equally close segments
+        if ( dist < closestDist || ( dist == closestDist && id < closest ) )
+        {
+          closest = static_cast< int >( id );
+          closestDist = dist;
+          tiedPoint = candidate;
+        }
+      }
+
+      snappedPoints[ i ] = tiedPoint;
+      tiedPoints.insert( segments.at( closest ), tiedPoint );
+    }
+
+    if ( feedback )
+    {
+      feedback->setProgress( 100.0 * static_cast< double >( ++step ) / featureCount );
+    }
+  }
+  segments.clear();
+  segmentIndex = QgsSpatialIndex();
   // end: tie points to graph
 
   // add tied point to graph
-  int i = 0;
   for ( i = 0; i < snappedPoints.size(); ++i )
   {
     if ( snappedPoints[ i ] != QgsPointXY( 0.0, 0.0 ) )
     {
-      points.push_back( snappedPoints [ i ] );
+      snappedPoints[ i ] = vertexGrid.vertices().at( vertexGrid.addPoint( snappedPoints[ i ] ) );
     }
   }
 
-  QgsPointCompare pointCompare( builder->topologyTolerance() );
-
-  std::sort( points.begin(), points.end(), pointCompare );
-  QVector< QgsPointXY >::iterator tmp = std::unique( points.begin(), points.end() );
-  points.resize( tmp - points.begin() );
-
+  const QVector< QgsPointXY > &points = vertexGrid.vertices();
   for ( i = 0; i < points.size(); ++i )
     builder->addVertex( i, points[ i ] );
 
-  for ( i = 0; i < snappedPoints.size() ; ++i )
-    snappedPoints[ i ] = *( my_binary_search( points.begin(), points.end(), snappedPoints[ i ], pointCompare ) );
-
-  std::sort( pointLengthMap.begin(), pointLengthMap.end(), TiePointInfoCompare );
-
   {
     // fill attribute list 'la'
     QgsAttributeList tmpAttr;
@@ -329,29 +412,13 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
           pointsOnArc[ 0.0 ] = pt1;
           pointsOnArc[ pt1.sqrDist( pt2 )] = pt2;
 
-          TiePointInfo t;
-          t.mFirstPoint = pt1;
-          t.mLastPoint  = pt2;
-          t.mLength = 0.0;
-          pointLengthIt = my_binary_search( pointLengthMap.begin(), pointLengthMap.end(), t, TiePointInfoCompare );
-
-          if ( pointLengthIt != pointLengthMap.end() )
+          QgsNetworkSegment segment;
+          segment.first = pt1;
+          segment.last = pt2;
+          QMultiHash< QgsNetworkSegment, QgsPointXY >::const_iterator tiedIt = tiedPoints.constFind( segment );
+          for ( ; tiedIt != tiedPoints.constEnd() && tiedIt.key() == segment; ++tiedIt )
           {
-            QVector< TiePointInfo >::iterator it;
-            for ( it = pointLengthIt; it - pointLengthMap.begin() >= 0; --it )
-            {
-              if ( it->mFirstPoint == pt1 && it->mLastPoint == pt2 )
-              {
-                pointsOnArc[ pt1.sqrDist( it->mTiedPoint )] = it->mTiedPoint;
-              }
-            }
-            for ( it = pointLengthIt + 1; it != pointLengthMap.end(); ++it )
-            {
-              if ( it->mFirstPoint == pt1 && it->mLastPoint == pt2 )
-              {
-                pointsOnArc[ pt1.sqrDist( it->mTiedPoint )] = it->mTiedPoint;
-              }
-            }
+            pointsOnArc[ pt1.sqrDist( *tiedIt )] = *tiedIt;
           }
 
           QMap< double, QgsPointXY >::iterator pointsIt;
@@ -361,10 +428,10 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
           bool isFirstPoint = true;
           for ( pointsIt = pointsOnArc.begin(); pointsIt != pointsOnArc.end(); ++pointsIt )
           {
-            pt2 = *pointsIt;
-            tmp = my_binary_search( points.begin(), points.end(), pt2, pointCompare );
-            pt2 = *tmp;
-            pt2idx = tmp - points.begin();
+            pt2idx = vertexGrid.findVertex( *pointsIt );
+            if ( pt2idx < 0 )
+              continue;
+            pt2 = points.at( pt2idx );
 
             if ( !isFirstPoint && pt1 != pt2 )
             {
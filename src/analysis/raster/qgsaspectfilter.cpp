@@ -17,6 +17,21 @@
 
 #include "qgsaspectfilter.h"
 #include <cmath>
+#include <vector>
+
+static inline float aspect( float derX, float derY, float outputNodata )
+{
+  if ( derX == outputNodata ||
+       derY == outputNodata ||
+       ( derX == 0.0 && derY == 0.0 ) )
+  {
+    return outputNodata;
+  }
+  else
+  {
+    return 180.0 + std::atan2( derX, derY ) * 180.0 / M_PI;
+  }
+}
 
 QgsAspectFilter::QgsAspectFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat )
   : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
@@ -31,16 +46,24 @@ float QgsAspectFilter::processNineCellWindow(
 {
   float derX = calcFirstDerX( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
   float derY = calcFirstDerY( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+  return aspect( derX, derY, mOutputNodataValue );
+}
 
-  if ( derX == mOutputNodataValue ||
-       derY == mOutputNodataValue ||
-       ( derX == 0.0 && derY == 0.0 ) )
-  {
-    return mOutputNodataValue;
-  }
-  else
+bool QgsAspectFilter::processBlocksInParallel() const
+{
+  return true;
+}
+
+void QgsAspectFilter::processBlock( const float *inputBlock, float *outputBlock, int columns, int rows )
+{
+  const int count = columns * rows;
+  std::vector< float > derX( count );
+  std::vector< float > derY( count );
+  calcFirstDerivatives( inputBlock, columns, rows, derX.data(), derY.data() );
+
+  for ( int i = 0; i < count; ++i )
   {
-    return 180.0 + std::atan2( derX, derY ) * 180.0 / M_PI;
+    outputBlock[i] = aspect( derX[i], derY[i], mOutputNodataValue );
   }
 }
 
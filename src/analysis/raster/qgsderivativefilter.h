@@ -38,6 +38,16 @@ class ANALYSIS_EXPORT QgsDerivativeFilter : public QgsNineCellFilter
     float calcFirstDerX( float *x11, float *x21, float *x31, float *x12, float *x22, float *x32, float *x13, float *x23, float *x33 );
     //! Calculates the first order derivative in y-direction according to Horn (1981)
     float calcFirstDerY( float *x11, float *x21, float *x31, float *x12, float *x22, float *x32, float *x13, float *x23, float *x33 );
+#ifndef SIP_RUN
+
+    /**
+     * Calculates the first order derivatives in x- and y-direction for all cells of a block, see
+     * processBlock() for the layout of \a inputBlock. The derivatives are stored row by row in \a derX
+     * and \a derY, which must have room for \a columns * \a rows values.
+     * \since QGIS 3.0
+     */
+    void calcFirstDerivatives( const float *inputBlock, int columns, int rows, float *derX, float *derY ) const;
+#endif
 };
 
 #endif // QGSDERIVATIVEFILTER_H
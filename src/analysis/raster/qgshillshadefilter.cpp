@@ -17,6 +17,27 @@
 
 #include "qgshillshadefilter.h"
 #include <cmath>
+#include <vector>
+
+static inline float hillshade( float derX, float derY, float outputNodata, float zenith_rad, float azimuth_rad )
+{
+  if ( derX == outputNodata || derY == outputNodata )
+  {
+    return outputNodata;
+  }
+
+  float slope_rad = std::atan( std::sqrt( derX * derX + derY * derY ) );
+  float aspect_rad = 0;
+  if ( derX == 0 && derY == 0 ) //aspect undefined, take a neutral value. Better solutions?
+  {
+    aspect_rad = azimuth_rad / 2.0;
+  }
+  else
+  {
+    aspect_rad = M_PI + std::atan2( derX, derY );
+  }
+  return std::max( 0.0, 255.0 * ( ( std::cos( zenith_rad ) * std::cos( slope_rad ) ) + ( std::sin( zenith_rad ) * std::sin( slope_rad ) * std::cos( azimuth_rad - aspect_rad ) ) ) );
+}
 
 QgsHillshadeFilter::QgsHillshadeFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat, double lightAzimuth,
                                         double lightAngle )
@@ -32,23 +53,25 @@ float QgsHillshadeFilter::processNineCellWindow( float *x11, float *x21, float *
 {
   float derX = calcFirstDerX( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
   float derY = calcFirstDerY( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+  return hillshade( derX, derY, mOutputNodataValue, mLightAngle * M_PI / 180.0, mLightAzimuth * M_PI / 180.0 );
+}
 
-  if ( derX == mOutputNodataValue || derY == mOutputNodataValue )
-  {
-    return mOutputNodataValue;
-  }
+bool QgsHillshadeFilter::processBlocksInParallel() const
+{
+  return true;
+}
 
-  float zenith_rad = mLightAngle * M_PI / 180.0;
-  float slope_rad = std::atan( std::sqrt( derX * derX + derY * derY ) );
-  float azimuth_rad = mLightAzimuth * M_PI / 180.0;
-  float aspect_rad = 0;
-  if ( derX == 0 && derY == 0 ) //aspect undefined, take a neutral value. Better solutions?
-  {
-    aspect_rad = azimuth_rad / 2.0;
-  }
-  else
+void QgsHillshadeFilter::processBlock( const float *inputBlock, float *outputBlock, int columns, int rows )
+{
+  const int count = columns * rows;
+  std::vector< float > derX( count );
+  std::vector< float > derY( count );
+  calcFirstDerivatives( inputBlock, columns, rows, derX.data(), derY.data() );
+
+  const float zenith_rad = mLightAngle * M_PI / 180.0;
+  const float azimuth_rad = mLightAzimuth * M_PI / 180.0;
+  for ( int i = 0; i < count; ++i )
   {
-    aspect_rad = M_PI + std::atan2( derX, derY );
+    outputBlock[i] = hillshade( derX[i], derY[i], mOutputNodataValue, zenith_rad, azimuth_rad );
   }
-  return std::max( 0.0, 255.0 * ( ( std::cos( zenith_rad ) * std::cos( slope_rad ) ) + ( std::sin( zenith_rad ) * std::sin( slope_rad ) * std::cos( azimuth_rad - aspect_rad ) ) ) );
 }
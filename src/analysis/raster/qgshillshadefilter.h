@@ -40,6 +40,12 @@ class ANALYSIS_EXPORT QgsHillshadeFilter: public QgsDerivativeFilter
     void setLightAzimuth( float azimuth ) { mLightAzimuth = azimuth; }
     float lightAngle() const { return mLightAngle; }
     void setLightAngle( float angle ) { mLightAngle = angle; }
+#ifndef SIP_RUN
+  protected:
+
+    void processBlock( const float *inputBlock, float *outputBlock, int columns, int rows ) override;
+    bool processBlocksInParallel() const override;
+#endif
 
   private:
     float mLightAzimuth;
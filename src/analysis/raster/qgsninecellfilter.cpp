@@ -20,6 +20,13 @@
 #include "cpl_string.h"
 #include "qgsfeedback.h"
 #include <QFile>
+#include <QPair>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <vector>
 
 QgsNineCellFilter::QgsNineCellFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat )
   : mInputFile( inputFile )
@@ -96,15 +103,22 @@ int QgsNineCellFilter::processRaster( QgsFeedback *feedback )
     return 6;
   }
 
-  //keep only three scanlines in memory at a time
-  float *scanLine1 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float *scanLine2 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float *scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-
-  float *resultLine = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-
-  //values outside the layer extent (if the 3x3 window is on the border) are sent to the processing method as (input) nodata values
-  for ( int i = 0; i < ySize; ++i )
+  //rows are processed in batches, which are read and written at once. Each batch is split into
+  //blocks of roughly 256k cells, which are processed in parallel if the filter supports it
+  const bool parallel = processBlocksInParallel();
+  const int rowsPerBlock = std::max( 1, 262144 / xSize );
+  const int blocksPerBatch = std::max( 1, QThread::idealThreadCount() ) * 2;
+  const int rowsPerBatch = rowsPerBlock * blocksPerBatch;
+
+  //the input buffer has one additional row above and below the batch and one additional column on both
+  //sides. Values outside the layer extent (if the 3x3 window is on the border) are sent to the processing
+  //method as (input) nodata values
+  const int lineLength = xSize + 2;
+  std::vector< float > inputBuffer;
+  std::vector< float > outputBuffer;
+  QVector< QPair< int, int > > blocks;
+
+  for ( int firstRow = 0; firstRow < ySize; firstRow += rowsPerBatch )
   {
     if ( feedback && feedback->isCanceled() )
     {
@@ -113,75 +127,50 @@ int QgsNineCellFilter::processRaster( QgsFeedback *feedback )
 
     if ( feedback )
     {
-      feedback->setProgress( 100.0 * static_cast< double >( i ) / ySize );
+      feedback->setProgress( 100.0 * static_cast< double >( firstRow ) / ySize );
     }
 
-    if ( i == 0 )
+    const int batchRows = std::min( rowsPerBatch, ySize - firstRow );
+    inputBuffer.assign( static_cast< size_t >( batchRows + 2 ) * lineLength, mInputNodataValue );
+    outputBuffer.resize( static_cast< size_t >( batchRows ) * xSize );
+
+    const int readFirstRow = std::max( 0, firstRow - 1 );
+    const int readLastRow = std::min( ySize - 1, firstRow + batchRows );
+    const int readRows = readLastRow - readFirstRow + 1;
+    float *readTarget = inputBuffer.data() + static_cast< size_t >( readFirstRow - firstRow + 1 ) * lineLength + 1;
+    if ( GDALRasterIO( rasterBand, GF_Read, 0, readFirstRow, xSize, readRows, readTarget, xSize, readRows, GDT_Float32,
+                       sizeof( float ), sizeof( float ) * lineLength ) != CE_None )
     {
-      //fill scanline 1 with (input) nodata for the values above the first row and feed scanline2 with the first row
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine1[a] = mInputNodataValue;
-      }
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, 0, xSize, 1, scanLine2, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
-      {
-        QgsDebugMsg( "Raster IO Error" );
-      }
+      QgsDebugMsg( "Raster IO Error" );
     }
-    else
+
+    blocks.clear();
+    for ( int blockRow = 0; blockRow < batchRows; blockRow += rowsPerBlock )
     {
-      //normally fetch only scanLine3 and release scanline 1 if we move forward one row
-      CPLFree( scanLine1 );
-      scanLine1 = scanLine2;
-      scanLine2 = scanLine3;
-      scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
+      blocks << qMakePair( blockRow, std::min( rowsPerBlock, batchRows - blockRow ) );
     }
 
-    if ( i == ySize - 1 ) //fill the row below the bottom with nodata values
+    const float *input = inputBuffer.data();
+    float *output = outputBuffer.data();
+    auto processRows = [this, input, output, xSize, lineLength]( const QPair< int, int > &block )
     {
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine3[a] = mInputNodataValue;
-      }
-    }
-    else
+      processBlock( input + static_cast< size_t >( block.first ) * lineLength, output + static_cast< size_t >( block.first ) * xSize, xSize, block.second );
+    };
+    if ( parallel )
     {
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, i + 1, xSize, 1, scanLine3, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
-      {
-        QgsDebugMsg( "Raster IO Error" );
-      }
+      QtConcurrent::blockingMap( blocks, processRows );
     }
-
-    for ( int j = 0; j < xSize; ++j )
+    else
     {
-      if ( j == 0 )
-      {
-        resultLine[j] = processNineCellWindow( &mInputNodataValue, &scanLine1[j], &scanLine1[j + 1], &mInputNodataValue, &scanLine2[j],
-                                               &scanLine2[j + 1], &mInputNodataValue, &scanLine3[j], &scanLine3[j + 1] );
-      }
-      else if ( j == xSize - 1 )
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j - 1], &scanLine1[j], &mInputNodataValue, &scanLine2[j - 1], &scanLine2[j],
-                                               &mInputNodataValue, &scanLine3[j - 1], &scanLine3[j], &mInputNodataValue );
-      }
-      else
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j - 1], &scanLine1[j], &scanLine1[j + 1], &scanLine2[j - 1], &scanLine2[j],
-                                               &scanLine2[j + 1], &scanLine3[j - 1], &scanLine3[j], &scanLine3[j + 1] );
-      }
+      std::for_each( blocks.constBegin(), blocks.constEnd(), processRows );
     }
 
-    if ( GDALRasterIO( outputRasterBand, GF_Write, 0, i, xSize, 1, resultLine, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
+    if ( GDALRasterIO( outputRasterBand, GF_Write, 0, firstRow, xSize, batchRows, output, xSize, batchRows, GDT_Float32, 0, 0 ) != CE_None )
     {
       QgsDebugMsg( "Raster IO Error" );
     }
   }
 
-  CPLFree( resultLine );
-  CPLFree( scanLine1 );
-  CPLFree( scanLine2 );
-  CPLFree( scanLine3 );
-
   GDALClose( inputDataset );
 
   if ( feedback && feedback->isCanceled() )
@@ -195,6 +184,30 @@ int QgsNineCellFilter::processRaster( QgsFeedback *feedback )
   return 0;
 }
 
+void QgsNineCellFilter::processBlock( const float *inputBlock, float *outputBlock, int columns, int rows )
+{
+  const int lineLength = columns + 2;
+  for ( int i = 0; i < rows; ++i )
+  {
+    //processNineCellWindow() does not modify the input values
+    float *line1 = const_cast< float * >( inputBlock ) + static_cast< size_t >( i ) * lineLength;
+    float *line2 = line1 + lineLength;
+    float *line3 = line2 + lineLength;
+    float *result = outputBlock + static_cast< size_t >( i ) * columns;
+    for ( int j = 0; j < columns; ++j )
+    {
+      result[j] = processNineCellWindow( &line1[j], &line1[j + 1], &line1[j + 2],
+                                         &line2[j], &line2[j + 1], &line2[j + 2],
+                                         &line3[j], &line3[j + 1], &line3[j + 2] );
+    }
+  }
+}
+
+bool QgsNineCellFilter::processBlocksInParallel() const
+{
+  return false;
+}
+
 GDALDatasetH QgsNineCellFilter::openInputFile( int &nCellsX, int &nCellsY )
 {
   GDALDatasetH inputDataset = GDALOpen( mInputFile.toUtf8().constData(), GA_ReadOnly );
@@ -21,6 +21,7 @@
 #include <QString>
 #include "gdal.h"
 #include "qgis_analysis.h"
+#include "qgis_sip.h"
 
 class QgsFeedback;
 
@@ -76,6 +77,30 @@ class ANALYSIS_EXPORT QgsNineCellFilter
     GDALDatasetH openOutputFile( GDALDatasetH inputDataset, GDALDriverH outputDriver );
 
   protected:
+#ifndef SIP_RUN
+
+    /**
+     * Calculates the output values of a block of \a rows x \a columns cells and stores them row by row
+     * in \a outputBlock. \a inputBlock contains the input values of the block with a border of one cell,
+     * i.e. \a rows + 2 lines of \a columns + 2 values, where cells outside of the raster are set to the
+     * input nodata value.
+     *
+     * The default implementation calls processNineCellWindow() for each cell. Subclasses can reimplement it
+     * with a loop over a kernel which can be inlined and vectorized by the compiler.
+     * \see processBlocksInParallel()
+     * \since QGIS 3.0
+     */
+    virtual void processBlock( const float *inputBlock, float *outputBlock, int columns, int rows );
+
+    /**
+     * Returns true if the blocks of rows may be passed to processBlock() from several threads at once.
+     * The default implementation returns false and the blocks are processed one after the other, as
+     * processNineCellWindow() may be implemented in Python or modify the filter. Subclasses whose
+     * processBlock() only reads the filter settings can return true.
+     * \since QGIS 3.0
+     */
+    virtual bool processBlocksInParallel() const;
+#endif
 
     QString mInputFile;
     QString mOutputFile;
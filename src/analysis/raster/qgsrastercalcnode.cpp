@@ -16,6 +16,98 @@
 #include "qgsrasterblock.h"
 #include "qgsrastermatrix.h"
 #include <cfloat>
+#include <algorithm>
+#include <vector>
+
+//! Number of cells evaluated at once by compiled expressions, small enough to keep intermediate results in cache
+static const int CALCULATION_CHUNK_SIZE = 1024;
+
+static bool toTwoArgumentOperator( QgsRasterCalcNode::Operator op, QgsRasterMatrix::TwoArgOperator &matrixOp )
+{
+  switch ( op )
+  {
+    case QgsRasterCalcNode::opPLUS:
+      matrixOp = QgsRasterMatrix::opPLUS;
+      return true;
+    case QgsRasterCalcNode::opMINUS:
+      matrixOp = QgsRasterMatrix::opMINUS;
+      return true;
+    case QgsRasterCalcNode::opMUL:
+      matrixOp = QgsRasterMatrix::opMUL;
+      return true;
+    case QgsRasterCalcNode::opDIV:
+      matrixOp = QgsRasterMatrix::opDIV;
+      return true;
+    case QgsRasterCalcNode::opPOW:
+      matrixOp = QgsRasterMatrix::opPOW;
+      return true;
+    case QgsRasterCalcNode::opEQ:
+      matrixOp = QgsRasterMatrix::opEQ;
+      return true;
+    case QgsRasterCalcNode::opNE:
+      matrixOp = QgsRasterMatrix::opNE;
+      return true;
+    case QgsRasterCalcNode::opGT:
+      matrixOp = QgsRasterMatrix::opGT;
+      return true;
+    case QgsRasterCalcNode::opLT:
+      matrixOp = QgsRasterMatrix::opLT;
+      return true;
+    case QgsRasterCalcNode::opGE:
+      matrixOp = QgsRasterMatrix::opGE;
+      return true;
+    case QgsRasterCalcNode::opLE:
+      matrixOp = QgsRasterMatrix::opLE;
+      return true;
+    case QgsRasterCalcNode::opAND:
+      matrixOp = QgsRasterMatrix::opAND;
+      return true;
+    case QgsRasterCalcNode::opOR:
+      matrixOp = QgsRasterMatrix::opOR;
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool toOneArgumentOperator( QgsRasterCalcNode::Operator op, QgsRasterMatrix::OneArgOperator &matrixOp )
+{
+  switch ( op )
+  {
+    case QgsRasterCalcNode::opSQRT:
+      matrixOp = QgsRasterMatrix::opSQRT;
+      return true;
+    case QgsRasterCalcNode::opSIN:
+      matrixOp = QgsRasterMatrix::opSIN;
+      return true;
+    case QgsRasterCalcNode::opCOS:
+      matrixOp = QgsRasterMatrix::opCOS;
+      return true;
+    case QgsRasterCalcNode::opTAN:
+      matrixOp = QgsRasterMatrix::opTAN;
+      return true;
+    case QgsRasterCalcNode::opASIN:
+      matrixOp = QgsRasterMatrix::opASIN;
+      return true;
+    case QgsRasterCalcNode::opACOS:
+      matrixOp = QgsRasterMatrix::opACOS;
+      return true;
+    case QgsRasterCalcNode::opATAN:
+      matrixOp = QgsRasterMatrix::opATAN;
+      return true;
+    case QgsRasterCalcNode::opSIGN:
+      matrixOp = QgsRasterMatrix::opSIGN;
+      return true;
+    case QgsRasterCalcNode::opLOG:
+      matrixOp = QgsRasterMatrix::opLOG;
+      return true;
+    case QgsRasterCalcNode::opLOG10:
+      matrixOp = QgsRasterMatrix::opLOG10;
+      return true;
+    default:
+      return false;
+  }
+}
 
 QgsRasterCalcNode::QgsRasterCalcNode()
   : mType( tNumber )
@@ -84,6 +176,167 @@ QgsRasterCalcNode::~QgsRasterCalcNode()
 }
 
 bool QgsRasterCalcNode::calculate( QMap<QString, QgsRasterBlock * > &rasterData, QgsRasterMatrix &result, int row ) const
+{
+  QVector< const QgsRasterCalcNode * > program;
+  int stackSize = 0;
+  if ( compile( program, stackSize ) )
+  {
+    return calculateProgram( program, stackSize, rasterData, result, row );
+  }
+  return calculateTree( rasterData, result, row );
+}
+
+bool QgsRasterCalcNode::compile( QVector< const QgsRasterCalcNode * > &program, int &stackSize, int depth ) const
+{
+  QgsRasterMatrix::TwoArgOperator twoArgOp;
+  QgsRasterMatrix::OneArgOperator oneArgOp;
+
+  switch ( mType )
+  {
+    case tNumber:
+    case tRasterRef:
+      break;
+
+    case tOperator:
+      if ( toTwoArgumentOperator( mOperator, twoArgOp ) )
+      {
+        if ( !mLeft || !mRight || !mLeft->compile( program, stackSize, depth ) || !mRight->compile( program, stackSize, depth + 1 ) )
+          return false;
+      }
+      else if ( toOneArgumentOperator( mOperator, oneArgOp ) )
+      {
+        if ( !mLeft || mRight || !mLeft->compile( program, stackSize, depth ) )
+          return false;
+      }
+      else
+      {
+        return false;
+      }
+      break;
+
+    case tMatrix:
+      // matrices may have any size, leave them to calculateTree()
+      return false;
+  }
+
+  stackSize = std::max( stackSize, depth + 1 );
+  program << this;
+  return true;
+}
+
+bool QgsRasterCalcNode::calculateProgram( const QVector< const QgsRasterCalcNode * > &program, int stackSize,
+    QMap<QString, QgsRasterBlock * > &rasterData, QgsRasterMatrix &result, int row )
+{
+  const double nodata = result.nodataValue();
+
+  //look up raster blocks, all of them need to have the same size. Without rasters the result is a number
+  QVector< QgsRasterBlock * > blocks( program.size(), nullptr );
+  bool hasRaster = false;
+  int nCols = 1;
+  int nRows = 1;
+  for ( int i = 0; i < program.size(); ++i )
+  {
+    const QgsRasterCalcNode *node = program.at( i );
+    if ( node->mType != tRasterRef )
+      continue;
+
+    QgsRasterBlock *block = rasterData.value( node->mRasterName );
+    if ( !block )
+    {
+      return false;
+    }
+
+    const int blockRows = row >= 0 ? 1 : block->height();
+    if ( hasRaster && ( block->width() != nCols || blockRows != nRows ) )
+    {
+      return false;
+    }
+    hasRaster = true;
+    nCols = block->width();
+    nRows = blockRows;
+    blocks[i] = block;
+  }
+
+  const int startRow = ( row >= 0 ? row : 0 );
+  const int nEntries = nCols * nRows;
+  double *data = new double[nEntries];
+
+  //intermediate results of one chunk of cells, a number only uses the first value of its slot
+  const int chunkSize = std::min( nEntries, CALCULATION_CHUNK_SIZE );
+  std::vector< double > stack( static_cast< size_t >( stackSize ) * chunkSize );
+  std::vector< char > isNumber( stackSize, 0 );
+
+  for ( int begin = 0; begin < nEntries; begin += chunkSize )
+  {
+    const int count = std::min( chunkSize, nEntries - begin );
+    int top = 0;
+
+    for ( int i = 0; i < program.size(); ++i )
+    {
+      const QgsRasterCalcNode *node = program.at( i );
+      double *values = stack.data() + static_cast< size_t >( top ) * chunkSize;
+      QgsRasterMatrix::TwoArgOperator twoArgOp;
+      QgsRasterMatrix::OneArgOperator oneArgOp;
+
+      switch ( node->mType )
+      {
+        case tNumber:
+          values[0] = node->mNumber;
+          isNumber[top++] = true;
+          break;
+
+        case tRasterRef:
+        {
+          //convert input raster values to double, also convert input no data to result no data
+          const QgsRasterBlock *block = blocks.at( i );
+          int dataRow = startRow + begin / nCols;
+          int dataCol = begin % nCols;
+          for ( int j = 0; j < count; ++j )
+          {
+            values[j] = block->isNoData( dataRow, dataCol ) ? nodata : block->value( dataRow, dataCol );
+            if ( ++dataCol == nCols )
+            {
+              dataCol = 0;
+              ++dataRow;
+            }
+          }
+          isNumber[top++] = false;
+          break;
+        }
+
+        case tOperator:
+          if ( toTwoArgumentOperator( node->mOperator, twoArgOp ) )
+          {
+            double *left = values - 2 * chunkSize;
+            const double *right = values - chunkSize;
+            const bool leftIsNumber = isNumber[top - 2];
+            const bool rightIsNumber = isNumber[top - 1];
+            const bool resultIsNumber = leftIsNumber && rightIsNumber;
+            QgsRasterMatrix::calculateTwoArgumentOperation( twoArgOp, left, leftIsNumber, nodata, right, rightIsNumber, nodata,
+                left, resultIsNumber ? 1 : count, nodata );
+            isNumber[top - 2] = resultIsNumber;
+            --top;
+          }
+          else if ( toOneArgumentOperator( node->mOperator, oneArgOp ) )
+          {
+            double *argument = values - chunkSize;
+            QgsRasterMatrix::calculateOneArgumentOperation( oneArgOp, argument, argument, isNumber[top - 1] ? 1 : count, nodata );
+          }
+          break;
+
+        case tMatrix:
+          break;
+      }
+    }
+
+    std::copy( stack.data(), stack.data() + count, data + begin );
+  }
+
+  result.setData( nCols, nRows, data, nodata );
+  return true;
+}
+
+bool QgsRasterCalcNode::calculateTree( QMap<QString, QgsRasterBlock * > &rasterData, QgsRasterMatrix &result, int row ) const
 {
   //if type is raster ref: return a copy of the corresponding matrix
 
@@ -122,11 +375,11 @@ bool QgsRasterCalcNode::calculate( QMap<QString, QgsRasterBlock * > &rasterData,
     leftMatrix.setNodataValue( result.nodataValue() );
     rightMatrix.setNodataValue( result.nodataValue() );
 
-    if ( !mLeft || !mLeft->calculate( rasterData, leftMatrix, row ) )
+    if ( !mLeft || !mLeft->calculateTree( rasterData, leftMatrix, row ) )
     {
       return false;
     }
-    if ( mRight && !mRight->calculate( rasterData, rightMatrix, row ) )
+    if ( mRight && !mRight->calculateTree( rasterData, rightMatrix, row ) )
     {
       return false;
     }
@@ -20,6 +20,7 @@
 #define QGSRASTERCALCNODE_H
 
 #include <QMap>
+#include <QVector>
 #include "qgis_sip.h"
 #include "qgis.h"
 #include <QString>
@@ -91,6 +92,9 @@ class ANALYSIS_EXPORT QgsRasterCalcNode
     void setRight( QgsRasterCalcNode *right ) { delete mRight; mRight = right; }
 
     /** Calculates result of raster calculation (might be real matrix or single number).
+     *
+     * Expressions on raster references and numbers are compiled into a flat list of
+     * operations, which is evaluated for blocks of cells at once.
      * \param rasterData input raster data references, map of raster name to raster data block
      * \param result destination raster matrix for calculation results
      * \param row optional row number to calculate for calculating result by rows, or -1 to
@@ -115,6 +119,20 @@ class ANALYSIS_EXPORT QgsRasterCalcNode
     QgsRasterMatrix *mMatrix = nullptr;
     Operator mOperator;
 
+    /**
+     * Appends the nodes of the expression to \a program in postfix order. \a stackSize is set to the
+     * number of intermediate results needed to evaluate the program.
+     * \returns false if the expression can not be compiled, e.g. because it contains matrix nodes
+     */
+    bool compile( QVector< const QgsRasterCalcNode * > &program, int &stackSize, int depth = 0 ) const;
+
+    //! Evaluates a \a program created by compile() in chunks of cells
+    static bool calculateProgram( const QVector< const QgsRasterCalcNode * > &program, int stackSize,
+                                  QMap<QString, QgsRasterBlock * > &rasterData, QgsRasterMatrix &result, int row );
+
+    //! Evaluates the expression tree recursively, creating an intermediate matrix for each node
+    bool calculateTree( QMap<QString, QgsRasterBlock * > &rasterData, QgsRasterMatrix &result, int row ) const;
+
 };
 
 
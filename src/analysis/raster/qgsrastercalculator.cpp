@@ -25,10 +25,17 @@
 #include "qgsfeedback.h"
 
 #include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QtConcurrentMap>
 
 #include <cpl_string.h>
 #include <gdalwarper.h>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 QgsRasterCalculator::QgsRasterCalculator( const QString &formulaString, const QString &outputFile, const QString &outputFormat,
     const QgsRectangle &outputExtent, int nOutputColumns, int nOutputRows, const QVector<QgsRasterCalculatorEntry> &rasterEntries )
   : mFormulaString( formulaString )
@@ -60,47 +67,22 @@ int QgsRasterCalculator::processCalculation( QgsFeedback *feedback )
 {
   //prepare search string / tree
   QString errorString;
-  QgsRasterCalcNode *calcNode = QgsRasterCalcNode::parseRasterCalcString( mFormulaString, errorString );
+  std::unique_ptr< QgsRasterCalcNode > calcNode( QgsRasterCalcNode::parseRasterCalcString( mFormulaString, errorString ) );
   if ( !calcNode )
   {
     //error
     return static_cast<int>( ParserError );
   }
 
-  QMap< QString, QgsRasterBlock * > inputBlocks;
+  QVector< bool > reproject;
   QVector<QgsRasterCalculatorEntry>::const_iterator it = mRasterEntries.constBegin();
   for ( ; it != mRasterEntries.constEnd(); ++it )
   {
     if ( !it->raster ) // no raster layer in entry
     {
-      delete calcNode;
-      qDeleteAll( inputBlocks );
       return static_cast< int >( InputLayerError );
     }
-
-    QgsRasterBlock *block = nullptr;
-    // if crs transform needed
-    if ( it->raster->crs() != mOutputCrs )
-    {
-      QgsRasterProjector proj;
-      proj.setCrs( it->raster->crs(), mOutputCrs );
-      proj.setInput( it->raster->dataProvider() );
-      proj.setPrecision( QgsRasterProjector::Exact );
-
-      block = proj.block( it->bandNumber, mOutputRectangle, mNumOutputColumns, mNumOutputRows );
-    }
-    else
-    {
-      block = it->raster->dataProvider()->block( it->bandNumber, mOutputRectangle, mNumOutputColumns, mNumOutputRows );
-    }
-    if ( block->isEmpty() )
-    {
-      delete block;
-      delete calcNode;
-      qDeleteAll( inputBlocks );
-      return static_cast<int>( MemoryError );
-    }
-    inputBlocks.insert( it->ref, block );
+    reproject << ( it->raster->crs() != mOutputCrs );
   }
 
   //open output dataset for writing
@@ -111,59 +93,140 @@ int QgsRasterCalculator::processCalculation( QgsFeedback *feedback )
   }
 
   GDALDatasetH outputDataset = openOutputFile( outputDriver );
+  if ( !outputDataset )
+  {
+    return static_cast< int >( CreateOutputError );
+  }
   GDALSetProjection( outputDataset, mOutputCrs.toWkt().toLocal8Bit().data() );
   GDALRasterBandH outputRasterBand = GDALGetRasterBand( outputDataset, 1 );
 
   float outputNodataValue = -FLT_MAX;
   GDALSetRasterNoDataValue( outputRasterBand, outputNodataValue );
 
-  QgsRasterMatrix resultMatrix;
-  resultMatrix.setNodataValue( outputNodataValue );
+  const QList< QRect > tiles = outputTiles( outputRasterBand );
+  const int workerCount = std::min( tiles.size(), std::max( 1, QThread::idealThreadCount() ) );
 
-  //read / write line by line
-  for ( int i = 0; i < mNumOutputRows; ++i )
+  // data providers can not be used by several threads at the same time, each worker reads from its own copies
+  std::vector< std::vector< std::unique_ptr< QgsRasterDataProvider > > > workerProviders( workerCount );
+  for ( int worker = 0; worker < workerCount; ++worker )
   {
-    if ( feedback )
+    for ( it = mRasterEntries.constBegin(); it != mRasterEntries.constEnd(); ++it )
     {
-      feedback->setProgress( 100.0 * static_cast< double >( i ) / mNumOutputRows );
+      QgsRasterDataProvider *provider = it->raster->dataProvider() ? dynamic_cast< QgsRasterDataProvider * >( it->raster->dataProvider()->clone() ) : nullptr;
+      if ( !provider )
+      {
+        GDALClose( outputDataset );
+        GDALDeleteDataset( outputDriver, mOutputFile.toUtf8().constData() );
+        return static_cast< int >( InputLayerError );
+      }
+      workerProviders[ worker ].emplace_back( provider );
     }
+  }
 
-    if ( feedback && feedback->isCanceled() )
-    {
-      break;
-    }
+  const double cellSizeX = mOutputRectangle.width() / mNumOutputColumns;
+  const double cellSizeY = mOutputRectangle.height() / mNumOutputRows;
+
+  QMutex mutex;
+  int processedTiles = 0;
+  Result result = Success;
+
+  // each worker calculates every workerCount-th tile, so that tiles are roughly written in order
+  auto calculateTiles = [&]( const int &worker )
+  {
+    const std::vector< std::unique_ptr< QgsRasterDataProvider > > &providers = workerProviders[ worker ];
+    QgsRasterMatrix resultMatrix;
+    resultMatrix.setNodataValue( outputNodataValue );
+    std::vector< float > calcData;
 
-    if ( calcNode->calculate( inputBlocks, resultMatrix, i ) )
+    for ( int tileIndex = worker; tileIndex < tiles.size(); tileIndex += workerCount )
     {
-      bool resultIsNumber = resultMatrix.isNumber();
-      float *calcData = new float[mNumOutputColumns];
+      if ( feedback && feedback->isCanceled() )
+      {
+        return;
+      }
 
-      for ( int j = 0; j < mNumOutputColumns; ++j )
       {
-        calcData[j] = ( float )( resultIsNumber ? resultMatrix.number() : resultMatrix.data()[j] );
+        QMutexLocker locker( &mutex );
+        if ( result != Success )
+          return;
       }
 
-      //write scanline to the dataset
-      if ( GDALRasterIO( outputRasterBand, GF_Write, 0, i, mNumOutputColumns, 1, calcData, mNumOutputColumns, 1, GDT_Float32, 0, 0 ) != CE_None )
+      const QRect &tile = tiles.at( tileIndex );
+      const QgsRectangle tileExtent( mOutputRectangle.xMinimum() + tile.left() * cellSizeX,
+                                     mOutputRectangle.yMaximum() - ( tile.top() + tile.height() ) * cellSizeY,
+                                     mOutputRectangle.xMinimum() + ( tile.left() + tile.width() ) * cellSizeX,
+                                     mOutputRectangle.yMaximum() - tile.top() * cellSizeY );
+
+      QMap< QString, QgsRasterBlock * > inputBlocks;
+      for ( int i = 0; i < mRasterEntries.size(); ++i )
+      {
+        const QgsRasterCalculatorEntry &entry = mRasterEntries.at( i );
+        QgsRasterBlock *block = nullptr;
+        // if crs transform needed
+        if ( reproject.at( i ) )
+        {
+          QgsRasterProjector proj;
+          proj.setCrs( entry.raster->crs(), mOutputCrs );
+          proj.setInput( providers[ i ].get() );
+          proj.setPrecision( QgsRasterProjector::Exact );
+
+          block = proj.block( entry.bandNumber, tileExtent, tile.width(), tile.height() );
+        }
+        else
+        {
+          block = providers[ i ]->block( entry.bandNumber, tileExtent, tile.width(), tile.height() );
+        }
+        if ( block->isEmpty() )
+        {
+          delete block;
+          qDeleteAll( inputBlocks );
+          QMutexLocker locker( &mutex );
+          result = MemoryError;
+          return;
+        }
+        delete inputBlocks.value( entry.ref );
+        inputBlocks.insert( entry.ref, block );
+      }
+
+      if ( calcNode->calculate( inputBlocks, resultMatrix ) )
       {
-        QgsDebugMsg( "RasterIO error!" );
+        const int nEntries = tile.width() * tile.height();
+        bool resultIsNumber = resultMatrix.isNumber();
+        calcData.resize( nEntries );
+        for ( int j = 0; j < nEntries; ++j )
+        {
+          calcData[j] = ( float )( resultIsNumber ? resultMatrix.number() : resultMatrix.data()[j] );
+        }
+
+        //write tile to the dataset
+        QMutexLocker locker( &mutex );
+        if ( GDALRasterIO( outputRasterBand, GF_Write, tile.left(), tile.top(), tile.width(), tile.height(), calcData.data(),
+                           tile.width(), tile.height(), GDT_Float32, 0, 0 ) != CE_None )
+        {
+          QgsDebugMsg( "RasterIO error!" );
+        }
       }
+      qDeleteAll( inputBlocks );
 
-      delete[] calcData;
+      if ( feedback )
+      {
+        QMutexLocker locker( &mutex );
+        ++processedTiles;
+        feedback->setProgress( 100.0 * static_cast< double >( processedTiles ) / tiles.size() );
+      }
     }
+  };
 
-  }
+  QList< int > workers;
+  for ( int worker = 0; worker < workerCount; ++worker )
+    workers << worker;
+  QtConcurrent::blockingMap( workers, calculateTiles );
 
   if ( feedback )
   {
     feedback->setProgress( 100.0 );
   }
 
-  //close datasets and release memory
-  delete calcNode;
-  qDeleteAll( inputBlocks );
-  inputBlocks.clear();
-
   if ( feedback && feedback->isCanceled() )
   {
     //delete the dataset without closing (because it is faster)
@@ -172,9 +235,46 @@ int QgsRasterCalculator::processCalculation( QgsFeedback *feedback )
   }
   GDALClose( outputDataset );
 
+  if ( result != Success )
+  {
+    GDALDeleteDataset( outputDriver, mOutputFile.toUtf8().constData() );
+    return static_cast< int >( result );
+  }
+
   return static_cast< int >( Success );
 }
 
+QList< QRect > QgsRasterCalculator::outputTiles( GDALRasterBandH outputBand ) const
+{
+  int tileWidth = mNumOutputColumns;
+  int tileHeight = mNumOutputRows;
+
+  if ( mTileSize > 0 )
+  {
+    int blockWidth = 0;
+    int blockHeight = 0;
+    GDALGetBlockSize( outputBand, &blockWidth, &blockHeight );
+    blockWidth = std::max( 1, blockWidth );
+    blockHeight = std::max( 1, blockHeight );
+
+    // whole blocks, with about mTileSize * mTileSize pixels. Blocks of striped files span the whole width,
+    // so the tile height is reduced for them.
+    tileWidth = std::min( mNumOutputColumns, ( ( mTileSize + blockWidth - 1 ) / blockWidth ) * blockWidth );
+    const qint64 rows = static_cast< qint64 >( mTileSize ) * mTileSize / std::max( 1, tileWidth );
+    tileHeight = static_cast< int >( std::min( static_cast< qint64 >( mNumOutputRows ), std::max( static_cast< qint64 >( blockHeight ), rows / blockHeight * blockHeight ) ) );
+  }
+
+  QList< QRect > tiles;
+  for ( int top = 0; top < mNumOutputRows; top += tileHeight )
+  {
+    for ( int left = 0; left < mNumOutputColumns; left += tileWidth )
+    {
+      tiles << QRect( left, top, std::min( tileWidth, mNumOutputColumns - left ), std::min( tileHeight, mNumOutputRows - top ) );
+    }
+  }
+  return tiles;
+}
+
 QgsRasterCalculator::QgsRasterCalculator()
   : mNumOutputColumns( 0 )
   , mNumOutputRows( 0 )
@@ -20,6 +20,8 @@
 
 #include "qgsrectangle.h"
 #include "qgscoordinatereferencesystem.h"
+#include <QList>
+#include <QRect>
 #include <QString>
 #include <QVector>
 #include "gdal.h"
@@ -93,6 +95,24 @@ class ANALYSIS_EXPORT QgsRasterCalculator
     //TODO QGIS 3.0 - return QgsRasterCalculator::Result
     int processCalculation( QgsFeedback *feedback = nullptr );
 
+    /**
+     * Sets the approximate \a size (width and height in pixels) of the tiles in which the
+     * output raster is calculated. Tiles are aligned to the blocks of the output file and are
+     * calculated in parallel. Only the input data for the tiles being calculated is held in memory.
+     * A size of 0 calculates the whole raster at once. The default is 1024.
+     * \see tileSize()
+     * \since QGIS 3.0
+     */
+    void setTileSize( int size ) { mTileSize = size; }
+
+    /**
+     * Returns the approximate size (width and height in pixels) of the tiles in which the
+     * output raster is calculated, or 0 if the whole raster is calculated at once.
+     * \see setTileSize()
+     * \since QGIS 3.0
+     */
+    int tileSize() const { return mTileSize; }
+
   private:
     //default constructor forbidden. We need formula, output file, output format and output raster resolution obligatory
     QgsRasterCalculator();
@@ -109,6 +129,9 @@ class ANALYSIS_EXPORT QgsRasterCalculator
       \param transform double[6] array that receives the GDAL parameters*/
     void outputGeoTransform( double *transform ) const;
 
+    //! Splits the output raster into tiles (in pixels) aligned to the blocks of \a outputBand
+    QList< QRect > outputTiles( GDALRasterBandH outputBand ) const;
+
     QString mFormulaString;
     QString mOutputFile;
     QString mOutputFormat;
@@ -124,6 +147,8 @@ class ANALYSIS_EXPORT QgsRasterCalculator
 
     /***/
     QVector<QgsRasterCalculatorEntry> mRasterEntries;
+
+    int mTileSize = 1024;
 };
 
 #endif // QGSRASTERCALCULATOR_H
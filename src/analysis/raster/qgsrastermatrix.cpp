@@ -193,231 +193,307 @@ bool QgsRasterMatrix::log10()
   return oneArgumentOperation( opLOG10 );
 }
 
-bool QgsRasterMatrix::oneArgumentOperation( OneArgOperator op )
+///@cond PRIVATE
+
+/*
+ * Operators are functors applied by the kernels below. Invalid operations return the nodata
+ * value, and are written so that both sides are computed and one of them is selected,
+ * which allows vectorizing the loops.
+ */
+
+struct QgsRasterPlus
 {
-  if ( !mData )
+  double operator()( double a, double b, double ) const { return a + b; }
+};
+
+struct QgsRasterMinus
+{
+  double operator()( double a, double b, double ) const { return a - b; }
+};
+
+struct QgsRasterMultiply
+{
+  double operator()( double a, double b, double ) const { return a * b; }
+};
+
+struct QgsRasterDivide
+{
+  double operator()( double a, double b, double nodata ) const
   {
-    return false;
+    const double quotient = a / b;
+    return b == 0 ? nodata : quotient;
   }
+};
 
-  int nEntries = mColumns * mRows;
-  double value;
-  for ( int i = 0; i < nEntries; ++i )
+struct QgsRasterPower
+{
+  double operator()( double a, double b, double nodata ) const
   {
-    value = mData[i];
-    if ( value != mNodataValue )
-    {
-      switch ( op )
-      {
-        case opSQRT:
-          if ( value < 0 ) //no complex numbers
-          {
-            mData[i] = mNodataValue;
-          }
-          else
-          {
-            mData[i] = std::sqrt( value );
-          }
-          break;
-        case opSIN:
-          mData[i] = std::sin( value );
-          break;
-        case opCOS:
-          mData[i] = std::cos( value );
-          break;
-        case opTAN:
-          mData[i] = std::tan( value );
-          break;
-        case opASIN:
-          mData[i] = std::asin( value );
-          break;
-        case opACOS:
-          mData[i] = std::acos( value );
-          break;
-        case opATAN:
-          mData[i] = std::atan( value );
-          break;
-        case opSIGN:
-          mData[i] = -value;
-          break;
-        case opLOG:
-          if ( value <= 0 )
-          {
-            mData[i] = mNodataValue;
-          }
-          else
-          {
-            mData[i] = ::log( value );
-          }
-          break;
-        case opLOG10:
-          if ( value <= 0 )
-          {
-            mData[i] = mNodataValue;
-          }
-          else
-          {
-            mData[i] = ::log10( value );
-          }
-          break;
-      }
-    }
+    if ( ( a == 0 && b < 0 ) || ( a < 0 && ( b - std::floor( b ) ) > 0 ) )
+      return nodata;
+    return std::pow( a, b );
   }
-  return true;
+};
+
+struct QgsRasterEqual
+{
+  double operator()( double a, double b, double ) const { return a == b ? 1.0 : 0.0; }
+};
+
+struct QgsRasterNotEqual
+{
+  double operator()( double a, double b, double ) const { return a == b ? 0.0 : 1.0; }
+};
+
+struct QgsRasterGreaterThan
+{
+  double operator()( double a, double b, double ) const { return a > b ? 1.0 : 0.0; }
+};
+
+struct QgsRasterLesserThan
+{
+  double operator()( double a, double b, double ) const { return a < b ? 1.0 : 0.0; }
+};
+
+struct QgsRasterGreaterEqual
+{
+  double operator()( double a, double b, double ) const { return a >= b ? 1.0 : 0.0; }
+};
+
+struct QgsRasterLesserEqual
+{
+  double operator()( double a, double b, double ) const { return a <= b ? 1.0 : 0.0; }
+};
+
+struct QgsRasterLogicalAnd
+{
+  double operator()( double a, double b, double ) const { return ( a != 0 ) & ( b != 0 ) ? 1.0 : 0.0; }
+};
+
+struct QgsRasterLogicalOr
+{
+  double operator()( double a, double b, double ) const { return ( a != 0 ) | ( b != 0 ) ? 1.0 : 0.0; }
+};
+
+struct QgsRasterSquareRoot
+{
+  double operator()( double a, double nodata ) const { return a < 0 ? nodata : std::sqrt( a ); } //no complex numbers
+};
+
+struct QgsRasterSinus
+{
+  double operator()( double a, double ) const { return std::sin( a ); }
+};
+
+struct QgsRasterCosinus
+{
+  double operator()( double a, double ) const { return std::cos( a ); }
+};
+
+struct QgsRasterTangens
+{
+  double operator()( double a, double ) const { return std::tan( a ); }
+};
+
+struct QgsRasterArcSinus
+{
+  double operator()( double a, double ) const { return std::asin( a ); }
+};
+
+struct QgsRasterArcCosinus
+{
+  double operator()( double a, double ) const { return std::acos( a ); }
+};
+
+struct QgsRasterArcTangens
+{
+  double operator()( double a, double ) const { return std::atan( a ); }
+};
+
+struct QgsRasterChangeSign
+{
+  double operator()( double a, double ) const { return -a; }
+};
+
+struct QgsRasterLog
+{
+  double operator()( double a, double nodata ) const { return a <= 0 ? nodata : std::log( a ); }
+};
+
+struct QgsRasterLog10
+{
+  double operator()( double a, double nodata ) const { return a <= 0 ? nodata : std::log10( a ); }
+};
+
+template <typename Operator, bool LEFT_IS_NUMBER, bool RIGHT_IS_NUMBER>
+static void twoArgumentKernel( const double *left, double leftNodata, const double *right, double rightNodata, double *result, int count, double nodata )
+{
+  const Operator op = Operator();
+  // numbers are read before the loop, as result may overwrite them
+  const double leftNumber = left[0];
+  const double rightNumber = right[0];
+  for ( int i = 0; i < count; ++i )
+  {
+    const double a = LEFT_IS_NUMBER ? leftNumber : left[i];
+    const double b = RIGHT_IS_NUMBER ? rightNumber : right[i];
+    const double value = op( a, b, nodata );
+    //operations with nodata values always generate nodata
+    result[i] = ( a == leftNodata ) | ( b == rightNodata ) ? nodata : value;
+  }
+}
+
+template <typename Operator>
+static void twoArgumentKernel( const double *left, bool leftIsNumber, double leftNodata, const double *right, bool rightIsNumber, double rightNodata, double *result, int count, double nodata )
+{
+  if ( leftIsNumber && !rightIsNumber )
+    twoArgumentKernel<Operator, true, false>( left, leftNodata, right, rightNodata, result, count, nodata );
+  else if ( !leftIsNumber && rightIsNumber )
+    twoArgumentKernel<Operator, false, true>( left, leftNodata, right, rightNodata, result, count, nodata );
+  else
+    twoArgumentKernel<Operator, false, false>( left, leftNodata, right, rightNodata, result, count, nodata );
 }
 
-double QgsRasterMatrix::calculateTwoArgumentOp( TwoArgOperator op, double arg1, double arg2 ) const
+template <typename Operator>
+static void oneArgumentKernel( const double *values, double *result, int count, double nodata )
+{
+  const Operator op = Operator();
+  for ( int i = 0; i < count; ++i )
+  {
+    const double a = values[i];
+    const double value = op( a, nodata );
+    result[i] = a == nodata ? nodata : value;
+  }
+}
+
+///@endcond
+
+void QgsRasterMatrix::calculateTwoArgumentOperation( TwoArgOperator op, const double *left, bool leftIsNumber, double leftNodataValue,
+    const double *right, bool rightIsNumber, double rightNodataValue,
+    double *result, int count, double nodataValue )
 {
   switch ( op )
   {
     case opPLUS:
-      return arg1 + arg2;
+      twoArgumentKernel<QgsRasterPlus>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
     case opMINUS:
-      return arg1 - arg2;
+      twoArgumentKernel<QgsRasterMinus>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
     case opMUL:
-      return arg1 * arg2;
+      twoArgumentKernel<QgsRasterMultiply>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
     case opDIV:
-      if ( arg2 == 0 )
-      {
-        return mNodataValue;
-      }
-      else
-      {
-        return arg1 / arg2;
-      }
+      twoArgumentKernel<QgsRasterDivide>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
     case opPOW:
-      if ( !testPowerValidity( arg1, arg2 ) )
-      {
-        return mNodataValue;
-      }
-      else
-      {
-        return std::pow( arg1, arg2 );
-      }
+      twoArgumentKernel<QgsRasterPower>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
     case opEQ:
-      return ( arg1 == arg2 ? 1.0 : 0.0 );
+      twoArgumentKernel<QgsRasterEqual>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
     case opNE:
-      return ( arg1 == arg2 ? 0.0 : 1.0 );
+      twoArgumentKernel<QgsRasterNotEqual>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
     case opGT:
-      return ( arg1 > arg2 ? 1.0 : 0.0 );
+      twoArgumentKernel<QgsRasterGreaterThan>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
     case opLT:
-      return ( arg1 < arg2 ? 1.0 : 0.0 );
+      twoArgumentKernel<QgsRasterLesserThan>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
     case opGE:
-      return ( arg1 >= arg2 ? 1.0 : 0.0 );
+      twoArgumentKernel<QgsRasterGreaterEqual>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
     case opLE:
-      return ( arg1 <= arg2 ? 1.0 : 0.0 );
+      twoArgumentKernel<QgsRasterLesserEqual>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
     case opAND:
-      return ( arg1 && arg2 ? 1.0 : 0.0 );
+      twoArgumentKernel<QgsRasterLogicalAnd>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
     case opOR:
-      return ( arg1 || arg2 ? 1.0 : 0.0 );
+      twoArgumentKernel<QgsRasterLogicalOr>( left, leftIsNumber, leftNodataValue, right, rightIsNumber, rightNodataValue, result, count, nodataValue );
+      break;
   }
-  return mNodataValue;
+}
+
+void QgsRasterMatrix::calculateOneArgumentOperation( OneArgOperator op, const double *values, double *result, int count, double nodataValue )
+{
+  switch ( op )
+  {
+    case opSQRT:
+      oneArgumentKernel<QgsRasterSquareRoot>( values, result, count, nodataValue );
+      break;
+    case opSIN:
+      oneArgumentKernel<QgsRasterSinus>( values, result, count, nodataValue );
+      break;
+    case opCOS:
+      oneArgumentKernel<QgsRasterCosinus>( values, result, count, nodataValue );
+      break;
+    case opTAN:
+      oneArgumentKernel<QgsRasterTangens>( values, result, count, nodataValue );
+      break;
+    case opASIN:
+      oneArgumentKernel<QgsRasterArcSinus>( values, result, count, nodataValue );
+      break;
+    case opACOS:
+      oneArgumentKernel<QgsRasterArcCosinus>( values, result, count, nodataValue );
+      break;
+    case opATAN:
+      oneArgumentKernel<QgsRasterArcTangens>( values, result, count, nodataValue );
+      break;
+    case opSIGN:
+      oneArgumentKernel<QgsRasterChangeSign>( values, result, count, nodataValue );
+      break;
+    case opLOG:
+      oneArgumentKernel<QgsRasterLog>( values, result, count, nodataValue );
+      break;
+    case opLOG10:
+      oneArgumentKernel<QgsRasterLog10>( values, result, count, nodataValue );
+      break;
+  }
+}
+
+bool QgsRasterMatrix::oneArgumentOperation( OneArgOperator op )
+{
+  if ( !mData )
+  {
+    return false;
+  }
+
+  calculateOneArgumentOperation( op, mData, mData, mColumns * mRows, mNodataValue );
+  return true;
 }
 
 bool QgsRasterMatrix::twoArgumentOperation( TwoArgOperator op, const QgsRasterMatrix &other )
 {
   if ( isNumber() && other.isNumber() ) //operation on two 1x1 matrices
   {
-    //operations with nodata values always generate nodata
-    if ( mData[0] == mNodataValue || other.number() == other.nodataValue() )
-    {
-      mData[0] = mNodataValue;
-    }
-    else
-    {
-      mData[0] = calculateTwoArgumentOp( op, mData[0], other.number() );
-    }
+    calculateTwoArgumentOperation( op, mData, false, mNodataValue, other.mData, false, other.mNodataValue, mData, 1, mNodataValue );
     return true;
   }
 
   //two matrices
   if ( !isNumber() && !other.isNumber() )
   {
-    double *matrix = other.mData;
-    int nEntries = mColumns * mRows;
-    double value1, value2;
-
-    for ( int i = 0; i < nEntries; ++i )
-    {
-      value1 = mData[i];
-      value2 = matrix[i];
-      if ( value1 == mNodataValue || value2 == other.mNodataValue )
-      {
-        mData[i] = mNodataValue;
-      }
-      else
-      {
-        mData[i] = calculateTwoArgumentOp( op, value1, value2 );
-      }
-    }
+    calculateTwoArgumentOperation( op, mData, false, mNodataValue, other.mData, false, other.mNodataValue, mData, mColumns * mRows, mNodataValue );
     return true;
   }
 
   //this matrix is a single number and the other one a real matrix
   if ( isNumber() )
   {
-    double *matrix = other.mData;
     int nEntries = other.nColumns() * other.nRows();
-    double value = mData[0];
+    double *data = new double[nEntries];
+    mNodataValue = other.nodataValue();
+    calculateTwoArgumentOperation( op, mData, true, mNodataValue, other.mData, false, other.mNodataValue, data, nEntries, mNodataValue );
     delete[] mData;
-    mData = new double[nEntries];
+    mData = data;
     mColumns = other.nColumns();
     mRows = other.nRows();
-    mNodataValue = other.nodataValue();
-
-    if ( value == mNodataValue )
-    {
-      for ( int i = 0; i < nEntries; ++i )
-      {
-        mData[i] = mNodataValue;
-      }
-      return true;
-    }
-
-    for ( int i = 0; i < nEntries; ++i )
-    {
-      if ( matrix[i] == other.mNodataValue )
-      {
-        mData[i] = mNodataValue;
-        continue;
-      }
-
-      mData[i] = calculateTwoArgumentOp( op, value, matrix[i] );
-    }
     return true;
   }
   else //this matrix is a real matrix and the other a number
   {
-    double value = other.number();
-    int nEntries = mColumns * mRows;
-
-    if ( other.number() == other.mNodataValue )
-    {
-      for ( int i = 0; i < nEntries; ++i )
-      {
-        mData[i] = mNodataValue;
-      }
-      return true;
-    }
-
-    for ( int i = 0; i < nEntries; ++i )
-    {
-      if ( mData[i] == mNodataValue )
-      {
-        continue;
-      }
-
-      mData[i] = calculateTwoArgumentOp( op, mData[i], value );
-    }
+    calculateTwoArgumentOperation( op, mData, false, mNodataValue, other.mData, true, other.mNodataValue, mData, mColumns * mRows, mNodataValue );
     return true;
   }
 }
-
-bool QgsRasterMatrix::testPowerValidity( double base, double power ) const
-{
-  if ( ( base == 0 && power < 0 ) || ( base < 0 && ( power - std::floor( power ) ) > 0 ) )
-  {
-    return false;
-  }
-  return true;
-}
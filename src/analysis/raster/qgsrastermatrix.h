@@ -114,6 +114,31 @@ class ANALYSIS_EXPORT QgsRasterMatrix
     bool log();
     bool log10();
 
+    /**
+     * Applies the operator \a op to \a count values of \a left and \a right and stores the results
+     * in \a result, which may point to the same values as \a left or \a right. If \a leftIsNumber or
+     * \a rightIsNumber is true, the corresponding argument holds a single number used for all values.
+     * Arguments equal to \a leftNodataValue or \a rightNodataValue result in \a nodataValue, as do
+     * invalid operations like divisions by zero.
+     *
+     * The operator is selected once for all values and nodata is masked without branches, so that
+     * the loop can be vectorized by the compiler.
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    static void calculateTwoArgumentOperation( TwoArgOperator op, const double *left, bool leftIsNumber, double leftNodataValue,
+        const double *right, bool rightIsNumber, double rightNodataValue,
+        double *result, int count, double nodataValue ) SIP_SKIP;
+
+    /**
+     * Applies the operator \a op to \a count \a values and stores the results in \a result, which may
+     * point to \a values. Values equal to \a nodataValue and invalid arguments (e.g. square roots of
+     * negative numbers) result in \a nodataValue.
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    static void calculateOneArgumentOperation( OneArgOperator op, const double *values, double *result, int count, double nodataValue ) SIP_SKIP;
+
   private:
     int mColumns;
     int mRows;
@@ -122,11 +147,9 @@ class ANALYSIS_EXPORT QgsRasterMatrix
 
     //! +,-,*,/,^,<,>,<=,>=,=,!=, and, or
     bool twoArgumentOperation( TwoArgOperator op, const QgsRasterMatrix &other );
-    double calculateTwoArgumentOp( TwoArgOperator op, double arg1, double arg2 ) const;
 
     /*sqrt, std::sin, std::cos, tan, asin, acos, atan*/
     bool oneArgumentOperation( OneArgOperator op );
-    bool testPowerValidity( double base, double power ) const;
 };
 
 #endif // QGSRASTERMATRIX_H
@@ -18,6 +18,51 @@
 #include "qgsruggednessfilter.h"
 #include <cmath>
 
+static inline float ruggedness( float x11, float x21, float x31, float x12, float x22, float x32, float x13, float x23, float x33,
+                                float nodata, float outputNodata )
+{
+  if ( x22 == nodata )
+  {
+    return outputNodata;
+  }
+
+  double sum = 0;
+  if ( x11 != nodata )
+  {
+    sum += ( x11 - x22 ) * ( x11 - x22 );
+  }
+  if ( x21 != nodata )
+  {
+    sum += ( x21 - x22 ) * ( x21 - x22 );
+  }
+  if ( x31 != nodata )
+  {
+    sum += ( x31 - x22 ) * ( x31 - x22 );
+  }
+  if ( x12 != nodata )
+  {
+    sum += ( x12 - x22 ) * ( x12 - x22 );
+  }
+  if ( x32 != nodata )
+  {
+    sum += ( x32 - x22 ) * ( x32 - x22 );
+  }
+  if ( x13 != nodata )
+  {
+    sum += ( x13 - x22 ) * ( x13 - x22 );
+  }
+  if ( x23 != nodata )
+  {
+    sum += ( x23 - x22 ) * ( x23 - x22 );
+  }
+  if ( x33 != nodata )
+  {
+    sum += ( x33 - x22 ) * ( x33 - x22 );
+  }
+
+  return std::sqrt( sum );
+}
+
 QgsRuggednessFilter::QgsRuggednessFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat ): QgsNineCellFilter( inputFile, outputFile, outputFormat )
 {
 
@@ -45,45 +90,28 @@ float QgsRuggednessFilter::processNineCellWindow( float *x11, float *x21, float
     return sqrt(diff1 * diff1 + diff2 * diff2 + diff3 * diff3 + diff4 * diff4 + diff5 * diff5 + diff6 * diff6 + diff7 * diff7 + diff8 * diff8);
    */
 
-  if ( *x22 == mInputNodataValue )
-  {
-    return mOutputNodataValue;
-  }
+  return ruggedness( *x11, *x21, *x31, *x12, *x22, *x32, *x13, *x23, *x33, mInputNodataValue, mOutputNodataValue );
+}
 
-  double sum = 0;
-  if ( *x11 != mInputNodataValue )
-  {
-    sum += ( *x11 - *x22 ) * ( *x11 - *x22 );
-  }
-  if ( *x21 != mInputNodataValue )
-  {
-    sum += ( *x21 - *x22 ) * ( *x21 - *x22 );
-  }
-  if ( *x31 != mInputNodataValue )
-  {
-    sum += ( *x31 - *x22 ) * ( *x31 - *x22 );
-  }
-  if ( *x12 != mInputNodataValue )
-  {
-    sum += ( *x12 - *x22 ) * ( *x12 - *x22 );
-  }
-  if ( *x32 != mInputNodataValue )
-  {
-    sum += ( *x32 - *x22 ) * ( *x32 - *x22 );
-  }
-  if ( *x13 != mInputNodataValue )
-  {
-    sum += ( *x13 - *x22 ) * ( *x13 - *x22 );
-  }
-  if ( *x23 != mInputNodataValue )
-  {
-    sum += ( *x23 - *x22 ) * ( *x23 - *x22 );
-  }
-  if ( *x33 != mInputNodataValue )
+bool QgsRuggednessFilter::processBlocksInParallel() const
+{
+  return true;
+}
+
+void QgsRuggednessFilter::processBlock( const float *inputBlock, float *outputBlock, int columns, int rows )
+{
+  const int lineLength = columns + 2;
+  for ( int i = 0; i < rows; ++i )
   {
-    sum += ( *x33 - *x22 ) * ( *x33 - *x22 );
+    const float *line1 = inputBlock + static_cast< size_t >( i ) * lineLength;
+    const float *line2 = line1 + lineLength;
+    const float *line3 = line2 + lineLength;
+    float *result = outputBlock + static_cast< size_t >( i ) * columns;
+    for ( int j = 0; j < columns; ++j )
+    {
+      result[j] = ruggedness( line1[j], line1[j + 1], line1[j + 2], line2[j], line2[j + 1], line2[j + 2], line3[j], line3[j + 1], line3[j + 2],
+                              mInputNodataValue, mOutputNodataValue );
+    }
   }
-
-  return std::sqrt( sum );
 }
 
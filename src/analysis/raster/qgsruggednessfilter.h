@@ -37,6 +37,10 @@ class ANALYSIS_EXPORT QgsRuggednessFilter: public QgsNineCellFilter
     float processNineCellWindow( float *x11, float *x21, float *x31,
                                  float *x12, float *x22, float *x32,
                                  float *x13, float *x23, float *x33 ) override;
+#ifndef SIP_RUN
+    void processBlock( const float *inputBlock, float *outputBlock, int columns, int rows ) override;
+    bool processBlocksInParallel() const override;
+#endif
 
   private:
     QgsRuggednessFilter();
@@ -17,6 +17,17 @@
 
 #include "qgsslopefilter.h"
 #include <cmath>
+#include <vector>
+
+static inline float slope( float derX, float derY, float outputNodata )
+{
+  if ( derX == outputNodata || derY == outputNodata )
+  {
+    return outputNodata;
+  }
+
+  return std::atan( std::sqrt( derX * derX + derY * derY ) ) * 180.0 / M_PI;
+}
 
 QgsSlopeFilter::QgsSlopeFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat )
   : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
@@ -29,12 +40,24 @@ float QgsSlopeFilter::processNineCellWindow( float *x11, float *x21, float *x31,
 {
   float derX = calcFirstDerX( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
   float derY = calcFirstDerY( x11, x21, x31, x12, x22, x32, x13, x23, x33 );
+  return slope( derX, derY, mOutputNodataValue );
+}
 
-  if ( derX == mOutputNodataValue || derY == mOutputNodataValue )
+bool QgsSlopeFilter::processBlocksInParallel() const
+{
+  return true;
+}
+
+void QgsSlopeFilter::processBlock( const float *inputBlock, float *outputBlock, int columns, int rows )
+{
+  const int count = columns * rows;
+  std::vector< float > derX( count );
+  std::vector< float > derY( count );
+  calcFirstDerivatives( inputBlock, columns, rows, derX.data(), derY.data() );
+
+  for ( int i = 0; i < count; ++i )
   {
-    return mOutputNodataValue;
+    outputBlock[i] = slope( derX[i], derY[i], mOutputNodataValue );
   }
-
-  return std::atan( std::sqrt( derX * derX + derY * derY ) ) * 180.0 / M_PI;
 }
 
@@ -17,6 +17,25 @@
 
 #include "qgstotalcurvaturefilter.h"
 
+static inline float totalCurvature( float x11, float x21, float x31, float x12, float x22, float x32, float x13, float x23, float x33,
+                                    float nodata, float outputNodata, double cellSizeX, double cellSizeY )
+{
+  //return nodata if one value is the nodata value
+  if ( x11 == nodata || x21 == nodata || x31 == nodata || x12 == nodata
+       || x22 == nodata || x32 == nodata || x13 == nodata || x23 == nodata
+       || x33 == nodata )
+  {
+    return outputNodata;
+  }
+
+  double cellSizeAvg = ( cellSizeX + cellSizeY ) / 2.0;
+  double dxx = ( x32 - 2 * x22 + x12 ) / ( cellSizeX * cellSizeX );
+  double dxy = ( -x11 + x31 + x13 - x33 ) / ( 4 * cellSizeAvg * cellSizeAvg );
+  double dyy = ( x21 - 2 * x22 + x23 ) / ( cellSizeY * cellSizeY );
+
+  return dxx * dxx + 2 * dxy * dxy + dyy * dyy;
+}
+
 QgsTotalCurvatureFilter::QgsTotalCurvatureFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat )
   : QgsNineCellFilter( inputFile, outputFile, outputFormat )
 {
@@ -26,18 +45,27 @@ QgsTotalCurvatureFilter::QgsTotalCurvatureFilter( const QString &inputFile, cons
 float QgsTotalCurvatureFilter::processNineCellWindow( float *x11, float *x21, float *x31, float *x12,
     float *x22, float *x32, float *x13, float *x23, float *x33 )
 {
-  //return nodata if one value is the nodata value
-  if ( *x11 == mInputNodataValue || *x21 == mInputNodataValue || *x31 == mInputNodataValue || *x12 == mInputNodataValue
-       || *x22 == mInputNodataValue || *x32 == mInputNodataValue || *x13 == mInputNodataValue || *x23 == mInputNodataValue
-       || *x33 == mInputNodataValue )
-  {
-    return mOutputNodataValue;
-  }
+  return totalCurvature( *x11, *x21, *x31, *x12, *x22, *x32, *x13, *x23, *x33, mInputNodataValue, mOutputNodataValue, mCellSizeX, mCellSizeY );
+}
 
-  double cellSizeAvg = ( mCellSizeX + mCellSizeY ) / 2.0;
-  double dxx = ( *x32 - 2 * *x22 + *x12 ) / ( mCellSizeX * mCellSizeX );
-  double dxy = ( -*x11 + *x31 + *x13 - *x33 ) / ( 4 * cellSizeAvg * cellSizeAvg );
-  double dyy = ( *x21 - 2 * *x22 + *x23 ) / ( mCellSizeY * mCellSizeY );
+bool QgsTotalCurvatureFilter::processBlocksInParallel() const
+{
+  return true;
+}
 
-  return dxx * dxx + 2 * dxy * dxy + dyy * dyy;
+void QgsTotalCurvatureFilter::processBlock( const float *inputBlock, float *outputBlock, int columns, int rows )
+{
+  const int lineLength = columns + 2;
+  for ( int i = 0; i < rows; ++i )
+  {
+    const float *line1 = inputBlock + static_cast< size_t >( i ) * lineLength;
+    const float *line2 = line1 + lineLength;
+    const float *line3 = line2 + lineLength;
+    float *result = outputBlock + static_cast< size_t >( i ) * columns;
+    for ( int j = 0; j < columns; ++j )
+    {
+      result[j] = totalCurvature( line1[j], line1[j + 1], line1[j + 2], line2[j], line2[j + 1], line2[j + 2], line3[j], line3[j + 1], line3[j + 2],
+                                  mInputNodataValue, mOutputNodataValue, mCellSizeX, mCellSizeY );
+    }
+  }
 }
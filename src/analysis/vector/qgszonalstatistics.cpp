@@ -24,9 +24,281 @@
 #include "qgsrasterdataprovider.h"
 #include "qgsrasterlayer.h"
 #include "qgsrasterblock.h"
+#include "qgsstatisticalsummary.h"
 #include "qgslogger.h"
 
 #include <QFile>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+///@cond PRIVATE
+
+/**
+ * Burns a polygon into a raster grid with a scanline fill.
+ *
+ * Cells are assigned to the polygon from the crossings of the polygon edges with each row
+ * of cell centers, so that no containment test is needed for single cells. The exact area of
+ * coverage is only calculated for cells which are crossed by the polygon boundary.
+ */
+class QgsZonalStatisticsRasterizer
+{
+  public:
+
+    explicit QgsZonalStatisticsRasterizer( const QgsGeometry &polygon )
+    {
+      if ( polygon.isMultipart() )
+        mParts = polygon.asMultiPolygon();
+      else
+        mParts << polygon.asPolygon();
+
+      Q_FOREACH ( const QgsPolygon &part, mParts )
+      {
+        Q_FOREACH ( const QgsPolyline &ring, part )
+        {
+          for ( int i = 1; i < ring.size(); ++i )
+          {
+            mEdges.push_back( Edge{ ring.at( i - 1 ).x(), ring.at( i - 1 ).y(), ring.at( i ).x(), ring.at( i ).y() } );
+          }
+        }
+      }
+      std::sort( mEdges.begin(), mEdges.end(), []( const Edge & a, const Edge & b ) { return a.yMax() > b.yMax(); } );
+    }
+
+    /**
+     * Calls \a cell( row, column ) for all cells of a grid with \a rows rows whose center is inside of the polygon.
+     * \a centersX are the ascending x coordinates of the cell centers of each column and \a firstCenterY is the y coordinate
+     * of the cell centers of the first row. Centers on the polygon boundary are not inside.
+     */
+    template <typename CellFunction>
+    void cellsWithCenterInside( const std::vector< double > &centersX, double firstCenterY, double cellSizeY, int rows, CellFunction cell ) const
+    {
+      const int columns = static_cast< int >( centersX.size() );
+      std::vector< const Edge * > active;
+      std::vector< double > crossings;
+      std::vector< std::pair< double, double > > onBoundary;
+      std::vector< char > inside( columns );
+      size_t nextEdge = 0;
+
+      double centerY = firstCenterY;
+      for ( int row = 0; row < rows; ++row, centerY -= cellSizeY )
+      {
+        // edges are sorted by their maximum y, scanlines move downwards
+        while ( nextEdge < mEdges.size() && mEdges[ nextEdge ].yMax() >= centerY )
+        {
+          active.push_back( &mEdges[ nextEdge++ ] );
+        }
+        active.erase( std::remove_if( active.begin(), active.end(), [centerY]( const Edge * edge ) { return edge->yMin() > centerY; } ), active.end() );
+        if ( active.empty() )
+        {
+          continue;
+        }
+
+        crossings.clear();
+        onBoundary.clear();
+        for ( const Edge *edge : active )
+        {
+          if ( edge->y1 == edge->y2 )
+          {
+            if ( edge->y1 == centerY )
+              onBoundary.push_back( std::make_pair( std::min( edge->x1, edge->x2 ), std::max( edge->x1, edge->x2 ) ) );
+            continue;
+          }
+          if ( ( edge->y1 > centerY ) != ( edge->y2 > centerY ) )
+          {
+            crossings.push_back( edge->x1 + ( centerY - edge->y1 ) * ( edge->x2 - edge->x1 ) / ( edge->y2 - edge->y1 ) );
+          }
+          if ( edge->y1 == centerY )
+          {
+            onBoundary.push_back( std::make_pair( edge->x1, edge->x1 ) );
+          }
+        }
+        if ( crossings.size() < 2 )
+        {
+          continue;
+        }
+        std::sort( crossings.begin(), crossings.end() );
+
+        // even-odd rule, centers strictly between a pair of crossings are inside
+        std::fill( inside.begin(), inside.end(), 0 );
+        for ( size_t k = 0; k + 1 < crossings.size(); k += 2 )
+        {
+          std::vector< double >::const_iterator first = std::upper_bound( centersX.begin(), centersX.end(), crossings[ k ] );
+          std::vector< double >::const_iterator last = std::lower_bound( first, centersX.end(), crossings[ k + 1 ] );
+          std::fill( inside.begin() + ( first - centersX.begin() ), inside.begin() + ( last - centersX.begin() ), 1 );
+        }
+        for ( const std::pair< double, double > &range : onBoundary )
+        {
+          std::vector< double >::const_iterator first = std::lower_bound( centersX.begin(), centersX.end(), range.first );
+          std::vector< double >::const_iterator last = std::upper_bound( first, centersX.end(), range.second );
+          std::fill( inside.begin() + ( first - centersX.begin() ), inside.begin() + ( last - centersX.begin() ), 0 );
+        }
+
+        for ( int column = 0; column < columns; ++column )
+        {
+          if ( inside[ column ] )
+            cell( row, column );
+        }
+      }
+    }
+
+    /**
+     * Sets the entries of \a boundary ( row * \a columns + column ) to 1 for all cells of the grid which are
+     * crossed by an edge of the polygon. The grid starts at \a xMin, \a yMax.
+     */
+    void markBoundaryCells( double xMin, double yMax, double cellSizeX, double cellSizeY, int columns, int rows, std::vector< char > &boundary ) const
+    {
+      for ( const Edge &edge : mEdges )
+      {
+        const double edgeYMax = edge.yMax();
+        const double edgeYMin = edge.yMin();
+        const int firstRow = std::max( 0, gridIndex( ( yMax - edgeYMax ) / cellSizeY, rows ) );
+        const int lastRow = std::min( rows - 1, gridIndex( ( yMax - edgeYMin ) / cellSizeY, rows ) );
+        for ( int row = firstRow; row <= lastRow; ++row )
+        {
+          // part of the edge inside of the row
+          double x1 = edge.x1;
+          double x2 = edge.x2;
+          if ( edge.y1 != edge.y2 )
+          {
+            const double top = std::min( edgeYMax, yMax - row * cellSizeY );
+            const double bottom = std::max( edgeYMin, yMax - ( row + 1 ) * cellSizeY );
+            x1 = edge.x1 + ( top - edge.y1 ) * ( edge.x2 - edge.x1 ) / ( edge.y2 - edge.y1 );
+            x2 = edge.x1 + ( bottom - edge.y1 ) * ( edge.x2 - edge.x1 ) / ( edge.y2 - edge.y1 );
+          }
+          const int firstColumn = std::max( 0, gridIndex( ( std::min( x1, x2 ) - xMin ) / cellSizeX, columns ) );
+          const int lastColumn = std::min( columns - 1, gridIndex( ( std::max( x1, x2 ) - xMin ) / cellSizeX, columns ) );
+          for ( int column = firstColumn; column <= lastColumn; ++column )
+          {
+            boundary[ static_cast< size_t >( row ) * columns + column ] = 1;
+          }
+        }
+      }
+    }
+
+    //! Returns the area of the intersection of the polygon and \a rect
+    double intersectionArea( const QgsRectangle &rect ) const
+    {
+      double area = 0;
+      Q_FOREACH ( const QgsPolygon &part, mParts )
+      {
+        double partArea = 0;
+        for ( int ring = 0; ring < part.size(); ++ring )
+        {
+          // the first ring is the exterior ring, all others are holes
+          partArea += ( ring == 0 ? 1 : -1 ) * clippedRingArea( part.at( ring ), rect );
+        }
+        area += std::max( 0.0, partArea );
+      }
+      return area;
+    }
+
+  private:
+
+    struct Edge
+    {
+      double x1;
+      double y1;
+      double x2;
+      double y2;
+
+      double yMin() const { return std::min( y1, y2 ); }
+      double yMax() const { return std::max( y1, y2 ); }
+    };
+
+    //! Tests whether \a point is on the inner side of a \a side of \a rect (left, right, bottom, top)
+    static bool insideSide( const QgsPointXY &point, const QgsRectangle &rect, int side )
+    {
+      switch ( side )
+      {
+        case 0:
+          return point.x() >= rect.xMinimum();
+        case 1:
+          return point.x() <= rect.xMaximum();
+        case 2:
+          return point.y() >= rect.yMinimum();
+        default:
+          return point.y() <= rect.yMaximum();
+      }
+    }
+
+    //! Returns the intersection of the segment from \a a to \a b with the line through a \a side of \a rect
+    static QgsPointXY sideIntersection( const QgsPointXY &a, const QgsPointXY &b, const QgsRectangle &rect, int side )
+    {
+      if ( side < 2 )
+      {
+        const double x = side == 0 ? rect.xMinimum() : rect.xMaximum();
+        return QgsPointXY( x, a.y() + ( x - a.x() ) * ( b.y() - a.y() ) / ( b.x() - a.x() ) );
+      }
+      const double y = side == 2 ? rect.yMinimum() : rect.yMaximum();
+      return QgsPointXY( a.x() + ( y - a.y() ) * ( b.x() - a.x() ) / ( b.y() - a.y() ), y );
+    }
+
+    //! Returns the index of the grid row or column containing \a position, clamped to [-1, count]
+    static int gridIndex( double position, int count )
+    {
+      return static_cast< int >( std::max( -1.0, std::min( static_cast< double >( count ), std::floor( position ) ) ) );
+    }
+
+    //! Returns the area of \a ring clipped to \a rect, using Sutherland-Hodgman clipping
+    static double clippedRingArea( const QgsPolyline &ring, const QgsRectangle &rect )
+    {
+      std::vector< QgsPointXY > points( ring.constBegin(), ring.constEnd() );
+      if ( points.size() > 1 && points.front() == points.back() )
+        points.pop_back();
+
+      // clip against the four sides of the rectangle one after another
+      std::vector< QgsPointXY > clipped;
+      for ( int side = 0; side < 4 && !points.empty(); ++side )
+      {
+        clipped.clear();
+        for ( size_t i = 0; i < points.size(); ++i )
+        {
+          const QgsPointXY &current = points[ i ];
+          const QgsPointXY &previous = points[( i + points.size() - 1 ) % points.size()];
+          const bool currentInside = insideSide( current, rect, side );
+          const bool previousInside = insideSide( previous, rect, side );
+          if ( currentInside != previousInside )
+            clipped.push_back( sideIntersection( previous, current, rect, side ) );
+          if ( currentInside )
+            clipped.push_back( current );
+        }
+        points.swap( clipped );
+      }
+
+      // shoelace formula
+      double area = 0;
+      for ( size_t i = 0; i < points.size(); ++i )
+      {
+        const QgsPointXY &a = points[ i ];
+        const QgsPointXY &b = points[( i + 1 ) % points.size()];
+        area += a.x() * b.y() - b.x() * a.y();
+      }
+      return std::fabs( area ) / 2.0;
+    }
+
+    QgsMultiPolygon mParts;
+    //! Polygon edges, sorted by their maximum y in descending order
+    std::vector< Edge > mEdges;
+};
+
+//! Returns the x coordinates of \a count cell centers, accumulated the same way as cell positions are advanced row by row
+static std::vector< double > cellCenters( double firstCenter, double cellSize, int count )
+{
+  std::vector< double > centers( count );
+  double center = firstCenter;
+  for ( int i = 0; i < count; ++i, center += cellSize )
+  {
+    centers[ i ] = center;
+  }
+  return centers;
+}
+
+///@endcond
 
 QgsZonalStatistics::QgsZonalStatistics( QgsVectorLayer *polygonLayer, QgsRasterLayer *rasterLayer, const QString &attributePrefix, int rasterBand, QgsZonalStatistics::Statistics stats )
   : mRasterLayer( rasterLayer )
@@ -78,123 +350,66 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
   QgsRectangle rasterBBox = mRasterProvider->extent();
 
   //add the new fields to the provider
+  struct StatisticField
+  {
+    Statistic statistic;
+    QString name;
+    QVariant::Type type;
+    QString typeName;
+  };
+  const QList< StatisticField > statisticFields = QList< StatisticField >()
+      << StatisticField{ Count, QStringLiteral( "count" ), QVariant::Double, QStringLiteral( "double precision" ) }
+      << StatisticField{ Sum, QStringLiteral( "sum" ), QVariant::Double, QStringLiteral( "double precision" ) }
+      << StatisticField{ Mean, QStringLiteral( "mean" ), QVariant::Double, QStringLiteral( "double precision" ) }
+      << StatisticField{ Median, QStringLiteral( "median" ), QVariant::Double, QStringLiteral( "double precision" ) }
+      << StatisticField{ StDev, QStringLiteral( "stdev" ), QVariant::Double, QStringLiteral( "double precision" ) }
+      << StatisticField{ Min, QStringLiteral( "min" ), QVariant::Double, QStringLiteral( "double precision" ) }
+      << StatisticField{ Max, QStringLiteral( "max" ), QVariant::Double, QStringLiteral( "double precision" ) }
+      << StatisticField{ Range, QStringLiteral( "range" ), QVariant::Double, QStringLiteral( "double precision" ) }
+      << StatisticField{ Minority, QStringLiteral( "minority" ), QVariant::Double, QStringLiteral( "double precision" ) }
+      << StatisticField{ Majority, QStringLiteral( "majority" ), QVariant::Double, QStringLiteral( "double precision" ) }
+      << StatisticField{ Variety, QStringLiteral( "variety" ), QVariant::Int, QStringLiteral( "int" ) }
+      << StatisticField{ Variance, QStringLiteral( "variance" ), QVariant::Double, QStringLiteral( "double precision" ) }
+      << StatisticField{ FirstQuartile, QStringLiteral( "q1" ), QVariant::Double, QStringLiteral( "double precision" ) }
+      << StatisticField{ ThirdQuartile, QStringLiteral( "q3" ), QVariant::Double, QStringLiteral( "double precision" ) };
+
   QList<QgsField> newFieldList;
-  QString countFieldName;
-  if ( mStatistics & QgsZonalStatistics::Count )
+  QMap< Statistic, QString > fieldNames;
+  Q_FOREACH ( const StatisticField &field, statisticFields )
   {
-    countFieldName = getUniqueFieldName( mAttributePrefix + "count", newFieldList );
-    QgsField countField( countFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
-    newFieldList.push_back( countField );
-  }
-  QString sumFieldName;
-  if ( mStatistics & QgsZonalStatistics::Sum )
-  {
-    sumFieldName = getUniqueFieldName( mAttributePrefix + "sum", newFieldList );
-    QgsField sumField( sumFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
-    newFieldList.push_back( sumField );
-  }
-  QString meanFieldName;
-  if ( mStatistics & QgsZonalStatistics::Mean )
-  {
-    meanFieldName = getUniqueFieldName( mAttributePrefix + "mean", newFieldList );
-    QgsField meanField( meanFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
-    newFieldList.push_back( meanField );
-  }
-  QString medianFieldName;
-  if ( mStatistics & QgsZonalStatistics::Median )
-  {
-    medianFieldName = getUniqueFieldName( mAttributePrefix + "median", newFieldList );
-    QgsField medianField( medianFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
-    newFieldList.push_back( medianField );
-  }
-  QString stdevFieldName;
-  if ( mStatistics & QgsZonalStatistics::StDev )
-  {
-    stdevFieldName = getUniqueFieldName( mAttributePrefix + "stdev", newFieldList );
-    QgsField stdField( stdevFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
-    newFieldList.push_back( stdField );
-  }
-  QString minFieldName;
-  if ( mStatistics & QgsZonalStatistics::Min )
-  {
-    minFieldName = getUniqueFieldName( mAttributePrefix + "min", newFieldList );
-    QgsField minField( minFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
-    newFieldList.push_back( minField );
-  }
-  QString maxFieldName;
-  if ( mStatistics & QgsZonalStatistics::Max )
-  {
-    maxFieldName = getUniqueFieldName( mAttributePrefix + "max", newFieldList );
-    QgsField maxField( maxFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
-    newFieldList.push_back( maxField );
-  }
-  QString rangeFieldName;
-  if ( mStatistics & QgsZonalStatistics::Range )
-  {
-    rangeFieldName = getUniqueFieldName( mAttributePrefix + "range", newFieldList );
-    QgsField rangeField( rangeFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
-    newFieldList.push_back( rangeField );
-  }
-  QString minorityFieldName;
-  if ( mStatistics & QgsZonalStatistics::Minority )
-  {
-    minorityFieldName = getUniqueFieldName( mAttributePrefix + "minority", newFieldList );
-    QgsField minorityField( minorityFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
-    newFieldList.push_back( minorityField );
-  }
-  QString majorityFieldName;
-  if ( mStatistics & QgsZonalStatistics::Majority )
-  {
-    majorityFieldName = getUniqueFieldName( mAttributePrefix + "majority", newFieldList );
-    QgsField majField( majorityFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
-    newFieldList.push_back( majField );
-  }
-  QString varietyFieldName;
-  if ( mStatistics & QgsZonalStatistics::Variety )
-  {
-    varietyFieldName = getUniqueFieldName( mAttributePrefix + "variety", newFieldList );
-    QgsField varietyField( varietyFieldName, QVariant::Int, QStringLiteral( "int" ) );
-    newFieldList.push_back( varietyField );
-  }
-  QString varianceFieldName;
-  if ( mStatistics & QgsZonalStatistics::Variance )
-  {
-    varianceFieldName = getUniqueFieldName( mAttributePrefix + "variance", newFieldList );
-    QgsField varianceField( varianceFieldName, QVariant::Double, QStringLiteral( "double precision" ) );
-    newFieldList.push_back( varianceField );
+    if ( !( mStatistics & field.statistic ) )
+      continue;
+
+    QString fieldName = getUniqueFieldName( mAttributePrefix + field.name, newFieldList );
+    fieldNames.insert( field.statistic, fieldName );
+    newFieldList.push_back( QgsField( fieldName, field.type, field.typeName ) );
   }
   vectorProvider->addAttributes( newFieldList );
 
   //index of the new fields
-  int countIndex = mStatistics & QgsZonalStatistics::Count ? vectorProvider->fieldNameIndex( countFieldName ) : -1;
-  int sumIndex = mStatistics & QgsZonalStatistics::Sum ? vectorProvider->fieldNameIndex( sumFieldName ) : -1;
-  int meanIndex = mStatistics & QgsZonalStatistics::Mean ? vectorProvider->fieldNameIndex( meanFieldName ) : -1;
-  int medianIndex = mStatistics & QgsZonalStatistics::Median ? vectorProvider->fieldNameIndex( medianFieldName ) : -1;
-  int stdevIndex = mStatistics & QgsZonalStatistics::StDev ? vectorProvider->fieldNameIndex( stdevFieldName ) : -1;
-  int minIndex = mStatistics & QgsZonalStatistics::Min ? vectorProvider->fieldNameIndex( minFieldName ) : -1;
-  int maxIndex = mStatistics & QgsZonalStatistics::Max ? vectorProvider->fieldNameIndex( maxFieldName ) : -1;
-  int rangeIndex = mStatistics & QgsZonalStatistics::Range ? vectorProvider->fieldNameIndex( rangeFieldName ) : -1;
-  int minorityIndex = mStatistics & QgsZonalStatistics::Minority ? vectorProvider->fieldNameIndex( minorityFieldName ) : -1;
-  int majorityIndex = mStatistics & QgsZonalStatistics::Majority ? vectorProvider->fieldNameIndex( majorityFieldName ) : -1;
-  int varietyIndex = mStatistics & QgsZonalStatistics::Variety ? vectorProvider->fieldNameIndex( varietyFieldName ) : -1;
-  int varianceIndex = mStatistics & QgsZonalStatistics::Variance ? vectorProvider->fieldNameIndex( varianceFieldName ) : -1;
-
-  if ( ( mStatistics & QgsZonalStatistics::Count && countIndex == -1 )
-       || ( mStatistics & QgsZonalStatistics::Sum && sumIndex == -1 )
-       || ( mStatistics & QgsZonalStatistics::Mean && meanIndex == -1 )
-       || ( mStatistics & QgsZonalStatistics::Median && medianIndex == -1 )
-       || ( mStatistics & QgsZonalStatistics::StDev && stdevIndex == -1 )
-       || ( mStatistics & QgsZonalStatistics::Min && minIndex == -1 )
-       || ( mStatistics & QgsZonalStatistics::Max && maxIndex == -1 )
-       || ( mStatistics & QgsZonalStatistics::Range && rangeIndex == -1 )
-       || ( mStatistics & QgsZonalStatistics::Minority && minorityIndex == -1 )
-       || ( mStatistics & QgsZonalStatistics::Majority && majorityIndex == -1 )
-       || ( mStatistics & QgsZonalStatistics::Variety && varietyIndex == -1 )
-       || ( mStatistics & QgsZonalStatistics::Variance && varianceIndex == -1 )
-     )
-  {
-    //failed to create a required field
-    return 8;
+  QMap< Statistic, int > fieldIndexes;
+  for ( QMap< Statistic, QString >::const_iterator it = fieldNames.constBegin(); it != fieldNames.constEnd(); ++it )
+  {
+    int index = vectorProvider->fieldNameIndex( it.value() );
+    if ( index == -1 )
+    {
+      //failed to create a required field
+      return 8;
+    }
+    fieldIndexes.insert( it.key(), index );
+  }
+
+  // raster data providers can not be used by several threads at the same time, each worker reads from its own copy
+  const int workerCount = std::max( 1, QThread::idealThreadCount() );
+  std::vector< std::unique_ptr< QgsRasterDataProvider > > workerProviders;
+  for ( int worker = 0; worker < workerCount; ++worker )
+  {
+    QgsRasterDataProvider *provider = dynamic_cast< QgsRasterDataProvider * >( mRasterProvider->clone() );
+    if ( !provider )
+    {
+      return 3;
+    }
+    workerProviders.emplace_back( provider );
   }
 
   //progress dialog
@@ -208,138 +423,81 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
 
   bool statsStoreValues = ( mStatistics & QgsZonalStatistics::Median ) ||
                           ( mStatistics & QgsZonalStatistics::StDev ) ||
-                          ( mStatistics & QgsZonalStatistics::Variance );
+                          ( mStatistics & QgsZonalStatistics::Variance ) ||
+                          ( mStatistics & QgsZonalStatistics::FirstQuartile ) ||
+                          ( mStatistics & QgsZonalStatistics::ThirdQuartile );
   bool statsStoreValueCount = ( mStatistics & QgsZonalStatistics::Minority ) ||
                               ( mStatistics & QgsZonalStatistics::Majority );
 
-  FeatureStats featureStats( statsStoreValues, statsStoreValueCount );
-  int featureCounter = 0;
+  // features are read in batches, the features of a batch are distributed over the workers
+  const int batchSize = workerCount * 64;
+  QVector< QgsFeatureId > batchIds;
+  QVector< QgsGeometry > batchGeometries;
+  std::vector< QgsAttributeMap > batchAttributes;
+  std::vector< char > batchCalculated;
+  QVector< int > workers;
+  for ( int worker = 0; worker < workerCount; ++worker )
+  {
+    workers << worker;
+  }
 
-  QgsChangedAttributesMap changeMap;
-  while ( fi.nextFeature( f ) )
+  auto processWorker = [&]( const int &worker )
   {
-    if ( feedback && feedback->isCanceled() )
+    FeatureStats featureStats( statsStoreValues, statsStoreValueCount );
+    QgsRasterDataProvider *provider = workerProviders[ worker ].get();
+    for ( int i = worker; i < batchGeometries.size(); i += workerCount )
     {
-      break;
-    }
+      if ( feedback && feedback->isCanceled() )
+      {
+        return;
+      }
 
-    if ( feedback )
-    {
-      feedback->setProgress( 100.0 * static_cast< double >( featureCounter ) / featureCount );
+      if ( statisticsForFeature( batchGeometries.at( i ), provider, rasterBBox, nCellsXProvider, nCellsYProvider, cellsizeX, cellsizeY, featureStats ) )
+      {
+        batchAttributes[ i ] = statisticsAttributes( featureStats, fieldIndexes );
+        batchCalculated[ i ] = 1;
+      }
     }
+  };
 
-    if ( !f.hasGeometry() )
+  int featureCounter = 0;
+  QgsChangedAttributesMap changeMap;
+  bool hasMoreFeatures = true;
+  while ( hasMoreFeatures )
+  {
+    batchIds.clear();
+    batchGeometries.clear();
+    while ( batchIds.size() < batchSize && ( hasMoreFeatures = fi.nextFeature( f ) ) )
     {
-      ++featureCounter;
-      continue;
+      batchIds << f.id();
+      batchGeometries << f.geometry();
     }
-    QgsGeometry featureGeometry = f.geometry();
-
-    QgsRectangle featureRect = featureGeometry.boundingBox().intersect( &rasterBBox );
-    if ( featureRect.isEmpty() )
+    if ( batchIds.isEmpty() )
     {
-      ++featureCounter;
-      continue;
+      break;
     }
 
-    int offsetX, offsetY, nCellsX, nCellsY;
-    if ( cellInfoForBBox( rasterBBox, featureRect, cellsizeX, cellsizeY, offsetX, offsetY, nCellsX, nCellsY ) != 0 )
-    {
-      ++featureCounter;
-      continue;
-    }
+    batchAttributes.assign( batchIds.size(), QgsAttributeMap() );
+    batchCalculated.assign( batchIds.size(), 0 );
+    QtConcurrent::blockingMap( workers, processWorker );
 
-    //avoid access to cells outside of the raster (may occur because of rounding)
-    if ( ( offsetX + nCellsX ) > nCellsXProvider )
-    {
-      nCellsX = nCellsXProvider - offsetX;
-    }
-    if ( ( offsetY + nCellsY ) > nCellsYProvider )
+    if ( feedback && feedback->isCanceled() )
     {
-      nCellsY = nCellsYProvider - offsetY;
+      break;
     }
 
-    statisticsFromMiddlePointTest( featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
-                                   rasterBBox, featureStats );
-
-    if ( featureStats.count <= 1 )
+    //write the statistics value to the vector data provider
+    for ( int i = 0; i < batchIds.size(); ++i )
     {
-      //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
-      statisticsFromPreciseIntersection( featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
-                                         rasterBBox, featureStats );
+      if ( batchCalculated[ i ] )
+        changeMap.insert( batchIds.at( i ), batchAttributes[ i ] );
     }
 
-    //write the statistics value to the vector data provider
-    QgsAttributeMap changeAttributeMap;
-    if ( mStatistics & QgsZonalStatistics::Count )
-      changeAttributeMap.insert( countIndex, QVariant( featureStats.count ) );
-    if ( mStatistics & QgsZonalStatistics::Sum )
-      changeAttributeMap.insert( sumIndex, QVariant( featureStats.sum ) );
-    if ( featureStats.count > 0 )
+    featureCounter += batchIds.size();
+    if ( feedback )
     {
-      double mean = featureStats.sum / featureStats.count;
-      if ( mStatistics & QgsZonalStatistics::Mean )
-        changeAttributeMap.insert( meanIndex, QVariant( mean ) );
-      if ( mStatistics & QgsZonalStatistics::Median )
-      {
-        std::sort( featureStats.values.begin(), featureStats.values.end() );
-        int size =  featureStats.values.count();
-        bool even = ( size % 2 ) < 1;
-        double medianValue;
-        if ( even )
-        {
-          medianValue = ( featureStats.values.at( size / 2 - 1 ) + featureStats.values.at( size / 2 ) ) / 2;
-        }
-        else //odd
-        {
-          medianValue = featureStats.values.at( ( size + 1 ) / 2 - 1 );
-        }
-        changeAttributeMap.insert( medianIndex, QVariant( medianValue ) );
-      }
-      if ( mStatistics & QgsZonalStatistics::StDev || mStatistics & QgsZonalStatistics::Variance )
-      {
-        double sumSquared = 0;
-        for ( int i = 0; i < featureStats.values.count(); ++i )
-        {
-          double diff = featureStats.values.at( i ) - mean;
-          sumSquared += diff * diff;
-        }
-        double variance = sumSquared / featureStats.values.count();
-        if ( mStatistics & QgsZonalStatistics::StDev )
-        {
-          double stdev = std::pow( variance, 0.5 );
-          changeAttributeMap.insert( stdevIndex, QVariant( stdev ) );
-        }
-        if ( mStatistics & QgsZonalStatistics::Variance )
-          changeAttributeMap.insert( varianceIndex, QVariant( variance ) );
-      }
-      if ( mStatistics & QgsZonalStatistics::Min )
-        changeAttributeMap.insert( minIndex, QVariant( featureStats.min ) );
-      if ( mStatistics & QgsZonalStatistics::Max )
-        changeAttributeMap.insert( maxIndex, QVariant( featureStats.max ) );
-      if ( mStatistics & QgsZonalStatistics::Range )
-        changeAttributeMap.insert( rangeIndex, QVariant( featureStats.max - featureStats.min ) );
-      if ( mStatistics & QgsZonalStatistics::Minority || mStatistics & QgsZonalStatistics::Majority )
-      {
-        QList<int> vals = featureStats.valueCount.values();
-        std::sort( vals.begin(), vals.end() );
-        if ( mStatistics & QgsZonalStatistics::Minority )
-        {
-          float minorityKey = featureStats.valueCount.key( vals.first() );
-          changeAttributeMap.insert( minorityIndex, QVariant( minorityKey ) );
-        }
-        if ( mStatistics & QgsZonalStatistics::Majority )
-        {
-          float majKey = featureStats.valueCount.key( vals.last() );
-          changeAttributeMap.insert( majorityIndex, QVariant( majKey ) );
-        }
-      }
-      if ( mStatistics & QgsZonalStatistics::Variety )
-        changeAttributeMap.insert( varietyIndex, QVariant( featureStats.valueCount.count() ) );
+      feedback->setProgress( 100.0 * static_cast< double >( featureCounter ) / featureCount );
     }
-
-    changeMap.insert( f.id(), changeAttributeMap );
-    ++featureCounter;
   }
 
   vectorProvider->changeAttributeValues( changeMap );
@@ -359,6 +517,127 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
   return 0;
 }
 
+bool QgsZonalStatistics::statisticsForFeature( const QgsGeometry &poly, QgsRasterDataProvider *provider, const QgsRectangle &rasterBBox,
+    int nCellsXProvider, int nCellsYProvider, double cellSizeX, double cellSizeY, FeatureStats &stats ) const
+{
+  stats.reset();
+
+  QgsRectangle featureRect = poly.boundingBox().intersect( &rasterBBox );
+  if ( poly.isNull() || featureRect.isEmpty() )
+  {
+    return false;
+  }
+
+  int offsetX, offsetY, nCellsX, nCellsY;
+  if ( cellInfoForBBox( rasterBBox, featureRect, cellSizeX, cellSizeY, offsetX, offsetY, nCellsX, nCellsY ) != 0 )
+  {
+    return false;
+  }
+
+  //avoid access to cells outside of the raster (may occur because of rounding)
+  if ( ( offsetX + nCellsX ) > nCellsXProvider )
+  {
+    nCellsX = nCellsXProvider - offsetX;
+  }
+  if ( ( offsetY + nCellsY ) > nCellsYProvider )
+  {
+    nCellsY = nCellsYProvider - offsetY;
+  }
+  if ( nCellsX <= 0 || nCellsY <= 0 )
+  {
+    return true;
+  }
+
+  // read the cells covering the feature at once, with an extent aligned to the raster grid so that no resampling happens
+  QgsRectangle blockExtent( rasterBBox.xMinimum() + offsetX * cellSizeX, rasterBBox.yMaximum() - ( offsetY + nCellsY ) * cellSizeY,
+                            rasterBBox.xMinimum() + ( offsetX + nCellsX ) * cellSizeX, rasterBBox.yMaximum() - offsetY * cellSizeY );
+  std::unique_ptr< QgsRasterBlock > block( provider->block( mRasterBand, blockExtent, nCellsX, nCellsY ) );
+  if ( !block || !block->isValid() )
+  {
+    return true;
+  }
+
+  statisticsFromMiddlePointTest( poly, offsetX, offsetY, nCellsX, nCellsY, cellSizeX, cellSizeY, rasterBBox, block.get(), stats );
+
+  if ( stats.count <= 1 )
+  {
+    //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
+    statisticsFromPreciseIntersection( poly, offsetX, offsetY, nCellsX, nCellsY, cellSizeX, cellSizeY, rasterBBox, block.get(), stats );
+  }
+  return true;
+}
+
+QgsAttributeMap QgsZonalStatistics::statisticsAttributes( FeatureStats &stats, const QMap< Statistic, int > &fieldIndexes ) const
+{
+  QgsAttributeMap changeAttributeMap;
+  if ( mStatistics & QgsZonalStatistics::Count )
+    changeAttributeMap.insert( fieldIndexes.value( Count ), QVariant( stats.count ) );
+  if ( mStatistics & QgsZonalStatistics::Sum )
+    changeAttributeMap.insert( fieldIndexes.value( Sum ), QVariant( stats.sum ) );
+  if ( stats.count > 0 )
+  {
+    double mean = stats.sum / stats.count;
+    if ( mStatistics & QgsZonalStatistics::Mean )
+      changeAttributeMap.insert( fieldIndexes.value( Mean ), QVariant( mean ) );
+    if ( mStatistics & QgsZonalStatistics::Median || mStatistics & QgsZonalStatistics::FirstQuartile || mStatistics & QgsZonalStatistics::ThirdQuartile )
+    {
+      QgsStatisticalSummary summary( QgsStatisticalSummary::Median | QgsStatisticalSummary::FirstQuartile | QgsStatisticalSummary::ThirdQuartile );
+      QList< double > values;
+      values.reserve( stats.values.count() );
+      Q_FOREACH ( float value, stats.values )
+        values << value;
+      summary.calculate( values );
+      if ( mStatistics & QgsZonalStatistics::Median )
+        changeAttributeMap.insert( fieldIndexes.value( Median ), QVariant( summary.median() ) );
+      if ( mStatistics & QgsZonalStatistics::FirstQuartile )
+        changeAttributeMap.insert( fieldIndexes.value( FirstQuartile ), QVariant( summary.firstQuartile() ) );
+      if ( mStatistics & QgsZonalStatistics::ThirdQuartile )
+        changeAttributeMap.insert( fieldIndexes.value( ThirdQuartile ), QVariant( summary.thirdQuartile() ) );
+    }
+    if ( mStatistics & QgsZonalStatistics::StDev || mStatistics & QgsZonalStatistics::Variance )
+    {
+      double sumSquared = 0;
+      for ( int i = 0; i < stats.values.count(); ++i )
+      {
+        double diff = stats.values.at( i ) - mean;
+        sumSquared += diff * diff;
+      }
+      double variance = sumSquared / stats.values.count();
+      if ( mStatistics & QgsZonalStatistics::StDev )
+      {
+        double stdev = std::pow( variance, 0.5 );
+        changeAttributeMap.insert( fieldIndexes.value( StDev ), QVariant( stdev ) );
+      }
+      if ( mStatistics & QgsZonalStatistics::Variance )
+        changeAttributeMap.insert( fieldIndexes.value( Variance ), QVariant( variance ) );
+    }
+    if ( mStatistics & QgsZonalStatistics::Min )
+      changeAttributeMap.insert( fieldIndexes.value( Min ), QVariant( stats.min ) );
+    if ( mStatistics & QgsZonalStatistics::Max )
+      changeAttributeMap.insert( fieldIndexes.value( Max ), QVariant( stats.max ) );
+    if ( mStatistics & QgsZonalStatistics::Range )
+      changeAttributeMap.insert( fieldIndexes.value( Range ), QVariant( stats.max - stats.min ) );
+    if ( mStatistics & QgsZonalStatistics::Minority || mStatistics & QgsZonalStatistics::Majority )
+    {
+      QList<int> vals = stats.valueCount.values();
+      std::sort( vals.begin(), vals.end() );
+      if ( mStatistics & QgsZonalStatistics::Minority )
+      {
+        float minorityKey = stats.valueCount.key( vals.first() );
+        changeAttributeMap.insert( fieldIndexes.value( Minority ), QVariant( minorityKey ) );
+      }
+      if ( mStatistics & QgsZonalStatistics::Majority )
+      {
+        float majKey = stats.valueCount.key( vals.last() );
+        changeAttributeMap.insert( fieldIndexes.value( Majority ), QVariant( majKey ) );
+      }
+    }
+    if ( mStatistics & QgsZonalStatistics::Variety )
+      changeAttributeMap.insert( fieldIndexes.value( Variety ), QVariant( stats.valueCount.count() ) );
+  }
+  return changeAttributeMap;
+}
+
 int QgsZonalStatistics::cellInfoForBBox( const QgsRectangle &rasterBBox, const QgsRectangle &featureBBox, double cellSizeX, double cellSizeY,
     int &offsetX, int &offsetY, int &nCellsX, int &nCellsY ) const
 {
@@ -387,110 +666,79 @@ int QgsZonalStatistics::cellInfoForBBox( const QgsRectangle &rasterBBox, const Q
 }
 
 void QgsZonalStatistics::statisticsFromMiddlePointTest( const QgsGeometry &poly, int pixelOffsetX,
-    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats )
+    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox,
+    const QgsRasterBlock *block, FeatureStats &stats ) const
 {
-  double cellCenterX, cellCenterY;
-
-  cellCenterY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
   stats.reset();
 
-  GEOSGeometry *polyGeos = poly.exportToGeos();
-  if ( !polyGeos )
-  {
-    return;
-  }
-
-  GEOSContextHandle_t geosctxt = QgsGeometry::getGEOSHandler();
-  const GEOSPreparedGeometry *polyGeosPrepared = GEOSPrepare_r( geosctxt, polyGeos );
-  if ( !polyGeosPrepared )
-  {
-    GEOSGeom_destroy_r( geosctxt, polyGeos );
-    return;
-  }
-
-  GEOSCoordSequence *cellCenterCoords = nullptr;
-  GEOSGeometry *currentCellCenter = nullptr;
-
-  QgsRectangle featureBBox = poly.boundingBox().intersect( &rasterBBox );
-  QgsRectangle intersectBBox = rasterBBox.intersect( &featureBBox );
+  QgsZonalStatisticsRasterizer rasterizer( poly );
+  const double firstCenterY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
+  const std::vector< double > centersX = cellCenters( rasterBBox.xMinimum() + pixelOffsetX * cellSizeX + cellSizeX / 2, cellSizeX, nCellsX );
 
-  QgsRasterBlock *block = mRasterProvider->block( mRasterBand, intersectBBox, nCellsX, nCellsY );
-  for ( int i = 0; i < nCellsY; ++i )
+  rasterizer.cellsWithCenterInside( centersX, firstCenterY, cellSizeY, nCellsY, [this, block, &stats]( int i, int j )
   {
-    cellCenterX = rasterBBox.xMinimum() + pixelOffsetX * cellSizeX + cellSizeX / 2;
-    for ( int j = 0; j < nCellsX; ++j )
+    double value = block->value( i, j );
+    if ( validPixel( value ) )
     {
-      if ( validPixel( block->value( i, j ) ) )
-      {
-        GEOSGeom_destroy_r( geosctxt, currentCellCenter );
-        cellCenterCoords = GEOSCoordSeq_create_r( geosctxt, 1, 2 );
-        GEOSCoordSeq_setX_r( geosctxt, cellCenterCoords, 0, cellCenterX );
-        GEOSCoordSeq_setY_r( geosctxt, cellCenterCoords, 0, cellCenterY );
-        currentCellCenter = GEOSGeom_createPoint_r( geosctxt, cellCenterCoords );
-        if ( GEOSPreparedContains_r( geosctxt, polyGeosPrepared, currentCellCenter ) )
-        {
-          stats.addValue( block->value( i, j ) );
-        }
-      }
-      cellCenterX += cellSizeX;
+      stats.addValue( value );
     }
-    cellCenterY -= cellSizeY;
-  }
-
-  GEOSGeom_destroy_r( geosctxt, currentCellCenter );
-  GEOSPreparedGeom_destroy_r( geosctxt, polyGeosPrepared );
-  GEOSGeom_destroy_r( geosctxt, polyGeos );
-  delete block;
+  } );
 }
 
 void QgsZonalStatistics::statisticsFromPreciseIntersection( const QgsGeometry &poly, int pixelOffsetX,
-    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats )
+    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox,
+    const QgsRasterBlock *block, FeatureStats &stats ) const
 {
   stats.reset();
 
-  double currentY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
-  QgsGeometry pixelRectGeometry;
+  const double pixelArea = cellSizeX * cellSizeY;
+  const double blockXMin = rasterBBox.xMinimum() + pixelOffsetX * cellSizeX;
+  const double blockYMax = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY;
 
-  double hCellSizeX = cellSizeX / 2.0;
-  double hCellSizeY = cellSizeY / 2.0;
-  double pixelArea = cellSizeX * cellSizeY;
-  double weight = 0;
+  QgsZonalStatisticsRasterizer rasterizer( poly );
 
-  QgsRectangle featureBBox = poly.boundingBox().intersect( &rasterBBox );
-  QgsRectangle intersectBBox = rasterBBox.intersect( &featureBBox );
+  // cells crossed by the polygon boundary are partially covered, all others are either fully covered or not at all
+  std::vector< char > boundary( static_cast< size_t >( nCellsX ) * nCellsY, 0 );
+  rasterizer.markBoundaryCells( blockXMin, blockYMax, cellSizeX, cellSizeY, nCellsX, nCellsY, boundary );
+
+  const std::vector< double > centersX = cellCenters( blockXMin + cellSizeX / 2, cellSizeX, nCellsX );
+  std::vector< char > inside( boundary.size(), 0 );
+  rasterizer.cellsWithCenterInside( centersX, blockYMax - cellSizeY / 2, cellSizeY, nCellsY, [nCellsX, &inside]( int i, int j )
+  {
+    inside[ static_cast< size_t >( i ) * nCellsX + j ] = 1;
+  } );
 
-  QgsRasterBlock *block = mRasterProvider->block( mRasterBand, intersectBBox, nCellsX, nCellsY );
   for ( int i = 0; i < nCellsY; ++i )
   {
-    double currentX = rasterBBox.xMinimum() + cellSizeX / 2.0 + pixelOffsetX * cellSizeX;
+    const double cellYMax = blockYMax - i * cellSizeY;
     for ( int j = 0; j < nCellsX; ++j )
     {
-      if ( !validPixel( block->value( i, j ) ) )
+      const size_t cell = static_cast< size_t >( i ) * nCellsX + j;
+      if ( !boundary[ cell ] && !inside[ cell ] )
       {
         continue;
       }
 
-      pixelRectGeometry = QgsGeometry::fromRect( QgsRectangle( currentX - hCellSizeX, currentY - hCellSizeY, currentX + hCellSizeX, currentY + hCellSizeY ) );
-      if ( !pixelRectGeometry.isNull() )
+      double value = block->value( i, j );
+      if ( !validPixel( value ) )
       {
-        //intersection
-        QgsGeometry intersectGeometry = pixelRectGeometry.intersection( poly );
-        if ( !intersectGeometry.isNull() )
-        {
-          double intersectionArea = intersectGeometry.area();
-          if ( intersectionArea >= 0.0 )
-          {
-            weight = intersectionArea / pixelArea;
-            stats.addValue( block->value( i, j ), weight );
-          }
-        }
-        pixelRectGeometry = QgsGeometry();
+        continue;
+      }
+
+      if ( !boundary[ cell ] )
+      {
+        stats.addValue( value );
+        continue;
+      }
+
+      const double cellXMin = blockXMin + j * cellSizeX;
+      const double intersectionArea = rasterizer.intersectionArea( QgsRectangle( cellXMin, cellYMax - cellSizeY, cellXMin + cellSizeX, cellYMax ) );
+      if ( intersectionArea > 0.0 )
+      {
+        stats.addValue( value, intersectionArea / pixelArea );
       }
-      currentX += cellSizeX;
     }
-    currentY -= cellSizeY;
   }
-  delete block;
 }
 
 bool QgsZonalStatistics::validPixel( float value ) const
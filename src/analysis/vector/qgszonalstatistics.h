@@ -25,11 +25,13 @@
 #include <cfloat>
 
 #include "qgis_analysis.h"
+#include "qgsfeature.h"
 #include "qgsfeedback.h"
 
 class QgsGeometry;
 class QgsVectorLayer;
 class QgsRasterLayer;
+class QgsRasterBlock;
 class QgsRasterDataProvider;
 class QgsRectangle;
 class QgsField;
@@ -55,7 +57,9 @@ class ANALYSIS_EXPORT QgsZonalStatistics
       Majority = 512, //!< Majority of pixel values
       Variety = 1024, //!< Variety (count of distinct) pixel values
       Variance = 2048, //!< Variance of pixel values
-      All = Count | Sum | Mean | Median | StDev | Max | Min | Range | Minority | Majority | Variety | Variance
+      FirstQuartile = 4096, //!< First quartile (25th percentile) of pixel values, since QGIS 3.0
+      ThirdQuartile = 8192, //!< Third quartile (75th percentile) of pixel values, since QGIS 3.0
+      All = Count | Sum | Mean | Median | StDev | Max | Min | Range | Minority | Majority | Variety | Variance | FirstQuartile | ThirdQuartile
     };
     Q_DECLARE_FLAGS( Statistics, Statistic )
 
@@ -69,6 +73,8 @@ class ANALYSIS_EXPORT QgsZonalStatistics
                         QgsZonalStatistics::Statistics stats = QgsZonalStatistics::Statistics( QgsZonalStatistics::Count | QgsZonalStatistics::Sum | QgsZonalStatistics::Mean ) );
 
     /** Starts the calculation
+     * Polygons are burnt into the raster grid with a scanline fill and features are processed
+     * in parallel, each thread reading raster values from its own copy of the raster data provider.
       \returns 0 in case of success*/
     int calculateStatistics( QgsFeedback *feedback );
 
@@ -121,13 +127,25 @@ class ANALYSIS_EXPORT QgsZonalStatistics
     int cellInfoForBBox( const QgsRectangle &rasterBBox, const QgsRectangle &featureBBox, double cellSizeX, double cellSizeY,
                          int &offsetX, int &offsetY, int &nCellsX, int &nCellsY ) const;
 
+    /**
+     * Calculates the statistics of the cells covered by \a poly, reading raster values from \a provider.
+     * \returns false if the feature has no geometry or does not intersect the raster
+     */
+    bool statisticsForFeature( const QgsGeometry &poly, QgsRasterDataProvider *provider, const QgsRectangle &rasterBBox,
+                               int nCellsXProvider, int nCellsYProvider, double cellSizeX, double cellSizeY, FeatureStats &stats ) const;
+
     //! Returns statistics by considering the pixels where the center point is within the polygon (fast)
     void statisticsFromMiddlePointTest( const QgsGeometry &poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
-                                        double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats );
+                                        double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, const QgsRasterBlock *block,
+                                        FeatureStats &stats ) const;
 
-    //! Returns statistics with precise pixel - polygon intersection test (slow)
+    //! Returns statistics with precise pixel - polygon intersection test, which is only calculated for cells on the polygon boundary (slow)
     void statisticsFromPreciseIntersection( const QgsGeometry &poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
-                                            double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats );
+                                            double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, const QgsRasterBlock *block,
+                                            FeatureStats &stats ) const;
+
+    //! Returns the attribute values for \a stats, \a fieldIndexes contains the index of the field of each statistic
+    QgsAttributeMap statisticsAttributes( FeatureStats &stats, const QMap< Statistic, int > &fieldIndexes ) const;
 
     //! Tests whether a pixel's value should be included in the result
     bool validPixel( float value ) const;
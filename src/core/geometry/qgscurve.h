@@ -132,7 +132,7 @@ class CORE_EXPORT QgsCurve: public QgsAbstractGeometry
 
     /** Returns a QPolygonF representing the points.
      */
-    QPolygonF asQPolygonF() const;
+    virtual QPolygonF asQPolygonF() const;
 
 #ifndef SIP_RUN
 
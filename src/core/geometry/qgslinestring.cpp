@@ -493,6 +493,22 @@ void QgsLineString::points( QgsPointSequence &pts ) const
   }
 }
 
+QPolygonF QgsLineString::asQPolygonF() const
+{
+  // copy the coordinate arrays directly, without a virtual call per point
+  const int nPoints = mX.size();
+  QPolygonF points( nPoints );
+  const double *x = mX.constData();
+  const double *y = mY.constData();
+  QPointF *dest = points.data();
+  for ( int i = 0; i < nPoints; ++i )
+  {
+    dest[i].rx() = x[i];
+    dest[i].ry() = y[i];
+  }
+  return points;
+}
+
 void QgsLineString::setPoints( const QgsPointSequence &points )
 {
   clearCache(); //set bounding box invalid
@@ -191,6 +191,7 @@ class CORE_EXPORT QgsLineString: public QgsCurve
     int numPoints() const override;
     virtual int nCoordinates() const override { return mX.size(); }
     void points( QgsPointSequence &pt SIP_OUT ) const override;
+    QPolygonF asQPolygonF() const override;
 
     void draw( QPainter &p ) const override;
 
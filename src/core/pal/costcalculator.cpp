@@ -41,6 +41,9 @@ void CostCalculator::addObstacleCostPenalty( LabelPosition *lp, FeaturePart *obs
   double dist;
   double distlabel = lp->feature->getLabelDistance();
 
+  // the obstacle may be used by candidates which are evaluated on other threads
+  QMutexLocker locker( obstacle->obstacleMutex() );
+
   switch ( obstacle->getGeosType() )
   {
     case GEOS_POINT:
@@ -83,6 +86,8 @@ void CostCalculator::addObstacleCostPenalty( LabelPosition *lp, FeaturePart *obs
       break;
   }
 
+  locker.unlock();
+
   if ( n > 0 )
     lp->setConflictsWithObstacle( true );
 
@@ -93,7 +98,7 @@ void CostCalculator::addObstacleCostPenalty( LabelPosition *lp, FeaturePart *obs
   lp->setCost( lp->cost() + obstacleCost );
 }
 
-void CostCalculator::setPolygonCandidatesCost( int nblp, QList< LabelPosition * > &lPos, RTree<FeaturePart *, double, 2, double> *obstacles, double bbx[4], double bby[4] )
+void CostCalculator::setPolygonCandidatesCost( int nblp, QList< LabelPosition * > &lPos, PackedRTree<FeaturePart *> *obstacles, double bbx[4], double bby[4] )
 {
   double normalizer;
   // compute raw cost
@@ -147,7 +152,7 @@ void CostCalculator::setPolygonCandidatesCost( int nblp, QList< LabelPosition *
   }
 }
 
-void CostCalculator::setCandidateCostFromPolygon( LabelPosition *lp, RTree <FeaturePart *, double, 2, double> *obstacles, double bbx[4], double bby[4] )
+void CostCalculator::setCandidateCostFromPolygon( LabelPosition *lp, PackedRTree<FeaturePart *> *obstacles, double bbx[4], double bby[4] )
 {
   double amin[2];
   double amax[2];
@@ -174,7 +179,7 @@ void CostCalculator::setCandidateCostFromPolygon( LabelPosition *lp, RTree <Feat
   delete pCost;
 }
 
-int CostCalculator::finalizeCandidatesCosts( Feats *feat, int max_p, RTree <FeaturePart *, double, 2, double> *obstacles, double bbx[4], double bby[4] )
+int CostCalculator::finalizeCandidatesCosts( Feats *feat, int max_p, PackedRTree<FeaturePart *> *obstacles, double bbx[4], double bby[4] )
 {
   // If candidates list is smaller than expected
   if ( max_p > feat->lPos.count() )
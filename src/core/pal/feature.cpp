@@ -1516,7 +1516,7 @@ int FeaturePart::createCandidatesForPolygon( QList< LabelPosition *> &lPos, Poin
 
 int FeaturePart::createCandidates( QList< LabelPosition *> &lPos,
                                    double bboxMin[2], double bboxMax[2],
-                                   PointSet *mapShape, RTree<LabelPosition *, double, 2, double> *candidates )
+                                   PointSet *mapShape )
 {
   double bbox[4];
 
@@ -1525,6 +1525,14 @@ int FeaturePart::createCandidates( QList< LabelPosition *> &lPos,
   bbox[2] = bboxMax[0];
   bbox[3] = bboxMax[1];
 
+  if ( mLF->hasPinnedPlacement() )
+  {
+    // keep the placement of a previous run
+    lPos << new LabelPosition( 0, mLF->pinnedPosition().x(), mLF->pinnedPosition().y(), getLabelWidth(), getLabelHeight(),
+                               mLF->pinnedAngle(), 0.0, this, mLF->pinnedReversed(), static_cast< LabelPosition::Quadrant >( mLF->pinnedQuadrant() ) );
+    return lPos.count();
+  }
+
   double angle = mLF->hasFixedAngle() ? mLF->fixedAngle() : 0.0;
 
   if ( mLF->hasFixedPosition() )
@@ -1591,10 +1599,6 @@ int FeaturePart::createCandidates( QList< LabelPosition *> &lPos,
       i.remove();
       delete pos;
     }
-    else   // this one is OK
-    {
-      pos->insertIntoIndex( candidates );
-    }
   }
 
   std::sort( lPos.begin(), lPos.end(), CostCalculator::candidateSortGrow );
@@ -1718,9 +1722,9 @@ bool FeaturePart::mergeWithFeaturePart( FeaturePart *other )
 
 double FeaturePart::calculatePriority() const
 {
-  if ( mLF->alwaysShow() )
+  if ( mLF->alwaysShow() || mLF->hasPinnedPlacement() )
   {
-    //if feature is set to always show, bump the priority up by orders of magnitude
+    //if feature is set to always show or pinned to a previous placement, bump the priority up by orders of magnitude
     //so that other feature's labels are unlikely to be placed over the label for this feature
     //(negative numbers due to how pal::extract calculates inactive cost)
     return -0.2;
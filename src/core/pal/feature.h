@@ -41,6 +41,7 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <QMutex>
 #include <QString>
 
 /** \ingroup core
@@ -126,10 +127,11 @@ namespace pal
        * \param bboxMin min values of the map extent
        * \param bboxMax max values of the map extent
        * \param mapShape generate candidates for this spatial entity
-       * \param candidates index for candidates
        * \returns the number of candidates generated in lPos
+       * \note candidates of different features may be generated on several threads at once,
+       * as long as all parts of a label feature are handled by the same thread.
        */
-      int createCandidates( QList<LabelPosition *> &lPos, double bboxMin[2], double bboxMax[2], PointSet *mapShape, RTree<LabelPosition *, double, 2, double> *candidates );
+      int createCandidates( QList<LabelPosition *> &lPos, double bboxMin[2], double bboxMax[2], PointSet *mapShape );
 
       /** Generate candidates for point feature, located around a specified point.
        * \param x x coordinate of the point
@@ -258,6 +260,11 @@ namespace pal
       //! Get hole (inner ring) - considered as obstacle
       FeaturePart *getSelfObstacle( int i ) { return mHoles.at( i ); }
 
+      /** Returns the mutex which must be held while the GEOS geometry of the part is used
+       * as an obstacle, as candidates of several features may be evaluated on different threads.
+       */
+      QMutex *obstacleMutex() { return &mObstacleMutex; }
+
       //! Check whether this part is connected with some other part
       bool isConnected( FeaturePart *p2 );
 
@@ -291,6 +298,8 @@ namespace pal
 
     private:
 
+      QMutex mObstacleMutex;
+
       LabelPosition::Quadrant quadrantFromOffset() const;
   };
 
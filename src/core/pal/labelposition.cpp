@@ -226,23 +226,52 @@ bool LabelPosition::isInConflict( LabelPosition *lp )
 
 bool LabelPosition::isInConflictSinglePart( LabelPosition *lp )
 {
-  if ( !mGeos )
-    createGeosGeom();
+  // Candidates are rectangles, so they are disjoint if and only if an edge of one of them
+  // separates them. Unlike GEOS predicates this does not need to create geometries, so it is fast
+  // and candidates can be compared on several threads at once.
+  auto hasSeparatingEdge = []( const LabelPosition * a, const LabelPosition * b )
+  {
+    // opposite edges of a rectangle are parallel, so two edges are enough
+    for ( int edge = 0; edge < 2; ++edge )
+    {
+      double nx = a->y[edge + 1] - a->y[edge];
+      double ny = a->x[edge] - a->x[edge + 1];
+      if ( nx == 0.0 && ny == 0.0 )
+      {
+        // zero width or height: the edge has no normal, the candidate is a segment along the
+        // other edge, whose direction is an axis too. Points have no axis at all.
+        const int other = 1 - edge;
+        nx = a->x[other + 1] - a->x[other];
+        ny = a->y[other + 1] - a->y[other];
+        if ( nx == 0.0 && ny == 0.0 )
+          continue;
+      }
 
-  if ( !lp->mGeos )
-    lp->createGeosGeom();
+      double aMin = DBL_MAX;
+      double aMax = -DBL_MAX;
+      double bMin = DBL_MAX;
+      double bMax = -DBL_MAX;
+      for ( int i = 0; i < 4; ++i )
+      {
+        const double aProjection = a->x[i] * nx + a->y[i] * ny;
+        aMin = std::min( aMin, aProjection );
+        aMax = std::max( aMax, aProjection );
+        const double bProjection = b->x[i] * nx + b->y[i] * ny;
+        bMin = std::min( bMin, bProjection );
+        bMax = std::max( bMax, bProjection );
+      }
 
-  GEOSContextHandle_t geosctxt = geosContext();
-  try
-  {
-    bool result = ( GEOSPreparedIntersects_r( geosctxt, preparedGeom(), lp->mGeos ) == 1 );
-    return result;
-  }
-  catch ( GEOSException &e )
-  {
-    QgsMessageLog::logMessage( QObject::tr( "Exception: %1" ).arg( e.what() ), QObject::tr( "GEOS" ) );
+      if ( aMax < bMin || bMax < aMin )
+        return true;
+    }
     return false;
-  }
+  };
+
+  // two points only conflict at the same location, as neither of them gives an axis
+  if ( x[0] == x[2] && y[0] == y[2] && lp->x[0] == lp->x[2] && lp->y[0] == lp->y[2] )
+    return x[0] == lp->x[0] && y[0] == lp->y[0];
+
+  return !hasSeparatingEdge( this, lp ) && !hasSeparatingEdge( lp, this );
 }
 
 bool LabelPosition::isInConflictMultiPart( LabelPosition *lp )
@@ -363,6 +392,7 @@ bool LabelPosition::polygonObstacleCallback( FeaturePart *obstacle, void *ctx )
     return true;
   }
 
+  QMutexLocker locker( obstacle->obstacleMutex() );
   pCost->update( obstacle );
 
   return true;
@@ -384,9 +414,9 @@ void LabelPosition::insertIntoIndex( RTree<LabelPosition *, double, 2, double> *
   index->Insert( amin, amax, this );
 }
 
-bool LabelPosition::pruneCallback( LabelPosition *candidatePosition, void *ctx )
+bool LabelPosition::pruneCallback( FeaturePart *obstaclePart, void *ctx )
 {
-  FeaturePart *obstaclePart = ( reinterpret_cast< PruneCtx * >( ctx ) )->obstacle;
+  LabelPosition *candidatePosition = reinterpret_cast< LabelPosition * >( ctx );
 
   // test whether we should ignore this obstacle for the candidate. We do this if:
   // 1. it's not a hole, and the obstacle belongs to the same label feature as the candidate (e.g.,
@@ -243,14 +243,8 @@ namespace pal
       void removeFromIndex( RTree<LabelPosition *, double, 2, double> *index );
       void insertIntoIndex( RTree<LabelPosition *, double, 2, double> *index );
 
-      typedef struct
-      {
-        Pal *pal = nullptr;
-        FeaturePart *obstacle = nullptr;
-      } PruneCtx;
-
-      //! Check whether the candidate in ctx overlap with obstacle feat
-      static bool pruneCallback( LabelPosition *candidatePosition, void *ctx );
+      //! Check whether the candidate in ctx overlaps with obstacle, and penalize its cost if so
+      static bool pruneCallback( FeaturePart *obstacle, void *ctx );
 
       // for counting number of overlaps
       typedef struct
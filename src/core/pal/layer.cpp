@@ -56,9 +56,6 @@ Layer::Layer( QgsAbstractLabelProvider *provider, const QString &name, QgsPalLay
   , mMergeLines( false )
   , mUpsidedownLabels( Upright )
 {
-  mFeatureIndex = new RTree<FeaturePart *, double, 2, double>();
-  mObstacleIndex = new RTree<FeaturePart *, double, 2, double>();
-
   if ( defaultPriority < 0.0001 )
     mDefaultPriority = 0.0001;
   else if ( defaultPriority > 1.0 )
@@ -77,9 +74,6 @@ Layer::~Layer()
   //should already be empty
   qDeleteAll( mConnectedHashtable );
 
-  delete mFeatureIndex;
-  delete mObstacleIndex;
-
   mMutex.unlock();
 }
 
@@ -289,16 +283,9 @@ bool Layer::registerFeature( QgsLabelFeature *lf )
 
 void Layer::addFeaturePart( FeaturePart *fpart, const QString &labelText )
 {
-  double bmin[2];
-  double bmax[2];
-  fpart->getBoundingBox( bmin, bmax );
-
-  // add to list of layer's feature parts
+  // add to list of layer's feature parts, the r-tree is built by buildIndexes()
   mFeatureParts << fpart;
 
-  // add to r-tree for fast spatial access
-  mFeatureIndex->Insert( bmin, bmax, fpart );
-
   // add to hashtable with equally named feature parts
   if ( mMergeLines && !labelText.isEmpty() )
   {
@@ -320,15 +307,8 @@ void Layer::addFeaturePart( FeaturePart *fpart, const QString &labelText )
 
 void Layer::addObstaclePart( FeaturePart *fpart )
 {
-  double bmin[2];
-  double bmax[2];
-  fpart->getBoundingBox( bmin, bmax );
-
-  // add to list of layer's feature parts
+  // add to list of layer's obstacle parts, the r-tree is built by buildIndexes()
   mObstacleParts.append( fpart );
-
-  // add to obstacle r-tree
-  mObstacleIndex->Insert( bmin, bmax, fpart );
 }
 
 static FeaturePart *_findConnectedPart( FeaturePart *partCheck, QLinkedList<FeaturePart *> *otherParts )
@@ -370,24 +350,9 @@ void Layer::joinConnectedFeatures()
       FeaturePart *otherPart = _findConnectedPart( partCheck, parts );
       if ( otherPart )
       {
-        // remove partCheck from r-tree
-        double checkpartBMin[2], checkpartBMax[2];
-        partCheck->getBoundingBox( checkpartBMin, checkpartBMax );
-
-        double otherPartBMin[2], otherPartBMax[2];
-        otherPart->getBoundingBox( otherPartBMin, otherPartBMax );
-
         // merge points from partCheck to p->item
         if ( otherPart->mergeWithFeaturePart( partCheck ) )
         {
-          // remove the parts we are joining from the index
-          mFeatureIndex->Remove( checkpartBMin, checkpartBMax, partCheck );
-          mFeatureIndex->Remove( otherPartBMin, otherPartBMax, otherPart );
-
-          // reinsert merged line to r-tree (probably not needed)
-          otherPart->getBoundingBox( otherPartBMin, otherPartBMax );
-          mFeatureIndex->Insert( otherPartBMin, otherPartBMax, otherPart );
-
           mConnectedFeaturesIds.insert( partCheck->featureId(), connectedFeaturesId );
           mConnectedFeaturesIds.insert( otherPart->featureId(), connectedFeaturesId );
 
@@ -429,10 +394,6 @@ void Layer::chopFeaturesAtRepeatDistance()
     {
       chopInterval *= std::ceil( fpart->getLabelWidth() / fpart->repeatDistance() );
 
-      double bmin[2], bmax[2];
-      fpart->getBoundingBox( bmin, bmax );
-      mFeatureIndex->Remove( bmin, bmax, fpart );
-
       const GEOSCoordSequence *cs = GEOSGeom_getCoordSeq_r( geosctxt, geom );
 
       // get number of points
@@ -486,8 +447,6 @@ void Layer::chopFeaturesAtRepeatDistance()
         GEOSGeometry *newgeom = GEOSGeom_createLineString_r( geosctxt, cooSeq );
         FeaturePart *newfpart = new FeaturePart( fpart->feature(), newgeom );
         newFeatureParts.append( newfpart );
-        newfpart->getBoundingBox( bmin, bmax );
-        mFeatureIndex->Insert( bmin, bmax, newfpart );
         part.clear();
         part.push_back( p );
       }
@@ -503,8 +462,6 @@ void Layer::chopFeaturesAtRepeatDistance()
       GEOSGeometry *newgeom = GEOSGeom_createLineString_r( geosctxt, cooSeq );
       FeaturePart *newfpart = new FeaturePart( fpart->feature(), newgeom );
       newFeatureParts.append( newfpart );
-      newfpart->getBoundingBox( bmin, bmax );
-      mFeatureIndex->Insert( bmin, bmax, newfpart );
       delete fpart;
     }
     else
@@ -515,3 +472,9 @@ void Layer::chopFeaturesAtRepeatDistance()
 
   mFeatureParts = newFeatureParts;
 }
+
+void Layer::buildIndexes()
+{
+  mFeatureIndex.BulkLoad( mFeatureParts );
+  mObstacleIndex.BulkLoad( mObstacleParts );
+}
@@ -35,7 +35,7 @@
 
 #include "qgis_core.h"
 #include "pal.h" // for LineArrangementFlags enum
-#include "rtree.hpp"
+#include "packedrtree.h"
 #include <QMutex>
 #include <QLinkedList>
 #include <QHash>
@@ -46,10 +46,6 @@ class QgsLabelFeature;
 namespace pal
 {
 
-  /// @cond PRIVATE
-  template<class DATATYPE, class ELEMTYPE, int NUMDIMS, class ELEMTYPEREAL, int TMAXNODES, int TMINNODES> class RTree;
-  /// @endcond
-
   class FeaturePart;
   class Pal;
   class LabelInfo;
@@ -244,6 +240,12 @@ namespace pal
       //! Chop layer features at the repeat distance *
       void chopFeaturesAtRepeatDistance();
 
+      /**
+       * Bulk loads the spatial indexes from the feature and obstacle parts. Must be called
+       * after the parts are joined and chopped, and before the indexes are searched.
+       */
+      void buildIndexes();
+
     protected:
       QgsAbstractLabelProvider *mProvider; // not owned
       QString mName;
@@ -273,12 +275,12 @@ namespace pal
       UpsideDownLabels mUpsidedownLabels;
 
       // indexes (spatial and id)
-      RTree<FeaturePart *, double, 2, double, 8, 4> *mFeatureIndex;
+      PackedRTree<FeaturePart *> mFeatureIndex;
       //! Lookup table of label features (owned by the label feature provider that created them)
       QHash< QgsFeatureId, QgsLabelFeature *> mHashtable;
 
       //obstacle r-tree
-      RTree<FeaturePart *, double, 2, double, 8, 4> *mObstacleIndex;
+      PackedRTree<FeaturePart *> mObstacleIndex;
 
       QHash< QString, QLinkedList<FeaturePart *>* > mConnectedHashtable;
       QStringList mConnectedTexts;
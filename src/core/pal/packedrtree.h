@@ -0,0 +1,289 @@
+/***************************************************************************
+  packedrtree.h
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef PAL_PACKEDRTREE_H
+#define PAL_PACKEDRTREE_H
+
+#define SIP_NO_FILE
+
+#include <algorithm>
+#include <cfloat>
+#include <utility>
+#include <vector>
+#include <QtGlobal>
+
+/// @cond PRIVATE
+
+namespace pal
+{
+
+  /**
+   * \ingroup core
+   * \brief Static two dimensional R-tree, packed along the Hilbert curve.
+   *
+   * Unlike RTree, the tree is built at once from all its entries with BulkLoad(). Entries are
+   * sorted by the Hilbert value of the center of their bounding boxes and grouped into nodes level
+   * by level, from the leaves to the root. Bounding boxes of entries and nodes are stored in one
+   * contiguous array and searches walk the tree without recursion, which makes searching much
+   * faster than in RTree.
+   *
+   * Entries can not be inserted into a built tree. They can be removed, removed entries are
+   * skipped by searches but the bounding boxes of their nodes are not updated.
+   *
+   * Searching does not modify the tree, so several threads may search a tree at the same time.
+   *
+   * \note not available in Python bindings
+   */
+  template <class DATATYPE>
+  class PackedRTree
+  {
+    public:
+
+      //! Maximum number of children of a node
+      static const int NODE_SIZE = 16;
+
+      /**
+       * Replaces the tree contents by \a entries. DATATYPE must be a pointer to an object with a
+       * getBoundingBox( double min[2], double max[2] ) method, \a entries may be any container of them.
+       * Entries with equal Hilbert values keep their order in \a entries.
+       */
+      template <class CONTAINER>
+      void BulkLoad( const CONTAINER &entries )
+      {
+        RemoveAll();
+
+        mEntryCount = static_cast< int >( entries.size() );
+        if ( mEntryCount == 0 )
+          return;
+
+        std::vector< Box > entryBoxes;
+        std::vector< DATATYPE > entryData;
+        entryBoxes.reserve( mEntryCount );
+        entryData.reserve( mEntryCount );
+
+        Box extent = { DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX };
+        for ( typename CONTAINER::const_iterator it = entries.begin(); it != entries.end(); ++it )
+        {
+          double min[2];
+          double max[2];
+          ( *it )->getBoundingBox( min, max );
+          const Box box = { min[0], min[1], max[0], max[1] };
+          entryBoxes.push_back( box );
+          entryData.push_back( *it );
+          extent.include( box );
+        }
+
+        // sort entries along the Hilbert curve through the extent
+        const double width = extent.maxX - extent.minX;
+        const double height = extent.maxY - extent.minY;
+        const double hilbertMax = static_cast< double >( ( 1 << HILBERT_BITS ) - 1 );
+        std::vector< std::pair< quint32, int > > order( mEntryCount );
+        for ( int i = 0; i < mEntryCount; ++i )
+        {
+          const Box &box = entryBoxes[i];
+          const double cx = width > 0 ? ( ( box.minX + box.maxX ) / 2 - extent.minX ) / width : 0;
+          const double cy = height > 0 ? ( ( box.minY + box.maxY ) / 2 - extent.minY ) / height : 0;
+          order[i] = std::make_pair( hilbertIndex( static_cast< quint32 >( cx * hilbertMax ), static_cast< quint32 >( cy * hilbertMax ) ), i );
+        }
+        std::sort( order.begin(), order.end() );
+
+        mBoxes.reserve( mEntryCount + mEntryCount / ( NODE_SIZE - 1 ) + 1 );
+        mData.reserve( mEntryCount );
+        for ( int i = 0; i < mEntryCount; ++i )
+        {
+          mBoxes.push_back( entryBoxes[ order[i].second ] );
+          mData.push_back( entryData[ order[i].second ] );
+        }
+        mRemoved.assign( mEntryCount, 0 );
+
+        // group each level into nodes of the next level, until a single root node remains.
+        // The children of consecutive nodes are consecutive, so mFirstChild also gives the end
+        // of the children of the previous node.
+        int levelStart = 0;
+        int levelEnd = mEntryCount;
+        while ( true )
+        {
+          for ( int start = levelStart; start < levelEnd; start += NODE_SIZE )
+          {
+            const int end = std::min( start + NODE_SIZE, levelEnd );
+            Box box = mBoxes[start];
+            for ( int child = start + 1; child < end; ++child )
+              box.include( mBoxes[child] );
+            mBoxes.push_back( box );
+            mFirstChild.push_back( start );
+          }
+          if ( levelEnd - levelStart <= NODE_SIZE )
+            break;
+
+          levelStart = levelEnd;
+          levelEnd = static_cast< int >( mBoxes.size() );
+        }
+        mFirstChild.push_back( static_cast< int >( mBoxes.size() ) - 1 );
+      }
+
+      /**
+       * Calls \a callback for all entries whose bounding box intersects the box from \a min to \a max.
+       * The search stops when \a callback returns false.
+       * \returns number of found entries
+       */
+      int Search( const double min[2], const double max[2], bool callback( DATATYPE data, void *context ), void *context ) const
+      {
+        const Box searchBox = { min[0], min[1], max[0], max[1] };
+        int foundCount = 0;
+        visitEntries( searchBox, [&]( int entry ) -> bool
+        {
+          ++foundCount;
+          return callback( mData[entry], context );
+        } );
+        return foundCount;
+      }
+
+      /**
+       * Removes \a data, which has the bounding box from \a min to \a max.
+       */
+      void Remove( const double min[2], const double max[2], const DATATYPE &data )
+      {
+        const Box searchBox = { min[0], min[1], max[0], max[1] };
+        visitEntries( searchBox, [&]( int entry ) -> bool
+        {
+          if ( mData[entry] != data )
+            return true;
+
+          mRemoved[entry] = 1;
+          mRemovedCount++;
+          return false;
+        } );
+      }
+
+      //! Removes all entries from the tree
+      void RemoveAll()
+      {
+        mEntryCount = 0;
+        mRemovedCount = 0;
+        mBoxes.clear();
+        mData.clear();
+        mRemoved.clear();
+        mFirstChild.clear();
+      }
+
+      //! Returns number of entries in the tree, excluding removed entries
+      int Count() const { return mEntryCount - mRemovedCount; }
+
+    private:
+
+      //! Number of bits of each coordinate of Hilbert values
+      static const int HILBERT_BITS = 16;
+
+      struct Box
+      {
+        double minX;
+        double minY;
+        double maxX;
+        double maxY;
+
+        void include( const Box &other )
+        {
+          minX = std::min( minX, other.minX );
+          minY = std::min( minY, other.minY );
+          maxX = std::max( maxX, other.maxX );
+          maxY = std::max( maxY, other.maxY );
+        }
+
+        bool intersects( const Box &other ) const
+        {
+          return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+        }
+      };
+
+      //! Bounding boxes of all entries, followed by the nodes, level by level up to the root
+      std::vector< Box > mBoxes;
+      //! Index in mBoxes of the first child of each node, plus the end of the children of the last node
+      std::vector< int > mFirstChild;
+      //! Data of the entries, in the order of mBoxes
+      std::vector< DATATYPE > mData;
+      std::vector< char > mRemoved;
+      int mEntryCount = 0;
+      int mRemovedCount = 0;
+
+      /**
+       * Calls \a visitor with the index of all entries which intersect \a searchBox and are not removed,
+       * until it returns false.
+       */
+      template <class VISITOR>
+      void visitEntries( const Box &searchBox, VISITOR visitor ) const
+      {
+        if ( mEntryCount == 0 )
+          return;
+
+        // the tree has at most 8 levels of nodes (NODE_SIZE ^ 8 > INT_MAX), so this is enough for all pending nodes
+        int stack[ 8 * NODE_SIZE ];
+        int stackSize = 0;
+        stack[ stackSize++ ] = static_cast< int >( mBoxes.size() ) - 1;
+
+        while ( stackSize > 0 )
+        {
+          const int node = stack[ --stackSize ] - mEntryCount;
+          const int childStart = mFirstChild[node];
+          const int childEnd = mFirstChild[node + 1];
+
+          if ( childStart < mEntryCount )
+          {
+            for ( int child = childStart; child < childEnd; ++child )
+            {
+              if ( !mRemoved[child] && mBoxes[child].intersects( searchBox ) && !visitor( child ) )
+                return;
+            }
+          }
+          else
+          {
+            // push children in reverse order, so that they are visited in order
+            for ( int child = childEnd - 1; child >= childStart; --child )
+            {
+              if ( mBoxes[child].intersects( searchBox ) )
+                stack[ stackSize++ ] = child;
+            }
+          }
+        }
+      }
+
+      //! Returns the position of the point ( \a x, \a y ) along the Hilbert curve
+      static quint32 hilbertIndex( quint32 x, quint32 y )
+      {
+        quint32 index = 0;
+        for ( quint32 s = 1u << ( HILBERT_BITS - 1 ); s > 0; s >>= 1 )
+        {
+          const quint32 rx = ( x & s ) > 0 ? 1 : 0;
+          const quint32 ry = ( y & s ) > 0 ? 1 : 0;
+          index += s * s * ( ( 3 * rx ) ^ ry );
+
+          // rotate the quadrant
+          if ( ry == 0 )
+          {
+            if ( rx == 1 )
+            {
+              x = s - 1 - x;
+              y = s - 1 - y;
+            }
+            std::swap( x, y );
+          }
+        }
+        return index;
+      }
+  };
+
+} // namespace pal
+
+/// @endcond
+
+#endif // PAL_PACKEDRTREE_H
@@ -32,7 +32,7 @@
 #include "layer.h"
 #include "palexception.h"
 #include "palstat.h"
-#include "rtree.hpp"
+#include "packedrtree.h"
 #include "costcalculator.h"
 #include "feature.h"
 #include "geomfunction.h"
@@ -41,7 +41,12 @@
 #include "pointset.h"
 #include "internalexception.h"
 #include "util.h"
+#include <QHash>
+#include <QPair>
+#include <QtConcurrentMap>
+#include <algorithm>
 #include <cfloat>
+#include <vector>
 
 using namespace pal;
 
@@ -121,11 +126,8 @@ Layer *Pal::addLayer( QgsAbstractLabelProvider *provider, const QString &layerNa
 typedef struct _featCbackCtx
 {
   Layer *layer = nullptr;
-  QLinkedList<Feats *> *fFeats;
-  RTree<FeaturePart *, double, 2, double> *obstacles;
-  RTree<LabelPosition *, double, 2, double> *candidates;
-  double bbox_min[2];
-  double bbox_max[2];
+  QList<FeaturePart *> *featureParts;
+  QList<FeaturePart *> *obstacleParts;
 } FeatCallBackCtx;
 
 
@@ -137,14 +139,12 @@ typedef struct _featCbackCtx
  */
 bool extractFeatCallback( FeaturePart *ft_ptr, void *ctx )
 {
-  double amin[2], amax[2];
   FeatCallBackCtx *context = reinterpret_cast< FeatCallBackCtx * >( ctx );
 
   // Holes of the feature are obstacles
   for ( int i = 0; i < ft_ptr->getNumSelfObstacles(); i++ )
   {
-    ft_ptr->getSelfObstacle( i )->getBoundingBox( amin, amax );
-    context->obstacles->Insert( amin, amax, ft_ptr->getSelfObstacle( i ) );
+    context->obstacleParts->append( ft_ptr->getSelfObstacle( i ) );
 
     if ( !ft_ptr->getSelfObstacle( i )->getHoleOf() )
     {
@@ -152,30 +152,15 @@ bool extractFeatCallback( FeaturePart *ft_ptr, void *ctx )
     }
   }
 
-  // generate candidates for the feature part
-  QList< LabelPosition * > lPos;
-  if ( ft_ptr->createCandidates( lPos, context->bbox_min, context->bbox_max, ft_ptr, context->candidates ) )
-  {
-    // valid features are added to fFeats
-    Feats *ft = new Feats();
-    ft->feature = ft_ptr;
-    ft->shape = nullptr;
-    ft->lPos = lPos;
-    ft->priority = ft_ptr->calculatePriority();
-    context->fFeats->append( ft );
-  }
-  else
-  {
-    // Others are deleted
-    qDeleteAll( lPos );
-  }
+  // candidates are generated afterwards, for all parts at once
+  context->featureParts->append( ft_ptr );
 
   return true;
 }
 
 typedef struct _obstaclebackCtx
 {
-  RTree<FeaturePart *, double, 2, double> *obstacles;
+  QList<FeaturePart *> *obstacleParts;
   int obstacleCount;
 } ObstacleCallBackCtx;
 
@@ -186,46 +171,126 @@ typedef struct _obstaclebackCtx
  */
 bool extractObstaclesCallback( FeaturePart *ft_ptr, void *ctx )
 {
-  double amin[2], amax[2];
   ObstacleCallBackCtx *context = reinterpret_cast< ObstacleCallBackCtx * >( ctx );
 
-  // insert into obstacles
-  ft_ptr->getBoundingBox( amin, amax );
-  context->obstacles->Insert( amin, amax, ft_ptr );
+  // the obstacles index is built once all obstacles are extracted
+  context->obstacleParts->append( ft_ptr );
   context->obstacleCount++;
   return true;
 }
 
-typedef struct _filterContext
+//! Number of items processed on several threads between two checks for cancelation
+static const int MAP_BATCH_SIZE = 1000;
+
+//! Number of candidates whose overlaps are counted by the same thread at once
+static const int OVERLAPS_CHUNK_SIZE = 64;
+
+/*
+ * Calls function on all items on several threads. Items are processed in batches, and
+ * the remaining batches are skipped once the job is canceled.
+ * Returns false if the job was canceled.
+ */
+template <class T, class MapFunctor>
+static bool blockingMapInBatches( Pal *pal, QList< T > &items, MapFunctor function )
 {
-  RTree<LabelPosition *, double, 2, double> *cdtsIndex;
-  Pal *pal = nullptr;
-} FilterContext;
+  for ( int start = 0; start < items.size(); start += MAP_BATCH_SIZE )
+  {
+    if ( pal->isCanceled() )
+      return false;
+
+    const int end = std::min( start + MAP_BATCH_SIZE, items.size() );
+    QtConcurrent::blockingMap( items.begin() + start, items.begin() + end, function );
+  }
+  return !pal->isCanceled();
+}
+
+/*
+ * Groups the indexes of feature parts by label feature. Parts of a label feature share
+ * its geometries (e.g. the permissible zone), so they must be processed by the same thread.
+ */
+static QList< QVector< int > > groupByLabelFeature( const QList< FeaturePart * > &featureParts )
+{
+  QList< QVector< int > > groups;
+  QHash< QgsLabelFeature *, int > groupIndexes;
+  for ( int i = 0; i < featureParts.size(); ++i )
+  {
+    QgsLabelFeature *labelFeature = featureParts.at( i )->feature();
+    QHash< QgsLabelFeature *, int >::const_iterator it = groupIndexes.constFind( labelFeature );
+    if ( it == groupIndexes.constEnd() )
+    {
+      groupIndexes.insert( labelFeature, groups.size() );
+      groups << ( QVector< int >() << i );
+    }
+    else
+    {
+      groups[ it.value()] << i;
+    }
+  }
+  return groups;
+}
 
-bool filteringCallback( FeaturePart *featurePart, void *ctx )
+/*
+ * Generates candidates for all feature parts on several threads.
+ * Parts with valid candidates are appended to fFeats, in the order of featureParts.
+ * Returns false if the job was canceled, some parts are missing from fFeats then.
+ */
+static bool createFeatureCandidates( Pal *pal, const QList< FeaturePart * > &featureParts, double bboxMin[2], double bboxMax[2], QList< Feats * > &fFeats )
 {
+  std::vector< Feats * > partFeats( featureParts.size(), nullptr );
 
-  RTree<LabelPosition *, double, 2, double> *cdtsIndex = ( reinterpret_cast< FilterContext * >( ctx ) )->cdtsIndex;
-  Pal *pal = ( reinterpret_cast< FilterContext * >( ctx ) )->pal;
+  auto createPartCandidates = [&]( const QVector< int > &group )
+  {
+    for ( int index : group )
+    {
+      FeaturePart *ft_ptr = featureParts.at( index );
 
-  if ( pal->isCanceled() )
-    return false; // do not continue searching
+      // generate candidates for the feature part
+      QList< LabelPosition * > lPos;
+      if ( ft_ptr->createCandidates( lPos, bboxMin, bboxMax, ft_ptr ) )
+      {
+        // valid features are added to fFeats
+        Feats *ft = new Feats();
+        ft->feature = ft_ptr;
+        ft->shape = nullptr;
+        ft->lPos = lPos;
+        ft->priority = ft_ptr->calculatePriority();
+        partFeats[ index ] = ft;
+      }
+      else
+      {
+        // Others are deleted
+        qDeleteAll( lPos );
+      }
+    }
+  };
 
-  double amin[2], amax[2];
-  featurePart->getBoundingBox( amin, amax );
+  QList< QVector< int > > groups = groupByLabelFeature( featureParts );
+  const bool completed = blockingMapInBatches( pal, groups, createPartCandidates );
 
-  LabelPosition::PruneCtx pruneContext;
-  pruneContext.obstacle = featurePart;
-  pruneContext.pal = pal;
-  cdtsIndex->Search( amin, amax, LabelPosition::pruneCallback, static_cast< void * >( &pruneContext ) );
+  for ( Feats *ft : partFeats )
+  {
+    if ( ft )
+      fFeats << ft;
+  }
+  return completed;
+}
 
-  return true;
+static void deleteFeats( QList< Feats * > &fFeats )
+{
+  Q_FOREACH ( Feats *feat, fFeats )
+  {
+    qDeleteAll( feat->lPos );
+    feat->lPos.clear();
+  }
+
+  qDeleteAll( fFeats );
+  fFeats.clear();
 }
 
 Problem *Pal::extract( double lambda_min, double phi_min, double lambda_max, double phi_max )
 {
   // to store obstacles
-  RTree<FeaturePart *, double, 2, double> *obstacles = new RTree<FeaturePart *, double, 2, double>();
+  QList<FeaturePart *> obstacleParts;
 
   Problem *prob = new Problem();
 
@@ -237,10 +302,6 @@ Problem *Pal::extract( double lambda_min, double phi_min, double lambda_max, dou
   double amin[2];
   double amax[2];
 
-  int max_p = 0;
-
-  LabelPosition *lp = nullptr;
-
   bbx[0] = bbx[3] = amin[0] = prob->bbox[0] = lambda_min;
   bby[0] = bby[1] = amin[1] = prob->bbox[1] = phi_min;
   bbx[1] = bbx[2] = amax[0] = prob->bbox[2] = lambda_max;
@@ -248,19 +309,15 @@ Problem *Pal::extract( double lambda_min, double phi_min, double lambda_max, dou
 
   prob->pal = this;
 
-  QLinkedList<Feats *> *fFeats = new QLinkedList<Feats *>;
+  QList<Feats *> fFeats;
+  QList<FeaturePart *> featureParts;
 
   FeatCallBackCtx context;
-  context.fFeats = fFeats;
-  context.obstacles = obstacles;
-  context.candidates = prob->candidates;
-  context.bbox_min[0] = amin[0];
-  context.bbox_min[1] = amin[1];
-  context.bbox_max[0] = amax[0];
-  context.bbox_max[1] = amax[1];
+  context.featureParts = &featureParts;
+  context.obstacleParts = &obstacleParts;
 
   ObstacleCallBackCtx obstacleContext;
-  obstacleContext.obstacles = obstacles;
+  obstacleContext.obstacleParts = &obstacleParts;
   obstacleContext.obstacleCount = 0;
 
   // first step : extract features from layers
@@ -291,19 +348,30 @@ Problem *Pal::extract( double lambda_min, double phi_min, double lambda_max, dou
 
     layer->mMutex.lock();
 
+    layer->buildIndexes();
+
     // find features within bounding box and generate candidates list
     context.layer = layer;
-    layer->mFeatureIndex->Search( amin, amax, extractFeatCallback, static_cast< void * >( &context ) );
+    featureParts.clear();
+    layer->mFeatureIndex.Search( amin, amax, extractFeatCallback, static_cast< void * >( &context ) );
+    if ( !createFeatureCandidates( this, featureParts, amin, amax, fFeats ) )
+    {
+      layer->mMutex.unlock();
+      mMutex.unlock();
+      deleteFeats( fFeats );
+      delete prob;
+      return nullptr;
+    }
     // find obstacles within bounding box
-    layer->mObstacleIndex->Search( amin, amax, extractObstaclesCallback, static_cast< void * >( &obstacleContext ) );
+    layer->mObstacleIndex.Search( amin, amax, extractObstaclesCallback, static_cast< void * >( &obstacleContext ) );
 
     layer->mMutex.unlock();
 
-    if ( context.fFeats->size() - previousFeatureCount > 0 || obstacleContext.obstacleCount > previousObstacleCount )
+    if ( fFeats.size() - previousFeatureCount > 0 || obstacleContext.obstacleCount > previousObstacleCount )
     {
       layersWithFeaturesInBBox << layer->name();
     }
-    previousFeatureCount = context.fFeats->size();
+    previousFeatureCount = fFeats.size();
     previousObstacleCount = obstacleContext.obstacleCount;
   }
   mMutex.unlock();
@@ -311,135 +379,143 @@ Problem *Pal::extract( double lambda_min, double phi_min, double lambda_max, dou
   prob->nbLabelledLayers = layersWithFeaturesInBBox.size();
   prob->labelledLayersName = layersWithFeaturesInBBox;
 
-  if ( fFeats->isEmpty() )
+  if ( fFeats.isEmpty() )
   {
-    delete fFeats;
     delete prob;
-    delete obstacles;
     return nullptr;
   }
 
-  prob->nbft = fFeats->size();
+  prob->nbft = fFeats.size();
   prob->nblp = 0;
   prob->featNbLp = new int [prob->nbft];
   prob->featStartId = new int [prob->nbft];
   prob->inactiveCost = new double[prob->nbft];
 
-  Feats *feat = nullptr;
+  PackedRTree<FeaturePart *> obstacles;
+  obstacles.BulkLoad( obstacleParts );
 
-  // Filtering label positions against obstacles
-  amin[0] = amin[1] = -DBL_MAX;
-  amax[0] = amax[1] = DBL_MAX;
-  FilterContext filterCtx;
-  filterCtx.cdtsIndex = prob->candidates;
-  filterCtx.pal = this;
-  obstacles->Search( amin, amax, filteringCallback, static_cast< void * >( &filterCtx ) );
+  // Filtering label positions against obstacles and finalizing their costs, on several threads.
+  // Candidates only look up the obstacles index, so the candidates index is not needed yet.
+  featureParts.clear();
+  Q_FOREACH ( Feats *feat, fFeats )
+  {
+    featureParts << feat->feature;
+  }
 
-  if ( isCanceled() )
+  auto finalizeCosts = [&]( const QVector< int > &group )
   {
-    Q_FOREACH ( Feats *feat, *fFeats )
+    double lpMin[2];
+    double lpMax[2];
+
+    for ( int index : group )
     {
-      qDeleteAll( feat->lPos );
-      feat->lPos.clear();
+      Feats *feat = fFeats.at( index );
+
+      Q_FOREACH ( LabelPosition *lp, feat->lPos )
+      {
+        lp->getBoundingBox( lpMin, lpMax );
+        obstacles.Search( lpMin, lpMax, LabelPosition::pruneCallback, static_cast< void * >( lp ) );
+      }
+
+      int max_p = 0;
+      switch ( feat->feature->getGeosType() )
+      {
+        case GEOS_POINT:
+          max_p = point_p;
+          break;
+        case GEOS_LINESTRING:
+          max_p = line_p;
+          break;
+        case GEOS_POLYGON:
+          max_p = poly_p;
+          break;
+      }
+
+      // sort candidates by cost, skip less interesting ones, calculate polygon costs (if using polygons)
+      max_p = CostCalculator::finalizeCandidatesCosts( feat, max_p, &obstacles, bbx, bby );
+
+      // only keep the 'max_p' best candidates
+      while ( feat->lPos.count() > max_p )
+      {
+        delete feat->lPos.takeLast();
+      }
     }
+  };
 
-    qDeleteAll( *fFeats );
-    delete fFeats;
+  QList< QVector< int > > groups = groupByLabelFeature( featureParts );
+  if ( !blockingMapInBatches( this, groups, finalizeCosts ) )
+  {
+    deleteFeats( fFeats );
     delete prob;
-    delete obstacles;
     return nullptr;
   }
 
+  // bulk load all remaining candidates into a rtree (to speed up conflicts searching)
+  std::vector< LabelPosition * > candidates;
+
   int idlp = 0;
   for ( i = 0; i < prob->nbft; i++ ) /* foreach feature into prob */
   {
-    feat = fFeats->takeFirst();
+    Feats *feat = fFeats.at( i );
 
     prob->featStartId[i] = idlp;
     prob->inactiveCost[i] = std::pow( 2, 10 - 10 * feat->priority );
 
-    switch ( feat->feature->getGeosType() )
-    {
-      case GEOS_POINT:
-        max_p = point_p;
-        break;
-      case GEOS_LINESTRING:
-        max_p = line_p;
-        break;
-      case GEOS_POLYGON:
-        max_p = poly_p;
-        break;
-    }
-
-    // sort candidates by cost, skip less interesting ones, calculate polygon costs (if using polygons)
-    max_p = CostCalculator::finalizeCandidatesCosts( feat, max_p, obstacles, bbx, bby );
-
-    // only keep the 'max_p' best candidates
-    while ( feat->lPos.count() > max_p )
-    {
-      // TODO remove from index
-      feat->lPos.last()->removeFromIndex( prob->candidates );
-      delete feat->lPos.takeLast();
-    }
-
     // update problem's # candidate
     prob->featNbLp[i] = feat->lPos.count();
     prob->nblp += feat->lPos.count();
 
-    // add all candidates into a rtree (to speed up conflicts searching)
     for ( j = 0; j < feat->lPos.count(); j++, idlp++ )
     {
-      lp = feat->lPos.at( j );
-      //lp->insertIntoIndex(prob->candidates);
+      LabelPosition *lp = feat->lPos.at( j );
       lp->setProblemIds( i, idlp ); // bugfix #1 (maxence 10/23/2008)
-    }
-    fFeats->append( feat );
-  }
-
-  int nbOverlaps = 0;
-
-  while ( !fFeats->isEmpty() ) // foreach feature
-  {
-    if ( isCanceled() )
-    {
-      Q_FOREACH ( Feats *feat, *fFeats )
-      {
-        qDeleteAll( feat->lPos );
-        feat->lPos.clear();
-      }
-
-      qDeleteAll( *fFeats );
-      delete fFeats;
-      delete prob;
-      delete obstacles;
-      return nullptr;
-    }
-
-    feat = fFeats->takeFirst();
-    while ( !feat->lPos.isEmpty() ) // foreach label candidate
-    {
-      lp = feat->lPos.takeFirst();
       lp->resetNumOverlaps();
 
       // make sure that candidate's cost is less than 1
       lp->validateCost();
 
       prob->addCandidatePosition( lp );
-      //prob->feat[idlp] = j;
+      candidates.push_back( lp );
+    }
+    feat->lPos.clear();
+  }
+  qDeleteAll( fFeats );
+  fFeats.clear();
 
-      lp->getBoundingBox( amin, amax );
+  prob->candidates->BulkLoad( candidates );
 
-      // lookup for overlapping candidate
-      prob->candidates->Search( amin, amax, LabelPosition::countOverlapCallback, static_cast< void * >( lp ) );
+  // lookup for overlapping candidates, on several threads (each candidate only updates its own count)
+  const int candidateCount = static_cast< int >( candidates.size() );
+  QList< QPair< int, int > > chunks;
+  for ( int start = 0; start < candidateCount; start += OVERLAPS_CHUNK_SIZE )
+  {
+    chunks << qMakePair( start, std::min( start + OVERLAPS_CHUNK_SIZE, candidateCount ) );
+  }
+
+  auto countOverlaps = [&]( const QPair< int, int > &chunk )
+  {
+    double lpMin[2];
+    double lpMax[2];
 
-      nbOverlaps += lp->getNumOverlaps();
+    for ( int index = chunk.first; index < chunk.second; ++index )
+    {
+      LabelPosition *lp = candidates[ index ];
+      lp->getBoundingBox( lpMin, lpMax );
+      prob->candidates->Search( lpMin, lpMax, LabelPosition::countOverlapCallback, static_cast< void * >( lp ) );
     }
-    delete feat;
+  };
+
+  if ( !blockingMapInBatches( this, chunks, countOverlaps ) )
+  {
+    delete prob;
+    return nullptr;
   }
-  delete fFeats;
 
-  //delete candidates;
-  delete obstacles;
+  int nbOverlaps = 0;
+  for ( LabelPosition *lp : candidates )
+  {
+    nbOverlaps += lp->getNumOverlaps();
+  }
 
   nbOverlaps /= 2;
   prob->all_nblp = prob->nblp;
@@ -31,6 +31,7 @@
 #include "palstat.h"
 #include "layer.h"
 #include "rtree.hpp"
+#include "packedrtree.h"
 #include "feature.h"
 #include "geomfunction.h"
 #include "labelposition.h"
@@ -76,7 +77,7 @@ Problem::Problem()
   bbox[2] = 0;
   bbox[3] = 0;
   featWrap = nullptr;
-  candidates = new RTree<LabelPosition *, double, 2, double>();
+  candidates = new PackedRTree<LabelPosition *>();
   candidates_sol = new RTree<LabelPosition *, double, 2, double>();
   candidates_subsol = nullptr;
 }
@@ -175,7 +176,7 @@ void Problem::reduce()
 
               nbOverlap -= lp2->getNumOverlaps();
               candidates->Search( amin, amax, LabelPosition::removeOverlapCallback, reinterpret_cast< void * >( lp2 ) );
-              lp2->removeFromIndex( candidates );
+              candidates->Remove( amin, amax, lp2 );
             }
 
             featNbLp[i] = j + 1;
@@ -217,7 +218,7 @@ typedef struct
 {
   PriorityQueue *list = nullptr;
   LabelPosition *lp = nullptr;
-  RTree <LabelPosition *, double, 2, double> *candidates;
+  PackedRTree<LabelPosition *> *candidates;
 } FalpContext;
 
 bool falpCallback2( LabelPosition *lp, void *ctx )
@@ -234,7 +235,7 @@ bool falpCallback2( LabelPosition *lp, void *ctx )
 }
 
 
-void ignoreLabel( LabelPosition *lp, PriorityQueue *list, RTree <LabelPosition *, double, 2, double> *candidates )
+void ignoreLabel( LabelPosition *lp, PriorityQueue *list, PackedRTree<LabelPosition *> *candidates )
 {
 
 
@@ -263,7 +264,7 @@ bool falpCallback1( LabelPosition *lp, void *ctx )
   FalpContext *context = reinterpret_cast< FalpContext * >( ctx );
   LabelPosition *lp2 = context->lp;
   PriorityQueue *list = context->list;
-  RTree <LabelPosition *, double, 2, double> *candidates = context->candidates;
+  PackedRTree<LabelPosition *> *candidates = context->candidates;
 
   if ( lp2->isInConflict( lp ) )
   {
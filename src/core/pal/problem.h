@@ -37,6 +37,7 @@
 #include <list>
 #include <QList>
 #include "rtree.hpp"
+#include "packedrtree.h"
 
 namespace pal
 {
@@ -228,7 +229,7 @@ namespace pal
 
       QList< LabelPosition * > mLabelPositions;
 
-      RTree<LabelPosition *, double, 2, double> *candidates; // index all candidates
+      PackedRTree<LabelPosition *> *candidates; // index all candidates
       RTree<LabelPosition *, double, 2, double> *candidates_sol; // index active candidates
       RTree<LabelPosition *, double, 2, double> *candidates_subsol; // idem for subparts
 
@@ -59,6 +59,9 @@ namespace pal
             This version uses new/delete for nodes, I recommend using a fixed size allocator for efficiency.
             Instead of using a callback function for returned results, I recommend and efficient pre-sized, grow-only memory
             array similar to MFC CArray or STL Vector for returning search query result.
+
+     In PAL, this tree only holds the indexes which are updated while searching. Indexes which are built
+     at once and then only searched are bulk loaded into a PackedRTree instead.
   */
 
   template < class DATATYPE, class ELEMTYPE, int NUMDIMS,
@@ -219,14 +219,22 @@ void QgsCoordinateTransform::transformInPlace( float &x, float &y, float &z,
 
 void QgsCoordinateTransform::transformPolygon( QPolygonF &poly, TransformDirection direction ) const
 {
-  if ( !d->mIsValid || d->mShortCircuit )
+  if ( !d->mIsValid || d->mShortCircuit || poly.isEmpty() )
   {
     return;
   }
 
-  //create x, y arrays
   int nVertices = poly.size();
 
+  if ( sizeof( qreal ) == sizeof( double ) )
+  {
+    // QPointF keeps x and y next to each other, so proj4 can transform the whole polygon in place
+    double *xy = reinterpret_cast< double * >( poly.data() );
+    transformCoordsStrided( nVertices, 2, xy, xy + 1, nullptr, direction );
+    return;
+  }
+
+  //create x, y arrays
   QVector<double> x( nVertices );
   QVector<double> y( nVertices );
   QVector<double> z( nVertices );
@@ -446,6 +454,11 @@ QgsRectangle QgsCoordinateTransform::transformBoundingBox( const QgsRectangle &r
 }
 
 void QgsCoordinateTransform::transformCoords( int numPoints, double *x, double *y, double *z, TransformDirection direction ) const
+{
+  transformCoordsStrided( numPoints, 1, x, y, z, direction );
+}
+
+void QgsCoordinateTransform::transformCoordsStrided( int numPoints, int pointOffset, double *x, double *y, double *z, TransformDirection direction ) const
 {
   if ( !d->mIsValid || d->mShortCircuit )
     return;
@@ -481,23 +494,31 @@ void QgsCoordinateTransform::transformCoords( int numPoints, double *x, double *
   if ( ( pj_is_latlong( destProj ) && ( direction == ReverseTransform ) )
        || ( pj_is_latlong( sourceProj ) && ( direction == ForwardTransform ) ) )
   {
-    for ( int i = 0; i < numPoints; ++i )
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
     {
       x[i] *= DEG_TO_RAD;
       y[i] *= DEG_TO_RAD;
     }
 
   }
+  // geocentric coordinates need a z value
+  QVector<double> zeroZ;
+  if ( !z && ( pj_is_geocent( sourceProj ) || pj_is_geocent( destProj ) ) )
+  {
+    zeroZ.fill( 0, numPoints * pointOffset );
+    z = zeroZ.data();
+  }
+
   int projResult;
   if ( direction == ReverseTransform )
   {
-    projResult = pj_transform( destProj, sourceProj, numPoints, 0, x, y, z );
+    projResult = pj_transform( destProj, sourceProj, numPoints, pointOffset, x, y, z );
   }
   else
   {
     Q_ASSERT( sourceProj );
     Q_ASSERT( destProj );
-    projResult = pj_transform( sourceProj, destProj, numPoints, 0, x, y, z );
+    projResult = pj_transform( sourceProj, destProj, numPoints, pointOffset, x, y, z );
   }
 
   if ( projResult != 0 )
@@ -505,7 +526,7 @@ void QgsCoordinateTransform::transformCoords( int numPoints, double *x, double *
     //something bad happened....
     QString points;
 
-    for ( int i = 0; i < numPoints; ++i )
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
     {
       if ( direction == ForwardTransform )
       {
@@ -545,7 +566,7 @@ void QgsCoordinateTransform::transformCoords( int numPoints, double *x, double *
   if ( ( pj_is_latlong( destProj ) && ( direction == ForwardTransform ) )
        || ( pj_is_latlong( sourceProj ) && ( direction == ReverseTransform ) ) )
   {
-    for ( int i = 0; i < numPoints; ++i )
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
     {
       x[i] *= RAD_TO_DEG;
       y[i] *= RAD_TO_DEG;
@@ -280,6 +280,12 @@ class CORE_EXPORT QgsCoordinateTransform
 
     static void searchDatumTransform( const QString &sql, QList< int > &transforms );
 
+    /**
+     * Transforms \a numPoints coordinates in place, with \a pointOffset doubles between consecutive
+     * coordinates of each array (e.g. 2 for the interleaved coordinates of a QPolygonF). \a z may be null.
+     */
+    void transformCoordsStrided( int numPoints, int pointOffset, double *x, double *y, double *z, TransformDirection direction ) const;
+
     mutable QExplicitlySharedDataPointer<QgsCoordinateTransformPrivate> d;
 };
 
@@ -57,6 +57,15 @@ QgsLabelFeature::~QgsLabelFeature()
   delete mInfo;
 }
 
+void QgsLabelFeature::setPinnedPlacement( const QgsPointXY &position, double angle, int quadrant, bool reversed )
+{
+  mHasPinnedPlacement = true;
+  mPinnedPosition = position;
+  mPinnedAngle = angle;
+  mPinnedQuadrant = quadrant;
+  mPinnedReversed = reversed;
+}
+
 void QgsLabelFeature::setObstacleGeometry( GEOSGeometry *obstacleGeom )
 {
   if ( mObstacleGeometry )
@@ -241,6 +241,33 @@ class CORE_EXPORT QgsLabelFeature
     //! the labels should be repeated (0 = no repetitions)
     void setRepeatDistance( double dist ) { mRepeatDistance = dist; }
 
+    /**
+     * Returns whether the label is pinned to a placement kept from a previous labeling run.
+     * Pinned labels get a single candidate at that placement and a very high priority.
+     * \see setPinnedPlacement()
+     * \since QGIS 3.0
+     */
+    bool hasPinnedPlacement() const { return mHasPinnedPlacement; }
+
+    /**
+     * Pins the label to a placement kept from a previous labeling run (see QgsLabelingCache).
+     * \a position is the first corner of the label and \a angle its angle in radians, both taken
+     * before the label is turned upright. \a quadrant is a pal::LabelPosition::Quadrant value
+     * and \a reversed whether the label is reversed.
+     * \see hasPinnedPlacement()
+     * \since QGIS 3.0
+     */
+    void setPinnedPlacement( const QgsPointXY &position, double angle, int quadrant, bool reversed );
+
+    //! Position of the pinned placement (relevant only if hasPinnedPlacement() returns true)
+    QgsPointXY pinnedPosition() const { return mPinnedPosition; }
+    //! Angle in radians of the pinned placement (relevant only if hasPinnedPlacement() returns true)
+    double pinnedAngle() const { return mPinnedAngle; }
+    //! Quadrant of the pinned placement (relevant only if hasPinnedPlacement() returns true)
+    int pinnedQuadrant() const { return mPinnedQuadrant; }
+    //! Whether the pinned placement is reversed (relevant only if hasPinnedPlacement() returns true)
+    bool pinnedReversed() const { return mPinnedReversed; }
+
     //! Whether label should be always shown (sets very high label priority)
     bool alwaysShow() const { return mAlwaysShow; }
     //! Set whether label should be always shown (sets very high label priority)
@@ -339,6 +366,16 @@ class CORE_EXPORT QgsLabelFeature
     QVector< QgsPalLayerSettings::PredefinedPointPosition > mPredefinedPositionOrder;
     //! distance after which label should be repeated (only for linestrings)
     double mRepeatDistance;
+    //! whether the label is pinned to mPinnedPosition, mPinnedAngle, mPinnedQuadrant and mPinnedReversed
+    bool mHasPinnedPlacement = false;
+    //! first corner of the pinned label
+    QgsPointXY mPinnedPosition;
+    //! angle in radians of the pinned label
+    double mPinnedAngle = 0;
+    //! quadrant of the pinned label
+    int mPinnedQuadrant = 0;
+    //! whether the pinned label is reversed
+    bool mPinnedReversed = false;
     //! whether to always show label - even in case of collisions
     bool mAlwaysShow;
     //! whether the feature geometry acts as an obstacle for labels
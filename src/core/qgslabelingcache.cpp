@@ -0,0 +1,216 @@
+/***************************************************************************
+  qgslabelingcache.cpp
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#include "qgslabelingcache.h"
+
+#include "qgslabelfeature.h"
+#include "qgslabelingengine.h"
+#include "qgsmaplayerlistutils.h"
+#include "qgsmapsettings.h"
+
+#include "feature.h"
+#include "labelposition.h"
+
+QgsLabelingCache::QgsLabelingCache( QObject *parent )
+  : QObject( parent )
+{
+}
+
+void QgsLabelingCache::clear()
+{
+  QMutexLocker locker( &mMutex );
+  clearInternal();
+}
+
+void QgsLabelingCache::clearInternal()
+{
+  Q_FOREACH ( const QgsWeakMapLayerPointer &layer, mConnectedLayers )
+  {
+    if ( layer.data() )
+      disconnect( layer.data(), nullptr, this, nullptr );
+  }
+  mConnectedLayers.clear();
+  mPlacements.clear();
+  mViewKey.clear();
+  mExtent = QgsRectangle();
+}
+
+void QgsLabelingCache::setBorderZone( double pixels )
+{
+  QMutexLocker locker( &mMutex );
+  mBorderZone = pixels;
+}
+
+double QgsLabelingCache::borderZone() const
+{
+  QMutexLocker locker( &mMutex );
+  return mBorderZone;
+}
+
+bool QgsLabelingCache::canPin( const QgsAbstractLabelProvider *provider )
+{
+  // a feature must have a single label, which is not curved
+  return provider &&
+         !provider->flags().testFlag( QgsAbstractLabelProvider::LabelPerFeaturePart ) &&
+         !provider->flags().testFlag( QgsAbstractLabelProvider::MergeConnectedLines ) &&
+         provider->placement() != QgsPalLayerSettings::Curved &&
+         provider->placement() != QgsPalLayerSettings::PerimeterCurved;
+}
+
+static QString providerKey( const QgsAbstractLabelProvider *provider )
+{
+  return provider->layerId() + ':' + provider->providerId();
+}
+
+QString QgsLabelingCache::viewKey( const QgsMapSettings &settings )
+{
+  // features of rotated maps are rotated around the extent center, which moves with the extent
+  if ( !qgsDoubleNear( settings.rotation(), 0.0 ) )
+    return QString();
+
+  const QgsLabelingEngineSettings &engineSettings = settings.labelingEngineSettings();
+  int candPoint, candLine, candPolygon;
+  engineSettings.numCandidatePositions( candPoint, candLine, candPolygon );
+
+  return QStringLiteral( "%1:%2:%3:%4:%5:%6:%7:%8" ).arg( settings.mapUnitsPerPixel(), 0, 'g', 17 )
+         .arg( settings.outputDpi() )
+         .arg( settings.destinationCrs().toProj4() )
+         .arg( static_cast< int >( engineSettings.flags() ) )
+         .arg( static_cast< int >( engineSettings.searchMethod() ) )
+         .arg( candPoint ).arg( candLine ).arg( candPolygon );
+}
+
+bool QgsLabelingCache::prepare( const QgsMapSettings &settings, const QgsRectangle &extent, QgsRectangle &reuseArea )
+{
+  const QString key = viewKey( settings );
+
+  QMutexLocker locker( &mMutex );
+
+  if ( key != mViewKey )
+  {
+    clearInternal();
+    mViewKey = key;
+  }
+
+  if ( key.isEmpty() || mPlacements.isEmpty() )
+    return false;
+
+  // labels close to the new area are placed again, to make room for the new labels
+  reuseArea = mExtent.intersect( &extent );
+  reuseArea.grow( -mBorderZone * settings.mapUnitsPerPixel() );
+  return !reuseArea.isEmpty();
+}
+
+bool QgsLabelingCache::pinFeature( const QgsAbstractLabelProvider *provider, QgsLabelFeature *feature, const QgsRectangle &reuseArea ) const
+{
+  if ( !canPin( provider ) || feature->repeatDistance() > 0 || feature->hasFixedPosition() )
+    return false;
+
+  QMutexLocker locker( &mMutex );
+
+  QHash< QString, ProviderPlacements >::const_iterator providerIt = mPlacements.constFind( providerKey( provider ) );
+  if ( providerIt == mPlacements.constEnd() )
+    return false;
+
+  QHash< QgsFeatureId, Placement >::const_iterator it = providerIt.value().placements.constFind( feature->id() );
+  if ( it == providerIt.value().placements.constEnd() )
+    return false;
+
+  const Placement &placement = it.value();
+  if ( !reuseArea.contains( placement.boundingBox ) )
+    return false;
+
+  feature->setPinnedPlacement( QgsPointXY( placement.x, placement.y ), placement.angle, placement.quadrant, placement.reversed );
+  return true;
+}
+
+void QgsLabelingCache::storePlacements( const QgsMapSettings &settings, const QgsRectangle &extent, const QList<pal::LabelPosition *> &labels )
+{
+  const QString key = viewKey( settings );
+
+  QMutexLocker locker( &mMutex );
+
+  // another run may have changed the view in the meantime
+  if ( key.isEmpty() || key != mViewKey )
+    return;
+
+  // the new solution replaces the previous one
+  mPlacements.clear();
+  mExtent = extent;
+
+  Q_FOREACH ( pal::LabelPosition *label, labels )
+  {
+    QgsLabelFeature *feature = label->getFeaturePart()->feature();
+    QgsAbstractLabelProvider *provider = feature ? feature->provider() : nullptr;
+    if ( !canPin( provider ) || feature->repeatDistance() > 0 || feature->hasFixedPosition() || label->getNextPart() )
+      continue;
+
+    Placement placement;
+    placement.x = label->getX();
+    placement.y = label->getY();
+    placement.angle = label->getAlpha();
+    placement.quadrant = label->getQuadrant();
+    placement.reversed = label->getReversed();
+
+    if ( label->getUpsideDown() )
+    {
+      // undo the turn done by the pal::LabelPosition constructor, which will do it again
+      placement.x = label->getX( 2 );
+      placement.y = label->getY( 2 );
+      placement.angle += M_PI;
+    }
+
+    double amin[2];
+    double amax[2];
+    label->getBoundingBox( amin, amax );
+    placement.boundingBox = QgsRectangle( amin[0], amin[1], amax[0], amax[1] );
+
+    ProviderPlacements &providerPlacements = mPlacements[ providerKey( provider )];
+    providerPlacements.placements.insert( feature->id(), placement );
+
+    QgsMapLayer *layer = provider->layer();
+    if ( layer && !providerPlacements.layer )
+    {
+      providerPlacements.layer = layer;
+      if ( !mConnectedLayers.contains( QgsWeakMapLayerPointer( layer ) ) )
+      {
+        connect( layer, &QgsMapLayer::repaintRequested, this, &QgsLabelingCache::layerChanged );
+        connect( layer, &QgsMapLayer::styleChanged, this, &QgsLabelingCache::layerChanged );
+        connect( layer, &QgsMapLayer::willBeDeleted, this, &QgsLabelingCache::layerChanged );
+        mConnectedLayers << layer;
+      }
+    }
+  }
+}
+
+void QgsLabelingCache::layerChanged()
+{
+  QgsMapLayer *layer = qobject_cast<QgsMapLayer *>( sender() );
+  if ( !layer )
+    return;
+
+  QMutexLocker locker( &mMutex );
+
+  QHash< QString, ProviderPlacements >::iterator it = mPlacements.begin();
+  while ( it != mPlacements.end() )
+  {
+    if ( it.value().layer.data() == layer )
+      it = mPlacements.erase( it );
+    else
+      ++it;
+  }
+
+  disconnect( layer, nullptr, this, nullptr );
+  mConnectedLayers.remove( QgsWeakMapLayerPointer( layer ) );
+}
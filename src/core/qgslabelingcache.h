@@ -0,0 +1,153 @@
+/***************************************************************************
+  qgslabelingcache.h
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSLABELINGCACHE_H
+#define QGSLABELINGCACHE_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+
+#include "qgsmaplayer.h"
+#include "qgsrectangle.h"
+
+class QgsAbstractLabelProvider;
+class QgsLabelFeature;
+class QgsMapSettings;
+
+namespace pal
+{
+  class LabelPosition;
+}
+
+/**
+ * \ingroup core
+ * \brief Keeps the label placements of a labeling run, so that the next runs can reuse them.
+ *
+ * When set on a map renderer job (QgsMapRendererJob::setLabelingCache()), the labeling engine
+ * pins the labels of features to their kept placement and only solves the placement of the
+ * other labels. Kept placements are only valid for the same map scale, output DPI and
+ * destination CRS, the cache is cleared when any of them changes. Placements of a layer are
+ * dropped when the layer requests a repaint or its style changes. No placement is kept for
+ * rotated maps, curved labels and labels of layers which label each feature part or merge
+ * connected lines.
+ *
+ * The cache is meant for interactive use: each run replaces the kept placements, and a placement
+ * is only reused if the label lies inside the overlap of both extents, away from its border zone
+ * (see setBorderZone()).
+ *
+ * The class is thread-safe (several labeling engines can use the same instance).
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.0
+ */
+class CORE_EXPORT QgsLabelingCache : public QObject
+{
+    Q_OBJECT
+
+  public:
+
+    //! Constructor for QgsLabelingCache
+    QgsLabelingCache( QObject *parent = nullptr );
+
+    //! Removes all kept placements
+    void clear();
+
+    /**
+     * Sets the width in pixels of the border zone of the overlap between the previous and the
+     * new extent. Labels within the border zone are placed again, so that they can make room for
+     * the labels of the new area.
+     * \see borderZone()
+     */
+    void setBorderZone( double pixels );
+
+    /**
+     * Returns the width in pixels of the border zone.
+     * \see setBorderZone()
+     */
+    double borderZone() const;
+
+    /**
+     * Prepares the cache for labeling \a extent with \a settings, clearing it if the scale, output
+     * DPI or destination CRS have changed. Returns false if no kept placement may be reused.
+     * \a reuseArea is set to the area where labels must lie to be reused.
+     * \note used internally by QgsLabelingEngine
+     */
+    bool prepare( const QgsMapSettings &settings, const QgsRectangle &extent, QgsRectangle &reuseArea );
+
+    /**
+     * Pins \a feature of \a provider to its kept placement, if there is one and it lies within
+     * \a reuseArea. Returns true if the feature was pinned.
+     * \note used internally by QgsLabelingEngine
+     */
+    bool pinFeature( const QgsAbstractLabelProvider *provider, QgsLabelFeature *feature, const QgsRectangle &reuseArea ) const;
+
+    /**
+     * Keeps the placement of \a labels, the solution of labeling \a extent with \a settings.
+     * \note used internally by QgsLabelingEngine
+     */
+    void storePlacements( const QgsMapSettings &settings, const QgsRectangle &extent, const QList<pal::LabelPosition *> &labels );
+
+  private slots:
+    //! Removes the placements of the layer which emitted the signal
+    void layerChanged();
+
+  private:
+
+    //! Placement of a label, before the label is turned upright
+    struct Placement
+    {
+      double x;
+      double y;
+      double angle;
+      int quadrant;
+      bool reversed;
+      //! Bounding box of the label
+      QgsRectangle boundingBox;
+    };
+
+    //! Kept placements of a label provider, by feature id
+    struct ProviderPlacements
+    {
+      QgsWeakMapLayerPointer layer;
+      QHash< QgsFeatureId, Placement > placements;
+    };
+
+    //! Returns whether labels of \a provider can be pinned
+    static bool canPin( const QgsAbstractLabelProvider *provider );
+
+    //! Returns the key of the view parameters of \a settings, or an empty string if they do not allow reuse
+    static QString viewKey( const QgsMapSettings &settings );
+
+    //! Removes all kept placements (without locking)
+    void clearInternal();
+
+    mutable QMutex mMutex;
+    double mBorderZone = 50;
+
+    //! Key of the view parameters of the kept placements
+    QString mViewKey;
+    //! Extent of the last run
+    QgsRectangle mExtent;
+    //! Kept placements, by label provider key
+    QHash< QString, ProviderPlacements > mPlacements;
+    //! Layers which the cache is connected to
+    QSet< QgsWeakMapLayerPointer > mConnectedLayers;
+};
+
+#endif // QGSLABELINGCACHE_H
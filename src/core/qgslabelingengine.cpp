@@ -16,6 +16,7 @@
 
 #include "qgslabelingengine.h"
 
+#include "qgslabelingcache.h"
 #include "qgslogger.h"
 
 #include "feature.h"
@@ -163,6 +164,9 @@ void QgsLabelingEngine::processProvider( QgsAbstractLabelProvider *provider, Qgs
 
   Q_FOREACH ( QgsLabelFeature *feature, features )
   {
+    if ( mReuseCachedPlacements )
+      mCache->pinFeature( provider, feature, mCacheReuseArea );
+
     try
     {
       l->registerFeature( feature );
@@ -220,6 +224,16 @@ void QgsLabelingEngine::run( QgsRenderContext &context )
 
   p.setShowPartial( settings.testFlag( QgsLabelingEngineSettings::UsePartialCandidates ) );
 
+  QgsGeometry extentGeom = QgsGeometry::fromRect( mMapSettings.visibleExtent() );
+  if ( !qgsDoubleNear( mMapSettings.rotation(), 0.0 ) )
+  {
+    //PAL features are prerotated, so extent also needs to be unrotated
+    extentGeom.rotate( -mMapSettings.rotation(), mMapSettings.visibleExtent().center() );
+  }
+
+  QgsRectangle extent = extentGeom.boundingBox();
+
+  mReuseCachedPlacements = mCache && mCache->prepare( mMapSettings, extent, mCacheReuseArea );
 
   // for each provider: get labels and register them in PAL
   Q_FOREACH ( QgsAbstractLabelProvider *provider, mProviders )
@@ -240,15 +254,6 @@ void QgsLabelingEngine::run( QgsRenderContext &context )
 
   QPainter *painter = context.painter();
 
-  QgsGeometry extentGeom = QgsGeometry::fromRect( mMapSettings.visibleExtent() );
-  if ( !qgsDoubleNear( mMapSettings.rotation(), 0.0 ) )
-  {
-    //PAL features are prerotated, so extent also needs to be unrotated
-    extentGeom.rotate( -mMapSettings.rotation(), mMapSettings.visibleExtent().center() );
-  }
-
-  QgsRectangle extent = extentGeom.boundingBox();
-
   p.registerCancelationCallback( &_palIsCanceled, reinterpret_cast< void * >( &context ) );
 
   QTime t;
@@ -318,6 +323,10 @@ void QgsLabelingEngine::run( QgsRenderContext &context )
     delete labels;
     return;
   }
+
+  if ( mCache )
+    mCache->storePlacements( mMapSettings, extent, *labels );
+
   painter->setRenderHint( QPainter::Antialiasing );
 
   // sort labels
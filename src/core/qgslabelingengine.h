@@ -26,6 +26,7 @@
 
 
 class QgsLabelingEngine;
+class QgsLabelingCache;
 
 
 /** \ingroup core
@@ -199,6 +200,21 @@ class CORE_EXPORT QgsLabelingEngine
     //! compute the labeling with given map settings and providers
     void run( QgsRenderContext &context );
 
+    /**
+     * Sets the \a cache of label placements used by the engine (not owned). Labels kept in the
+     * cache are pinned to their previous placement and the solution is stored in the cache.
+     * \see cache()
+     * \since QGIS 3.0
+     */
+    void setCache( QgsLabelingCache *cache ) { mCache = cache; }
+
+    /**
+     * Returns the cache of label placements used by the engine, if any.
+     * \see setCache()
+     * \since QGIS 3.0
+     */
+    QgsLabelingCache *cache() const { return mCache; }
+
     //! Return pointer to recently computed results and pass the ownership of results to the caller
     QgsLabelingResults *takeResults();
 
@@ -219,6 +235,13 @@ class CORE_EXPORT QgsLabelingEngine
     //! Resulting labeling layout
     std::unique_ptr< QgsLabelingResults > mResults;
 
+    //! Cache of label placements (not owned)
+    QgsLabelingCache *mCache = nullptr;
+    //! Whether kept placements of the cache are reused by the current run
+    bool mReuseCachedPlacements = false;
+    //! Area in which labels kept in the cache are reused by the current run
+    QgsRectangle mCacheReuseArea;
+
 };
 
 
@@ -17,6 +17,9 @@
 
 #include "qgsmaplayer.h"
 #include "qgsmaplayerlistutils.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+#include "qgsvectorlayereditbuffer.h"
 
 QgsMapRendererCache::QgsMapRendererCache()
 {
@@ -39,12 +42,12 @@ void QgsMapRendererCache::clearInternal()
   {
     if ( layer.data() )
     {
-      disconnect( layer.data(), &QgsMapLayer::repaintRequested, this, &QgsMapRendererCache::layerRequestedRepaint );
-      disconnect( layer.data(), &QgsMapLayer::willBeDeleted, this, &QgsMapRendererCache::layerRequestedRepaint );
+      disconnect( layer.data(), nullptr, this, nullptr );
     }
   }
   mCachedImages.clear();
   mConnectedLayers.clear();
+  mLayerChanges.clear();
 }
 
 void QgsMapRendererCache::dropUnusedConnections()
@@ -55,12 +58,41 @@ void QgsMapRendererCache::dropUnusedConnections()
   {
     if ( layer.data() )
     {
-      disconnect( layer.data(), &QgsMapLayer::repaintRequested, this, &QgsMapRendererCache::layerRequestedRepaint );
-      disconnect( layer.data(), &QgsMapLayer::willBeDeleted, this, &QgsMapRendererCache::layerRequestedRepaint );
+      disconnect( layer.data(), nullptr, this, nullptr );
     }
   }
 
   mConnectedLayers = stillDepends;
+
+  // changes are only tracked for layers with an updatable image
+  QHash< QString, LayerChanges >::iterator it = mLayerChanges.begin();
+  while ( it != mLayerChanges.end() )
+  {
+    if ( mCachedImages.value( it.key() ).updatable )
+      ++it;
+    else
+      it = mLayerChanges.erase( it );
+  }
+}
+
+void QgsMapRendererCache::connectLayer( QgsMapLayer *layer )
+{
+  if ( mConnectedLayers.contains( QgsWeakMapLayerPointer( layer ) ) )
+    return;
+
+  connect( layer, &QgsMapLayer::repaintRequested, this, &QgsMapRendererCache::layerRequestedRepaint );
+  connect( layer, &QgsMapLayer::willBeDeleted, this, &QgsMapRendererCache::layerInvalidated );
+  if ( QgsVectorLayer *vl = qobject_cast< QgsVectorLayer * >( layer ) )
+  {
+    // vertex markers are only drawn while editing
+    connect( vl, &QgsVectorLayer::editingStarted, this, &QgsMapRendererCache::layerInvalidated );
+    connect( vl, &QgsVectorLayer::editingStopped, this, &QgsMapRendererCache::layerInvalidated );
+    connect( vl, &QgsVectorLayer::featureAdded, this, &QgsMapRendererCache::featureAdded );
+    connect( vl, &QgsVectorLayer::featureDeleted, this, &QgsMapRendererCache::featureDeleted );
+    connect( vl, &QgsVectorLayer::geometryChanged, this, &QgsMapRendererCache::geometryChanged );
+    connect( vl, &QgsVectorLayer::attributeValueChanged, this, &QgsMapRendererCache::attributeValueChanged );
+  }
+  mConnectedLayers << layer;
 }
 
 QSet<QgsWeakMapLayerPointer > QgsMapRendererCache::dependentLayers() const
@@ -82,11 +114,38 @@ bool QgsMapRendererCache::init( const QgsRectangle &extent, double scale )
 {
   QMutexLocker lock( &mMutex );
 
+  // edits not followed by a repaint request are rendered now
+  QHash< QString, LayerChanges >::iterator changesIt = mLayerChanges.begin();
+  for ( ; changesIt != mLayerChanges.end(); ++changesIt )
+    changesIt.value().edited = false;
+
+  Q_FOREACH ( const QgsWeakMapLayerPointer &layer, mConnectedLayers )
+  {
+    if ( QgsVectorLayer *vl = qobject_cast< QgsVectorLayer * >( layer.data() ) )
+      updateSelection( vl );
+  }
+
   // check whether the params are the same
   if ( extent == mExtent &&
        qgsDoubleNear( scale, mScale ) )
     return true;
 
+  if ( qgsDoubleNear( scale, mScale ) )
+  {
+    // the extent was shifted: keep the images which can be updated partially
+    QMap<QString, CacheParameters>::iterator it = mCachedImages.begin();
+    while ( it != mCachedImages.end() )
+    {
+      if ( it.value().updatable )
+        ++it;
+      else
+        it = mCachedImages.erase( it );
+    }
+    dropUnusedConnections();
+    mExtent = extent;
+    return false;
+  }
+
   clearInternal();
 
   // set new params
@@ -102,6 +161,7 @@ void QgsMapRendererCache::setCacheImage( const QString &cacheKey, const QImage &
 
   CacheParameters params;
   params.cachedImage = image;
+  params.extent = mExtent;
 
   // connect to the layer to listen to layer's repaintRequested() signals
   Q_FOREACH ( QgsMapLayer *layer, dependentLayers )
@@ -109,31 +169,88 @@ void QgsMapRendererCache::setCacheImage( const QString &cacheKey, const QImage &
     if ( layer )
     {
       params.dependentLayers << layer;
-      if ( !mConnectedLayers.contains( QgsWeakMapLayerPointer( layer ) ) )
-      {
-        connect( layer, &QgsMapLayer::repaintRequested, this, &QgsMapRendererCache::layerRequestedRepaint );
-        connect( layer, &QgsMapLayer::willBeDeleted, this, &QgsMapRendererCache::layerRequestedRepaint );
-        mConnectedLayers << layer;
-      }
+      connectLayer( layer );
     }
   }
 
   mCachedImages[cacheKey] = params;
+  mLayerChanges.remove( cacheKey );
+}
+
+void QgsMapRendererCache::setLayerCacheImage( QgsMapLayer *layer, const QImage &image, const QgsMapToPixel &mapToPixel )
+{
+  if ( !layer )
+    return;
+
+  QMutexLocker lock( &mMutex );
+
+  CacheParameters params;
+  params.cachedImage = image;
+  params.dependentLayers << layer;
+  params.extent = mExtent;
+  params.updatable = true;
+  params.mapToPixel = mapToPixel;
+  connectLayer( layer );
+
+  if ( QgsVectorLayer *vl = qobject_cast< QgsVectorLayer * >( layer ) )
+  {
+    LayerChanges changes;
+    if ( QgsVectorLayerEditBuffer *editBuffer = vl->editBuffer() )
+    {
+      // features changed in the edit buffer are drawn with their new geometry
+      const QgsGeometryMap changedGeometries = editBuffer->changedGeometries();
+      for ( QgsGeometryMap::const_iterator it = changedGeometries.constBegin(); it != changedGeometries.constEnd(); ++it )
+        changes.featureBounds.insert( it.key(), it.value().boundingBox() );
+
+      const QgsFeatureMap addedFeatures = editBuffer->addedFeatures();
+      for ( QgsFeatureMap::const_iterator it = addedFeatures.constBegin(); it != addedFeatures.constEnd(); ++it )
+        changes.featureBounds.insert( it.key(), it.value().geometry().boundingBox() );
+    }
+    changes.selectedFeatureIds = vl->selectedFeatureIds();
+    mLayerChanges.insert( layer->id(), changes );
+  }
+
+  mCachedImages[layer->id()] = params;
+}
+
+QImage QgsMapRendererCache::layerCacheImage( const QString &layerId, QgsMapToPixel &mapToPixel, QList<QgsRectangle> &dirtyExtents ) const
+{
+  QMutexLocker lock( &mMutex );
+
+  QMap<QString, CacheParameters>::const_iterator it = mCachedImages.constFind( layerId );
+  if ( it == mCachedImages.constEnd() || !it.value().updatable )
+    return QImage();
+
+  mapToPixel = it.value().mapToPixel;
+  dirtyExtents = it.value().dirtyExtents;
+  return it.value().cachedImage;
+}
+
+bool QgsMapRendererCache::isCurrent( const CacheParameters &params ) const
+{
+  return params.extent == mExtent && params.dirtyExtents.isEmpty();
 }
 
 bool QgsMapRendererCache::hasCacheImage( const QString &cacheKey ) const
 {
-  return mCachedImages.contains( cacheKey );
+  QMutexLocker lock( &mMutex );
+  QMap<QString, CacheParameters>::const_iterator it = mCachedImages.constFind( cacheKey );
+  return it != mCachedImages.constEnd() && isCurrent( it.value() );
 }
 
 QImage QgsMapRendererCache::cacheImage( const QString &cacheKey ) const
 {
   QMutexLocker lock( &mMutex );
-  return mCachedImages.value( cacheKey ).cachedImage;
+  QMap<QString, CacheParameters>::const_iterator it = mCachedImages.constFind( cacheKey );
+  if ( it == mCachedImages.constEnd() || !isCurrent( it.value() ) )
+    return QImage();
+
+  return it.value().cachedImage;
 }
 
 QList< QgsMapLayer * > QgsMapRendererCache::dependentLayers( const QString &cacheKey ) const
 {
+  QMutexLocker lock( &mMutex );
   if ( mCachedImages.contains( cacheKey ) )
   {
     return _qgis_listQPointerToRaw( mCachedImages.value( cacheKey ).dependentLayers );
@@ -149,7 +266,39 @@ void QgsMapRendererCache::layerRequestedRepaint()
 
   QMutexLocker lock( &mMutex );
 
+  // edit tools and selection changes request a repaint of the layer, its image only needs a partial update then
+  bool keepLayerImage = false;
+  if ( mLayerChanges.contains( layer->id() ) )
+  {
+    const bool edited = mLayerChanges[layer->id()].edited;
+    mLayerChanges[layer->id()].edited = false;
+    keepLayerImage = updateSelection( qobject_cast< QgsVectorLayer * >( layer ) ) || edited;
+  }
+
   // check through all cached images to clear any which depend on this layer
+  QMap<QString, CacheParameters>::iterator it = mCachedImages.begin();
+  for ( ; it != mCachedImages.end(); )
+  {
+    if ( !it.value().dependentLayers.contains( layer ) ||
+         ( keepLayerImage && it.value().updatable && it.key() == layer->id() ) )
+    {
+      ++it;
+      continue;
+    }
+
+    it = mCachedImages.erase( it );
+  }
+  dropUnusedConnections();
+}
+
+void QgsMapRendererCache::layerInvalidated()
+{
+  QgsMapLayer *layer = qobject_cast<QgsMapLayer *>( sender() );
+  if ( !layer )
+    return;
+
+  QMutexLocker lock( &mMutex );
+
   QMap<QString, CacheParameters>::iterator it = mCachedImages.begin();
   for ( ; it != mCachedImages.end(); )
   {
@@ -164,6 +313,148 @@ void QgsMapRendererCache::layerRequestedRepaint()
   dropUnusedConnections();
 }
 
+void QgsMapRendererCache::addDirtyExtents( QgsMapLayer *layer, const QList<QgsRectangle> &extents )
+{
+  QMap<QString, CacheParameters>::iterator it = mCachedImages.find( layer->id() );
+  if ( it == mCachedImages.end() || !it.value().updatable )
+    return;
+
+  it.value().dirtyExtents << extents;
+  if ( it.value().dirtyExtents.count() > MAX_DIRTY_EXTENTS )
+  {
+    mCachedImages.erase( it );
+    dropUnusedConnections();
+  }
+}
+
+QList< QgsRectangle > QgsMapRendererCache::drawnFeatureBounds( QgsVectorLayer *layer, const QgsFeatureIds &fids ) const
+{
+  QList< QgsRectangle > bounds;
+  QgsFeatureIds unchangedFids;
+  QHash< QString, LayerChanges >::const_iterator changesIt = mLayerChanges.constFind( layer->id() );
+  Q_FOREACH ( QgsFeatureId fid, fids )
+  {
+    if ( changesIt != mLayerChanges.constEnd() && changesIt.value().featureBounds.contains( fid ) )
+      bounds << changesIt.value().featureBounds.value( fid );
+    else
+      unchangedFids << fid;
+  }
+
+  if ( !unchangedFids.isEmpty() && layer->dataProvider() )
+  {
+    // the other features are drawn as stored by the data provider
+    QgsFeatureIterator fit = layer->dataProvider()->getFeatures( QgsFeatureRequest().setFilterFids( unchangedFids ).setSubsetOfAttributes( QgsAttributeList() ) );
+    QgsFeature feature;
+    while ( fit.nextFeature( feature ) )
+    {
+      if ( feature.hasGeometry() )
+        bounds << feature.geometry().boundingBox();
+    }
+  }
+  return bounds;
+}
+
+bool QgsMapRendererCache::updateSelection( QgsVectorLayer *layer )
+{
+  if ( !layer || !mLayerChanges.contains( layer->id() ) )
+    return false;
+
+  const QgsFeatureIds selected = layer->selectedFeatureIds();
+  QgsFeatureIds &drawnSelected = mLayerChanges[layer->id()].selectedFeatureIds;
+  if ( selected == drawnSelected )
+    return false;
+
+  // features which are selected in only one of the selections
+  QgsFeatureIds changed = selected;
+  changed.unite( drawnSelected );
+  QgsFeatureIds common = selected;
+  common.intersect( drawnSelected );
+  changed.subtract( common );
+  drawnSelected = selected;
+
+  if ( changed.count() > MAX_DIRTY_EXTENTS )
+  {
+    mCachedImages.remove( layer->id() );
+    dropUnusedConnections();
+    return true;
+  }
+
+  addDirtyExtents( layer, drawnFeatureBounds( layer, changed ) );
+  return true;
+}
+
+void QgsMapRendererCache::featureAdded( QgsFeatureId fid )
+{
+  QgsVectorLayer *layer = qobject_cast<QgsVectorLayer *>( sender() );
+  if ( !layer )
+    return;
+
+  QMutexLocker lock( &mMutex );
+  if ( !mLayerChanges.contains( layer->id() ) )
+    return;
+
+  // the new feature is drawn as stored in the edit buffer
+  QgsFeature feature;
+  if ( !layer->getFeatures( QgsFeatureRequest( fid ).setSubsetOfAttributes( QgsAttributeList() ) ).nextFeature( feature ) || !feature.hasGeometry() )
+    return;
+
+  const QgsRectangle bounds = feature.geometry().boundingBox();
+  LayerChanges &changes = mLayerChanges[layer->id()];
+  changes.featureBounds.insert( fid, bounds );
+  changes.edited = true;
+  addDirtyExtents( layer, QList< QgsRectangle >() << bounds );
+}
+
+void QgsMapRendererCache::featureDeleted( QgsFeatureId fid )
+{
+  QgsVectorLayer *layer = qobject_cast<QgsVectorLayer *>( sender() );
+  if ( !layer )
+    return;
+
+  QMutexLocker lock( &mMutex );
+  if ( !mLayerChanges.contains( layer->id() ) )
+    return;
+
+  const QList< QgsRectangle > bounds = drawnFeatureBounds( layer, QgsFeatureIds() << fid );
+  LayerChanges &changes = mLayerChanges[layer->id()];
+  changes.featureBounds.remove( fid );
+  changes.edited = true;
+  addDirtyExtents( layer, bounds );
+}
+
+void QgsMapRendererCache::geometryChanged( QgsFeatureId fid, const QgsGeometry &geometry )
+{
+  QgsVectorLayer *layer = qobject_cast<QgsVectorLayer *>( sender() );
+  if ( !layer )
+    return;
+
+  QMutexLocker lock( &mMutex );
+  if ( !mLayerChanges.contains( layer->id() ) )
+    return;
+
+  // both the previous and the new geometry need to be redrawn
+  QList< QgsRectangle > bounds = drawnFeatureBounds( layer, QgsFeatureIds() << fid );
+  bounds << geometry.boundingBox();
+  LayerChanges &changes = mLayerChanges[layer->id()];
+  changes.featureBounds.insert( fid, geometry.boundingBox() );
+  changes.edited = true;
+  addDirtyExtents( layer, bounds );
+}
+
+void QgsMapRendererCache::attributeValueChanged( QgsFeatureId fid )
+{
+  QgsVectorLayer *layer = qobject_cast<QgsVectorLayer *>( sender() );
+  if ( !layer )
+    return;
+
+  QMutexLocker lock( &mMutex );
+  if ( !mLayerChanges.contains( layer->id() ) )
+    return;
+
+  mLayerChanges[layer->id()].edited = true;
+  addDirtyExtents( layer, drawnFeatureBounds( layer, QgsFeatureIds() << fid ) );
+}
+
 void QgsMapRendererCache::clearCacheImage( const QString &cacheKey )
 {
   QMutexLocker lock( &mMutex );
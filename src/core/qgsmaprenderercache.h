@@ -17,12 +17,18 @@
 #define QGSMAPRENDERERCACHE_H
 
 #include "qgis_core.h"
+#include "qgis_sip.h"
+#include <QHash>
 #include <QMap>
 #include <QImage>
 #include <QMutex>
 
 #include "qgsrectangle.h"
 #include "qgsmaplayer.h"
+#include "qgsmaptopixel.h"
+#include "qgsfeature.h"
+
+class QgsVectorLayer;
 
 
 /** \ingroup core
@@ -34,6 +40,12 @@
  * If triggered, the cache removes the rendered image (and disconnects from the
  * layers).
  *
+ * Images of single layers set with setLayerCacheImage() can also be updated
+ * partially: they are kept when the map extent is shifted at the same scale,
+ * and edits or selection changes of vector layer features only mark the area
+ * of the changed features as dirty. Map renderer jobs then copy the kept pixels
+ * and only render the newly exposed and dirty areas (see layerCacheImage()).
+ *
  * The class is thread-safe (multiple classes can access the same instance safely).
  *
  * \since QGIS 2.4
@@ -53,7 +65,9 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
 
     /**
      * Initialize cache: set new parameters and clears the cache if any
-     * parameters have changed since last initialization.
+     * parameters have changed since last initialization. If only the
+     * extent was shifted, images set with setLayerCacheImage() are kept
+     * for partial updates.
      * \returns flag whether the parameters are the same as last time
      */
     bool init( const QgsRectangle &extent, double scale );
@@ -68,6 +82,27 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
      */
     void setCacheImage( const QString &cacheKey, const QImage &image, const QList< QgsMapLayer * > &dependentLayers = QList< QgsMapLayer * >() );
 
+    /**
+     * Set the cached \a image of \a layer, rendered with \a mapToPixel. Unlike images set
+     * with setCacheImage(), the image is kept when the map extent is shifted at the same
+     * scale, and edits or selection changes of vector layer features only mark the area
+     * of the changed features as dirty instead of removing the image.
+     * \see layerCacheImage()
+     * \since QGIS 3.0
+     */
+    void setLayerCacheImage( QgsMapLayer *layer, const QImage &image, const QgsMapToPixel &mapToPixel );
+
+    /**
+     * Returns the cached image of the layer with matching \a layerId, as set with setLayerCacheImage(),
+     * even if it was rendered for another extent or has dirty areas. \a mapToPixel is set to the transform
+     * the image was rendered with and \a dirtyExtents to the extents (in layer CRS) of the features which
+     * changed since then, they must be rendered again.
+     * Returns a null image if there is no such image.
+     * \see setLayerCacheImage()
+     * \since QGIS 3.0
+     */
+    QImage layerCacheImage( const QString &layerId, QgsMapToPixel &mapToPixel SIP_OUT, QList< QgsRectangle > &dirtyExtents SIP_OUT ) const;
+
     /**
      * Returns true if the cache contains an image with the specified \a cacheKey.
      * \since QGIS 3.0
@@ -78,7 +113,7 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
     /**
      * Returns the cached image for the specified \a cacheKey. The \a cacheKey usually
      * matches the QgsMapLayer::id() which the image is a render of.
-     * Returns a null image if it is not cached.
+     * Returns a null image if it is not cached, or if it needs to be updated for the current extent.
      * \see setCacheImage()
      * \see hasCacheImage()
      */
@@ -97,20 +132,75 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
     void clearCacheImage( const QString &cacheKey );
 
   private slots:
-    //! Remove layer (that emitted the signal) from the cache
+    //! Remove layer (that emitted the signal) from the cache, unless the repaint is only due to feature edits or selection
     void layerRequestedRepaint();
 
+    //! Remove layer (that emitted the signal) from the cache
+    void layerInvalidated();
+
+    //! Marks the area of a feature added to a vector layer as dirty
+    void featureAdded( QgsFeatureId fid );
+
+    //! Marks the area of a feature deleted from a vector layer as dirty
+    void featureDeleted( QgsFeatureId fid );
+
+    //! Marks the previous and new area of a feature as dirty
+    void geometryChanged( QgsFeatureId fid, const QgsGeometry &geometry );
+
+    //! Marks the area of a feature whose attributes changed as dirty, its symbol may change
+    void attributeValueChanged( QgsFeatureId fid );
+
   private:
 
     struct CacheParameters
     {
       QImage cachedImage;
       QgsWeakMapLayerPointerList dependentLayers;
+      //! Map extent the image was rendered for
+      QgsRectangle extent;
+      //! True for images set with setLayerCacheImage(), which can be updated partially
+      bool updatable = false;
+      //! Map to pixel transform the image was rendered with (updatable images only)
+      QgsMapToPixel mapToPixel;
+      //! Extents (in layer CRS) of features changed since the image was rendered (updatable images only)
+      QList< QgsRectangle > dirtyExtents;
     };
 
+    //! Changes of a vector layer since its updatable image was cached
+    struct LayerChanges
+    {
+      //! Bounding boxes (in layer CRS) of features as drawn in the image, if they may differ from the data provider
+      QHash< QgsFeatureId, QgsRectangle > featureBounds;
+      //! Features which were selected when the image was rendered
+      QgsFeatureIds selectedFeatureIds;
+      //! True if features were edited since the last repaint request
+      bool edited = false;
+    };
+
+    //! Maximum number of dirty extents of an image, beyond which rendering the whole image is cheaper
+    static const int MAX_DIRTY_EXTENTS = 256;
+
     //! Invalidate cache contents (without locking)
     void clearInternal();
 
+    //! Connects to the signals of \a layer, unless already connected (without locking)
+    void connectLayer( QgsMapLayer *layer );
+
+    //! Returns true if \a params are valid for the current extent, without any dirty area
+    bool isCurrent( const CacheParameters &params ) const;
+
+    //! Adds \a extents to the dirty extents of the image of \a layer, or drops the image if there are too many (without locking)
+    void addDirtyExtents( QgsMapLayer *layer, const QList< QgsRectangle > &extents );
+
+    //! Returns the bounding boxes of features \a fids of \a layer, as drawn in the cached image (without locking)
+    QList< QgsRectangle > drawnFeatureBounds( QgsVectorLayer *layer, const QgsFeatureIds &fids ) const;
+
+    /**
+     * Marks the features whose selection changed since the image of \a layer was rendered as dirty.
+     * Returns false if the selection did not change (without locking).
+     */
+    bool updateSelection( QgsVectorLayer *layer );
+
     //! Disconnects from layers we no longer care about
     void dropUnusedConnections();
 
@@ -124,6 +214,8 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
     QMap<QString, CacheParameters> mCachedImages;
     //! List of all layers on which this cache is currently connected
     QSet< QgsWeakMapLayerPointer > mConnectedLayers;
+    //! Changes of vector layers with updatable images, by layer id
+    QHash< QString, LayerChanges > mLayerChanges;
 };
 
 
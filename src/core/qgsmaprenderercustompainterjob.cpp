@@ -76,6 +76,7 @@ void QgsMapRendererCustomPainterJob::start()
   {
     mLabelingEngineV2.reset( new QgsLabelingEngine() );
     mLabelingEngineV2->setMapSettings( mSettings );
+    mLabelingEngineV2->setCache( mLabelingCache );
   }
 
   bool canUseLabelCache = prepareLabelCache();
@@ -256,7 +257,8 @@ void QgsMapRendererCustomPainterJob::doRender()
       QTime layerTime;
       layerTime.start();
 
-      if ( job.img )
+      // images updated from the cache already contain the kept pixels
+      if ( job.img && !job.imageInitialized )
       {
         job.img->fill( 0 );
         job.imageInitialized = true;
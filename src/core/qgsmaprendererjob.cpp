@@ -66,6 +66,11 @@ void QgsMapRendererJob::setCache( QgsMapRendererCache *cache )
   mCache = cache;
 }
 
+void QgsMapRendererJob::setLabelingCache( QgsLabelingCache *cache )
+{
+  mLabelingCache = cache;
+}
+
 const QgsMapSettings &QgsMapRendererJob::mapSettings() const
 {
   return mSettings;
@@ -209,7 +214,7 @@ bool QgsMapRendererJob::reprojectToLayerExtent( const QgsMapLayer *ml, const Qgs
 
 
 
-LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEngine *labelingEngine2 )
+LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEngine *labelingEngine2, bool renderParallelTiles )
 {
   LayerRenderJobs layerJobs;
 
@@ -259,14 +264,14 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
       continue;
     }
 
-    // Force render of layers that are being edited
-    // or if there's a labeling engine that needs the layer to register features
+    // Force render of layers if there's a labeling engine that needs the layer to register features.
+    // Edits of features only mark their area as dirty in the cache, it is rendered again below.
     if ( mCache && ml->type() == QgsMapLayer::VectorLayer )
     {
       QgsVectorLayer *vl = qobject_cast<QgsVectorLayer *>( ml );
       bool requiresLabeling = false;
       requiresLabeling = ( labelingEngine2 && QgsPalLabeling::staticWillUseLayer( vl ) ) && requiresLabelRedraw;
-      if ( vl->isEditable() || requiresLabeling )
+      if ( requiresLabeling )
       {
         mCache->clearCacheImage( ml->id() );
       }
@@ -291,6 +296,7 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
     job.context.setLabelingEngine( labelingEngine2 );
     job.context.setCoordinateTransform( ct );
     job.context.setExtent( r1 );
+    job.context.setFlag( QgsRenderContext::RenderParallelTiles, renderParallelTiles );
 
     if ( mFeatureFilterProvider )
       job.context.setFeatureFilterProvider( mFeatureFilterProvider );
@@ -334,16 +340,139 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
     if ( hasStyleOverride )
       ml->styleManager()->setOverrideStyle( mSettings.layerStyleOverrides().value( ml->id() ) );
 
+    // a partial update draws with a clipped painter, which is never split into tiles
+    int dx = 0, dy = 0;
+    QList< QgsRectangle > dirtyExtents;
+    if ( mCache && job.img && ml->type() == QgsMapLayer::VectorLayer && !updatableLayerImage( job, dx, dy, dirtyExtents ).isNull() )
+      job.context.setFlag( QgsRenderContext::RenderParallelTiles, false );
+
     job.renderer = ml->createMapRenderer( job.context );
 
     if ( hasStyleOverride )
       ml->styleManager()->restoreOverrideStyle();
 
+    if ( mCache && job.img )
+      prepareLayerUpdate( job, ct );
+
   } // while (li.hasPrevious())
 
   return layerJobs;
 }
 
+bool QgsMapRendererJob::prepareLayerUpdate( LayerRenderJob &job, const QgsCoordinateTransform &ct )
+{
+  // only vector layers know how far their features are drawn
+  QgsVectorLayerRenderer *renderer = dynamic_cast< QgsVectorLayerRenderer * >( job.renderer );
+  if ( !renderer || !job.layer )
+    return false;
+
+  int dx = 0, dy = 0;
+  QList< QgsRectangle > dirtyExtents;
+  const QImage cachedImage = updatableLayerImage( job, dx, dy, dirtyExtents );
+  if ( cachedImage.isNull() )
+    return false;
+
+  const double margin = renderer->partialRenderingMargin();
+  if ( margin < 0 )
+    return false;
+
+  // area to render: the exposed part of the image and the areas of changed features
+  const QRect imageRect = job.img->rect();
+  const QgsMapToPixel &mapToPixel = job.context.mapToPixel();
+  QRegion region = QRegion( imageRect ).subtracted( QRegion( imageRect.translated( dx, dy ) ) );
+  const int pixelMargin = static_cast< int >( std::ceil( margin ) );
+  Q_FOREACH ( QgsRectangle extent, dirtyExtents )
+  {
+    if ( ct.isValid() )
+    {
+      try
+      {
+        extent = ct.transformBoundingBox( extent );
+      }
+      catch ( QgsCsException &cse )
+      {
+        Q_UNUSED( cse );
+        return false;
+      }
+    }
+
+    QgsRectangle pixelExtent;
+    pixelExtent.setMinimal();
+    const QgsPointXY corners[] =
+    {
+      mapToPixel.transform( extent.xMinimum(), extent.yMinimum() ),
+      mapToPixel.transform( extent.xMaximum(), extent.yMinimum() ),
+      mapToPixel.transform( extent.xMinimum(), extent.yMaximum() ),
+      mapToPixel.transform( extent.xMaximum(), extent.yMaximum() )
+    };
+    for ( const QgsPointXY &corner : corners )
+      pixelExtent.combineExtentWith( corner.x(), corner.y() );
+
+    const QRect dirtyRect = QRectF( pixelExtent.xMinimum(), pixelExtent.yMinimum(), pixelExtent.width(), pixelExtent.height() ).toAlignedRect();
+    region += dirtyRect.adjusted( -pixelMargin, -pixelMargin, pixelMargin, pixelMargin ) & imageRect;
+  }
+  if ( region.isEmpty() )
+    return false;
+
+  // features whose symbols reach into the area are rendered too, they are clipped by the painter
+  const QRect renderRect = region.boundingRect().adjusted( -pixelMargin, -pixelMargin, pixelMargin, pixelMargin );
+  QgsRectangle extent;
+  extent.setMinimal();
+  const QgsPointXY renderCorners[] =
+  {
+    mapToPixel.toMapCoordinatesF( renderRect.left(), renderRect.top() ),
+    mapToPixel.toMapCoordinatesF( renderRect.right() + 1, renderRect.top() ),
+    mapToPixel.toMapCoordinatesF( renderRect.left(), renderRect.bottom() + 1 ),
+    mapToPixel.toMapCoordinatesF( renderRect.right() + 1, renderRect.bottom() + 1 )
+  };
+  for ( const QgsPointXY &corner : renderCorners )
+    extent.combineExtentWith( corner.x(), corner.y() );
+
+  QgsRectangle r2;
+  if ( ct.isValid() )
+    reprojectToLayerExtent( job.layer.data(), ct, extent, r2 );
+  if ( !extent.isFinite() )
+    return false;
+
+  // copy the kept pixels and clear the area to render
+  QPainter *painter = job.context.painter();
+  job.img->fill( 0 );
+  painter->drawImage( dx, dy, cachedImage );
+  painter->setClipRegion( region );
+  painter->setCompositionMode( QPainter::CompositionMode_Clear );
+  painter->fillRect( region.boundingRect(), Qt::transparent );
+  painter->setCompositionMode( QPainter::CompositionMode_SourceOver );
+
+  // the context keeps the map extent, for symbols to be clipped like in a full render
+  renderer->setPartialRenderingExtent( extent );
+  job.imageInitialized = true;
+  QgsDebugMsgLevel( QString( "updating %1 rectangles of cached image of layer %2" ).arg( region.rectCount() ).arg( job.layer->id() ), 2 );
+  return true;
+}
+
+QImage QgsMapRendererJob::updatableLayerImage( const LayerRenderJob &job, int &dx, int &dy, QList< QgsRectangle > &dirtyExtents ) const
+{
+  if ( !job.layer )
+    return QImage();
+
+  QgsMapToPixel cachedMapToPixel;
+  const QImage cachedImage = mCache->layerCacheImage( job.layer->id(), cachedMapToPixel, dirtyExtents );
+  const QgsMapToPixel &mapToPixel = job.context.mapToPixel();
+  if ( cachedImage.isNull() || cachedImage.size() != job.img->size() || cachedImage.format() != job.img->format() ||
+       !qgsDoubleNear( cachedMapToPixel.mapUnitsPerPixel(), mapToPixel.mapUnitsPerPixel() ) ||
+       !qgsDoubleNear( cachedMapToPixel.mapRotation(), mapToPixel.mapRotation() ) )
+    return QImage();
+
+  // the kept pixels can only be copied if the extent was shifted by whole pixels
+  const QgsPointXY origin = mapToPixel.transform( cachedMapToPixel.toMapCoordinatesF( 0, 0 ) );
+  dx = static_cast< int >( std::round( origin.x() ) );
+  dy = static_cast< int >( std::round( origin.y() ) );
+  if ( std::fabs( origin.x() - dx ) > 0.01 || std::fabs( origin.y() - dy ) > 0.01 )
+    return QImage();
+
+  return cachedImage;
+}
+
 LabelRenderJob QgsMapRendererJob::prepareLabelingJob( QPainter *painter, QgsLabelingEngine *labelingEngine2, bool canUseLabelCache )
 {
   LabelRenderJob job;
@@ -399,7 +528,7 @@ void QgsMapRendererJob::cleanupJobs( LayerRenderJobs &jobs )
       if ( mCache && !job.cached && !job.context.renderingStopped() && job.layer )
       {
         QgsDebugMsg( "caching image for " + ( job.layer ? job.layer->id() : QString() ) );
-        mCache->setCacheImage( job.layer->id(), *job.img, QList< QgsMapLayer * >() << job.layer );
+        mCache->setLayerCacheImage( job.layer, *job.img, job.context.mapToPixel() );
       }
 
       delete job.img;
@@ -30,6 +30,7 @@
 #include "qgsmapsettings.h"
 
 
+class QgsLabelingCache;
 class QgsLabelingEngine;
 class QgsLabelingResults;
 class QgsMapLayerRenderer;
@@ -186,6 +187,15 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
     //! Does not take ownership of the object.
     void setCache( QgsMapRendererCache *cache );
 
+    /**
+     * Assigns a cache of label placements, which the labeling engine uses to keep the placement
+     * of labels from one job to the next one. Does not take ownership of the object.
+     * \see QgsLabelingCache
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    void setLabelingCache( QgsLabelingCache *cache ) SIP_SKIP;
+
     //! Find out how long it took to finish the job (in milliseconds)
     int renderingTime() const { return mRenderingTime; }
 
@@ -224,6 +234,9 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
 
     QgsMapRendererCache *mCache = nullptr;
 
+    //! Cache of label placements (not owned)
+    QgsLabelingCache *mLabelingCache = nullptr;
+
     int mRenderingTime = 0;
 
     /**
@@ -233,8 +246,12 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
      */
     bool prepareLabelCache() const SIP_SKIP;
 
-    //! \note not available in Python bindings
-    LayerRenderJobs prepareJobs( QPainter *painter, QgsLabelingEngine *labelingEngine2 ) SIP_SKIP;
+    /**
+     * Prepares the rendering jobs of all layers. If \a renderParallelTiles is true, layer renderers
+     * may split their rendering into tiles which are rendered on several threads.
+     * \note not available in Python bindings
+     */
+    LayerRenderJobs prepareJobs( QPainter *painter, QgsLabelingEngine *labelingEngine2, bool renderParallelTiles = false ) SIP_SKIP;
 
     /**
      * Prepares a labeling job.
@@ -275,6 +292,22 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
 
     bool needTemporaryImage( QgsMapLayer *ml );
 
+    /**
+     * Prepares \a job to update the image of its layer kept in the cache, if the map extent was only
+     * shifted or some features changed: the kept pixels are copied into the job image and only the
+     * exposed and dirty areas are rendered. \a ct is the transform from the layer CRS to the map CRS.
+     * \returns false if the whole layer needs to be rendered
+     */
+    bool prepareLayerUpdate( LayerRenderJob &job, const QgsCoordinateTransform &ct );
+
+    /**
+     * Returns the image of the layer of \a job kept in the cache if it can be updated for the current
+     * map settings, i.e. if it was rendered at the same scale and rotation and the map extent was shifted
+     * by whole pixels. \a dx and \a dy are set to the position of the cached image in the new image and
+     * \a dirtyExtents to the extents of the changed features. Returns a null image otherwise.
+     */
+    QImage updatableLayerImage( const LayerRenderJob &job, int &dx, int &dy, QList< QgsRectangle > &dirtyExtents ) const;
+
     const QgsFeatureFilterProvider *mFeatureFilterProvider = nullptr;
 };
 
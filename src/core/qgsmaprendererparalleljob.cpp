@@ -55,10 +55,12 @@ void QgsMapRendererParallelJob::start()
   {
     mLabelingEngineV2.reset( new QgsLabelingEngine() );
     mLabelingEngineV2->setMapSettings( mSettings );
+    mLabelingEngineV2->setCache( mLabelingCache );
   }
 
   bool canUseLabelCache = prepareLabelCache();
-  mLayerJobs = prepareJobs( nullptr, mLabelingEngineV2.get() );
+  // layers are rendered concurrently, but a single expensive layer may still split its work into tiles for the idle threads
+  mLayerJobs = prepareJobs( nullptr, mLabelingEngineV2.get(), true );
   mLabelJob = prepareLabelingJob( nullptr, mLabelingEngineV2.get(), canUseLabelCache );
 
   QgsDebugMsg( QString( "QThreadPool max thread count is %1" ).arg( QThreadPool::globalInstance()->maxThreadCount() ) );
@@ -242,7 +244,8 @@ void QgsMapRendererParallelJob::renderLayerStatic( LayerRenderJob &job )
   if ( job.cached )
     return;
 
-  if ( job.img )
+  // images updated from the cache already contain the kept pixels
+  if ( job.img && !job.imageInitialized )
   {
     job.img->fill( 0 );
     job.imageInitialized = true;
@@ -261,6 +261,28 @@ void QgsMapToPixel::transformInPlace( float &x, float &y ) const
   y = my;
 }
 
+void QgsMapToPixel::transformInPlace( QPolygonF &polygon ) const
+{
+  // the matrix is affine: spelling out QTransform::map() avoids a call and a switch per point, and lets
+  // the compiler vectorize the loop
+  const double m11 = mMatrix.m11();
+  const double m12 = mMatrix.m12();
+  const double m21 = mMatrix.m21();
+  const double m22 = mMatrix.m22();
+  const double dx = mMatrix.dx();
+  const double dy = mMatrix.dy();
+
+  QPointF *point = polygon.data();
+  const int count = polygon.size();
+  for ( int i = 0; i < count; ++i )
+  {
+    const double x = point[i].x();
+    const double y = point[i].y();
+    point[i].rx() = m11 * x + m21 * y + dx;
+    point[i].ry() = m12 * x + m22 * y + dy;
+  }
+}
+
 QTransform QgsMapToPixel::transform() const
 {
   // NOTE: operations are done in the reverse order in which
@@ -19,6 +19,7 @@
 
 #include "qgis_core.h"
 #include "qgis_sip.h"
+#include <QPolygonF>
 #include <QTransform>
 #include <vector>
 #include "qgsunittypes.h"
@@ -100,6 +101,14 @@ class CORE_EXPORT QgsMapToPixel
 
 #ifndef SIP_RUN
 
+    /**
+     * Transforms all points of \a polygon from map (world) coordinates to device coordinates, in place.
+     * Much faster than transforming the points one by one.
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    void transformInPlace( QPolygonF &polygon ) const SIP_SKIP;
+
     /**
      * Transform device coordinates to map coordinates. Modifies the
      * given coordinates in place. Intended as a fast way to do the
@@ -22,6 +22,10 @@
 #include "qgswkbptr.h"
 #include "qgscoordinatereferencesystem.h"
 #include "qgsrectangle.h"
+#include "qgsgeometrycollection.h"
+#include "qgslinestring.h"
+#include "qgspoint.h"
+#include "qgspolygon.h"
 
 #include <QColor>
 #include <QStringList>
@@ -1122,6 +1126,278 @@ QDomElement QgsOgcUtils::rectangleToGMLEnvelope( QgsRectangle *env, QDomDocument
   return envElem;
 }
 
+/*
+ * GML text is written the same way as QDomDocument::toString( 1 ) writes the elements
+ * created by the DOM functions: one element per line, indented by one space per level,
+ * text content on the line of its element.
+ */
+namespace
+{
+  //! Appends the attribute \a name with \a value to a start tag, escaped as QDom escapes it
+  void appendGMLAttribute( QString &gml, const QString &name, const QString &value )
+  {
+    gml += ' ' + name + QLatin1String( "=\"" );
+    for ( int i = 0; i < value.size(); ++i )
+    {
+      const QChar c = value.at( i );
+      if ( c == '<' )
+        gml += QLatin1String( "&lt;" );
+      else if ( c == '"' )
+        gml += QLatin1String( "&quot;" );
+      else if ( c == '&' )
+        gml += QLatin1String( "&amp;" );
+      else if ( c == '>' && i >= 2 && value.at( i - 1 ) == ']' && value.at( i - 2 ) == ']' )
+        gml += QLatin1String( "&gt;" );
+      else if ( c == '\n' )
+        gml += QLatin1String( "&#xa;" );
+      else if ( c == '\r' )
+        gml += QLatin1String( "&#xd;" );
+      else if ( c == '\t' )
+        gml += QLatin1String( "&#x9;" );
+      else
+        gml += c;
+    }
+    gml += '"';
+  }
+
+  //! Appends the start tag of an element created with QDomDocument::createElementNS()
+  void openGMLElement( QString &gml, int indent, const QString &name, const QString &ns, const QString &srsName = QString(), bool empty = false )
+  {
+    gml += QString( indent, ' ' ) + '<' + name;
+    appendGMLAttribute( gml, QStringLiteral( "xmlns" ), ns );
+    if ( !srsName.isEmpty() )
+      appendGMLAttribute( gml, QStringLiteral( "srsName" ), srsName );
+    gml += empty ? QLatin1String( "/>\n" ) : QLatin1String( ">\n" );
+  }
+
+  void closeGMLElement( QString &gml, int indent, const QString &name )
+  {
+    gml += QString( indent, ' ' ) + QLatin1String( "</" ) + name + QLatin1String( ">\n" );
+  }
+
+  //! Appends the coordinates of a geometry, as QgsGeometryUtils::pointsToGML2() / pointsToGML3() create them
+  void writeGMLCoordinates( QString &gml, int indent, bool gml3, const QString &gml3Name, const QString &ns, bool is3D, const QString &coordinates )
+  {
+    const QString name = gml3 ? gml3Name : QStringLiteral( "coordinates" );
+    gml += QString( indent, ' ' ) + '<' + name;
+    appendGMLAttribute( gml, QStringLiteral( "xmlns" ), ns );
+    if ( gml3 )
+    {
+      gml += QStringLiteral( " srsDimension=\"%1\"" ).arg( is3D ? 3 : 2 );
+    }
+    else
+    {
+      gml += QLatin1String( " cs=\",\" ts=\" \"" );
+    }
+    gml += '>' + coordinates + QLatin1String( "</" ) + name + QLatin1String( ">\n" );
+  }
+
+  //! Appends a line string, or the linear ring of a polygon when \a name is LinearRing
+  void writeGMLLineString( QString &gml, int indent, bool gml3, const QgsLineString &line, int precision, const QString &name, const QString &ns, const QString &srsName )
+  {
+    // Z values are only written in GML3
+    const bool is3D = gml3 && line.is3D();
+
+    QString coordinates;
+    for ( int i = 0; i < line.numPoints(); ++i )
+    {
+      if ( i > 0 )
+        coordinates += ' ';
+      coordinates += qgsDoubleToString( line.xAt( i ), precision ) + ( gml3 ? ' ' : ',' ) + qgsDoubleToString( line.yAt( i ), precision );
+      if ( is3D )
+        coordinates += ' ' + qgsDoubleToString( line.zAt( i ), precision );
+    }
+
+    openGMLElement( gml, indent, name, ns, srsName );
+    writeGMLCoordinates( gml, indent + 1, gml3, QStringLiteral( "posList" ), ns, line.is3D(), coordinates );
+    closeGMLElement( gml, indent, name );
+  }
+
+  //! Returns true if the rings of \a polygon are line strings, which can be written as text
+  bool hasLineStringRings( const QgsPolygonV2 &polygon )
+  {
+    if ( !qgsgeometry_cast<const QgsLineString *>( polygon.exteriorRing() ) )
+      return false;
+
+    for ( int i = 0; i < polygon.numInteriorRings(); ++i )
+    {
+      if ( !qgsgeometry_cast<const QgsLineString *>( polygon.interiorRing( i ) ) )
+        return false;
+    }
+    return true;
+  }
+
+  void writeGMLPolygon( QString &gml, int indent, bool gml3, const QgsPolygonV2 &polygon, int precision, const QString &ns, const QString &srsName )
+  {
+    const QString exteriorName = gml3 ? QStringLiteral( "exterior" ) : QStringLiteral( "outerBoundaryIs" );
+    const QString interiorName = gml3 ? QStringLiteral( "interior" ) : QStringLiteral( "innerBoundaryIs" );
+
+    openGMLElement( gml, indent, QStringLiteral( "Polygon" ), ns, srsName );
+    openGMLElement( gml, indent + 1, exteriorName, ns );
+    writeGMLLineString( gml, indent + 2, gml3, *static_cast<const QgsLineString *>( polygon.exteriorRing() ), precision, QStringLiteral( "LinearRing" ), ns, QString() );
+    closeGMLElement( gml, indent + 1, exteriorName );
+    for ( int i = 0; i < polygon.numInteriorRings(); ++i )
+    {
+      openGMLElement( gml, indent + 1, interiorName, ns );
+      writeGMLLineString( gml, indent + 2, gml3, *static_cast<const QgsLineString *>( polygon.interiorRing( i ) ), precision, QStringLiteral( "LinearRing" ), ns, QString() );
+      closeGMLElement( gml, indent + 1, interiorName );
+    }
+    closeGMLElement( gml, indent, QStringLiteral( "Polygon" ) );
+  }
+
+  //! Returns true if the geometry is written as text, false if it has to be written by the DOM
+  bool isTextGMLGeometry( const QgsAbstractGeometry *geometry )
+  {
+    switch ( QgsWkbTypes::flatType( geometry->wkbType() ) )
+    {
+      case QgsWkbTypes::Point:
+      case QgsWkbTypes::LineString:
+        return true;
+      case QgsWkbTypes::Polygon:
+        return hasLineStringRings( *static_cast<const QgsPolygonV2 *>( geometry ) );
+      case QgsWkbTypes::MultiPoint:
+      case QgsWkbTypes::MultiLineString:
+      case QgsWkbTypes::MultiPolygon:
+      {
+        const QgsGeometryCollection *collection = static_cast<const QgsGeometryCollection *>( geometry );
+        for ( int i = 0; i < collection->numGeometries(); ++i )
+        {
+          if ( !isTextGMLGeometry( collection->geometryN( i ) ) )
+            return false;
+        }
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
+  void writeGMLGeometry( QString &gml, int indent, bool gml3, const QgsAbstractGeometry *geometry, int precision, const QString &ns, const QString &srsName );
+
+  void writeGMLCollection( QString &gml, int indent, bool gml3, const QgsGeometryCollection &collection, int precision, const QString &ns, const QString &srsName,
+                           const QString &name, const QString &memberName )
+  {
+    if ( collection.numGeometries() == 0 )
+    {
+      openGMLElement( gml, indent, name, ns, srsName, true );
+      return;
+    }
+
+    openGMLElement( gml, indent, name, ns, srsName );
+    for ( int i = 0; i < collection.numGeometries(); ++i )
+    {
+      openGMLElement( gml, indent + 1, memberName, ns );
+      writeGMLGeometry( gml, indent + 2, gml3, collection.geometryN( i ), precision, ns, QString() );
+      closeGMLElement( gml, indent + 1, memberName );
+    }
+    closeGMLElement( gml, indent, name );
+  }
+
+  //! Writes a geometry for which isTextGMLGeometry() is true
+  void writeGMLGeometry( QString &gml, int indent, bool gml3, const QgsAbstractGeometry *geometry, int precision, const QString &ns, const QString &srsName )
+  {
+    switch ( QgsWkbTypes::flatType( geometry->wkbType() ) )
+    {
+      case QgsWkbTypes::Point:
+      {
+        const QgsPoint *point = static_cast<const QgsPoint *>( geometry );
+        QString coordinates = qgsDoubleToString( point->x(), precision ) + ( gml3 ? ' ' : ',' ) + qgsDoubleToString( point->y(), precision );
+        if ( gml3 && point->is3D() )
+          coordinates += ' ' + qgsDoubleToString( point->z(), precision );
+
+        openGMLElement( gml, indent, QStringLiteral( "Point" ), ns, srsName );
+        writeGMLCoordinates( gml, indent + 1, gml3, QStringLiteral( "pos" ), ns, point->is3D(), coordinates );
+        closeGMLElement( gml, indent, QStringLiteral( "Point" ) );
+        break;
+      }
+      case QgsWkbTypes::LineString:
+        writeGMLLineString( gml, indent, gml3, *static_cast<const QgsLineString *>( geometry ), precision, QStringLiteral( "LineString" ), ns, srsName );
+        break;
+      case QgsWkbTypes::Polygon:
+        writeGMLPolygon( gml, indent, gml3, *static_cast<const QgsPolygonV2 *>( geometry ), precision, ns, srsName );
+        break;
+      case QgsWkbTypes::MultiPoint:
+        writeGMLCollection( gml, indent, gml3, *static_cast<const QgsGeometryCollection *>( geometry ), precision, ns, srsName,
+                            QStringLiteral( "MultiPoint" ), QStringLiteral( "pointMember" ) );
+        break;
+      case QgsWkbTypes::MultiLineString:
+        writeGMLCollection( gml, indent, gml3, *static_cast<const QgsGeometryCollection *>( geometry ), precision, ns, srsName,
+                            gml3 ? QStringLiteral( "MultiCurve" ) : QStringLiteral( "MultiLineString" ),
+                            gml3 ? QStringLiteral( "curveMember" ) : QStringLiteral( "lineStringMember" ) );
+        break;
+      case QgsWkbTypes::MultiPolygon:
+        writeGMLCollection( gml, indent, gml3, *static_cast<const QgsGeometryCollection *>( geometry ), precision, ns, srsName,
+                            QStringLiteral( "MultiPolygon" ), QStringLiteral( "polygonMember" ) );
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+QString QgsOgcUtils::geometryToGMLString( const QgsAbstractGeometry *geometry, QgsOgcUtils::GMLVersion gmlVersion, int precision, const QString &ns, const QString &srsName, int indent )
+{
+  if ( !geometry )
+    return QString();
+
+  const bool gml3 = gmlVersion != GML_2_1_2;
+  QString gml;
+  if ( isTextGMLGeometry( geometry ) )
+  {
+    writeGMLGeometry( gml, indent, gml3, geometry, precision, ns, srsName );
+    return gml;
+  }
+
+  // curves and other collections are written by the geometry itself
+  QDomDocument doc;
+  QDomElement geometryElem = gml3 ? geometry->asGML3( doc, precision, ns ) : geometry->asGML2( doc, precision, ns );
+  if ( geometryElem.isNull() )
+    return QString();
+
+  if ( !srsName.isEmpty() )
+    geometryElem.setAttribute( QStringLiteral( "srsName" ), srsName );
+  doc.appendChild( geometryElem );
+
+  const QString indentString( indent, ' ' );
+  Q_FOREACH ( const QString &line, doc.toString( 1 ).split( '\n', QString::SkipEmptyParts ) )
+  {
+    gml += indentString + line + '\n';
+  }
+  return gml;
+}
+
+QString QgsOgcUtils::rectangleToGMLBoxString( const QgsRectangle &box, int precision, const QString &srsName, int indent )
+{
+  const QString indentString( indent, ' ' );
+  QString gml = indentString + QLatin1String( "<gml:Box" );
+  if ( !srsName.isEmpty() )
+    appendGMLAttribute( gml, QStringLiteral( "srsName" ), srsName );
+  gml += QLatin1String( ">\n" );
+  gml += indentString + QLatin1String( " <gml:coordinates cs=\",\" ts=\" \">" )
+         + qgsDoubleToString( box.xMinimum(), precision ) + ',' + qgsDoubleToString( box.yMinimum(), precision ) + ' '
+         + qgsDoubleToString( box.xMaximum(), precision ) + ',' + qgsDoubleToString( box.yMaximum(), precision )
+         + QLatin1String( "</gml:coordinates>\n" );
+  gml += indentString + QLatin1String( "</gml:Box>\n" );
+  return gml;
+}
+
+QString QgsOgcUtils::rectangleToGMLEnvelopeString( const QgsRectangle &env, int precision, const QString &srsName, int indent )
+{
+  const QString indentString( indent, ' ' );
+  QString gml = indentString + QLatin1String( "<gml:Envelope" );
+  if ( !srsName.isEmpty() )
+    appendGMLAttribute( gml, QStringLiteral( "srsName" ), srsName );
+  gml += QLatin1String( ">\n" );
+  gml += indentString + QLatin1String( " <gml:lowerCorner>" )
+         + qgsDoubleToString( env.xMinimum(), precision ) + ' ' + qgsDoubleToString( env.yMinimum(), precision )
+         + QLatin1String( "</gml:lowerCorner>\n" );
+  gml += indentString + QLatin1String( " <gml:upperCorner>" )
+         + qgsDoubleToString( env.xMaximum(), precision ) + ' ' + qgsDoubleToString( env.yMaximum(), precision )
+         + QLatin1String( "</gml:upperCorner>\n" );
+  gml += indentString + QLatin1String( "</gml:Envelope>\n" );
+  return gml;
+}
+
 QDomElement QgsOgcUtils::geometryToGML( const QgsGeometry &geometry, QDomDocument &doc, const QString &format, int precision )
 {
   return geometryToGML( geometry, doc, ( format == QLatin1String( "GML2" ) ) ? GML_2_1_2 : GML_3_2_1, QString(), false, QString(), precision );
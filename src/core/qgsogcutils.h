@@ -27,6 +27,7 @@ class QString;
 #include <list>
 #include <QVector>
 
+class QgsAbstractGeometry;
 class QgsExpression;
 class QgsGeometry;
 class QgsPointXY;
@@ -125,6 +126,51 @@ class CORE_EXPORT QgsOgcUtils
         bool invertAxisOrientation,
         int precision = 17 );
 
+    /**
+     * Exports the geometry to GML2 or GML3 text, with the same elements as
+     * QgsAbstractGeometry::asGML2() or asGML3() written by QDomDocument::toString( 1 ):
+     * one element per line, the geometry element being indented by \a indent spaces.
+     * Points, line strings, polygons and their multi types are written without building
+     * a DOM document.
+     * \param geometry geometry to export
+     * \param gmlVersion GML version, GML3 elements are written for GML_3_1_0 and GML_3_2_1
+     * \param precision number of decimal places of the coordinates
+     * \param ns namespace of the elements
+     * \param srsName srsName attribute of the geometry element, not written if empty
+     * \param indent indentation of the geometry element
+     * \returns an empty string if the geometry cannot be exported
+     * \see geometryToGML()
+     * \since QGIS 3.0
+     */
+    static QString geometryToGMLString( const QgsAbstractGeometry *geometry,
+                                        QgsOgcUtils::GMLVersion gmlVersion,
+                                        int precision = 17,
+                                        const QString &ns = "gml",
+                                        const QString &srsName = QString(),
+                                        int indent = 0 );
+
+    /**
+     * Exports the rectangle to GML2 Box text, with the same elements as rectangleToGMLBox()
+     * written by QDomDocument::toString( 1 ), the Box element being indented by \a indent spaces.
+     * \see rectangleToGMLBox()
+     * \since QGIS 3.0
+     */
+    static QString rectangleToGMLBoxString( const QgsRectangle &box,
+                                            int precision = 17,
+                                            const QString &srsName = QString(),
+                                            int indent = 0 );
+
+    /**
+     * Exports the rectangle to GML3 Envelope text, with the same elements as rectangleToGMLEnvelope()
+     * written by QDomDocument::toString( 1 ), the Envelope element being indented by \a indent spaces.
+     * \see rectangleToGMLEnvelope()
+     * \since QGIS 3.0
+     */
+    static QString rectangleToGMLEnvelopeString( const QgsRectangle &env,
+        int precision = 17,
+        const QString &srsName = QString(),
+        int indent = 0 );
+
 
     //! Parse XML with OGC fill into QColor
     static QColor colorFromOgcFill( const QDomElement &fillElement );
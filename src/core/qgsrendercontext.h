@@ -67,6 +67,7 @@ class CORE_EXPORT QgsRenderContext
       RenderMapTile            = 0x40,  //!< Draw map such that there are no problems between adjacent tiles
       Antialiasing             = 0x80,  //!< Use antialiasing while drawing
       RenderPartialOutput      = 0x100, //!< Whether to make extra effort to update map image with partially rendered layers (better for interactive map canvas). Added in QGIS 3.0
+      RenderParallelTiles      = 0x200, //!< Whether layer renderers may split the map into tiles which are rendered on several threads. Added in QGIS 3.0
     };
     Q_DECLARE_FLAGS( Flags, Flag )
 
@@ -1833,9 +1833,7 @@ void QgsTextRenderer::drawBuffer( QgsRenderContext &context, const QgsTextRender
 
   double penSize = context.convertToPainterUnits( buffer.size(), buffer.sizeUnit(), buffer.sizeMapUnitScale() );
 
-  QPainterPath path;
-  path.setFillRule( Qt::WindingFill );
-  path.addText( 0, 0, format.scaledFont( context ), component.text );
+  QPainterPath path = QgsTextPathCache::instance()->path( format.scaledFont( context ), component.text );
   QColor bufferColor = buffer.color();
   bufferColor.setAlphaF( buffer.opacity() );
   QPen pen( bufferColor );
@@ -2572,28 +2570,31 @@ void QgsTextRenderer::drawTextInternal( TextPart drawType,
     }
     else
     {
-      // draw text, QPainterPath method
-      QPainterPath path;
-      path.setFillRule( Qt::WindingFill );
-      path.addText( 0, 0, format.scaledFont( context ), subComponent.text );
+      bool drawTextShadow = format.shadow().enabled() && format.shadow().shadowPlacement() == QgsTextShadowSettings::ShadowText;
 
-      // store text's drawing in QPicture for drop shadow call
+      // store text's drawing in QPicture for drop shadow call. Not needed when drawing text as text without shadow.
       QPicture textPict;
-      QPainter textp;
-      textp.begin( &textPict );
-      textp.setPen( Qt::NoPen );
-      QColor textColor = format.color();
-      textColor.setAlphaF( format.opacity() );
-      textp.setBrush( textColor );
-      textp.drawPath( path );
-      // TODO: why are some font settings lost on drawPicture() when using drawText() inside QPicture?
-      //       e.g. some capitalization options, but not others
-      //textp.setFont( tmpLyr.textFont );
-      //textp.setPen( tmpLyr.textColor );
-      //textp.drawText( 0, 0, component.text() );
-      textp.end();
-
-      if ( format.shadow().enabled() && format.shadow().shadowPlacement() == QgsTextShadowSettings::ShadowText )
+      if ( drawAsOutlines || drawTextShadow )
+      {
+        // draw text, QPainterPath method
+        QPainterPath path = QgsTextPathCache::instance()->path( format.scaledFont( context ), subComponent.text );
+
+        QPainter textp;
+        textp.begin( &textPict );
+        textp.setPen( Qt::NoPen );
+        QColor textColor = format.color();
+        textColor.setAlphaF( format.opacity() );
+        textp.setBrush( textColor );
+        textp.drawPath( path );
+        // TODO: why are some font settings lost on drawPicture() when using drawText() inside QPicture?
+        //       e.g. some capitalization options, but not others
+        //textp.setFont( tmpLyr.textFont );
+        //textp.setPen( tmpLyr.textColor );
+        //textp.drawText( 0, 0, component.text() );
+        textp.end();
+      }
+
+      if ( drawTextShadow )
       {
         subComponent.picture = textPict;
         subComponent.pictureBuffer = 0.0; // no pen width to deal with
@@ -2633,3 +2634,81 @@ void QgsTextRenderer::drawTextInternal( TextPart drawType,
   }
 }
 
+///@cond PRIVATE
+
+QgsTextPathCache *QgsTextPathCache::instance()
+{
+  static QgsTextPathCache sInstance;
+  return &sInstance;
+}
+
+QgsTextPathCache::QgsTextPathCache()
+  : mCache( MAX_COST )
+{
+}
+
+QPainterPath QgsTextPathCache::path( const QFont &font, const QString &text )
+{
+  const QString pathKey = key( font, text );
+
+  // paths are copied element by element rather than shared: QPainterPath lazily caches
+  // data derived from its elements, so copies sharing data are not safe to use from several threads
+  QPainterPath path;
+  path.setFillRule( Qt::WindingFill );
+  {
+    QMutexLocker locker( &mMutex );
+    if ( const QPainterPath *cachedPath = mCache.object( pathKey ) )
+    {
+      mHits++;
+      path.addPath( *cachedPath );
+      return path;
+    }
+    mMisses++;
+  }
+
+  // lay out the text without blocking the other threads
+  path.addText( 0, 0, font, text );
+
+  QPainterPath *cachedPath = new QPainterPath();
+  cachedPath->addPath( path );
+
+  QMutexLocker locker( &mMutex );
+  mCache.insert( pathKey, cachedPath, std::max( path.elementCount(), 1 ) );
+  return path;
+}
+
+void QgsTextPathCache::clear()
+{
+  QMutexLocker locker( &mMutex );
+  mCache.clear();
+  mHits = 0;
+  mMisses = 0;
+}
+
+int QgsTextPathCache::hits() const
+{
+  QMutexLocker locker( &mMutex );
+  return mHits;
+}
+
+int QgsTextPathCache::misses() const
+{
+  QMutexLocker locker( &mMutex );
+  return mMisses;
+}
+
+QString QgsTextPathCache::key( const QFont &font, const QString &text )
+{
+  // QFont::key() misses some of the properties which change the outline
+  return font.key() + '|' + font.styleName()
+         + '|' + QString::number( font.letterSpacing(), 'g', 17 )
+         + '|' + QString::number( static_cast< int >( font.letterSpacingType() ) )
+         + '|' + QString::number( font.wordSpacing(), 'g', 17 )
+         + '|' + QString::number( static_cast< int >( font.capitalization() ) )
+         + '|' + QString::number( font.stretch() )
+         + '|' + QString::number( font.kerning() )
+         + '|' + QString::number( static_cast< int >( font.hintingPreference() ) )
+         + '\n' + text;
+}
+
+///@endcond
@@ -27,6 +27,9 @@
 #include "qgspainteffect.h"
 #include <QSharedData>
 #include <QPainter>
+#include <QPainterPath>
+#include <QCache>
+#include <QMutex>
 
 /// @cond
 
@@ -284,6 +287,47 @@ class CORE_EXPORT QgsTextSettingsPrivate : public QSharedData
 
 
 
+
+/**
+ * Least recently used cache of text outlines, shared by all rendering threads. Buffers,
+ * shadows and text drawn as outlines of the same string and font reuse the same path
+ * instead of laying out the text again.
+ */
+class CORE_EXPORT QgsTextPathCache
+{
+  public:
+
+    //! Maximum total number of path elements in the cache
+    static const int MAX_COST = 1000000;
+
+    //! Returns the cache instance
+    static QgsTextPathCache *instance();
+
+    QgsTextPathCache();
+
+    //! Returns the outline of \a text drawn with \a font, with the baseline start at the origin
+    QPainterPath path( const QFont &font, const QString &text );
+
+    //! Removes all paths from the cache and resets the hits() and misses() counters
+    void clear();
+
+    //! Returns the number of lookups which found a cached path since the last clear()
+    int hits() const;
+
+    //! Returns the number of lookups which had to build the path since the last clear()
+    int misses() const;
+
+  private:
+
+    mutable QMutex mMutex;
+    QCache< QString, QPainterPath > mCache;
+    int mHits = 0;
+    int mMisses = 0;
+
+    //! Returns the key of the path of \a text drawn with \a font
+    static QString key( const QFont &font, const QString &text );
+};
+
 /// @endcond
 
 #endif // QGSTEXTRENDERER_PRIVATE_H
@@ -24,6 +24,7 @@
 #include "qgsrendercontext.h"
 #include "qgssinglesymbolrenderer.h"
 #include "qgssymbollayer.h"
+#include "qgssymbollayerutils.h"
 #include "qgssymbol.h"
 #include "qgsvectorlayer.h"
 #include "qgsvectorlayerdiagramprovider.h"
@@ -37,6 +38,53 @@
 #include "qgssettings.h"
 
 #include <QPicture>
+#include <QThread>
+#include <QtConcurrentMap>
+
+///@cond PRIVATE
+
+//! Horizontal part of the output image, rendered by QgsVectorLayerRenderer::drawRendererTiles()
+struct QgsVectorLayerRendererTile
+{
+  //! Pixels of the output image covered by the tile
+  QRect rect;
+  //! Extent of features to draw, in layer coordinates
+  QgsRectangle extent;
+  std::unique_ptr< QgsFeatureRenderer > renderer;
+  QImage image;
+  //! Rendered features which need to be registered for labeling, in rendering order
+  QList< QgsFeature > labelFeatures;
+};
+
+//! Returns how far in pixels \a symbol may extend beyond the geometry of a feature
+static double symbolMargin( QgsSymbol *symbol, const QgsRenderContext &context )
+{
+  double margin = QgsSymbolLayerUtils::estimateMaxSymbolBleed( symbol, context );
+  for ( int i = 0; i < symbol->symbolLayerCount(); ++i )
+  {
+    QgsSymbolLayer *layer = symbol->symbolLayer( i );
+    double layerMargin = 0;
+    if ( const QgsMarkerSymbolLayer *marker = dynamic_cast< const QgsMarkerSymbolLayer * >( layer ) )
+    {
+      const double offset = std::max( std::fabs( marker->offset().x() ), std::fabs( marker->offset().y() ) );
+      layerMargin = context.convertToPainterUnits( marker->size(), marker->sizeUnit(), marker->sizeMapUnitScale() )
+                    + context.convertToPainterUnits( offset, marker->offsetUnit(), marker->offsetMapUnitScale() );
+    }
+    else if ( const QgsLineSymbolLayer *line = dynamic_cast< const QgsLineSymbolLayer * >( layer ) )
+    {
+      layerMargin = context.convertToPainterUnits( line->width(), line->widthUnit(), line->widthMapUnitScale() )
+                    + context.convertToPainterUnits( std::fabs( line->offset() ), line->offsetUnit(), line->offsetMapUnitScale() );
+    }
+    if ( QgsSymbol *subSymbol = layer->subSymbol() )
+    {
+      layerMargin += symbolMargin( subSymbol, context );
+    }
+    margin = std::max( margin, layerMargin );
+  }
+  return margin;
+}
+
+///@endcond
 
 
 QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer *layer, QgsRenderContext &context )
@@ -100,6 +148,17 @@ QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer *layer, QgsRender
   //register label and diagram layer to the labeling engine
   prepareLabeling( layer, mAttrNames );
   prepareDiagrams( layer, mAttrNames );
+
+  if ( mContext.testFlag( QgsRenderContext::RenderParallelTiles ) && supportsTiles() )
+  {
+    // feature sources take a copy of the layer state, so they need to be created in the main thread,
+    // only when the layer will really be split into tiles
+    const int count = maximumTileCount();
+    for ( int i = 0; count > 1 && i < count; ++i )
+    {
+      mTileSources.emplace_back( new QgsVectorLayerFeatureSource( layer ) );
+    }
+  }
 }
 
 
@@ -140,7 +199,7 @@ bool QgsVectorLayerRenderer::render()
 
   QString rendererFilter = mRenderer->filter( mFields );
 
-  QgsRectangle requestExtent = mContext.extent();
+  QgsRectangle requestExtent = mPartialRenderingExtent.isNull() ? mContext.extent() : mPartialRenderingExtent;
   mRenderer->modifyRequestExtent( requestExtent, mContext );
 
   QgsFeatureRequest featureRequest = QgsFeatureRequest()
@@ -237,17 +296,20 @@ bool QgsVectorLayerRenderer::render()
     mContext.setVectorSimplifyMethod( vectorMethod );
   }
 
-  QgsFeatureIterator fit = mSource->getFeatures( featureRequest );
-  // Attach an interruption checker so that iterators that have potentially
-  // slow fetchFeature() implementations, such as in the WFS provider, can
-  // check it, instead of relying on just the mContext.renderingStopped() check
-  // in drawRenderer()
-  fit.setInterruptionChecker( &mInterruptionChecker );
-
-  if ( ( mRenderer->capabilities() & QgsFeatureRenderer::SymbolLevels ) && mRenderer->usingSymbolLevels() )
-    drawRendererLevels( fit );
-  else
-    drawRenderer( fit );
+  if ( mTileSources.empty() || !drawRendererTiles( featureRequest ) )
+  {
+    QgsFeatureIterator fit = mSource->getFeatures( featureRequest );
+    // Attach an interruption checker so that iterators that have potentially
+    // slow fetchFeature() implementations, such as in the WFS provider, can
+    // check it, instead of relying on just the mContext.renderingStopped() check
+    // in drawRenderer()
+    fit.setInterruptionChecker( &mInterruptionChecker );
+
+    if ( ( mRenderer->capabilities() & QgsFeatureRenderer::SymbolLevels ) && mRenderer->usingSymbolLevels() )
+      drawRendererLevels( fit );
+    else
+      drawRenderer( fit );
+  }
 
   if ( usingEffect )
   {
@@ -291,27 +353,7 @@ void QgsVectorLayerRenderer::drawRenderer( QgsFeatureIterator &fit )
         // new labeling engine
         if ( mContext.labelingEngine() && ( mLabelProvider || mDiagramProvider ) )
         {
-          QgsGeometry obstacleGeometry;
-          QgsSymbolList symbols = mRenderer->originalSymbolsForFeature( fet, mContext );
-
-          if ( !symbols.isEmpty() && fet.geometry().type() == QgsWkbTypes::PointGeometry )
-          {
-            obstacleGeometry = QgsVectorLayerLabelProvider::getPointObstacleGeometry( fet, mContext, symbols );
-          }
-
-          if ( !symbols.isEmpty() )
-          {
-            QgsExpressionContextUtils::updateSymbolScope( symbols.at( 0 ), symbolScope );
-          }
-
-          if ( mLabelProvider )
-          {
-            mLabelProvider->registerFeature( fet, mContext, obstacleGeometry );
-          }
-          if ( mDiagramProvider )
-          {
-            mDiagramProvider->registerFeature( fet, mContext, obstacleGeometry );
-          }
+          registerLabelFeature( fet, symbolScope );
         }
       }
     }
@@ -466,6 +508,260 @@ void QgsVectorLayerRenderer::drawRendererLevels( QgsFeatureIterator &fit )
 }
 
 
+void QgsVectorLayerRenderer::registerLabelFeature( QgsFeature &fet, QgsExpressionContextScope *symbolScope )
+{
+  QgsGeometry obstacleGeometry;
+  QgsSymbolList symbols = mRenderer->originalSymbolsForFeature( fet, mContext );
+
+  if ( !symbols.isEmpty() && fet.geometry().type() == QgsWkbTypes::PointGeometry )
+  {
+    obstacleGeometry = QgsVectorLayerLabelProvider::getPointObstacleGeometry( fet, mContext, symbols );
+  }
+
+  if ( !symbols.isEmpty() )
+  {
+    QgsExpressionContextUtils::updateSymbolScope( symbols.at( 0 ), symbolScope );
+  }
+
+  if ( mLabelProvider )
+  {
+    mLabelProvider->registerFeature( fet, mContext, obstacleGeometry );
+  }
+  if ( mDiagramProvider )
+  {
+    mDiagramProvider->registerFeature( fet, mContext, obstacleGeometry );
+  }
+}
+
+bool QgsVectorLayerRenderer::supportsTiles()
+{
+  if ( !mRenderer )
+    return false;
+
+  // other renderers need to see all features at once, e.g. to cluster points or to build a heatmap
+  if ( mRenderer->type() != QLatin1String( "singleSymbol" )
+       && mRenderer->type() != QLatin1String( "categorizedSymbol" )
+       && mRenderer->type() != QLatin1String( "graduatedSymbol" )
+       && mRenderer->type() != QLatin1String( "RuleRenderer" ) )
+    return false;
+
+  // symbol levels and feature ordering need a global order of all features
+  if ( ( mRenderer->capabilities() & QgsFeatureRenderer::SymbolLevels ) && mRenderer->usingSymbolLevels() )
+    return false;
+  if ( mRenderer->orderByEnabled() )
+    return false;
+
+  // effects and feature blending work on the whole layer image
+  if ( mRenderer->paintEffect() && mRenderer->paintEffect()->enabled() )
+    return false;
+  if ( mContext.useAdvancedEffects() && mFeatureBlendMode != QPainter::CompositionMode_SourceOver )
+    return false;
+
+  // the extent of data defined symbols is unknown, so the overlap of tiles can not be calculated
+  Q_FOREACH ( QgsSymbol *symbol, mRenderer->symbols( mContext ) )
+  {
+    if ( symbol->hasDataDefinedProperties() )
+      return false;
+  }
+  return true;
+}
+
+double QgsVectorLayerRenderer::tileMargin()
+{
+  double margin = 0;
+  Q_FOREACH ( QgsSymbol *symbol, mRenderer->symbols( mContext ) )
+  {
+    margin = std::max( margin, symbolMargin( symbol, mContext ) );
+  }
+  if ( mDrawVertexMarkers )
+  {
+    // vertex marker size is in pixels
+    margin = std::max( margin, static_cast< double >( mVertexMarkerSize ) );
+  }
+  // antialiasing may touch one more pixel
+  return margin + 1;
+}
+
+double QgsVectorLayerRenderer::partialRenderingMargin()
+{
+  // parts of the layer are rendered separately like tiles
+  return supportsTiles() ? tileMargin() : -1;
+}
+
+void QgsVectorLayerRenderer::setPartialRenderingExtent( const QgsRectangle &extent )
+{
+  mPartialRenderingExtent = extent;
+}
+
+int QgsVectorLayerRenderer::maximumTileCount() const
+{
+  QPainter *painter = mContext.painter();
+  if ( !painter || !painter->device() || painter->device()->devType() != QInternal::Image
+       || !painter->transform().isIdentity() || painter->hasClipping() )
+    return 0;
+
+  // tiles with less rows are not worth the overhead
+  const int minimumTileHeight = 64;
+  const QImage *destination = static_cast< QImage * >( painter->device() );
+  return std::min( QThread::idealThreadCount(), destination->height() / minimumTileHeight );
+}
+
+bool QgsVectorLayerRenderer::drawRendererTiles( const QgsFeatureRequest &featureRequest )
+{
+  const int tileCount = std::min( static_cast< int >( mTileSources.size() ), maximumTileCount() );
+  if ( tileCount < 2 )
+    return false;
+
+  QPainter *painter = mContext.painter();
+  const QImage *destination = static_cast< QImage * >( painter->device() );
+
+  const QgsMapToPixel &mtp = mContext.mapToPixel();
+  const QgsCoordinateTransform ct = mContext.coordinateTransform();
+  const QgsRectangle requestExtent = featureRequest.filterRect();
+  const double margin = tileMargin();
+
+  std::vector< QgsVectorLayerRendererTile > tiles( tileCount );
+  QVector< int > tileIndexes;
+  for ( int i = 0; i < tileCount; ++i )
+  {
+    QgsVectorLayerRendererTile &tile = tiles[ i ];
+    const int top = destination->height() * i / tileCount;
+    const int bottom = destination->height() * ( i + 1 ) / tileCount;
+    tile.rect = QRect( 0, top, destination->width(), bottom - top );
+
+    // features whose symbols reach into the tile are drawn too, they are clipped by the tile image
+    const QgsPointXY corners[] =
+    {
+      mtp.toMapCoordinatesF( -margin, top - margin ),
+      mtp.toMapCoordinatesF( destination->width() + margin, top - margin ),
+      mtp.toMapCoordinatesF( -margin, bottom + margin ),
+      mtp.toMapCoordinatesF( destination->width() + margin, bottom + margin )
+    };
+    QgsRectangle tileExtent;
+    tileExtent.setMinimal();
+    for ( const QgsPointXY &corner : corners )
+    {
+      tileExtent.combineExtentWith( corner.x(), corner.y() );
+    }
+    if ( ct.isValid() )
+    {
+      try
+      {
+        tileExtent = ct.transformBoundingBox( tileExtent, QgsCoordinateTransform::ReverseTransform );
+      }
+      catch ( QgsCsException &cse )
+      {
+        Q_UNUSED( cse );
+        tileExtent = requestExtent;
+      }
+    }
+    if ( !tileExtent.isFinite() )
+    {
+      tileExtent = requestExtent;
+    }
+    tile.extent = requestExtent.isNull() ? tileExtent : tileExtent.intersect( &requestExtent );
+    if ( tile.extent.isEmpty() )
+      continue;
+
+    // renderers keep state while rendering, each tile needs its own
+    tile.renderer.reset( mRenderer->clone() );
+    if ( mDrawVertexMarkers )
+      tile.renderer->setVertexMarkerAppearance( mVertexMarkerStyle, mVertexMarkerSize );
+    tileIndexes << i;
+  }
+
+  const bool registerLabels = mContext.labelingEngine() && ( mLabelProvider || mDiagramProvider );
+
+  auto renderTile = [&]( const int &index )
+  {
+    QgsVectorLayerRendererTile &tile = tiles[ index ];
+    tile.image = QImage( tile.rect.size(), QImage::Format_ARGB32_Premultiplied );
+    tile.image.setDotsPerMeterX( destination->dotsPerMeterX() );
+    tile.image.setDotsPerMeterY( destination->dotsPerMeterY() );
+    tile.image.fill( Qt::transparent );
+
+    QPainter tilePainter( &tile.image );
+    tilePainter.setRenderHints( painter->renderHints() );
+    tilePainter.translate( 0, -tile.rect.top() );
+
+    // the context keeps the map extent: symbols clip geometries to it, and clipping them to the tile
+    // would change where lines and rings start (dash patterns, marker intervals, centroids...)
+    QgsRenderContext context( mContext );
+    context.setPainter( &tilePainter );
+    context.setLabelingEngine( nullptr );
+
+    QgsFeatureRenderer *renderer = tile.renderer.get();
+    renderer->startRender( context, mFields );
+
+    QgsFeatureRequest request( featureRequest );
+    request.setFilterRect( tile.extent );
+    QgsFeatureIterator fit = mTileSources[ index ]->getFeatures( request );
+    fit.setInterruptionChecker( &mInterruptionChecker );
+
+    QgsFeature fet;
+    while ( fit.nextFeature( fet ) )
+    {
+      if ( mContext.renderingStopped() )
+        break;
+
+      if ( !fet.hasGeometry() )
+        continue; // skip features without geometry
+
+      context.expressionContext().setFeature( fet );
+
+      bool sel = context.showSelection() && mSelectedFeatureIds.contains( fet.id() );
+      bool drawMarker = ( mDrawVertexMarkers && context.drawEditingInformation() && ( !mVertexMarkerOnlyForSelection || sel ) );
+
+      try
+      {
+        if ( renderer->renderFeature( fet, context, -1, sel, drawMarker ) && registerLabels )
+          tile.labelFeatures << fet;
+      }
+      catch ( const QgsCsException &cse )
+      {
+        Q_UNUSED( cse );
+        QgsDebugMsg( QString( "Failed to transform a point while drawing a feature with ID '%1'. Ignoring this feature. %2" )
+                     .arg( fet.id() ).arg( cse.what() ) );
+      }
+    }
+
+    renderer->stopRender( context );
+  };
+
+  QtConcurrent::blockingMap( tileIndexes, renderTile );
+
+  Q_FOREACH ( int index, tileIndexes )
+  {
+    painter->drawImage( tiles[ index ].rect.topLeft(), tiles[ index ].image );
+  }
+
+  // features overlapping several tiles are registered once, in the order of the first tile which drew them
+  if ( registerLabels && !mContext.renderingStopped() )
+  {
+    QgsExpressionContextScope *symbolScope = QgsExpressionContextUtils::updateSymbolScope( nullptr, new QgsExpressionContextScope() );
+    mContext.expressionContext().appendScope( symbolScope );
+
+    QSet< QgsFeatureId > registeredIds;
+    Q_FOREACH ( int index, tileIndexes )
+    {
+      for ( QgsFeature &fet : tiles[ index ].labelFeatures )
+      {
+        if ( registeredIds.contains( fet.id() ) )
+          continue;
+        registeredIds.insert( fet.id() );
+
+        mContext.expressionContext().setFeature( fet );
+        registerLabelFeature( fet, symbolScope );
+      }
+    }
+
+    delete mContext.expressionContext().popScope();
+  }
+
+  stopRenderer( nullptr );
+  return true;
+}
+
 void QgsVectorLayerRenderer::stopRenderer( QgsSingleSymbolRenderer *selRenderer )
 {
   mRenderer->stopRender( mContext );
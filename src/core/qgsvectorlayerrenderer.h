@@ -24,6 +24,7 @@ class QgsVectorLayerFeatureSource;
 class QgsDiagramRenderer;
 class QgsDiagramLayerSettings;
 
+class QgsExpressionContextScope;
 class QgsFeatureIterator;
 class QgsSingleSymbolRenderer;
 
@@ -32,6 +33,9 @@ class QgsSingleSymbolRenderer;
 #include <QList>
 #include <QPainter>
 
+#include <memory>
+#include <vector>
+
 typedef QList<int> QgsAttributeList;
 
 #include "qgis.h"
@@ -73,6 +77,23 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
 
     virtual bool render() override;
 
+    /**
+     * Returns how far in pixels features may be drawn beyond their bounding box, for rendering
+     * only a part of the layer. Returns a negative value if features can not be rendered separately
+     * from each other (e.g. when the renderer clusters points or uses symbol levels).
+     * \since QGIS 3.0
+     */
+    double partialRenderingMargin();
+
+    /**
+     * Sets the \a extent (in layer coordinates) of the features rendered when only a part of the layer
+     * image is updated. The extent of the render context is left as is, so that symbols are clipped
+     * like in a full render. A null rectangle renders the features of the whole context extent.
+     * \see partialRenderingMargin()
+     * \since QGIS 3.0
+     */
+    void setPartialRenderingExtent( const QgsRectangle &extent );
+
   private:
 
     /** Registers label and diagram layer
@@ -90,6 +111,32 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
      */
     void drawRendererLevels( QgsFeatureIterator &fit );
 
+    /**
+     * Returns true if the layer can be split into tiles which are rendered independently, i.e. if the
+     * renderer does not need to see all features at once (symbol levels, feature ordering, point clustering...).
+     */
+    bool supportsTiles();
+
+    /**
+     * Draw layer split into horizontal tiles of the output image, rendered in parallel with features
+     * fetched by \a featureRequest. Each tile uses its own feature source, renderer and image, tiles are
+     * composited in order. QgsFeatureRenderer::startRender() needs to be called before using this method.
+     * \returns false if tiles can not be used for the current painter, nothing is drawn in that case
+     */
+    bool drawRendererTiles( const QgsFeatureRequest &featureRequest );
+
+    /**
+     * Returns the number of tiles the layer would be split into for the current painter, which must
+     * paint into an image without transformation or clipping. Less than 2 means no tiles.
+     */
+    int maximumTileCount() const;
+
+    //! Returns how far in pixels symbols of the renderer may extend beyond the geometry of a feature
+    double tileMargin();
+
+    //! Registers a rendered feature with the label and diagram providers
+    void registerLabelFeature( QgsFeature &fet, QgsExpressionContextScope *symbolScope );
+
     //! Stop version 2 renderer and selected renderer (if required)
     void stopRenderer( QgsSingleSymbolRenderer *selRenderer );
 
@@ -109,6 +156,12 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
 
     QgsVectorLayerFeatureSource *mSource = nullptr;
 
+    //! Feature sources for tiles rendered in parallel, empty if the layer is not split into tiles
+    std::vector< std::unique_ptr< QgsVectorLayerFeatureSource > > mTileSources;
+
+    //! Extent of the features rendered for a partial update, null to render the whole context extent
+    QgsRectangle mPartialRenderingExtent;
+
     QgsFeatureRenderer *mRenderer = nullptr;
 
     bool mDrawVertexMarkers;
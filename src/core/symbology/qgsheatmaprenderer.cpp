@@ -30,6 +30,8 @@
 
 #include <QDomDocument>
 #include <QDomElement>
+#include <QThread>
+#include <QtConcurrentMap>
 
 QgsHeatmapRenderer::QgsHeatmapRenderer()
   : QgsFeatureRenderer( QStringLiteral( "heatmapRenderer" ) )
@@ -55,12 +57,37 @@ QgsHeatmapRenderer::~QgsHeatmapRenderer()
 
 void QgsHeatmapRenderer::initializeValues( QgsRenderContext &context )
 {
-  mValues.resize( context.painter()->device()->width() * context.painter()->device()->height() / ( mRenderQuality * mRenderQuality ) );
+  mWidth = context.painter()->device()->width() / mRenderQuality;
+  mHeight = context.painter()->device()->height() / mRenderQuality;
+  mValues.resize( mWidth * mHeight );
   mValues.fill( 0 );
   mCalculatedMaxValue = 0;
   mFeaturesRendered = 0;
+  mPendingPoints.clear();
   mRadiusPixels = std::round( context.convertToPainterUnits( mRadius, mRadiusUnit, mRadiusMapUnitScale ) / mRenderQuality );
   mRadiusSquared = mRadiusPixels * mRadiusPixels;
+
+  //the kernel only depends on the offset from the point, so compute it once for all points
+  const int kernelSize = 2 * mRadiusPixels;
+  mKernel.fill( 0, kernelSize * kernelSize );
+  mKernelRowStart.fill( 0, kernelSize );
+  mKernelRowEnd.fill( 0, kernelSize );
+  for ( int row = 0; row < kernelSize; ++row )
+  {
+    mKernelRowStart[ row ] = kernelSize;
+    for ( int column = 0; column < kernelSize; ++column )
+    {
+      double distanceSquared = std::pow( mRadiusPixels - column, 2.0 ) + std::pow( mRadiusPixels - row, 2.0 );
+      if ( distanceSquared > mRadiusSquared )
+      {
+        continue;
+      }
+
+      mKernel[ row * kernelSize + column ] = quarticKernel( std::sqrt( distanceSquared ), mRadiusPixels );
+      mKernelRowStart[ row ] = std::min( mKernelRowStart[ row ], column );
+      mKernelRowEnd[ row ] = column + 1;
+    }
+  }
 }
 
 void QgsHeatmapRenderer::startRender( QgsRenderContext &context, const QgsFields &fields )
@@ -136,9 +163,6 @@ bool QgsHeatmapRenderer::renderFeature( QgsFeature &feature, QgsRenderContext &c
     }
   }
 
-  int width = context.painter()->device()->width() / mRenderQuality;
-  int height = context.painter()->device()->height() / mRenderQuality;
-
   //transform geometry if required
   QgsGeometry geom = feature.geometry();
   QgsCoordinateTransform xform = context.coordinateTransform();
@@ -156,30 +180,23 @@ bool QgsHeatmapRenderer::renderFeature( QgsFeature &feature, QgsRenderContext &c
     QgsPointXY pixel = context.mapToPixel().transform( *pointIt );
     int pointX = pixel.x() / mRenderQuality;
     int pointY = pixel.y() / mRenderQuality;
-    for ( int x = std::max( pointX - mRadiusPixels, 0 ); x < std::min( pointX + mRadiusPixels, width ); ++x )
+    if ( pointX + mRadiusPixels <= 0 || pointY + mRadiusPixels <= 0 || pointX - mRadiusPixels >= mWidth || pointY - mRadiusPixels >= mHeight )
     {
-      for ( int y = std::max( pointY - mRadiusPixels, 0 ); y < std::min( pointY + mRadiusPixels, height ); ++y )
-      {
-        int index = y * width + x;
-        if ( index >= mValues.count() )
-        {
-          continue;
-        }
-        double distanceSquared = std::pow( pointX - x, 2.0 ) + std::pow( pointY - y, 2.0 );
-        if ( distanceSquared > mRadiusSquared )
-        {
-          continue;
-        }
-
-        double score = weight * quarticKernel( std::sqrt( distanceSquared ), mRadiusPixels );
-        double value = mValues.at( index ) + score;
-        if ( value > mCalculatedMaxValue )
-        {
-          mCalculatedMaxValue = value;
-        }
-        mValues[ index ] = value;
-      }
+      //kernel is outside of the heatmap
+      continue;
     }
+
+    //points are added to the heatmap in batches, see addPendingPoints()
+    PendingPoint point;
+    point.x = pointX;
+    point.y = pointY;
+    point.weight = weight;
+    mPendingPoints.push_back( point );
+  }
+
+  if ( static_cast< int >( mPendingPoints.size() ) >= MAX_PENDING_POINTS )
+  {
+    addPendingPoints();
   }
 
   mFeaturesRendered++;
@@ -194,6 +211,93 @@ bool QgsHeatmapRenderer::renderFeature( QgsFeature &feature, QgsRenderContext &c
 }
 
 
+void QgsHeatmapRenderer::addPendingPoints()
+{
+  if ( mPendingPoints.empty() || mKernel.isEmpty() )
+  {
+    mPendingPoints.clear();
+    return;
+  }
+
+  //split the heatmap into bands of rows, at least as high as the kernel so that each point reaches
+  //into two bands at most. Each band adds the points in the order they were rendered, so the
+  //values do not depend on the number of bands.
+  const int kernelSize = 2 * mRadiusPixels;
+  int bandCount = 1;
+  if ( mPendingPoints.size() > 1000 )
+  {
+    bandCount = std::max( 1, std::min( QThread::idealThreadCount() * 4, mHeight / kernelSize ) );
+  }
+  const int bandHeight = ( mHeight + bandCount - 1 ) / bandCount;
+
+  QVector< Band > bands( bandCount );
+  for ( int i = 0; i < bandCount; ++i )
+  {
+    bands[ i ].firstRow = i * bandHeight;
+    bands[ i ].endRow = std::min( ( i + 1 ) * bandHeight, mHeight );
+    bands[ i ].maxValue = mCalculatedMaxValue;
+  }
+
+  for ( int i = 0; i < static_cast< int >( mPendingPoints.size() ); ++i )
+  {
+    const PendingPoint &point = mPendingPoints[ i ];
+    const int firstBand = std::max( point.y - mRadiusPixels, 0 ) / bandHeight;
+    const int lastBand = std::min( point.y + mRadiusPixels - 1, mHeight - 1 ) / bandHeight;
+    for ( int band = firstBand; band <= lastBand; ++band )
+    {
+      bands[ band ].points.push_back( i );
+    }
+  }
+
+  if ( bandCount == 1 )
+  {
+    addPointsToBand( bands[ 0 ] );
+  }
+  else
+  {
+    QtConcurrent::blockingMap( bands, [this]( Band & band ) { addPointsToBand( band ); } );
+  }
+
+  Q_FOREACH ( const Band &band, bands )
+  {
+    mCalculatedMaxValue = std::max( mCalculatedMaxValue, band.maxValue );
+  }
+  mPendingPoints.clear();
+}
+
+void QgsHeatmapRenderer::addPointsToBand( Band &band )
+{
+  const int kernelSize = 2 * mRadiusPixels;
+  double *values = mValues.data();
+  const double *kernel = mKernel.constData();
+
+  for ( int pointIndex : band.points )
+  {
+    const PendingPoint &point = mPendingPoints[ pointIndex ];
+    const int firstRow = std::max( point.y - mRadiusPixels, band.firstRow );
+    const int endRow = std::min( point.y + mRadiusPixels, band.endRow );
+    for ( int y = firstRow; y < endRow; ++y )
+    {
+      const int kernelRow = y - point.y + mRadiusPixels;
+      const int kernelOffset = point.x - mRadiusPixels;
+      const int firstColumn = std::max( kernelOffset + mKernelRowStart.at( kernelRow ), 0 );
+      const int endColumn = std::min( kernelOffset + mKernelRowEnd.at( kernelRow ), mWidth );
+
+      double *valueRow = values + y * mWidth;
+      const double *kernelRowValues = kernel + kernelRow * kernelSize;
+      for ( int x = firstColumn; x < endColumn; ++x )
+      {
+        double value = valueRow[ x ] + point.weight * kernelRowValues[ x - kernelOffset ];
+        if ( value > band.maxValue )
+        {
+          band.maxValue = value;
+        }
+        valueRow[ x ] = value;
+      }
+    }
+  }
+}
+
 double QgsHeatmapRenderer::uniformKernel( const double distance, const int bandwidth ) const
 {
   Q_UNUSED( distance );
@@ -223,6 +327,7 @@ double QgsHeatmapRenderer::triangularKernel( const double distance, const int ba
 
 void QgsHeatmapRenderer::stopRender( QgsRenderContext &context )
 {
+  addPendingPoints();
   renderImage( context );
   mWeightExpression.reset();
 }
@@ -22,6 +22,8 @@
 #include "qgsexpression.h"
 #include "qgsgeometry.h"
 
+#include <vector>
+
 class QgsColorRamp;
 
 /** \ingroup core
@@ -165,7 +167,42 @@ class CORE_EXPORT QgsHeatmapRenderer : public QgsFeatureRenderer
 
   private:
 
+    //! A rendered point waiting to be added to mValues, in pixels of the heatmap
+    struct PendingPoint
+    {
+      int x;
+      int y;
+      double weight;
+    };
+
+    //! Horizontal band of the heatmap, filled by a single thread
+    struct Band
+    {
+      int firstRow;
+      int endRow;
+      //! Indexes of the pending points whose kernel reaches into the band
+      std::vector<int> points;
+      double maxValue;
+    };
+
+    //! Maximum number of rendered points waiting to be added to mValues
+    static const int MAX_PENDING_POINTS = 500000;
+
     QVector<double> mValues;
+    //! Size of the heatmap in pixels
+    int mWidth = 0;
+    int mHeight = 0;
+
+    /**
+     * Kernel values around a point, for offsets from -mRadiusPixels to mRadiusPixels (excluded) in
+     * both directions. The kernel only depends on the offset, so it is computed once per render.
+     */
+    QVector<double> mKernel;
+    //! Range of offsets of each kernel row (first and past the last) within the radius
+    QVector<int> mKernelRowStart;
+    QVector<int> mKernelRowEnd;
+
+    std::vector<PendingPoint> mPendingPoints;
 
     double mCalculatedMaxValue;
 
@@ -194,7 +231,21 @@ class CORE_EXPORT QgsHeatmapRenderer : public QgsFeatureRenderer
 
     QgsMultiPoint convertToMultipoint( const QgsGeometry *geom );
     void initializeValues( QgsRenderContext &context );
+
+    /**
+     * Adds the kernels of the pending points to mValues. The heatmap is split into bands of rows, which
+     * are filled in parallel.
+     */
+    void addPendingPoints();
+
+    /**
+     * Adds the kernels of the pending points of \a band to its rows of mValues, in order,
+     * and raises the band's maximum value to the highest reached value.
+     */
+    void addPointsToBand( Band &band );
     void renderImage( QgsRenderContext &context );
+
+    friend class TestQgsHeatmapRenderer;
 };
 
 
@@ -18,7 +18,6 @@
 #include "qgspointdistancerenderer.h"
 #include "qgsgeometry.h"
 #include "qgssymbollayerutils.h"
-#include "qgsspatialindex.h"
 #include "qgsmultipoint.h"
 #include "qgslogger.h"
 
@@ -34,7 +33,6 @@ QgsPointDistanceRenderer::QgsPointDistanceRenderer( const QString &rendererName,
   , mTolerance( 3 )
   , mToleranceUnit( QgsUnitTypes::RenderMillimeters )
   , mDrawLabels( true )
-  , mSpatialIndex( nullptr )
 {
   mRenderer.reset( QgsFeatureRenderer::defaultRenderer( QgsWkbTypes::PointGeometry ) );
 }
@@ -89,48 +87,64 @@ bool QgsPointDistanceRenderer::renderFeature( QgsFeature &feature, QgsRenderCont
     transformedFeature.setGeometry( geom );
   }
 
-  double searchDistance = context.convertToMapUnits( mTolerance, mToleranceUnit, mToleranceMapUnitScale );
   QgsPointXY point = transformedFeature.geometry().asPoint();
-  QList<QgsFeatureId> intersectList = mSpatialIndex->intersects( searchRect( point, searchDistance ) );
-  if ( intersectList.empty() )
+  QgsRectangle rect = searchRect( point, mSearchDistance );
+
+  // find group with closest location to this point (may be more than one within search tolerance).
+  // The search rectangle is as large as a grid cell, so it covers 2 x 2 cells at most.
+  int groupIdx = -1;
+  double minDist = 0;
+  const QPair< qint64, qint64 > minCell = gridCell( rect.xMinimum(), rect.yMinimum() );
+  const QPair< qint64, qint64 > maxCell = gridCell( rect.xMaximum(), rect.yMaximum() );
+  for ( qint64 cellX = minCell.first; cellX <= maxCell.first; ++cellX )
+  {
+    for ( qint64 cellY = minCell.second; cellY <= maxCell.second; ++cellY )
+    {
+      QHash< QPair< qint64, qint64 >, QVector< int > >::const_iterator cellIt = mGroupGrid.constFind( qMakePair( cellX, cellY ) );
+      if ( cellIt == mGroupGrid.constEnd() )
+        continue;
+
+      Q_FOREACH ( int candidateIdx, cellIt.value() )
+      {
+        const GroupLocation &location = mGroupLocations.at( candidateIdx );
+        if ( !rect.contains( location.firstPoint ) )
+          continue;
+
+        // prefer the oldest group on ties, so that the result does not depend on the grid
+        double newDist = location.center.distance( point );
+        if ( groupIdx < 0 || newDist < minDist || ( newDist == minDist && candidateIdx < groupIdx ) )
+        {
+          minDist = newDist;
+          groupIdx = candidateIdx;
+        }
+      }
+    }
+  }
+
+  if ( groupIdx < 0 )
   {
-    mSpatialIndex->insertFeature( transformedFeature );
     // create new group
     ClusteredGroup newGroup;
     newGroup << GroupedFeature( transformedFeature, symbol->clone(), selected, label );
     mClusteredGroups.push_back( newGroup );
     // add to group index
-    mGroupIndex.insert( transformedFeature.id(), mClusteredGroups.count() - 1 );
-    mGroupLocations.insert( transformedFeature.id(), point );
+    GroupLocation location;
+    location.firstPoint = point;
+    location.center = point;
+    mGroupLocations << location;
+    mGroupGrid[ gridCell( point.x(), point.y() )] << mClusteredGroups.count() - 1;
   }
   else
   {
-    // find group with closest location to this point (may be more than one within search tolerance)
-    QgsFeatureId minDistFeatureId = intersectList.at( 0 );
-    double minDist = mGroupLocations.value( minDistFeatureId ).distance( point );
-    for ( int i = 1; i < intersectList.count(); ++i )
-    {
-      QgsFeatureId candidateId = intersectList.at( i );
-      double newDist = mGroupLocations.value( candidateId ).distance( point );
-      if ( newDist < minDist )
-      {
-        minDist = newDist;
-        minDistFeatureId = candidateId;
-      }
-    }
-
-    int groupIdx = mGroupIndex[ minDistFeatureId ];
     ClusteredGroup &group = mClusteredGroups[groupIdx];
 
     // calculate new centroid of group
-    QgsPointXY oldCenter = mGroupLocations.value( minDistFeatureId );
-    mGroupLocations[ minDistFeatureId ] = QgsPointXY( ( oldCenter.x() * group.size() + point.x() ) / ( group.size() + 1.0 ),
-                                          ( oldCenter.y() * group.size() + point.y() ) / ( group.size() + 1.0 ) );
+    QgsPointXY &center = mGroupLocations[ groupIdx ].center;
+    center = QgsPointXY( ( center.x() * group.size() + point.x() ) / ( group.size() + 1.0 ),
+                         ( center.y() * group.size() + point.y() ) / ( group.size() + 1.0 ) );
 
     // add to a group
     group << GroupedFeature( transformedFeature, symbol->clone(), selected, label );
-    // add to group index
-    mGroupIndex.insert( transformedFeature.id(), groupIdx );
   }
 
   return true;
@@ -290,9 +304,9 @@ void QgsPointDistanceRenderer::startRender( QgsRenderContext &context, const Qgs
   mRenderer->startRender( context, fields );
 
   mClusteredGroups.clear();
-  mGroupIndex.clear();
   mGroupLocations.clear();
-  mSpatialIndex = new QgsSpatialIndex;
+  mGroupGrid.clear();
+  mSearchDistance = context.convertToMapUnits( mTolerance, mToleranceUnit, mToleranceMapUnitScale );
 
   if ( mLabelAttributeName.isEmpty() )
   {
@@ -323,10 +337,8 @@ void QgsPointDistanceRenderer::stopRender( QgsRenderContext &context )
   }
 
   mClusteredGroups.clear();
-  mGroupIndex.clear();
   mGroupLocations.clear();
-  delete mSpatialIndex;
-  mSpatialIndex = nullptr;
+  mGroupGrid.clear();
 
   mRenderer->stopRender( context );
 }
@@ -345,6 +357,14 @@ QgsRectangle QgsPointDistanceRenderer::searchRect( const QgsPointXY &p, double d
   return QgsRectangle( p.x() - distance, p.y() - distance, p.x() + distance, p.y() + distance );
 }
 
+QPair< qint64, qint64 > QgsPointDistanceRenderer::gridCell( double x, double y ) const
+{
+  const double cellSize = mSearchDistance > 0 ? 2 * mSearchDistance : 1.0;
+  // bound the cell coordinates, so that they can be converted for points far away from the cell size
+  return qMakePair( static_cast< qint64 >( std::floor( qBound( -1e15, x / cellSize, 1e15 ) ) ),
+                    static_cast< qint64 >( std::floor( qBound( -1e15, y / cellSize, 1e15 ) ) ) );
+}
+
 void QgsPointDistanceRenderer::printGroupInfo() const
 {
 #ifdef QGISDEBUG
@@ -22,8 +22,9 @@
 #include "qgis.h"
 #include "qgsrenderer.h"
 #include <QFont>
-
-class QgsSpatialIndex;
+#include <QHash>
+#include <QPair>
+#include <QVector>
 
 /** \class QgsPointDistanceRenderer
  * \ingroup core
@@ -241,15 +242,6 @@ class CORE_EXPORT QgsPointDistanceRenderer: public QgsFeatureRenderer
     //! Groups of features that are considered clustered together.
     QList<ClusteredGroup> mClusteredGroups;
 
-    //! Mapping of feature ID to the feature's group index.
-    QMap<QgsFeatureId, int> mGroupIndex;
-
-    //! Mapping of feature ID to approximate group location
-    QMap<QgsFeatureId, QgsPointXY > mGroupLocations;
-
-    //! Spatial index for fast lookup of nearby points.
-    QgsSpatialIndex *mSpatialIndex = nullptr;
-
     /** Renders the labels for a group.
      * \param centerPoint center point of group
      * \param context destination render context
@@ -261,6 +253,30 @@ class CORE_EXPORT QgsPointDistanceRenderer: public QgsFeatureRenderer
 
   private:
 
+    //! Location of a group of mClusteredGroups
+    struct GroupLocation
+    {
+      //! Position of the first feature of the group, which the group is found by
+      QgsPointXY firstPoint;
+      //! Approximate group location (centroid of the features)
+      QgsPointXY center;
+    };
+
+    //! Locations of the groups, in the order of mClusteredGroups
+    QVector< GroupLocation > mGroupLocations;
+
+    /**
+     * Uniform grid for fast lookup of nearby groups. Each cell holds the indexes of the groups
+     * whose first point lies within it, see gridCell().
+     */
+    QHash< QPair< qint64, qint64 >, QVector< int > > mGroupGrid;
+
+    //! Search distance in map units. Cells of mGroupGrid are twice as large.
+    double mSearchDistance = 0;
+
+    //! Returns the cell of mGroupGrid containing the map coordinates ( \a x, \a y )
+    QPair< qint64, qint64 > gridCell( double x, double y ) const;
+
     /** Draws a group of clustered points.
      * \param centerPoint central point (geographic centroid) of all points contained within the cluster
      * \param context destination render context
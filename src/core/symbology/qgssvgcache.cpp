@@ -86,7 +86,7 @@ int QgsSvgCacheEntry::dataSize() const
   }
   if ( image )
   {
-    size += ( image->width() * image->height() * 32 );
+    size += image->byteCount();
   }
   return size;
 }
@@ -127,8 +127,8 @@ QImage QgsSvgCache::svgAsImage( const QString &file, double size, const QColor &
     }
     long cachedDataSize = 0;
     cachedDataSize += currentEntry->svgContent.size();
-    cachedDataSize += static_cast< int >( currentEntry->size * currentEntry->size * hwRatio * 32 );
-    if ( cachedDataSize > MAXIMUM_SIZE / 2 )
+    cachedDataSize += static_cast< int >( currentEntry->size * currentEntry->size * hwRatio * 4 );
+    if ( cachedDataSize > mMaximumSize / 2 )
     {
       fitsInCache = false;
       delete currentEntry->image;
@@ -195,7 +195,7 @@ QgsSvgCacheEntry *QgsSvgCache::insertSvg( const QString &path, double size, cons
 
   replaceParamsAndCacheSvg( entry );
 
-  mEntryLookup.insert( path, entry );
+  mEntryLookup.insert( entryKey( entry ), entry );
 
   //insert to most recent place in entry list
   if ( !mMostRecentEntry ) //inserting first entry
@@ -521,7 +521,7 @@ void QgsSvgCache::cacheImage( QgsSvgCacheEntry *entry )
   }
 
   entry->image = image;
-  mTotalSize += ( image->width() * image->height() * 32 );
+  mTotalSize += image->byteCount();
 }
 
 void QgsSvgCache::cachePicture( QgsSvgCacheEntry *entry, bool forceVectorOutput )
@@ -561,29 +561,25 @@ QgsSvgCacheEntry *QgsSvgCache::cacheEntry( const QString &path, double size, con
     double widthScaleFactor )
 {
   //search entries in mEntryLookup
-  QgsSvgCacheEntry *currentEntry = nullptr;
-  QList<QgsSvgCacheEntry *> entries = mEntryLookup.values( path );
-
-  QList<QgsSvgCacheEntry *>::iterator entryIt = entries.begin();
-  for ( ; entryIt != entries.end(); ++entryIt )
-  {
-    QgsSvgCacheEntry *cacheEntry = *entryIt;
-    if ( qgsDoubleNear( cacheEntry->size, size ) && cacheEntry->fill == fill && cacheEntry->stroke == stroke &&
-         qgsDoubleNear( cacheEntry->strokeWidth, strokeWidth ) && qgsDoubleNear( cacheEntry->widthScaleFactor, widthScaleFactor ) )
-    {
-      currentEntry = cacheEntry;
-      break;
-    }
-  }
+  EntryKey key;
+  key.path = path;
+  key.size = size;
+  key.strokeWidth = strokeWidth;
+  key.widthScaleFactor = widthScaleFactor;
+  key.fill = fill;
+  key.stroke = stroke;
+  QgsSvgCacheEntry *currentEntry = mEntryLookup.value( key );
 
   //if not found: create new entry
   //cache and replace params in svg content
   if ( !currentEntry )
   {
+    mMissCount++;
     currentEntry = insertSvg( path, size, fill, stroke, strokeWidth, widthScaleFactor );
   }
   else
   {
+    mHitCount++;
     takeEntryFromList( currentEntry );
     if ( !mMostRecentEntry ) //list is empty
     {
@@ -871,10 +867,53 @@ void QgsSvgCache::containsElemParams( const QDomElement &elem, bool &hasFillPara
   }
 }
 
-void QgsSvgCache::removeCacheEntry( const QString &s, QgsSvgCacheEntry *entry )
+void QgsSvgCache::removeCacheEntry( QgsSvgCacheEntry *entry )
 {
+  mEntryLookup.remove( entryKey( entry ) );
   delete entry;
-  mEntryLookup.remove( s, entry );
+}
+
+QgsSvgCache::EntryKey QgsSvgCache::entryKey( const QgsSvgCacheEntry *entry )
+{
+  EntryKey key;
+  key.path = entry->path;
+  key.size = entry->size;
+  key.strokeWidth = entry->strokeWidth;
+  key.widthScaleFactor = entry->widthScaleFactor;
+  key.fill = entry->fill;
+  key.stroke = entry->stroke;
+  return key;
+}
+
+void QgsSvgCache::setMaximumSize( long bytes )
+{
+  QMutexLocker locker( &mMutex );
+  mMaximumSize = bytes;
+  trimToMaximumSize();
+}
+
+long QgsSvgCache::maximumSize() const
+{
+  QMutexLocker locker( &mMutex );
+  return mMaximumSize;
+}
+
+long QgsSvgCache::totalSize() const
+{
+  QMutexLocker locker( &mMutex );
+  return mTotalSize;
+}
+
+int QgsSvgCache::hitCount() const
+{
+  QMutexLocker locker( &mMutex );
+  return mHitCount;
+}
+
+int QgsSvgCache::missCount() const
+{
+  QMutexLocker locker( &mMutex );
+  return mMissCount;
 }
 
 void QgsSvgCache::printEntryList()
@@ -899,16 +938,16 @@ void QgsSvgCache::trimToMaximumSize()
   {
     return;
   }
+  //the most recent entry is the one being requested, it is never removed
   QgsSvgCacheEntry *entry = mLeastRecentEntry;
-  while ( entry && ( mTotalSize > MAXIMUM_SIZE ) )
+  while ( entry && entry != mMostRecentEntry && ( mTotalSize > mMaximumSize ) )
   {
     QgsSvgCacheEntry *bkEntry = entry;
     entry = entry->nextEntry;
 
     takeEntryFromList( bkEntry );
-    mEntryLookup.remove( bkEntry->path, bkEntry );
     mTotalSize -= bkEntry->dataSize();
-    delete bkEntry;
+    removeCacheEntry( bkEntry );
   }
 }
 
@@ -21,7 +21,7 @@
 #include <QColor>
 #include "qgis.h"
 #include <QMap>
-#include <QMultiHash>
+#include <QHash>
 #include <QMutex>
 #include <QString>
 #include <QUrl>
@@ -189,6 +189,41 @@ class CORE_EXPORT QgsSvgCache : public QObject
     QByteArray svgContent( const QString &path, double size, const QColor &fill, const QColor &stroke, double strokeWidth,
                            double widthScaleFactor );
 
+    /**
+     * Sets the maximum memory used by the cache, in bytes. The least recently used entries
+     * are removed when the cached content exceeds it.
+     * \see maximumSize()
+     * \since QGIS 3.0
+     */
+    void setMaximumSize( long bytes );
+
+    /**
+     * Returns the maximum memory used by the cache, in bytes.
+     * \see setMaximumSize()
+     * \since QGIS 3.0
+     */
+    long maximumSize() const;
+
+    /**
+     * Returns the memory currently used by the cached SVG content, images and pictures, in bytes.
+     * \since QGIS 3.0
+     */
+    long totalSize() const;
+
+    /**
+     * Returns the number of requests which found an entry with the same parameters in the cache.
+     * \see missCount()
+     * \since QGIS 3.0
+     */
+    int hitCount() const;
+
+    /**
+     * Returns the number of requests which had to create a new cache entry.
+     * \see hitCount()
+     * \since QGIS 3.0
+     */
+    int missCount() const;
+
   signals:
     //! Emit a signal to be caught by qgisapp and display a msg on status bar
     void statusChanged( const QString  &statusQString );
@@ -223,19 +258,52 @@ class CORE_EXPORT QgsSvgCache : public QObject
     void downloadProgress( qint64, qint64 );
 
   private:
-    //! Entry pointers accessible by file name
-    QMultiHash< QString, QgsSvgCacheEntry * > mEntryLookup;
-    //! Estimated total size of all images, pictures and svgContent
+
+    //! Parameters of a cache entry, which it is looked up by
+    struct EntryKey
+    {
+      QString path;
+      double size;
+      double strokeWidth;
+      double widthScaleFactor;
+      QColor fill;
+      QColor stroke;
+
+      bool operator==( const EntryKey &other ) const
+      {
+        return path == other.path && size == other.size && strokeWidth == other.strokeWidth &&
+               widthScaleFactor == other.widthScaleFactor && fill == other.fill && stroke == other.stroke;
+      }
+    };
+
+    friend uint qHash( const EntryKey &key, uint seed )
+    {
+      uint hash = qHash( key.path, seed );
+      hash = qHash( key.size, hash * 31 );
+      hash = qHash( key.strokeWidth, hash * 31 );
+      hash = qHash( key.widthScaleFactor, hash * 31 );
+      hash = qHash( key.fill.rgba(), hash * 31 );
+      return qHash( key.stroke.rgba(), hash * 31 );
+    }
+
+    //! Returns the lookup key of \a entry
+    static EntryKey entryKey( const QgsSvgCacheEntry *entry );
+
+    //! Entry pointers accessible by their parameters
+    QHash< EntryKey, QgsSvgCacheEntry * > mEntryLookup;
+    //! Total size of all images, pictures and svgContent, in bytes
     long mTotalSize;
+    //! Maximum cache size, in bytes
+    long mMaximumSize = 20000000;
+
+    int mHitCount = 0;
+    int mMissCount = 0;
 
     //The svg cache keeps the entries on a double connected list, moving the current entry to the front.
     //That way, removing entries for more space can start with the least used objects.
     QgsSvgCacheEntry *mLeastRecentEntry = nullptr;
     QgsSvgCacheEntry *mMostRecentEntry = nullptr;
 
-    //! Maximum cache size
-    static const long MAXIMUM_SIZE = 20000000;
-
     //! Replaces parameters in elements of a dom node and calls method for all child nodes
     void replaceElemParams( QDomElement &elem, const QColor &fill, const QColor &stroke, double strokeWidth );
 
@@ -250,7 +318,7 @@ class CORE_EXPORT QgsSvgCache : public QObject
     double calcSizeScaleFactor( QgsSvgCacheEntry *entry, const QDomElement &docElem, QSizeF &viewboxSize ) const;
 
     //! Release memory and remove cache entry from mEntryLookup
-    void removeCacheEntry( const QString &s, QgsSvgCacheEntry *entry );
+    void removeCacheEntry( QgsSvgCacheEntry *entry );
 
     //! For debugging
     void printEntryList();
@@ -259,7 +327,7 @@ class CORE_EXPORT QgsSvgCache : public QObject
     QByteArray mMissingSvg;
 
     //! Mutex to prevent concurrent access to the class from multiple threads at once (may corrupt the entries otherwise).
-    QMutex mMutex;
+    mutable QMutex mMutex;
 
 };
 
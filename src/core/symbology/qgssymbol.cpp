@@ -114,24 +114,24 @@ QPolygonF QgsSymbol::_getLineString( QgsRenderContext &context, const QgsCurve &
     const double cw = e.width() / 10;
     const double ch = e.height() / 10;
     const QgsRectangle clipRect( e.xMinimum() - cw, e.yMinimum() - ch, e.xMaximum() + cw, e.yMaximum() + ch );
-    pts = QgsClipper::clippedLine( curve, clipRect );
+    // lines within the clip rectangle are left as they are
+    if ( !clipRect.contains( curve.boundingBox() ) )
+      pts = QgsClipper::clippedLine( curve, clipRect );
+    else
+      pts = curve.asQPolygonF();
   }
   else
   {
     pts = curve.asQPolygonF();
   }
 
-  //transform the QPolygonF to screen coordinates
+  //transform the QPolygonF to screen coordinates, in place
   if ( ct.isValid() )
   {
     ct.transformPolygon( pts );
   }
 
-  QPointF *ptr = pts.data();
-  for ( int i = 0; i < pts.size(); ++i, ++ptr )
-  {
-    mtp.transformInPlace( ptr->rx(), ptr->ry() );
-  }
+  mtp.transformInPlace( pts );
 
   return pts;
 }
@@ -140,34 +140,29 @@ QPolygonF QgsSymbol::_getPolygonRing( QgsRenderContext &context, const QgsCurve
 {
   const QgsCoordinateTransform ct = context.coordinateTransform();
   const QgsMapToPixel &mtp = context.mapToPixel();
-  const QgsRectangle &e = context.extent();
-  const double cw = e.width() / 10;
-  const double ch = e.height() / 10;
-  QgsRectangle clipRect( e.xMinimum() - cw, e.yMinimum() - ch, e.xMaximum() + cw, e.yMaximum() + ch );
-
-  QPolygonF poly = curve.asQPolygonF();
 
   if ( curve.numPoints() < 1 )
     return QPolygonF();
 
+  QPolygonF poly = curve.asQPolygonF();
+
   //clip close to view extent, if needed
-  const QRectF ptsRect = poly.boundingRect();
-  if ( clipToExtent && !context.extent().contains( ptsRect ) )
+  if ( clipToExtent && !context.extent().contains( curve.boundingBox() ) )
   {
+    const QgsRectangle &e = context.extent();
+    const double cw = e.width() / 10;
+    const double ch = e.height() / 10;
+    const QgsRectangle clipRect( e.xMinimum() - cw, e.yMinimum() - ch, e.xMaximum() + cw, e.yMaximum() + ch );
     QgsClipper::trimPolygon( poly, clipRect );
   }
 
-  //transform the QPolygonF to screen coordinates
+  //transform the QPolygonF to screen coordinates, in place
   if ( ct.isValid() )
   {
     ct.transformPolygon( poly );
   }
 
-  QPointF *ptr = poly.data();
-  for ( int i = 0; i < poly.size(); ++i, ++ptr )
-  {
-    mtp.transformInPlace( ptr->rx(), ptr->ry() );
-  }
+  mtp.transformInPlace( poly );
 
   return poly;
 }
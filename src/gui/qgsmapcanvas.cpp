@@ -52,6 +52,7 @@ email                : sherman at mrcc.com
 #include "qgsmaptoolzoom.h"
 #include "qgsmaptopixel.h"
 #include "qgsmapoverviewcanvas.h"
+#include "qgslabelingcache.h"
 #include "qgsmaprenderercache.h"
 #include "qgsmaprenderercustompainterjob.h"
 #include "qgsmaprendererparalleljob.h"
@@ -237,6 +238,7 @@ QgsMapCanvas::~QgsMapCanvas()
   // CanvasProperties struct has its own dtor for freeing resources
 
   delete mCache;
+  delete mLabelingCache;
 
   delete mLabelingResults;
 
@@ -443,6 +445,35 @@ void QgsMapCanvas::clearCache()
 {
   if ( mCache )
     mCache->clear();
+  if ( mLabelingCache )
+    mLabelingCache->clear();
+}
+
+void QgsMapCanvas::setLabelingCacheEnabled( bool enabled )
+{
+  if ( enabled == isLabelingCacheEnabled() )
+    return;
+
+  if ( mJob && mJob->isActive() )
+  {
+    // wait for the current rendering to finish, before touching the cache
+    mJob->waitForFinished();
+  }
+
+  if ( enabled )
+  {
+    mLabelingCache = new QgsLabelingCache;
+  }
+  else
+  {
+    delete mLabelingCache;
+    mLabelingCache = nullptr;
+  }
+}
+
+bool QgsMapCanvas::isLabelingCacheEnabled() const
+{
+  return nullptr != mLabelingCache;
 }
 
 void QgsMapCanvas::setParallelRenderingEnabled( bool enabled )
@@ -538,6 +569,7 @@ void QgsMapCanvas::refreshMap()
     mJob = new QgsMapRendererSequentialJob( mSettings );
   connect( mJob, &QgsMapRendererJob::finished, this, &QgsMapCanvas::rendererJobFinished );
   mJob->setCache( mCache );
+  mJob->setLabelingCache( mLabelingCache );
 
   mJob->start();
 
@@ -55,6 +55,7 @@ class QgsMapLayer;
 class QgsHighlight;
 class QgsVectorLayer;
 
+class QgsLabelingCache;
 class QgsLabelingResults;
 class QgsMapRendererCache;
 class QgsMapRendererQImageJob;
@@ -138,10 +139,26 @@ class GUI_EXPORT QgsMapCanvas : public QGraphicsView
     //! \since QGIS 2.4
     bool isCachingEnabled() const;
 
-    //! Make sure to remove any rendered images from cache (does nothing if cache is not enabled)
+    //! Make sure to remove any rendered images and kept label placements from caches (does nothing if caches are not enabled)
     //! \since QGIS 2.4
     void clearCache();
 
+    /**
+     * Sets whether to keep the placement of labels from one render to the next one. Labels
+     * which stay inside the map when panning then keep their placement, and only the labels
+     * of the newly visible area are placed.
+     * \see isLabelingCacheEnabled()
+     * \since QGIS 3.0
+     */
+    void setLabelingCacheEnabled( bool enabled );
+
+    /**
+     * Returns whether the placement of labels is kept from one render to the next one.
+     * \see setLabelingCacheEnabled()
+     * \since QGIS 3.0
+     */
+    bool isLabelingCacheEnabled() const;
+
     //! Reload all layers, clear the cache and refresh the canvas
     //! \since QGIS 2.9
     void refreshAllLayers();
@@ -839,6 +856,9 @@ class GUI_EXPORT QgsMapCanvas : public QGraphicsView
     //! Optionally use cache with rendered map layers for the current map settings
     QgsMapRendererCache *mCache = nullptr;
 
+    //! Optionally keep label placements from one render to the next one
+    QgsLabelingCache *mLabelingCache = nullptr;
+
     QTimer *mResizeTimer = nullptr;
     QTimer *mRefreshTimer = nullptr;
 
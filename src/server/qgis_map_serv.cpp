@@ -45,6 +45,10 @@ int main( int argc, char *argv[] )
   server.initPython();
 #endif
   // Starts FCGI loop
+  // Requests are handled one at a time on purpose: QgsServer keeps the state of the current
+  // request in QgsProject::instance() and in its single QgsServerInterface, and the service
+  // modules are not reentrant. Accepting requests on several threads (FCGX_Accept_r) needs
+  // per-thread server and project contexts first, until then run several FastCGI processes.
   while ( fcgi_accept() >= 0 )
   {
     QgsFcgiServerRequest  request;
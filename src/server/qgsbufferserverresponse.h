@@ -103,6 +103,10 @@ class SERVER_EXPORT QgsBufferServerResponse: public QgsServerResponse
      *
      * 'flush()' may be called multiple times. For HTTP transactions
      * headers will be written on the first call to 'flush()'.
+     *
+     * The flushed data is appended to body(), which keeps the whole
+     * response in memory: streamed responses only run in bounded memory
+     * with responses writing to the network, like the FastCGI one.
      */
     void flush() override;
 
@@ -174,6 +174,8 @@ void QgsConfigCache::removeChangedEntry( const QString &path )
   mXmlDocumentCache.remove( path );
 
   mFileSystemWatcher.removePath( path );
+
+  emit entryRemoved( path );
 }
 
 
@@ -55,6 +55,16 @@ class SERVER_EXPORT QgsConfigCache : public QObject
      */
     const QgsProject *project( const QString &path );
 
+  signals:
+
+    /**
+     * Emitted when the entries of the configuration file \a path are removed
+     * from the cache, because the file changed or removeEntry() was called.
+     * Other caches of data computed from the file can connect to it.
+     * \since QGIS 3.0
+     */
+    void entryRemoved( const QString &path );
+
   private:
     QgsConfigCache() SIP_FORCE;
 
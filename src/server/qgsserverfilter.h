@@ -71,7 +71,8 @@ class SERVER_EXPORT QgsServerFilter
      * the responseComplete() plugin hook. For streaming services (like WFS on
      * getFeature requests, sendResponse() might have been called several times
      * before the response is complete: in this particular case, sendResponse()
-     * is called once for each feature before hitting responseComplete()
+     * is called each time a chunk of about 64 KiB of features is flushed, before
+     * hitting responseComplete()
      */
     virtual void sendResponse();
 
@@ -130,6 +130,61 @@ void QgsServerSettings::initSettings()
                                QVariant()
                              };
   mSettings[ sCacheSize.envVar ] = sCacheSize;
+
+  // wms metatile size
+  const Setting sWmsMetatileSize = { QgsServerSettingsEnv::QGIS_SERVER_WMS_METATILE_SIZE,
+                                     QgsServerSettingsEnv::DEFAULT_VALUE,
+                                     "Number of tiles along each side of WMS metatiles (0 disables the tile mode)",
+                                     "",
+                                     QVariant::Int,
+                                     QVariant( 0 ),
+                                     QVariant()
+                                   };
+  mSettings[ sWmsMetatileSize.envVar ] = sWmsMetatileSize;
+
+  // wms tile size
+  const Setting sWmsTileSize = { QgsServerSettingsEnv::QGIS_SERVER_WMS_TILE_SIZE,
+                                 QgsServerSettingsEnv::DEFAULT_VALUE,
+                                 "Width and height in pixels of WMS tiles",
+                                 "",
+                                 QVariant::Int,
+                                 QVariant( 256 ),
+                                 QVariant()
+                               };
+  mSettings[ sWmsTileSize.envVar ] = sWmsTileSize;
+
+  // wms tile cache directory
+  const Setting sWmsTileCacheDir = { QgsServerSettingsEnv::QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY,
+                                     QgsServerSettingsEnv::DEFAULT_VALUE,
+                                     "Directory of the WMS tile cache (tiles are kept in memory if empty)",
+                                     "",
+                                     QVariant::String,
+                                     QVariant( "" ),
+                                     QVariant()
+                                   };
+  mSettings[ sWmsTileCacheDir.envVar ] = sWmsTileCacheDir;
+
+  // wms tile cache size
+  const Setting sWmsTileCacheSize = { QgsServerSettingsEnv::QGIS_SERVER_WMS_TILE_CACHE_SIZE,
+                                      QgsServerSettingsEnv::DEFAULT_VALUE,
+                                      "Maximum size in bytes of the WMS tiles kept in memory",
+                                      "",
+                                      QVariant::LongLong,
+                                      QVariant( 64 * 1024 * 1024 ),
+                                      QVariant()
+                                    };
+  mSettings[ sWmsTileCacheSize.envVar ] = sWmsTileCacheSize;
+
+  // wms palette iterations
+  const Setting sWmsPaletteIterations = { QgsServerSettingsEnv::QGIS_SERVER_WMS_PALETTE_ITERATIONS,
+                                          QgsServerSettingsEnv::DEFAULT_VALUE,
+                                          "Number of k-means iterations refining the palette of 8 bit PNG images",
+                                          "",
+                                          QVariant::Int,
+                                          QVariant( 0 ),
+                                          QVariant()
+                                        };
+  mSettings[ sWmsPaletteIterations.envVar ] = sWmsPaletteIterations;
 }
 
 void QgsServerSettings::load()
@@ -305,3 +360,28 @@ QString QgsServerSettings::cacheDirectory() const
 {
   return value( QgsServerSettingsEnv::QGIS_SERVER_CACHE_DIRECTORY ).toString();
 }
+
+int QgsServerSettings::wmsMetatileSize() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMS_METATILE_SIZE ).toInt();
+}
+
+int QgsServerSettings::wmsTileSize() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMS_TILE_SIZE ).toInt();
+}
+
+QString QgsServerSettings::wmsTileCacheDirectory() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY ).toString();
+}
+
+qint64 QgsServerSettings::wmsTileCacheSize() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMS_TILE_CACHE_SIZE ).toLongLong();
+}
+
+int QgsServerSettings::wmsPaletteIterations() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMS_PALETTE_ITERATIONS ).toInt();
+}
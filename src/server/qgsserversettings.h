@@ -56,7 +56,12 @@ class SERVER_EXPORT QgsServerSettingsEnv : public QObject
       QGIS_PROJECT_FILE,
       MAX_CACHE_LAYERS,
       QGIS_SERVER_CACHE_DIRECTORY,
-      QGIS_SERVER_CACHE_SIZE
+      QGIS_SERVER_CACHE_SIZE,
+      QGIS_SERVER_WMS_METATILE_SIZE,
+      QGIS_SERVER_WMS_TILE_SIZE,
+      QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY,
+      QGIS_SERVER_WMS_TILE_CACHE_SIZE,
+      QGIS_SERVER_WMS_PALETTE_ITERATIONS
     };
     Q_ENUM( EnvVar )
 };
@@ -144,6 +149,44 @@ class SERVER_EXPORT QgsServerSettings
       */
     QString cacheDirectory() const;
 
+    /**
+      * Returns the number of tiles along each side of the metatiles rendered for
+      * WMS GetMap tile requests. Tile requests are GetMap requests of wmsTileSize()
+      * pixels whose BBOX is aligned on a grid anchored at the origin of the CRS.
+      * \returns the number of tiles, 0 if the tile mode is disabled.
+      * \since QGIS 3.0
+      */
+    int wmsMetatileSize() const;
+
+    /**
+      * Returns the width and height in pixels of WMS GetMap tile requests.
+      * \returns the tile size.
+      * \since QGIS 3.0
+      */
+    int wmsTileSize() const;
+
+    /**
+      * Returns the directory where rendered WMS tiles are stored.
+      * \returns the directory or an empty string if tiles are kept in memory.
+      * \since QGIS 3.0
+      */
+    QString wmsTileCacheDirectory() const;
+
+    /**
+      * Returns the maximum size of the rendered WMS tiles kept in memory.
+      * \returns the size in bytes.
+      * \since QGIS 3.0
+      */
+    qint64 wmsTileCacheSize() const;
+
+    /**
+      * Returns the number of k-means iterations refining the median cut palette
+      * of 8 bit PNG images.
+      * \returns the number of iterations, 0 to keep the median cut palette.
+      * \since QGIS 3.0
+      */
+    int wmsPaletteIterations() const;
+
   private:
     void initSettings();
     QVariant value( QgsServerSettingsEnv::EnvVar envVar ) const;
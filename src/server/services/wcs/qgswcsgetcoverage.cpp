@@ -26,11 +26,22 @@
 #include "qgsrasterprojector.h"
 #include "qgsrasterfilewriter.h"
 
-#include <QTemporaryFile>
+#include <QUuid>
+
+#include <cpl_conv.h>
+#include <cpl_vsi.h>
+
+#include <algorithm>
 
 namespace QgsWcs
 {
 
+  namespace
+  {
+    //! Size of the coverage parts written to the response
+    const vsi_l_offset RESPONSE_CHUNK_SIZE = 1024 * 1024;
+  }
+
   /**
    * Output WCS DescribeCoverage response
    */
@@ -39,11 +50,28 @@ namespace QgsWcs
   {
     Q_UNUSED( version );
 
-    response.write( getCoverageData( serverIface, project, request ) );
+    // the coverage is written in memory by GDAL, never on disk
+    const QByteArray fileName = QStringLiteral( "/vsimem/qgis_server/wcs_%1.tif" ).arg( QUuid::createUuid().toString() ).toUtf8();
+    writeCoverageData( serverIface, project, request, QString::fromUtf8( fileName ) );
+
+    // take the ownership of the GDAL buffer, which is copied to the response by parts
+    vsi_l_offset size = 0;
+    GByte *data = VSIGetMemFileBuffer( fileName.constData(), &size, TRUE );
+    if ( !data )
+    {
+      throw QgsRequestNotWellFormedException( QStringLiteral( "Cannot read the coverage" ) );
+    }
+
     response.setHeader( "Content-Type", "image/tiff" );
+    for ( vsi_l_offset offset = 0; offset < size; offset += RESPONSE_CHUNK_SIZE )
+    {
+      response.write( reinterpret_cast< const char * >( data + offset ), static_cast< qint64 >( std::min( RESPONSE_CHUNK_SIZE, size - offset ) ) );
+      response.flush();
+    }
+    CPLFree( data );
   }
 
-  QByteArray getCoverageData( QgsServerInterface *serverIface, const QgsProject *project, const QgsServerRequest &request )
+  void writeCoverageData( QgsServerInterface *serverIface, const QgsProject *project, const QgsServerRequest &request, const QString &fileName )
   {
     QgsServerRequest::Parameters parameters = request.parameters();
 
@@ -177,9 +205,7 @@ namespace QgsWcs
       }
     }
 
-    QTemporaryFile tempFile;
-    tempFile.open();
-    QgsRasterFileWriter fileWriter( tempFile.fileName() );
+    QgsRasterFileWriter fileWriter( fileName );
 
     // clone pipe/provider
     QgsRasterPipe pipe;
@@ -202,9 +228,9 @@ namespace QgsWcs
     QgsRasterFileWriter::WriterError err = fileWriter.writeRaster( &pipe, width, height, rect, responseCRS );
     if ( err != QgsRasterFileWriter::NoError )
     {
+      VSIUnlink( fileName.toUtf8().constData() );
       throw QgsRequestNotWellFormedException( QStringLiteral( "Cannot write raster error code: %1" ).arg( err ) );
     }
-    return tempFile.readAll();
   }
 
 } // namespace QgsWcs
@@ -19,7 +19,7 @@
 #ifndef QGSWCSGETCOVERAGE_H
 #define QGSWCSGETCOVERAGE_H
 
-#include <QByteArray>
+#include <QString>
 
 namespace QgsWcs
 {
@@ -30,9 +30,11 @@ namespace QgsWcs
                          const QgsServerRequest &request, QgsServerResponse &response );
 
   /**
-   * Compute coverage data
+   * Compute coverage data and write it as a GeoTIFF file
+   * \param fileName the output file, which may be a GDAL /vsimem/ in-memory file
    */
-  QByteArray getCoverageData( QgsServerInterface *serverIface, const QgsProject *project, const QgsServerRequest &request );
+  void writeCoverageData( QgsServerInterface *serverIface, const QgsProject *project, const QgsServerRequest &request,
+                          const QString &fileName );
 
 } // namespace QgsWcs
 
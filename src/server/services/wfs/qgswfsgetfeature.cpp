@@ -44,24 +44,23 @@ namespace QgsWfs
   namespace
   {
 
-    QString createFeatureGeoJSON( QgsFeature *feat, int prec, QgsCoordinateReferenceSystem &crs, const QgsAttributeList &attrIndexes,
+    QString createFeatureGeoJSON( QgsFeature *feat, QgsJsonExporter &exporter, const QgsAttributeList &attrIndexes,
                                   const QSet<QString> &excludedAttributes, const QString &typeName, bool withGeom,
                                   const QString &geometryName );
 
-    QDomElement createFeatureGML2( QgsFeature *feat, QDomDocument &doc, int prec, QgsCoordinateReferenceSystem &crs,
-                                   const QgsAttributeList &attrIndexes, const QSet<QString> &excludedAttributes, const QString &typeName,
-                                   bool withGeom, const QString &geometryName );
+    void writeFeatureGML( QString &gml, QgsFeature *feat, bool gml3, int prec, const QgsCoordinateReferenceSystem &crs,
+                          const QgsAttributeList &attrIndexes, const QSet<QString> &excludedAttributes, const QString &typeName,
+                          bool withGeom, const QString &geometryName );
 
-    QDomElement createFeatureGML3( QgsFeature *feat, QDomDocument &doc, int prec, QgsCoordinateReferenceSystem &crs,
-                                   const QgsAttributeList &attrIndexes, const QSet<QString> &excludedAttributes, const QString &typeName,
-                                   bool withGeom, const QString geometryName );
+    void writeBoundingBoxGML( QString &gml, int depth, bool gml3, const QgsRectangle &rect, int prec,
+                              const QgsCoordinateReferenceSystem &crs );
 
     void startGetFeature( const QgsServerRequest &request, QgsServerResponse &response, const QgsProject *project, const QString &format,
                           int prec, QgsCoordinateReferenceSystem &crs, QgsRectangle *rect, const QStringList &typeNames );
 
     void setGetFeature( QgsServerResponse &response, const QString &format, QgsFeature *feat, int featIdx, int prec,
                         QgsCoordinateReferenceSystem &crs, const QgsAttributeList &attrIndexes, const QSet<QString> &excludedAttributes,
-                        const QString &typeName, bool withGeom, const QString &geometryName );
+                        const QString &typeName, bool withGeom, const QString &geometryName, QgsJsonExporter &jsonExporter );
 
     void endGetFeature( QgsServerResponse &response, const QString &format );
 
@@ -306,6 +305,9 @@ namespace QgsWfs
       {
         geometryName = QLatin1String( "NONE" );
       }
+      // GeoJSON exporter, its transformation to EPSG:4326 is set up once for all the features
+      QgsJsonExporter jsonExporter;
+      jsonExporter.setSourceCrs( layerCrs );
 
       // Iterate through features
       QgsFeatureIterator fit = vlayer->getFeatures( featureRequest );
@@ -317,7 +319,7 @@ namespace QgsWfs
         if ( iteratedFeatures >= aRequest.startIndex )
         {
           setGetFeature( response, aRequest.outputFormat, &feature, sentFeatures, layerPrecision, layerCrs, attrIndexes, layerExcludedAttributes,
-                         typeName, withGeom, geometryName );
+                         typeName, withGeom, geometryName, jsonExporter );
           ++sentFeatures;
         }
         ++iteratedFeatures;
@@ -900,42 +902,23 @@ namespace QgsWfs
         response.write( fcString.toUtf8() );
         response.flush();
 
-        QDomDocument doc;
-        QDomElement bbElem = doc.createElement( QStringLiteral( "gml:boundedBy" ) );
-        if ( format == QLatin1String( "GML3" ) )
-        {
-          QDomElement envElem = QgsOgcUtils::rectangleToGMLEnvelope( rect, doc, prec );
-          if ( !envElem.isNull() )
-          {
-            if ( crs.isValid() )
-            {
-              envElem.setAttribute( QStringLiteral( "srsName" ), crs.authid() );
-            }
-            bbElem.appendChild( envElem );
-            doc.appendChild( bbElem );
-          }
-        }
-        else
-        {
-          QDomElement boxElem = QgsOgcUtils::rectangleToGMLBox( rect, doc, prec );
-          if ( !boxElem.isNull() )
-          {
-            if ( crs.isValid() )
-            {
-              boxElem.setAttribute( QStringLiteral( "srsName" ), crs.authid() );
-            }
-            bbElem.appendChild( boxElem );
-            doc.appendChild( bbElem );
-          }
-        }
-        response.write( doc.toByteArray() );
+        QString gml;
+        writeBoundingBoxGML( gml, 0, format == QLatin1String( "GML3" ), *rect, prec, crs );
+        response.write( gml.toUtf8() );
         response.flush();
       }
     }
 
+    /**
+     * Size of the buffered response content which is flushed to the client.
+     * Server filters' sendResponse() is called on each flush, that is once per
+     * chunk of this size instead of once per feature.
+     */
+    const int RESPONSE_FLUSH_SIZE = 64 * 1024;
+
     void setGetFeature( QgsServerResponse &response, const QString &format, QgsFeature *feat, int featIdx, int prec,
                         QgsCoordinateReferenceSystem &crs, const QgsAttributeList &attrIndexes, const QSet<QString> &excludedAttributes,
-                        const QString &typeName, bool withGeom, const QString &geometryName )
+                        const QString &typeName, bool withGeom, const QString &geometryName, QgsJsonExporter &jsonExporter )
     {
       if ( !feat->isValid() )
         return;
@@ -947,30 +930,21 @@ namespace QgsWfs
           fcString += QLatin1String( "  " );
         else
           fcString += QLatin1String( " ," );
-        fcString += createFeatureGeoJSON( feat, prec, crs, attrIndexes, excludedAttributes, typeName, withGeom, geometryName );
+        fcString += createFeatureGeoJSON( feat, jsonExporter, attrIndexes, excludedAttributes, typeName, withGeom, geometryName );
         fcString += QLatin1String( "\n" );
 
         response.write( fcString.toUtf8() );
       }
       else
       {
-        QDomDocument gmlDoc;
-        QDomElement featureElement;
-        if ( format == QLatin1String( "GML3" ) )
-        {
-          featureElement = createFeatureGML3( feat, gmlDoc, prec, crs, attrIndexes, excludedAttributes, typeName, withGeom, geometryName );
-          gmlDoc.appendChild( featureElement );
-        }
-        else
-        {
-          featureElement = createFeatureGML2( feat, gmlDoc, prec, crs, attrIndexes, excludedAttributes, typeName, withGeom, geometryName );
-          gmlDoc.appendChild( featureElement );
-        }
-        response.write( gmlDoc.toByteArray() );
+        QString gml;
+        writeFeatureGML( gml, feat, format == QLatin1String( "GML3" ), prec, crs, attrIndexes, excludedAttributes, typeName, withGeom, geometryName );
+        response.write( gml.toUtf8() );
       }
 
-      // Stream partial content
-      response.flush();
+      // Stream partial content, once enough of it is buffered
+      if ( response.data().size() >= RESPONSE_FLUSH_SIZE )
+        response.flush();
     }
 
     void endGetFeature( QgsServerResponse &response, const QString &format )
@@ -989,16 +963,12 @@ namespace QgsWfs
     }
 
 
-    QString createFeatureGeoJSON( QgsFeature *feat, int prec, QgsCoordinateReferenceSystem &crs, const QgsAttributeList &attrIndexes, const QSet<QString> &excludedAttributes, const QString &typeName, bool withGeom, const QString &geometryName )
+    QString createFeatureGeoJSON( QgsFeature *feat, QgsJsonExporter &exporter, const QgsAttributeList &attrIndexes, const QSet<QString> &excludedAttributes, const QString &typeName, bool withGeom, const QString &geometryName )
     {
       QString id = QStringLiteral( "%1.%2" ).arg( typeName, FID_TO_STRING( feat->id() ) );
 
-      QgsJsonExporter exporter;
-      exporter.setSourceCrs( crs );
       //QgsJsonExporter force transform geometry to ESPG:4326
       //and the RFC 7946 GeoJSON specification recommends limiting coordinate precision to 6
-      Q_UNUSED( prec );
-      //exporter.setPrecision( prec );
 
       //copy feature so we can modify its geometry as required
       QgsFeature f( *feat );
@@ -1043,142 +1013,117 @@ namespace QgsWfs
       return exporter.exportFeature( f, QVariantMap(), id );
     }
 
+    /*
+     * Features are written as text, the same way as QDomDocument::toByteArray() writes a DOM:
+     * one element per line, indented by one space per level. Geometries and bounding boxes
+     * are written by the text GML writers of QgsOgcUtils.
+     */
 
-    QDomElement createFeatureGML2( QgsFeature *feat, QDomDocument &doc, int prec, QgsCoordinateReferenceSystem &crs, const QgsAttributeList &attrIndexes, const QSet<QString> &excludedAttributes, const QString &typeName, bool withGeom, const QString &geometryName )
+    //! Appends \a text escaped as the character data of an element
+    void appendXmlText( QString &xml, const QString &text )
     {
-      //gml:FeatureMember
-      QDomElement featureElement = doc.createElement( QStringLiteral( "gml:featureMember" )/*wfs:FeatureMember*/ );
-
-      //qgs:%TYPENAME%
-      QDomElement typeNameElement = doc.createElement( "qgs:" + typeName /*qgs:%TYPENAME%*/ );
-      typeNameElement.setAttribute( QStringLiteral( "fid" ), typeName + "." + QString::number( feat->id() ) );
-      featureElement.appendChild( typeNameElement );
-
-      if ( withGeom && geometryName != QLatin1String( "NONE" ) )
+      for ( int i = 0; i < text.size(); ++i )
       {
-        //add geometry column (as gml)
-        QgsGeometry geom = feat->geometry();
-
-        QDomElement geomElem = doc.createElement( QStringLiteral( "qgs:geometry" ) );
-        QDomElement gmlElem;
-        if ( geometryName == QLatin1String( "EXTENT" ) )
-        {
-          QgsGeometry bbox = QgsGeometry::fromRect( geom.boundingBox() );
-          gmlElem = QgsOgcUtils::geometryToGML( bbox, doc, prec );
-        }
-        else if ( geometryName == QLatin1String( "CENTROID" ) )
-        {
-          QgsGeometry centroid = geom.centroid();
-          gmlElem = QgsOgcUtils::geometryToGML( centroid, doc, prec );
-        }
+        const QChar c = text.at( i );
+        if ( c == '<' )
+          xml += QLatin1String( "&lt;" );
+        else if ( c == '&' )
+          xml += QLatin1String( "&amp;" );
+        else if ( c == '>' && i >= 2 && text.at( i - 1 ) == ']' && text.at( i - 2 ) == ']' )
+          xml += QLatin1String( "&gt;" );
+        else if ( c == '\r' )
+          xml += QLatin1String( "&#xd;" );
         else
-        {
-          QgsAbstractGeometry *abstractGeom = geom.geometry();
-          if ( abstractGeom )
-          {
-            gmlElem = abstractGeom->asGML2( doc, prec, "http://www.opengis.net/gml" );
-          }
-        }
-
-        if ( !gmlElem.isNull() )
-        {
-          QgsRectangle box = geom.boundingBox();
-          QDomElement bbElem = doc.createElement( QStringLiteral( "gml:boundedBy" ) );
-          QDomElement boxElem = QgsOgcUtils::rectangleToGMLBox( &box, doc, prec );
+          xml += c;
+      }
+    }
 
-          if ( crs.isValid() )
-          {
-            boxElem.setAttribute( QStringLiteral( "srsName" ), crs.authid() );
-            gmlElem.setAttribute( QStringLiteral( "srsName" ), crs.authid() );
-          }
+    //! Appends the attribute \a name with \a value to a start tag
+    void appendXmlAttribute( QString &xml, const QString &name, const QString &value )
+    {
+      xml += ' ' + name + QLatin1String( "=\"" );
+      for ( int i = 0; i < value.size(); ++i )
+      {
+        const QChar c = value.at( i );
+        if ( c == '<' )
+          xml += QLatin1String( "&lt;" );
+        else if ( c == '"' )
+          xml += QLatin1String( "&quot;" );
+        else if ( c == '&' )
+          xml += QLatin1String( "&amp;" );
+        else if ( c == '>' && i >= 2 && value.at( i - 1 ) == ']' && value.at( i - 2 ) == ']' )
+          xml += QLatin1String( "&gt;" );
+        else if ( c == '\n' )
+          xml += QLatin1String( "&#xa;" );
+        else if ( c == '\r' )
+          xml += QLatin1String( "&#xd;" );
+        else if ( c == '\t' )
+          xml += QLatin1String( "&#x9;" );
+        else
+          xml += c;
+      }
+      xml += '"';
+    }
 
-          bbElem.appendChild( boxElem );
-          typeNameElement.appendChild( bbElem );
+    //! Appends \a element of \a doc at \a depth, returns false if the element is null
+    bool appendDomElement( QString &xml, int depth, QDomDocument &doc, QDomElement element, const QString &srsName )
+    {
+      if ( element.isNull() )
+        return false;
 
-          geomElem.appendChild( gmlElem );
-          typeNameElement.appendChild( geomElem );
-        }
-      }
+      if ( !srsName.isEmpty() )
+        element.setAttribute( QStringLiteral( "srsName" ), srsName );
+      doc.appendChild( element );
 
-      //read all attribute values from the feature
-      QgsAttributes featureAttributes = feat->attributes();
-      QgsFields fields = feat->fields();
-      for ( int i = 0; i < attrIndexes.count(); ++i )
+      const QString indent( depth, ' ' );
+      Q_FOREACH ( const QString &line, doc.toString( 1 ).split( '\n', QString::SkipEmptyParts ) )
       {
-        int idx = attrIndexes[i];
-        if ( idx >= fields.count() )
-        {
-          continue;
-        }
-        QString attributeName = fields.at( idx ).name();
-        //skip attribute if it is excluded from WFS publication
-        if ( excludedAttributes.contains( attributeName ) )
-        {
-          continue;
-        }
-
-        QDomElement fieldElem = doc.createElement( "qgs:" + attributeName.replace( QStringLiteral( " " ), QStringLiteral( "_" ) ) );
-        QDomText fieldText = doc.createTextNode( featureAttributes[idx].toString() );
-        fieldElem.appendChild( fieldText );
-        typeNameElement.appendChild( fieldElem );
+        xml += indent + line + '\n';
       }
-
-      return featureElement;
+      return true;
     }
 
-    QDomElement createFeatureGML3( QgsFeature *feat, QDomDocument &doc, int prec, QgsCoordinateReferenceSystem &crs, const QgsAttributeList &attrIndexes, const QSet<QString> &excludedAttributes, const QString &typeName, bool withGeom, const QString geometryName )
+    void writeBoundingBoxGML( QString &gml, int depth, bool gml3, const QgsRectangle &rect, int prec, const QgsCoordinateReferenceSystem &crs )
     {
-      //gml:FeatureMember
-      QDomElement featureElement = doc.createElement( QStringLiteral( "gml:featureMember" )/*wfs:FeatureMember*/ );
+      const QString indent( depth, ' ' );
+      const QString srsName = crs.isValid() ? crs.authid() : QString();
+      gml += indent + QLatin1String( "<gml:boundedBy>\n" );
+      gml += gml3 ? QgsOgcUtils::rectangleToGMLEnvelopeString( rect, prec, srsName, depth + 1 )
+             : QgsOgcUtils::rectangleToGMLBoxString( rect, prec, srsName, depth + 1 );
+      gml += indent + QLatin1String( "</gml:boundedBy>\n" );
+    }
 
-      //qgs:%TYPENAME%
-      QDomElement typeNameElement = doc.createElement( "qgs:" + typeName /*qgs:%TYPENAME%*/ );
-      typeNameElement.setAttribute( QStringLiteral( "gml:id" ), typeName + "." + QString::number( feat->id() ) );
-      featureElement.appendChild( typeNameElement );
+    void writeFeatureGML( QString &gml, QgsFeature *feat, bool gml3, int prec, const QgsCoordinateReferenceSystem &crs, const QgsAttributeList &attrIndexes, const QSet<QString> &excludedAttributes, const QString &typeName, bool withGeom, const QString &geometryName )
+    {
+      QString members;
 
       if ( withGeom && geometryName != QLatin1String( "NONE" ) )
       {
         //add geometry column (as gml)
         QgsGeometry geom = feat->geometry();
+        const QString srsName = crs.isValid() ? crs.authid() : QString();
 
-        QDomElement geomElem = doc.createElement( QStringLiteral( "qgs:geometry" ) );
-        QDomElement gmlElem;
-        if ( geometryName == QLatin1String( "EXTENT" ) )
+        QString geometryGml;
+        bool hasGeometry = false;
+        if ( geometryName == QLatin1String( "EXTENT" ) || geometryName == QLatin1String( "CENTROID" ) )
         {
-          QgsGeometry bbox = QgsGeometry::fromRect( geom.boundingBox() );
-          gmlElem = QgsOgcUtils::geometryToGML( bbox, doc, QStringLiteral( "GML3" ), prec );
+          QDomDocument doc;
+          QgsGeometry outputGeom = geometryName == QLatin1String( "EXTENT" ) ? QgsGeometry::fromRect( geom.boundingBox() ) : geom.centroid();
+          QDomElement gmlElem = gml3 ? QgsOgcUtils::geometryToGML( outputGeom, doc, QStringLiteral( "GML3" ), prec )
+                                : QgsOgcUtils::geometryToGML( outputGeom, doc, prec );
+          hasGeometry = appendDomElement( geometryGml, 3, doc, gmlElem, srsName );
         }
-        else if ( geometryName == QLatin1String( "CENTROID" ) )
+        else if ( geom.geometry() )
         {
-          QgsGeometry centroid = geom.centroid();
-          gmlElem = QgsOgcUtils::geometryToGML( centroid, doc, QStringLiteral( "GML3" ), prec );
-        }
-        else
-        {
-          QgsAbstractGeometry *abstractGeom = geom.geometry();
-          if ( abstractGeom )
-          {
-            gmlElem = abstractGeom->asGML3( doc, prec, "http://www.opengis.net/gml" );
-          }
+          geometryGml = QgsOgcUtils::geometryToGMLString( geom.geometry(), gml3 ? QgsOgcUtils::GML_3_1_0 : QgsOgcUtils::GML_2_1_2,
+                        prec, GML_NAMESPACE, srsName, 3 );
+          hasGeometry = !geometryGml.isEmpty();
         }
 
-        if ( !gmlElem.isNull() )
+        if ( hasGeometry )
         {
-          QgsRectangle box = geom.boundingBox();
-          QDomElement bbElem = doc.createElement( QStringLiteral( "gml:boundedBy" ) );
-          QDomElement boxElem = QgsOgcUtils::rectangleToGMLEnvelope( &box, doc, prec );
-
-          if ( crs.isValid() )
-          {
-            boxElem.setAttribute( QStringLiteral( "srsName" ), crs.authid() );
-            gmlElem.setAttribute( QStringLiteral( "srsName" ), crs.authid() );
-          }
-
-          bbElem.appendChild( boxElem );
-          typeNameElement.appendChild( bbElem );
-
-          geomElem.appendChild( gmlElem );
-          typeNameElement.appendChild( geomElem );
+          writeBoundingBoxGML( members, 2, gml3, geom.boundingBox(), prec, crs );
+          members += QLatin1String( "  <qgs:geometry>\n" ) + geometryGml + QLatin1String( "  </qgs:geometry>\n" );
         }
       }
 
@@ -1199,21 +1144,22 @@ namespace QgsWfs
           continue;
         }
 
-        QDomElement fieldElem = doc.createElement( "qgs:" + attributeName.replace( QStringLiteral( " " ), QStringLiteral( "_" ) ) );
-        QDomText fieldText = doc.createTextNode( featureAttributes[idx].toString() );
-        fieldElem.appendChild( fieldText );
-        typeNameElement.appendChild( fieldElem );
+        const QString elementName = "qgs:" + attributeName.replace( QStringLiteral( " " ), QStringLiteral( "_" ) );
+        members += QLatin1String( "  <" ) + elementName + '>';
+        appendXmlText( members, featureAttributes[idx].toString() );
+        members += QLatin1String( "</" ) + elementName + QLatin1String( ">\n" );
       }
 
-      return featureElement;
+      //gml:FeatureMember with qgs:%TYPENAME%
+      gml += QLatin1String( "<gml:featureMember>\n <qgs:" ) + typeName;
+      appendXmlAttribute( gml, gml3 ? QStringLiteral( "gml:id" ) : QStringLiteral( "fid" ), typeName + "." + QString::number( feat->id() ) );
+      if ( members.isEmpty() )
+        gml += QLatin1String( "/>\n" );
+      else
+        gml += QLatin1String( ">\n" ) + members + QLatin1String( " </qgs:" ) + typeName + QLatin1String( ">\n" );
+      gml += QLatin1String( "</gml:featureMember>\n" );
     }
 
-
-
-
   } // namespace
 
 } // samespace QgsWfs
-
-
-
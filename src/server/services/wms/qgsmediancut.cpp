@@ -24,6 +24,11 @@
 #include <QList>
 #include <QMultiMap>
 #include <QHash>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cstdlib>
 
 namespace QgsWms
 {
@@ -34,29 +39,84 @@ namespace QgsWms
   namespace
   {
 
+    //! Minimum number of pixels of an image processed by several threads
+    const int PARALLEL_PIXEL_COUNT = 100000;
+
+    //! Minimum number of colors matched with a palette by several threads
+    const int PARALLEL_COLOR_COUNT = 1000;
+
+    //! Range of image rows or colors processed by a thread
+    struct Band
+    {
+      int begin;
+      int end;
+      QHash<QRgb, int> colors;
+    };
+
+    QVector<Band> createBands( int count, bool parallel )
+    {
+      const int bandCount = parallel ? std::max( 1, std::min( QThread::idealThreadCount() * 4, count ) ) : 1;
+      const int bandSize = ( count + bandCount - 1 ) / bandCount;
+
+      QVector<Band> bands( bandCount );
+      for ( int i = 0; i < bandCount; ++i )
+      {
+        bands[i].begin = std::min( i * bandSize, count );
+        bands[i].end = std::min( ( i + 1 ) * bandSize, count );
+      }
+      return bands;
+    }
+
+    template <typename BandOperation>
+    void processBands( QVector<Band> &bands, BandOperation operation )
+    {
+      if ( bands.size() == 1 )
+      {
+        operation( bands[0] );
+      }
+      else
+      {
+        QtConcurrent::blockingMap( bands, operation );
+      }
+    }
+
     void imageColors( QHash<QRgb, int> &colors, const QImage &image )
     {
       colors.clear();
-      int width = image.width();
-      int height = image.height();
+      const int width = image.width();
+      const int bytesPerLine = image.bytesPerLine();
+      const uchar *bits = image.constBits();
 
-      const QRgb *currentScanLine = nullptr;
-      QHash<QRgb, int>::iterator colorIt;
-      for ( int i = 0; i < height; ++i )
+      // each band of rows gets its own histogram, merged afterwards
+      QVector<Band> bands = createBands( image.height(), width * image.height() >= PARALLEL_PIXEL_COUNT );
+      processBands( bands, [width, bytesPerLine, bits]( Band & band )
       {
-        currentScanLine = ( const QRgb * )( image.scanLine( i ) );
-        for ( int j = 0; j < width; ++j )
+        for ( int i = band.begin; i < band.end; ++i )
         {
-          colorIt = colors.find( currentScanLine[j] );
-          if ( colorIt == colors.end() )
-          {
-            colors.insert( currentScanLine[j], 1 );
-          }
-          else
+          const QRgb *currentScanLine = reinterpret_cast< const QRgb * >( bits + i * bytesPerLine );
+          int j = 0;
+          while ( j < width )
           {
-            colorIt.value()++;
+            // rendered maps have long runs of the same color
+            const QRgb color = currentScanLine[j];
+            int runLength = 1;
+            while ( j + runLength < width && currentScanLine[j + runLength] == color )
+            {
+              ++runLength;
+            }
+            band.colors[color] += runLength;
+            j += runLength;
           }
         }
+      } );
+
+      colors.swap( bands[0].colors );
+      for ( int i = 1; i < bands.size(); ++i )
+      {
+        for ( auto colorIt = bands[i].colors.constBegin(); colorIt != bands[i].colors.constEnd(); ++colorIt )
+        {
+          colors[colorIt.key()] += colorIt.value();
+        }
       }
     }
 
@@ -251,73 +311,261 @@ namespace QgsWms
       colorBoxMap.insert( halfSum * 2.0 - currentSum, newColorBox2 );
     }
 
-  } // namespace
+    void medianCutColors( QVector<QRgb> &colorTable, int nColors, const QHash<QRgb, int> &inputColors )
+    {
+      if ( inputColors.size() <= nColors ) //all the colors in the image can be mapped to one palette color
+      {
+        colorTable.resize( inputColors.size() );
+        int index = 0;
+        for ( auto inputColorIt = inputColors.constBegin(); inputColorIt != inputColors.constEnd(); ++inputColorIt )
+        {
+          colorTable[index] = inputColorIt.key();
+          ++index;
+        }
+        return;
+      }
 
-  void medianCut( QVector<QRgb> &colorTable, int nColors, const QImage &inputImage )
-  {
-    QHash<QRgb, int> inputColors;
-    imageColors( inputColors, inputImage );
+      //create first box
+      QgsColorBox firstBox; //QList< QPair<QRgb, int> >
+      int firstBoxPixelSum = 0;
+      for ( auto  inputColorIt = inputColors.constBegin(); inputColorIt != inputColors.constEnd(); ++inputColorIt )
+      {
+        firstBox.push_back( qMakePair( inputColorIt.key(), inputColorIt.value() ) );
+        firstBoxPixelSum += inputColorIt.value();
+      }
 
-    if ( inputColors.size() <= nColors ) //all the colors in the image can be mapped to one palette color
-    {
-      colorTable.resize( inputColors.size() );
+      QgsColorBoxMap colorBoxMap; //QMultiMap< int, ColorBox >
+      colorBoxMap.insert( firstBoxPixelSum, firstBox );
+      QMap<int, QgsColorBox>::iterator colorBoxMapIt = colorBoxMap.end();
+
+      //split boxes until number of boxes == nColors or all the boxes have color count 1
+      bool allColorsMapped = false;
+      while ( colorBoxMap.size() < nColors )
+      {
+        //start at the end of colorBoxMap and pick the first entry with number of colors < 1
+        colorBoxMapIt = colorBoxMap.end();
+        while ( true )
+        {
+          --colorBoxMapIt;
+          if ( colorBoxMapIt.value().size() > 1 )
+          {
+            splitColorBox( colorBoxMapIt.value(), colorBoxMap, colorBoxMapIt );
+            break;
+          }
+          if ( colorBoxMapIt == colorBoxMap.begin() )
+          {
+            allColorsMapped = true;
+            break;
+          }
+        }
+
+        if ( allColorsMapped )
+        {
+          break;
+        }
+      }
+
+      //get representative colors for the boxes
       int index = 0;
-      for ( auto inputColorIt = inputColors.constBegin(); inputColorIt != inputColors.constEnd(); ++inputColorIt )
+      colorTable.resize( colorBoxMap.size() );
+      for ( auto colorBoxIt = colorBoxMap.constBegin(); colorBoxIt != colorBoxMap.constEnd(); ++colorBoxIt )
       {
-        colorTable[index] = inputColorIt.key();
+        colorTable[index] = boxColor( colorBoxIt.value(), colorBoxIt.key() );
         ++index;
       }
-      return;
     }
 
-    //create first box
-    QgsColorBox firstBox; //QList< QPair<QRgb, int> >
-    int firstBoxPixelSum = 0;
-    for ( auto  inputColorIt = inputColors.constBegin(); inputColorIt != inputColors.constEnd(); ++inputColorIt )
+    //! Palette colors stored by channel, the distances to all the colors are computed by vector instructions
+    struct PaletteChannels
+    {
+      explicit PaletteChannels( const QVector<QRgb> &colorTable )
+      {
+        for ( QRgb color : colorTable )
+        {
+          red << qRed( color );
+          green << qGreen( color );
+          blue << qBlue( color );
+          alpha << qAlpha( color );
+        }
+      }
+
+      QVector<int> red;
+      QVector<int> green;
+      QVector<int> blue;
+      QVector<int> alpha;
+    };
+
+    //! Returns the index of the palette color closest to \a color, using the same distance as QImage::convertToFormat()
+    int nearestColorIndex( QRgb color, const PaletteChannels &palette, int *distances )
     {
-      firstBox.push_back( qMakePair( inputColorIt.key(), inputColorIt.value() ) );
-      firstBoxPixelSum += inputColorIt.value();
+      const int count = palette.red.size();
+      const int *red = palette.red.constData();
+      const int *green = palette.green.constData();
+      const int *blue = palette.blue.constData();
+      const int *alpha = palette.alpha.constData();
+      const int r = qRed( color );
+      const int g = qGreen( color );
+      const int b = qBlue( color );
+      const int a = qAlpha( color );
+
+      for ( int i = 0; i < count; ++i )
+      {
+        distances[i] = std::abs( red[i] - r ) + std::abs( green[i] - g ) + std::abs( blue[i] - b ) + std::abs( alpha[i] - a );
+      }
+      return std::min_element( distances, distances + count ) - distances;
     }
 
-    QgsColorBoxMap colorBoxMap; //QMultiMap< int, ColorBox >
-    colorBoxMap.insert( firstBoxPixelSum, firstBox );
-    QMap<int, QgsColorBox>::iterator colorBoxMapIt = colorBoxMap.end();
+    //! Returns the index of the palette color closest to each color
+    QVector<int> nearestColorIndexes( const QVector<QRgb> &colors, const QVector<QRgb> &colorTable )
+    {
+      const PaletteChannels palette( colorTable );
+      const int paletteSize = colorTable.size();
+      QVector<int> indexes( colors.size() );
+      int *indexData = indexes.data();
 
-    //split boxes until number of boxes == nColors or all the boxes have color count 1
-    bool allColorsMapped = false;
-    while ( colorBoxMap.size() < nColors )
+      QVector<Band> bands = createBands( colors.size(), colors.size() >= PARALLEL_COLOR_COUNT );
+      processBands( bands, [&colors, &palette, paletteSize, indexData]( Band & band )
+      {
+        QVector<int> distances( paletteSize );
+        for ( int i = band.begin; i < band.end; ++i )
+        {
+          indexData[i] = nearestColorIndex( colors.at( i ), palette, distances.data() );
+        }
+      } );
+      return indexes;
+    }
+
+    //! Moves each palette color to the mean of the colors closest to it (k-means iterations)
+    void refinePalette( QVector<QRgb> &colorTable, const QVector<QRgb> &colors, const QVector<int> &pixelCounts, int iterations )
     {
-      //start at the end of colorBoxMap and pick the first entry with number of colors < 1
-      colorBoxMapIt = colorBoxMap.end();
-      while ( true )
+      for ( int iteration = 0; iteration < iterations; ++iteration )
       {
-        --colorBoxMapIt;
-        if ( colorBoxMapIt.value().size() > 1 )
+        const QVector<int> indexes = nearestColorIndexes( colors, colorTable );
+
+        QVector<double> sums( colorTable.size() * 4, 0.0 );
+        QVector<double> pixelSums( colorTable.size(), 0.0 );
+        for ( int i = 0; i < colors.size(); ++i )
         {
-          splitColorBox( colorBoxMapIt.value(), colorBoxMap, colorBoxMapIt );
-          break;
+          const int index = indexes.at( i );
+          const double pixels = pixelCounts.at( i );
+          sums[index * 4] += qRed( colors.at( i ) ) * pixels;
+          sums[index * 4 + 1] += qGreen( colors.at( i ) ) * pixels;
+          sums[index * 4 + 2] += qBlue( colors.at( i ) ) * pixels;
+          sums[index * 4 + 3] += qAlpha( colors.at( i ) ) * pixels;
+          pixelSums[index] += pixels;
+        }
+
+        bool changed = false;
+        for ( int i = 0; i < colorTable.size(); ++i )
+        {
+          if ( pixelSums.at( i ) <= 0 )
+          {
+            continue;
+          }
+
+          const QRgb mean = qRgba( qRound( sums.at( i * 4 ) / pixelSums.at( i ) ),
+                                   qRound( sums.at( i * 4 + 1 ) / pixelSums.at( i ) ),
+                                   qRound( sums.at( i * 4 + 2 ) / pixelSums.at( i ) ),
+                                   qRound( sums.at( i * 4 + 3 ) / pixelSums.at( i ) ) );
+          if ( mean != colorTable.at( i ) )
+          {
+            colorTable[i] = mean;
+            changed = true;
+          }
         }
-        if ( colorBoxMapIt == colorBoxMap.begin() )
+
+        if ( !changed )
         {
-          allColorsMapped = true;
           break;
         }
       }
+    }
 
-      if ( allColorsMapped )
-      {
-        break;
-      }
+  } // namespace
+
+  void medianCut( QVector<QRgb> &colorTable, int nColors, const QImage &inputImage )
+  {
+    QHash<QRgb, int> inputColors;
+    imageColors( inputColors, inputImage );
+    medianCutColors( colorTable, nColors, inputColors );
+  }
+
+  QImage quantizeImage( const QImage &inputImage, int nColors, int refinementIterations )
+  {
+    // premultiplied images are converted too, convertToFormat() matched unpremultiplied colors against the palette
+    const bool argb = inputImage.format() == QImage::Format_ARGB32 || inputImage.format() == QImage::Format_RGB32;
+    const QImage image = argb ? inputImage : inputImage.convertToFormat( QImage::Format_ARGB32 );
+    nColors = std::min( nColors, 256 );
+
+    QHash<QRgb, int> inputColors;
+    imageColors( inputColors, image );
+
+    QVector<QRgb> colorTable;
+    medianCutColors( colorTable, nColors, inputColors );
+
+    QVector<QRgb> colors;
+    QVector<int> pixelCounts;
+    colors.reserve( inputColors.size() );
+    pixelCounts.reserve( inputColors.size() );
+    for ( auto inputColorIt = inputColors.constBegin(); inputColorIt != inputColors.constEnd(); ++inputColorIt )
+    {
+      colors << inputColorIt.key();
+      pixelCounts << inputColorIt.value();
+    }
+
+    if ( colors.size() > nColors )
+    {
+      refinePalette( colorTable, colors, pixelCounts, refinementIterations );
     }
 
-    //get representative colors for the boxes
-    int index = 0;
-    colorTable.resize( colorBoxMap.size() );
-    for ( auto colorBoxIt = colorBoxMap.constBegin(); colorBoxIt != colorBoxMap.constEnd(); ++colorBoxIt )
+    // the histogram becomes the lookup table of the palette index of each image color,
+    // iterating over the unchanged hash gives the colors in the same order
+    const QVector<int> indexes = nearestColorIndexes( colors, colorTable );
+    int colorIndex = 0;
+    for ( auto inputColorIt = inputColors.begin(); inputColorIt != inputColors.end(); ++inputColorIt, ++colorIndex )
     {
-      colorTable[index] = boxColor( colorBoxIt.value(), colorBoxIt.key() );
-      ++index;
+      inputColorIt.value() = indexes.at( colorIndex );
     }
+    const QHash<QRgb, int> &paletteIndexes = inputColors;
+
+    QImage result( image.size(), QImage::Format_Indexed8 );
+    if ( result.isNull() )
+    {
+      return QImage();
+    }
+    result.setColorTable( colorTable );
+    result.setDotsPerMeterX( image.dotsPerMeterX() );
+    result.setDotsPerMeterY( image.dotsPerMeterY() );
+    result.setOffset( image.offset() );
+
+    const int width = image.width();
+    const int bytesPerLine = image.bytesPerLine();
+    const uchar *bits = image.constBits();
+    const int resultBytesPerLine = result.bytesPerLine();
+    uchar *resultBits = result.bits();
+
+    QVector<Band> bands = createBands( image.height(), width * image.height() >= PARALLEL_PIXEL_COUNT );
+    processBands( bands, [&paletteIndexes, width, bytesPerLine, bits, resultBytesPerLine, resultBits]( Band & band )
+    {
+      for ( int i = band.begin; i < band.end; ++i )
+      {
+        const QRgb *scanLine = reinterpret_cast< const QRgb * >( bits + i * bytesPerLine );
+        uchar *resultScanLine = resultBits + i * resultBytesPerLine;
+        QRgb previousColor = 0;
+        int index = 0;
+        for ( int j = 0; j < width; ++j )
+        {
+          if ( j == 0 || scanLine[j] != previousColor )
+          {
+            previousColor = scanLine[j];
+            index = paletteIndexes.value( previousColor );
+          }
+          resultScanLine[j] = static_cast< uchar >( index );
+        }
+      }
+    } );
+
+    return result;
   }
 
 } // namespace QgsWms
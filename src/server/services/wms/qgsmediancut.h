@@ -39,6 +39,19 @@ namespace QgsWms
    */
   void medianCut( QVector<QRgb> &colorTable, int nColors, const QImage &inputImage );
 
+  /**
+   * Reduces the colors of an image to a median cut palette, and returns the 8 bit
+   * indexed image. Pixels are mapped to the closest palette color as done by
+   * QImage::convertToFormat(), large images are processed by several threads.
+   * \param inputImage the image, converted to QImage::Format_ARGB32 unless it is already
+   * QImage::Format_ARGB32 or QImage::Format_RGB32
+   * \param nColors the maximum number of colors, up to 256
+   * \param refinementIterations the number of k-means iterations moving each palette
+   * color to the mean of the image colors closest to it
+   * \since QGIS 3.0
+   */
+  QImage quantizeImage( const QImage &inputImage, int nColors, int refinementIterations = 0 );
+
 } // namespace QgsWms
 
 #endif
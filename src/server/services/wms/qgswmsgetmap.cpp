@@ -21,6 +21,7 @@
 #include "qgswmsutils.h"
 #include "qgswmsgetmap.h"
 #include "qgswmsrenderer.h"
+#include "qgswmstilecache.h"
 
 #include <QImage>
 
@@ -35,12 +36,24 @@ namespace QgsWms
 
     QgsServerRequest::Parameters params = request.parameters();
     QgsRenderer renderer( serverIface, project, params, getConfigParser( serverIface ) );
+    QString format = params.value( QStringLiteral( "FORMAT" ), QStringLiteral( "PNG" ) );
+
+    // tile requests are cut from metatiles when the tile mode is enabled
+    QgsWmsTileCache *tileCache = QgsWmsTileCache::instance( *serverIface->serverSettings() );
+    if ( tileCache )
+    {
+      QImage tile = tileCache->tile( serverIface, project, params );
+      if ( !tile.isNull() )
+      {
+        writeImage( response, tile, format, renderer.getImageQuality(), serverIface->serverSettings()->wmsPaletteIterations() );
+        return;
+      }
+    }
 
     std::unique_ptr<QImage> result( renderer.getMap() );
     if ( result )
     {
-      QString format = params.value( QStringLiteral( "FORMAT" ), QStringLiteral( "PNG" ) );
-      writeImage( response, *result, format, renderer.getImageQuality() );
+      writeImage( response, *result, format, renderer.getImageQuality(), serverIface->serverSettings()->wmsPaletteIterations() );
     }
     else
     {
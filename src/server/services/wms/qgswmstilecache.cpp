@@ -0,0 +1,284 @@
+/***************************************************************************
+                              qgswmstilecache.cpp
+                              -------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by QGIS Development Team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgswmstilecache.h"
+#include "qgswmsutils.h"
+#include "qgswmsparameters.h"
+#include "qgswmsrenderer.h"
+#include "qgsaccesscontrol.h"
+#include "qgsconfigcache.h"
+#include "qgscoordinatereferencesystem.h"
+#include "qgsmessagelog.h"
+#include "qgsserverinterface.h"
+#include "qgsserverprojectutils.h"
+#include "qgsserversettings.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace QgsWms
+{
+
+  QgsWmsMemoryTileCache::QgsWmsMemoryTileCache( qint64 maximumSize )
+    : mTiles( static_cast<int>( std::min<qint64>( maximumSize, std::numeric_limits<int>::max() ) ) )
+  {
+  }
+
+  QImage QgsWmsMemoryTileCache::tile( const QString &projectPath, const QString &key )
+  {
+    QImage *image = mTiles.object( projectPath + '\n' + key );
+    return image ? *image : QImage();
+  }
+
+  void QgsWmsMemoryTileCache::insertTile( const QString &projectPath, const QString &key, const QImage &tile )
+  {
+    mTiles.insert( projectPath + '\n' + key, new QImage( tile ), tile.byteCount() );
+  }
+
+  void QgsWmsMemoryTileCache::removeProject( const QString &projectPath )
+  {
+    const QString prefix = projectPath + '\n';
+    Q_FOREACH ( const QString &key, mTiles.keys() )
+    {
+      if ( key.startsWith( prefix ) )
+        mTiles.remove( key );
+    }
+  }
+
+  QgsWmsDiskTileCache::QgsWmsDiskTileCache( const QString &directory )
+    : mDirectory( directory )
+  {
+  }
+
+  QImage QgsWmsDiskTileCache::tile( const QString &projectPath, const QString &key )
+  {
+    QImage image;
+    if ( !image.load( tileFile( projectPath, key ), "PNG" ) )
+      return QImage();
+
+    return image;
+  }
+
+  void QgsWmsDiskTileCache::insertTile( const QString &projectPath, const QString &key, const QImage &tile )
+  {
+    QDir().mkpath( projectDirectory( projectPath ) );
+
+    // the file is renamed once written, other server processes never read a partial tile
+    QSaveFile file( tileFile( projectPath, key ) );
+    if ( !file.open( QIODevice::WriteOnly ) || !tile.save( &file, "PNG" ) || !file.commit() )
+    {
+      QgsMessageLog::logMessage( QStringLiteral( "Cannot write tile file '%1'" ).arg( file.fileName() ),
+                                 QStringLiteral( "Server" ), QgsMessageLog::WARNING );
+    }
+  }
+
+  void QgsWmsDiskTileCache::removeProject( const QString &projectPath )
+  {
+    QDir( projectDirectory( projectPath ) ).removeRecursively();
+  }
+
+  QString QgsWmsDiskTileCache::projectDirectory( const QString &projectPath ) const
+  {
+    const QByteArray hash = QCryptographicHash::hash( projectPath.toUtf8(), QCryptographicHash::Md5 ).toHex();
+    return mDirectory + '/' + QString::fromLatin1( hash );
+  }
+
+  QString QgsWmsDiskTileCache::tileFile( const QString &projectPath, const QString &key ) const
+  {
+    const QByteArray hash = QCryptographicHash::hash( key.toUtf8(), QCryptographicHash::Md5 ).toHex();
+    return projectDirectory( projectPath ) + '/' + QString::fromLatin1( hash ) + ".png";
+  }
+
+  //! Sets \a index to the position of the cell spanning from \a min to \a max, on a grid of cells of this size. Returns false if the cell is not aligned on the grid.
+  static bool gridIndex( double min, double max, qint64 &index )
+  {
+    const double size = max - min;
+    if ( size <= 0 )
+      return false;
+
+    const double position = min / size;
+    if ( std::fabs( position ) > 1e12 )
+      return false;
+
+    index = static_cast<qint64>( std::floor( position + 0.5 ) );
+    // coordinates far from the origin lose precision when clients compute the BBOX
+    return std::fabs( position - index ) < 1e-3;
+  }
+
+  //! Returns the index of the metatile of \a metatileSize tiles containing the tile \a index
+  static qint64 metatileIndex( qint64 index, int metatileSize )
+  {
+    return index >= 0 ? index / metatileSize : -( ( -index - 1 ) / metatileSize ) - 1;
+  }
+
+  //! Width in pixels of the gutter rendered around metatiles
+  static const int METATILE_GUTTER = 64;
+
+  QgsWmsTileCache *QgsWmsTileCache::instance( const QgsServerSettings &settings )
+  {
+    static QgsWmsTileCache *sInstance = nullptr;
+
+    if ( sInstance && !sInstance->hasSettings( settings ) )
+    {
+      delete sInstance;
+      sInstance = nullptr;
+    }
+
+    if ( !sInstance && settings.wmsMetatileSize() > 0 && settings.wmsTileSize() > 0 )
+      sInstance = new QgsWmsTileCache( settings );
+
+    return sInstance;
+  }
+
+  QgsWmsTileCache::QgsWmsTileCache( const QgsServerSettings &settings )
+    : mMetatileSize( settings.wmsMetatileSize() )
+    , mTileSize( settings.wmsTileSize() )
+    , mCacheDirectory( settings.wmsTileCacheDirectory() )
+    , mCacheSize( settings.wmsTileCacheSize() )
+  {
+    if ( mCacheDirectory.isEmpty() )
+      mBackend.reset( new QgsWmsMemoryTileCache( mCacheSize ) );
+    else
+      mBackend.reset( new QgsWmsDiskTileCache( mCacheDirectory ) );
+
+    connect( QgsConfigCache::instance(), &QgsConfigCache::entryRemoved, this, &QgsWmsTileCache::removeProject );
+  }
+
+  bool QgsWmsTileCache::hasSettings( const QgsServerSettings &settings ) const
+  {
+    return settings.wmsMetatileSize() == mMetatileSize && settings.wmsTileSize() == mTileSize
+           && settings.wmsTileCacheDirectory() == mCacheDirectory && settings.wmsTileCacheSize() == mCacheSize;
+  }
+
+  void QgsWmsTileCache::removeProject( const QString &projectPath )
+  {
+    mBackend->removeProject( projectPath );
+  }
+
+  QImage QgsWmsTileCache::tile( QgsServerInterface *serverIface, const QgsProject *project,
+                                const QgsServerRequest::Parameters &parameters )
+  {
+    QgsWmsParameters wmsParameters( parameters );
+    if ( wmsParameters.widthAsInt() != mTileSize || wmsParameters.heightAsInt() != mTileSize )
+      return QImage();
+
+    // the metatile and its gutter must be allowed by the project
+    const int metatilePixels = mMetatileSize * mTileSize + 2 * METATILE_GUTTER;
+    const int maxWidth = QgsServerProjectUtils::wmsMaxWidth( *project );
+    const int maxHeight = QgsServerProjectUtils::wmsMaxHeight( *project );
+    if ( ( maxWidth != -1 && metatilePixels > maxWidth ) || ( maxHeight != -1 && metatilePixels > maxHeight ) )
+      return QImage();
+
+    // BBOX values along the image axes, as read by QgsRenderer::configureMapSettings()
+    QgsRectangle extent = wmsParameters.bboxAsRectangle();
+    if ( extent.isEmpty() )
+      return QImage();
+
+    QString crs = wmsParameters.crs();
+    bool inverted = false;
+    if ( crs.compare( QLatin1String( "CRS:84" ), Qt::CaseInsensitive ) == 0 )
+    {
+      crs = QStringLiteral( "EPSG:4326" );
+      inverted = true;
+    }
+    if ( wmsParameters.versionAsNumber() >= QgsProjectVersion( 1, 3, 0 ) && QgsCoordinateReferenceSystem::fromOgcWmsCrs( crs ).hasAxisInverted() )
+      inverted = !inverted;
+    if ( inverted )
+      extent.invert();
+
+    qint64 column = 0;
+    qint64 row = 0;
+    if ( !gridIndex( extent.xMinimum(), extent.xMaximum(), column ) || !gridIndex( extent.yMinimum(), extent.yMaximum(), row ) )
+      return QImage();
+
+    // every parameter but the tile position changes the tiles
+    QStringList keyList;
+    QgsServerRequest::Parameters::const_iterator paramIt = parameters.constBegin();
+    for ( ; paramIt != parameters.constEnd(); ++paramIt )
+    {
+      if ( paramIt.key() != QLatin1String( "BBOX" ) && paramIt.key() != QLatin1String( "WIDTH" ) && paramIt.key() != QLatin1String( "HEIGHT" ) )
+        keyList << paramIt.key() + '=' + paramIt.value();
+    }
+
+#ifdef HAVE_SERVER_PYTHON_PLUGINS
+    QgsAccessControl *accessControl = serverIface->accessControls();
+    if ( accessControl && !accessControl->fillCacheKey( keyList ) )
+      return QImage();
+#endif
+
+    const QString projectPath = serverIface->configFilePath();
+    keyList << QString::number( QFileInfo( projectPath ).lastModified().toMSecsSinceEpoch() );
+    // clients compute the BBOX of each tile, the last digits of its size may differ
+    keyList << QString::number( extent.width(), 'g', 8 ) << QString::number( extent.height(), 'g', 8 );
+    const QString key = keyList.join( QStringLiteral( "&" ) );
+
+    QImage image = mBackend->tile( projectPath, key + QStringLiteral( "&%1,%2" ).arg( column ).arg( row ) );
+    if ( !image.isNull() )
+      return image;
+
+    const qint64 metatileColumn = metatileIndex( column, mMetatileSize );
+    const qint64 metatileRow = metatileIndex( row, mMetatileSize );
+    const double gutterWidth = METATILE_GUTTER * extent.width() / mTileSize;
+    const double gutterHeight = METATILE_GUTTER * extent.height() / mTileSize;
+    QgsRectangle metatileExtent( metatileColumn * mMetatileSize * extent.width() - gutterWidth,
+                                 metatileRow * mMetatileSize * extent.height() - gutterHeight,
+                                 ( metatileColumn + 1 ) * mMetatileSize * extent.width() + gutterWidth,
+                                 ( metatileRow + 1 ) * mMetatileSize * extent.height() + gutterHeight );
+    if ( inverted )
+      metatileExtent.invert();
+
+    QgsServerRequest::Parameters metatileParameters = parameters;
+    metatileParameters[ QStringLiteral( "BBOX" )] = QStringLiteral( "%1,%2,%3,%4" )
+        .arg( metatileExtent.xMinimum(), 0, 'g', 17 ).arg( metatileExtent.yMinimum(), 0, 'g', 17 )
+        .arg( metatileExtent.xMaximum(), 0, 'g', 17 ).arg( metatileExtent.yMaximum(), 0, 'g', 17 );
+    metatileParameters[ QStringLiteral( "WIDTH" )] = QString::number( metatilePixels );
+    metatileParameters[ QStringLiteral( "HEIGHT" )] = QString::number( metatilePixels );
+
+    QgsRenderer renderer( serverIface, project, metatileParameters, getConfigParser( serverIface ) );
+    std::unique_ptr<QImage> metatile( renderer.getMap() );
+    if ( !metatile || metatile->width() != metatilePixels || metatile->height() != metatilePixels )
+    {
+      throw QgsServiceException( QStringLiteral( "UnknownError" ),
+                                 QStringLiteral( "Failed to compute GetMap metatile image" ) );
+    }
+
+    // rows of the grid go up, rows of the image go down
+    for ( int i = 0; i < mMetatileSize; ++i )
+    {
+      for ( int j = 0; j < mMetatileSize; ++j )
+      {
+        const qint64 tileColumn = metatileColumn * mMetatileSize + i;
+        const qint64 tileRow = metatileRow * mMetatileSize + j;
+        QImage tile = metatile->copy( METATILE_GUTTER + i * mTileSize, METATILE_GUTTER + ( mMetatileSize - 1 - j ) * mTileSize,
+                                      mTileSize, mTileSize );
+        mBackend->insertTile( projectPath, key + QStringLiteral( "&%1,%2" ).arg( tileColumn ).arg( tileRow ), tile );
+
+        if ( tileColumn == column && tileRow == row )
+          image = tile;
+      }
+    }
+
+    return image;
+  }
+
+} // namespace QgsWms
@@ -0,0 +1,172 @@
+/***************************************************************************
+                              qgswmstilecache.h
+                              -------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by QGIS Development Team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSWMSTILECACHE_H
+#define QGSWMSTILECACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QObject>
+#include <memory>
+
+#include "qgsserverrequest.h"
+
+class QgsProject;
+class QgsServerInterface;
+class QgsServerSettings;
+
+namespace QgsWms
+{
+
+  /** \ingroup server
+    * Storage of the tiles rendered for WMS GetMap tile requests, by project
+    * file path and tile key.
+    * \since QGIS 3.0
+    */
+  class QgsWmsTileCacheBackend
+  {
+    public:
+
+      virtual ~QgsWmsTileCacheBackend() = default;
+
+      /** Returns the stored tile.
+        * \param projectPath the project file path
+        * \param key the key of the tile
+        * \returns the tile or a null image if it is not stored
+        */
+      virtual QImage tile( const QString &projectPath, const QString &key ) = 0;
+
+      /** Stores a tile.
+        * \param projectPath the project file path
+        * \param key the key of the tile
+        * \param tile the tile
+        */
+      virtual void insertTile( const QString &projectPath, const QString &key, const QImage &tile ) = 0;
+
+      /** Removes all the stored tiles of a project.
+        * \param projectPath the project file path
+        */
+      virtual void removeProject( const QString &projectPath ) = 0;
+  };
+
+  /** \ingroup server
+    * Keeps tiles in memory. The least recently used tiles are removed when
+    * the maximum size is exceeded.
+    * \since QGIS 3.0
+    */
+  class QgsWmsMemoryTileCache : public QgsWmsTileCacheBackend
+  {
+    public:
+
+      /** Constructor.
+        * \param maximumSize the maximum size of the tiles in bytes
+        */
+      explicit QgsWmsMemoryTileCache( qint64 maximumSize );
+
+      QImage tile( const QString &projectPath, const QString &key ) override;
+      void insertTile( const QString &projectPath, const QString &key, const QImage &tile ) override;
+      void removeProject( const QString &projectPath ) override;
+
+    private:
+      QCache<QString, QImage> mTiles;
+  };
+
+  /** \ingroup server
+    * Stores tiles as PNG files in a directory, with a sub-directory per
+    * project. The size of the directory is not limited.
+    * \since QGIS 3.0
+    */
+  class QgsWmsDiskTileCache : public QgsWmsTileCacheBackend
+  {
+    public:
+
+      /** Constructor.
+        * \param directory the directory of the tiles
+        */
+      explicit QgsWmsDiskTileCache( const QString &directory );
+
+      QImage tile( const QString &projectPath, const QString &key ) override;
+      void insertTile( const QString &projectPath, const QString &key, const QImage &tile ) override;
+      void removeProject( const QString &projectPath ) override;
+
+    private:
+      QString projectDirectory( const QString &projectPath ) const;
+      QString tileFile( const QString &projectPath, const QString &key ) const;
+
+      QString mDirectory;
+  };
+
+  /** \ingroup server
+    * Renders WMS GetMap tile requests as metatiles of N x N tiles, and keeps
+    * all the tiles of a metatile for the next requests. Labels are placed once
+    * for the whole metatile, so that labels crossing tile edges are consistent.
+    *
+    * Tile requests are GetMap requests whose WIDTH and HEIGHT are the tile size
+    * and whose BBOX is aligned on a grid anchored at the origin of the CRS
+    * (e.g. the usual EPSG:3857 and EPSG:4326 grids). Tiles are stored by project
+    * file path and by a key made of the tile position, the file modification
+    * time and all the other request parameters (layers, styles, filters...).
+    * Tiles of a project are removed when QgsConfigCache removes its entries.
+    *
+    * Metatiles are rendered with a gutter around them, which is cropped, so
+    * that symbols and labels of features close to their edges are drawn.
+    * \since QGIS 3.0
+    */
+  class QgsWmsTileCache : public QObject
+  {
+      Q_OBJECT
+
+    public:
+
+      /** Returns the tile cache. The cache is created again when the tile
+        * settings change, e.g. with QgsServer::putenv().
+        * \param settings the server settings
+        * \returns the tile cache or nullptr if the tile mode is disabled
+        */
+      static QgsWmsTileCache *instance( const QgsServerSettings &settings );
+
+      /** Returns the image of a GetMap tile request, rendering its metatile if
+        * the tile is not stored yet.
+        * \param serverIface the server interface
+        * \param project the project
+        * \param parameters the GetMap request parameters
+        * \returns the tile or a null image if the request is not a tile request
+        * and must be rendered alone
+        * \throws QgsServiceException if the metatile cannot be rendered
+        */
+      QImage tile( QgsServerInterface *serverIface, const QgsProject *project,
+                   const QgsServerRequest::Parameters &parameters );
+
+    private slots:
+      //! Removes the stored tiles of a project
+      void removeProject( const QString &projectPath );
+
+    private:
+      explicit QgsWmsTileCache( const QgsServerSettings &settings );
+
+      //! Returns true if the cache was created with the tile settings of \a settings
+      bool hasSettings( const QgsServerSettings &settings ) const;
+
+      int mMetatileSize;
+      int mTileSize;
+      QString mCacheDirectory;
+      qint64 mCacheSize;
+      std::unique_ptr<QgsWmsTileCacheBackend> mBackend;
+  };
+
+} // namespace QgsWms
+
+#endif
@@ -118,7 +118,7 @@ namespace QgsWms
 
   // Write image response
   void writeImage( QgsServerResponse &response, QImage &img, const QString &formatStr,
-                   int imageQuality )
+                   int imageQuality, int paletteIterations )
   {
     ImageOutputFormat outputFormat = parseImageFormat( formatStr );
     QImage  result;
@@ -132,16 +132,10 @@ namespace QgsWms
         saveFormat = "PNG";
         break;
       case PNG8:
-      {
-        QVector<QRgb> colorTable;
-        medianCut( colorTable, 256, img );
-        result = img.convertToFormat( QImage::Format_Indexed8, colorTable,
-                                      Qt::ColorOnly | Qt::ThresholdDither |
-                                      Qt::ThresholdAlphaDither | Qt::NoOpaqueDetection );
-      }
-      contentType = "image/png";
-      saveFormat = "PNG";
-      break;
+        result = quantizeImage( img, 256, paletteIterations );
+        contentType = "image/png";
+        saveFormat = "PNG";
+        break;
       case PNG16:
         result = img.convertToFormat( QImage::Format_ARGB4444_Premultiplied );
         contentType = "image/png";
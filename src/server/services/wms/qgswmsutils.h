@@ -70,9 +70,10 @@ namespace QgsWms
   ImageOutputFormat parseImageFormat( const QString &format );
 
   /** Write image response
+   * \param paletteIterations the number of k-means iterations refining the palette of 8 bit PNG images
    */
   void writeImage( QgsServerResponse &response, QImage &img, const QString &formatStr,
-                   int imageQuality = -1 );
+                   int imageQuality = -1, int paletteIterations = 0 );
 
   /**
    * Parse bbox parameter
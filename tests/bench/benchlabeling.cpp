@@ -0,0 +1,196 @@
+/***************************************************************************
+  benchlabeling.cpp
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+/*
+ * Benchmarks of the labeling engine on a dense city map: many small, overlapping
+ * label candidates. Run the executable with the usual QTestLib options (e.g. -iterations,
+ * -callgrind), on builds before and after a change to compare them.
+ */
+
+#include "qgstest.h"
+#include <QObject>
+
+#include "qgsapplication.h"
+#include "qgsmaprenderersequentialjob.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+#include "qgsvectorlayerlabeling.h"
+#include "pal/packedrtree.h"
+#include "pal/rtree.hpp"
+
+#include <vector>
+
+//! Bounding box of a label candidate, as stored in the labeling indexes
+struct BenchBox
+{
+  double min[2];
+  double max[2];
+
+  void getBoundingBox( double amin[2], double amax[2] ) const
+  {
+    amin[0] = min[0];
+    amin[1] = min[1];
+    amax[0] = max[0];
+    amax[1] = max[1];
+  }
+};
+
+static bool countCallback( BenchBox *, void *ctx )
+{
+  ++*static_cast< int * >( ctx );
+  return true;
+}
+
+class BenchLabeling : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void rtreeBuild();
+    void packedRTreeBuild();
+    void rtreeSearch();
+    void packedRTreeSearch();
+    void labelDenseCity();
+
+  private:
+    //! Candidate boxes: 8 candidates around each of 25000 points spread over a city block grid
+    std::vector< BenchBox > mBoxes;
+    std::vector< BenchBox * > mBoxPointers;
+    QgsVectorLayer *mCityLayer = nullptr;
+};
+
+void BenchLabeling::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  const int pointCount = 25000;
+  const double labelWidth = 40;
+  const double labelHeight = 8;
+  mBoxes.reserve( pointCount * 8 );
+
+  // points on a 10000 x 10000 city, with a deterministic pseudo random jitter
+  mCityLayer = new QgsVectorLayer( QStringLiteral( "Point?field=name:string" ), QStringLiteral( "city" ), QStringLiteral( "memory" ) );
+  QgsFeatureList features;
+  quint32 seed = 1;
+  for ( int i = 0; i < pointCount; ++i )
+  {
+    seed = seed * 1103515245 + 12345;
+    const double x = ( i % 158 ) * 63.0 + ( seed >> 16 ) % 40;
+    seed = seed * 1103515245 + 12345;
+    const double y = ( i / 158 ) * 63.0 + ( seed >> 16 ) % 40;
+
+    for ( int candidate = 0; candidate < 8; ++candidate )
+    {
+      const double dx = ( candidate % 3 - 1 ) * labelWidth / 2;
+      const double dy = ( candidate / 3 - 1 ) * labelHeight;
+      BenchBox box = { { x + dx, y + dy }, { x + dx + labelWidth, y + dy + labelHeight } };
+      mBoxes.push_back( box );
+    }
+
+    QgsFeature f( mCityLayer->fields() );
+    f.setAttribute( 0, QStringLiteral( "Street %1" ).arg( i ) );
+    f.setGeometry( QgsGeometry::fromPoint( QgsPointXY( x, y ) ) );
+    features << f;
+  }
+  mCityLayer->dataProvider()->addFeatures( features );
+
+  for ( BenchBox &box : mBoxes )
+    mBoxPointers.push_back( &box );
+}
+
+void BenchLabeling::cleanupTestCase()
+{
+  delete mCityLayer;
+  QgsApplication::exitQgis();
+}
+
+void BenchLabeling::rtreeBuild()
+{
+  QBENCHMARK
+  {
+    pal::RTree< BenchBox *, double, 2, double > index;
+    for ( BenchBox *box : mBoxPointers )
+      index.Insert( box->min, box->max, box );
+  }
+}
+
+void BenchLabeling::packedRTreeBuild()
+{
+  QBENCHMARK
+  {
+    pal::PackedRTree< BenchBox * > index;
+    index.BulkLoad( mBoxPointers );
+  }
+}
+
+void BenchLabeling::rtreeSearch()
+{
+  pal::RTree< BenchBox *, double, 2, double > index;
+  for ( BenchBox *box : mBoxPointers )
+    index.Insert( box->min, box->max, box );
+
+  int found = 0;
+  QBENCHMARK
+  {
+    // conflicts of each candidate, as counted by Pal::extract()
+    found = 0;
+    for ( BenchBox *box : mBoxPointers )
+      index.Search( box->min, box->max, countCallback, &found );
+  }
+  QVERIFY( found > 0 );
+}
+
+void BenchLabeling::packedRTreeSearch()
+{
+  pal::PackedRTree< BenchBox * > index;
+  index.BulkLoad( mBoxPointers );
+
+  int found = 0;
+  QBENCHMARK
+  {
+    found = 0;
+    for ( BenchBox *box : mBoxPointers )
+      index.Search( box->min, box->max, countCallback, &found );
+  }
+  QVERIFY( found > 0 );
+}
+
+void BenchLabeling::labelDenseCity()
+{
+  QgsPalLayerSettings settings;
+  settings.fieldName = QStringLiteral( "name" );
+  settings.placement = QgsPalLayerSettings::AroundPoint;
+  mCityLayer->setLabeling( new QgsVectorLayerSimpleLabeling( settings ) );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( QSize( 2000, 2000 ) );
+  mapSettings.setExtent( mCityLayer->extent() );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << mCityLayer );
+  mapSettings.setOutputDpi( 96 );
+
+  QBENCHMARK
+  {
+    QgsMapRendererSequentialJob job( mapSettings );
+    job.start();
+    job.waitForFinished();
+  }
+
+  mCityLayer->setLabeling( nullptr );
+}
+
+QGSTEST_MAIN( BenchLabeling )
+#include "benchlabeling.moc"
@@ -0,0 +1,290 @@
+/***************************************************************************
+  testqgsinterpolator.cpp
+  -----------------------
+Date                 : October 2017
+Copyright            : (C) 2017 by QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgstest.h"
+
+#include <cmath>
+#include <memory>
+
+//header for class being tested
+#include "qgsgridfilewriter.h"
+#include "qgsidwinterpolator.h"
+#include "qgsrasterdataprovider.h"
+#include "qgsrasterlayer.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+#include <qgsapplication.h>
+
+#include <QTemporaryDir>
+
+/**
+ * Reimplements interpolatePoint(), so the grid file writer must not interpolate points
+ * concurrently with the inherited interpolatePointConcurrently().
+ */
+class OffsetInterpolator : public QgsIDWInterpolator
+{
+  public:
+    explicit OffsetInterpolator( const QList<QgsInterpolator::LayerData> &layerData )
+      : QgsIDWInterpolator( layerData )
+    {
+      setConcurrentInterpolationEnabled( false );
+    }
+
+    int interpolatePoint( double x, double y, double &result ) override
+    {
+      const int error = QgsIDWInterpolator::interpolatePoint( x, y, result );
+      result += 100;
+      return error;
+    }
+};
+
+class TestQgsInterpolator : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void init() {} // will be called before each testfunction is executed.
+    void cleanup() {} // will be called after every testfunction.
+    void idw();
+    void idwIntegerPowers();
+    void idwNearestNeighbors();
+    void idwSearchRadius();
+    void gridFileWriter_data();
+    void gridFileWriter();
+    void gridFileWriterSerial();
+
+  private:
+
+    //! Points with values 1 at (0 0), 2 at (10 0), 3 at (0 10) and 4 at (10 10)
+    std::unique_ptr< QgsVectorLayer > mLayer;
+
+    QList< QgsInterpolator::LayerData > layerData() const;
+};
+
+void TestQgsInterpolator::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mLayer.reset( new QgsVectorLayer( QStringLiteral( "Point?crs=EPSG:3857&field=value:double" ), QStringLiteral( "points" ), QStringLiteral( "memory" ) ) );
+  QVERIFY( mLayer->isValid() );
+
+  QgsFeatureList features;
+  const double coords[4][3] = { { 0, 0, 1 }, { 10, 0, 2 }, { 0, 10, 3 }, { 10, 10, 4 } };
+  for ( int i = 0; i < 4; ++i )
+  {
+    QgsFeature f( mLayer->fields() );
+    f.setGeometry( QgsGeometry::fromPoint( QgsPointXY( coords[i][0], coords[i][1] ) ) );
+    f.setAttribute( 0, coords[i][2] );
+    features << f;
+  }
+  QVERIFY( mLayer->dataProvider()->addFeatures( features ) );
+}
+
+void TestQgsInterpolator::cleanupTestCase()
+{
+  mLayer.reset();
+  QgsApplication::exitQgis();
+}
+
+QList< QgsInterpolator::LayerData > TestQgsInterpolator::layerData() const
+{
+  QgsInterpolator::LayerData data;
+  data.vectorLayer = mLayer.get();
+  data.zCoordInterpolation = false;
+  data.interpolationAttribute = 0;
+  data.mInputType = QgsInterpolator::POINTS;
+  return QList< QgsInterpolator::LayerData >() << data;
+}
+
+void TestQgsInterpolator::idw()
+{
+  QgsIDWInterpolator interpolator( layerData() );
+  double result = 0;
+
+  // data points are returned as is
+  QCOMPARE( interpolator.interpolatePoint( 10, 0, result ), 0 );
+  QCOMPARE( result, 2.0 );
+
+  // equal distance to all points
+  QCOMPARE( interpolator.interpolatePoint( 5, 5, result ), 0 );
+  QGSCOMPARENEAR( result, 2.5, 0.0000001 );
+
+  // 1 / d^2 weights of 1/4, 1/36, 1/16 and 1/52
+  QCOMPARE( interpolator.interpolatePoint( 2, 0, result ), 0 );
+  const double expected = ( 1.0 / 4 + 2.0 / 64 + 3.0 / 104 + 4.0 / 164 ) / ( 1.0 / 4 + 1.0 / 64 + 1.0 / 104 + 1.0 / 164 );
+  QGSCOMPARENEAR( result, expected, 0.0000001 );
+}
+
+void TestQgsInterpolator::idwIntegerPowers()
+{
+  QgsIDWInterpolator interpolator( layerData() );
+
+  // integer powers use dedicated weight functions, compare them with the generic one
+  for ( double power = 1.0; power <= 3.0; power += 1.0 )
+  {
+    interpolator.setDistanceCoefficient( power );
+    double result = 0;
+    QCOMPARE( interpolator.interpolatePoint( 3, 1, result ), 0 );
+
+    const double d[4] = { std::sqrt( 10.0 ), std::sqrt( 50.0 ), std::sqrt( 90.0 ), std::sqrt( 130.0 ) };
+    double sumCounter = 0;
+    double sumDenominator = 0;
+    for ( int i = 0; i < 4; ++i )
+    {
+      const double weight = 1.0 / std::pow( d[i], power );
+      sumCounter += weight * ( i + 1 );
+      sumDenominator += weight;
+    }
+    QGSCOMPARENEAR( result, sumCounter / sumDenominator, 0.0000001 );
+  }
+}
+
+void TestQgsInterpolator::idwNearestNeighbors()
+{
+  QgsIDWInterpolator interpolator( layerData() );
+  interpolator.setMaxNeighborCount( 1 );
+  QCOMPARE( interpolator.maxNeighborCount(), 1 );
+
+  double result = 0;
+  QCOMPARE( interpolator.interpolatePoint( 1, 2, result ), 0 );
+  QCOMPARE( result, 1.0 );
+  QCOMPARE( interpolator.interpolatePoint( 9, 8, result ), 0 );
+  QCOMPARE( result, 4.0 );
+
+  // two nearest points at equal distance
+  interpolator.setMaxNeighborCount( 2 );
+  QCOMPARE( interpolator.interpolatePoint( 5, 1, result ), 0 );
+  QGSCOMPARENEAR( result, 1.5, 0.0000001 );
+
+  // more neighbors than points
+  interpolator.setMaxNeighborCount( 10 );
+  QCOMPARE( interpolator.interpolatePoint( 5, 5, result ), 0 );
+  QGSCOMPARENEAR( result, 2.5, 0.0000001 );
+}
+
+void TestQgsInterpolator::idwSearchRadius()
+{
+  QgsIDWInterpolator interpolator( layerData() );
+  interpolator.setSearchRadius( 6 );
+  QCOMPARE( interpolator.searchRadius(), 6.0 );
+
+  double result = 0;
+  QCOMPARE( interpolator.interpolatePoint( 0, 5, result ), 0 );
+  QGSCOMPARENEAR( result, 2.0, 0.0000001 );
+
+  // no data point within the radius
+  QCOMPARE( interpolator.interpolatePoint( 5, 5, result ), 1 );
+
+  // radius combined with a maximum number of neighbors
+  interpolator.setSearchRadius( 100 );
+  interpolator.setMaxNeighborCount( 1 );
+  QCOMPARE( interpolator.interpolatePoint( 8, 9, result ), 0 );
+  QCOMPARE( result, 4.0 );
+}
+
+void TestQgsInterpolator::gridFileWriter_data()
+{
+  QTest::addColumn< int >( "format" );
+  QTest::addColumn< QString >( "fileName" );
+
+  QTest::newRow( "ascii" ) << static_cast< int >( QgsGridFileWriter::AsciiGrid ) << "idw.asc";
+  QTest::newRow( "geotiff" ) << static_cast< int >( QgsGridFileWriter::GeoTiff ) << "idw.tif";
+}
+
+void TestQgsInterpolator::gridFileWriter()
+{
+  QFETCH( int, format );
+  QFETCH( QString, fileName );
+
+  QTemporaryDir dir;
+  QVERIFY( dir.isValid() );
+  const QString path = dir.path() + '/' + fileName;
+
+  // more rows than a single band, so that bands are interpolated in parallel
+  const int columns = 1500;
+  const int rows = 100;
+  const QgsRectangle extent( -5, -5, 15, 15 );
+  QgsIDWInterpolator interpolator( layerData() );
+  interpolator.setSearchRadius( 8 );
+  QgsGridFileWriter writer( &interpolator, path, extent, columns, rows, extent.width() / columns, extent.height() / rows );
+  writer.setFormat( static_cast< QgsGridFileWriter::Format >( format ) );
+  QCOMPARE( writer.format(), static_cast< QgsGridFileWriter::Format >( format ) );
+  QCOMPARE( writer.writeFile(), 0 );
+
+  QgsRasterLayer layer( path, QStringLiteral( "grid" ), QStringLiteral( "gdal" ) );
+  QVERIFY( layer.isValid() );
+  QCOMPARE( layer.width(), columns );
+  QCOMPARE( layer.height(), rows );
+  std::unique_ptr< QgsRasterBlock > block( layer.dataProvider()->block( 1, layer.extent(), columns, rows ) );
+  QVERIFY( block );
+
+  for ( int row = 0; row < rows; row += 7 )
+  {
+    for ( int column = 0; column < columns; column += 13 )
+    {
+      double expected = 0;
+      const double x = extent.xMinimum() + ( column + 0.5 ) * extent.width() / columns;
+      const double y = extent.yMaximum() - ( row + 0.5 ) * extent.height() / rows;
+      if ( interpolator.interpolatePoint( x, y, expected ) == 0 )
+      {
+        QGSCOMPARENEAR( block->value( row, column ), expected, 0.0001 );
+      }
+      else
+      {
+        QVERIFY( block->isNoData( row, column ) );
+      }
+    }
+  }
+}
+
+void TestQgsInterpolator::gridFileWriterSerial()
+{
+  QTemporaryDir dir;
+  QVERIFY( dir.isValid() );
+  const QString path = dir.path() + "/offset.asc";
+
+  QgsIDWInterpolator idw( layerData() );
+  QVERIFY( idw.prepareForConcurrentInterpolation() );
+  OffsetInterpolator interpolator( layerData() );
+  QVERIFY( !interpolator.prepareForConcurrentInterpolation() );
+
+  // points are interpolated with the reimplemented interpolatePoint()
+  const int columns = 1500;
+  const int rows = 100;
+  const QgsRectangle extent( -5, -5, 15, 15 );
+  QgsGridFileWriter writer( &interpolator, path, extent, columns, rows, extent.width() / columns, extent.height() / rows );
+  QCOMPARE( writer.writeFile(), 0 );
+
+  QgsRasterLayer layer( path, QStringLiteral( "grid" ), QStringLiteral( "gdal" ) );
+  QVERIFY( layer.isValid() );
+  std::unique_ptr< QgsRasterBlock > block( layer.dataProvider()->block( 1, layer.extent(), columns, rows ) );
+  QVERIFY( block );
+
+  for ( int row = 0; row < rows; row += 7 )
+  {
+    for ( int column = 0; column < columns; column += 13 )
+    {
+      double expected = 0;
+      const double x = extent.xMinimum() + ( column + 0.5 ) * extent.width() / columns;
+      const double y = extent.yMaximum() - ( row + 0.5 ) * extent.height() / rows;
+      QCOMPARE( idw.interpolatePoint( x, y, expected ), 0 );
+      QGSCOMPARENEAR( block->value( row, column ), expected + 100, 0.0001 );
+    }
+  }
+}
+
+QGSTEST_MAIN( TestQgsInterpolator )
+#include "testqgsinterpolator.moc"
@@ -0,0 +1,491 @@
+/***************************************************************************
+  testqgsnetworkanalysis.cpp
+  --------------------------
+Date                 : October 2017
+Copyright            : (C) 2017 by QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgstest.h"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+
+//header for class being tested
+#include "qgsgraph.h"
+#include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
+#include "qgscontractionhierarchy.h"
+#include "qgsfeedback.h"
+#include "qgsgraphbuilder.h"
+#include "qgsnetworkdistancestrategy.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+#include "qgsvectorlayerdirector.h"
+#include <qgsapplication.h>
+
+#include <QDataStream>
+#include <QFile>
+#include <QTemporaryFile>
+
+class TestQgsNetworkAnalysis : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void init() {} // will be called before each testfunction is executed.
+    void cleanup() {} // will be called after every testfunction.
+    void compactGraph();
+    void dijkstra();
+    void dijkstraEarlyTermination();
+    void shortestTree();
+    void costMatrix();
+    void contractionHierarchy();
+    void contractionHierarchyFile();
+    void contractionHierarchyCorruptedFile();
+    void vectorLayerDirector();
+
+  private:
+
+    /**
+     * Creates a graph with two strategies:
+     *
+     *   0 --1/9--> 1 --1/1--> 2
+     *   |                     ^
+     *   +-------5/2-----------+
+     *
+     *   3 (isolated)
+     */
+    QgsGraph *createGraph() const;
+
+    //! Creates a size x size grid graph with edges in both directions and varying costs
+    QgsGraph *createGridGraph( int size ) const;
+
+    //! Compares all point to point queries of \a hierarchy with Dijkstra searches on \a graph
+    void compareWithDijkstra( const QgsGraph *graph, const QgsContractionHierarchy &hierarchy ) const;
+
+    /**
+     * Writes an index file for a graph of 3 vertices and 2 edges with the given vertex ranks and
+     * arcs, each arc being (from, to, edge id, first child arc, second child arc). Source graph
+     * edges cost 1 and shortcuts cost 2.
+     */
+    bool writeHierarchyFile( const QString &path, const QVector<int> &rank, const QList< QList<int> > &arcs ) const;
+};
+
+void TestQgsNetworkAnalysis::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void TestQgsNetworkAnalysis::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+QgsGraph *TestQgsNetworkAnalysis::createGraph() const
+{
+  QgsGraph *graph = new QgsGraph();
+  graph->addVertex( QgsPointXY( 0, 0 ) );
+  graph->addVertex( QgsPointXY( 1, 0 ) );
+  graph->addVertex( QgsPointXY( 2, 0 ) );
+  graph->addVertex( QgsPointXY( 5, 5 ) );
+  graph->addEdge( 0, 1, QVector< QVariant >() << 1.0 << 9.0 );
+  graph->addEdge( 1, 2, QVector< QVariant >() << 1.0 << 1.0 );
+  graph->addEdge( 0, 2, QVector< QVariant >() << 5.0 << 2.0 );
+  return graph;
+}
+
+void TestQgsNetworkAnalysis::compactGraph()
+{
+  std::unique_ptr< QgsGraph > graph( createGraph() );
+
+  QgsCompactGraph all( graph.get() );
+  QCOMPARE( all.vertexCount(), 4 );
+  QCOMPARE( all.edgeCount(), 3 );
+  QVERIFY( all.hasStrategy( 0 ) );
+  QVERIFY( all.hasStrategy( 1 ) );
+  QVERIFY( !all.hasStrategy( 2 ) );
+  QVERIFY( !all.hasStrategy( -1 ) );
+
+  QgsCompactGraph second( graph.get(), QList<int>() << 1 );
+  QVERIFY( !second.hasStrategy( 0 ) );
+  QVERIFY( second.hasStrategy( 1 ) );
+
+  // empty graph
+  QgsGraph empty;
+  QgsCompactGraph compactEmpty( &empty );
+  QCOMPARE( compactEmpty.vertexCount(), 0 );
+  QCOMPARE( compactEmpty.edgeCount(), 0 );
+}
+
+void TestQgsNetworkAnalysis::dijkstra()
+{
+  std::unique_ptr< QgsGraph > graph( createGraph() );
+  const double inf = std::numeric_limits<double>::infinity();
+
+  QVector<int> tree;
+  QVector<double> cost;
+  QgsGraphAnalyzer::dijkstra( graph.get(), 0, 0, &tree, &cost );
+  QCOMPARE( tree, QVector<int>() << -1 << 0 << 1 << -1 );
+  QCOMPARE( cost, QVector<double>() << 0.0 << 1.0 << 2.0 << inf );
+
+  QgsGraphAnalyzer::dijkstra( graph.get(), 0, 1, &tree, &cost );
+  QCOMPARE( tree, QVector<int>() << -1 << 0 << 2 << -1 );
+  QCOMPARE( cost, QVector<double>() << 0.0 << 9.0 << 2.0 << inf );
+
+  // result arrays are optional
+  QgsGraphAnalyzer::dijkstra( graph.get(), 0, 1, nullptr, &cost );
+  QCOMPARE( cost, QVector<double>() << 0.0 << 9.0 << 2.0 << inf );
+  QgsGraphAnalyzer::dijkstra( graph.get(), 0, 1, &tree, nullptr );
+  QCOMPARE( tree, QVector<int>() << -1 << 0 << 2 << -1 );
+
+  // compact graph directly, edge ids refer to the source graph
+  QgsCompactGraph compact( graph.get() );
+  compact.dijkstra( 1, 0, tree, cost );
+  QCOMPARE( tree, QVector<int>() << -1 << -1 << 1 << -1 );
+  QCOMPARE( cost, QVector<double>() << inf << 0.0 << 1.0 << inf );
+
+  // invalid start vertex
+  compact.dijkstra( 10, 0, tree, cost );
+  QCOMPARE( tree, QVector<int>() << -1 << -1 << -1 << -1 );
+  QCOMPARE( cost, QVector<double>() << inf << inf << inf << inf );
+}
+
+void TestQgsNetworkAnalysis::dijkstraEarlyTermination()
+{
+  std::unique_ptr< QgsGraph > graph( createGraph() );
+  const double inf = std::numeric_limits<double>::infinity();
+  QgsCompactGraph compact( graph.get() );
+
+  QVector<int> tree;
+  QVector<double> cost;
+
+  // stop at target vertex 1, vertex 2 is cheaper and settled before
+  compact.dijkstra( 0, 1, tree, cost, 1 );
+  QCOMPARE( tree.at( 1 ), 0 );
+  QCOMPARE( cost.at( 1 ), 9.0 );
+  QCOMPARE( cost.at( 2 ), 2.0 );
+
+  // vertex 2 is still queued when target vertex 1 is reached
+  compact.dijkstra( 0, 0, tree, cost, 1 );
+  QCOMPARE( tree, QVector<int>() << -1 << 0 << -1 << -1 );
+  QCOMPARE( cost, QVector<double>() << 0.0 << 1.0 << inf << inf );
+
+  // cost limit
+  compact.dijkstra( 0, 1, tree, cost, -1, 5.0 );
+  QCOMPARE( tree, QVector<int>() << -1 << -1 << 2 << -1 );
+  QCOMPARE( cost, QVector<double>() << 0.0 << inf << 2.0 << inf );
+
+  compact.dijkstra( 0, 1, tree, cost, -1, 9.0 );
+  QCOMPARE( cost, QVector<double>() << 0.0 << 9.0 << 2.0 << inf );
+}
+
+void TestQgsNetworkAnalysis::shortestTree()
+{
+  std::unique_ptr< QgsGraph > graph( createGraph() );
+
+  std::unique_ptr< QgsGraph > tree( QgsGraphAnalyzer::shortestTree( graph.get(), 0, 1 ) );
+  QCOMPARE( tree->vertexCount(), 3 );
+  QCOMPARE( tree->edgeCount(), 2 );
+  QCOMPARE( tree->vertex( tree->edge( 0 ).inVertex() ).point(), QgsPointXY( 1, 0 ) );
+  QCOMPARE( tree->vertex( tree->edge( 1 ).inVertex() ).point(), QgsPointXY( 2, 0 ) );
+  QCOMPARE( tree->vertex( tree->edge( 1 ).outVertex() ).point(), QgsPointXY( 0, 0 ) );
+}
+
+void TestQgsNetworkAnalysis::costMatrix()
+{
+  std::unique_ptr< QgsGraph > graph( createGridGraph( 10 ) );
+  QgsCompactGraph compact( graph.get() );
+
+  QVector<int> origins;
+  origins << 0 << 99 << 45 << 100 << -1 << 17;
+  QVector<int> destinations;
+  destinations << 3 << 99 << 100 << 3 << 200 << 0;
+
+  QgsFeedback feedback;
+  const QVector<double> matrix = compact.costMatrix( origins, destinations, 0, &feedback );
+  QCOMPARE( matrix.size(), origins.size() * destinations.size() );
+  QCOMPARE( feedback.progress(), 100.0 );
+
+  QVector<int> tree;
+  QVector<double> costs;
+  for ( int i = 0; i < origins.size(); ++i )
+  {
+    compact.dijkstra( origins.at( i ), 0, tree, costs );
+    for ( int j = 0; j < destinations.size(); ++j )
+    {
+      const double expected = destinations.at( j ) < graph->vertexCount() ? costs.at( destinations.at( j ) ) : std::numeric_limits<double>::infinity();
+      const double actual = matrix.at( i * destinations.size() + j );
+      if ( std::isinf( expected ) )
+        QVERIFY( std::isinf( actual ) );
+      else
+        QCOMPARE( actual, expected );
+    }
+  }
+
+  // invalid strategy
+  const QVector<double> invalid = compact.costMatrix( origins, destinations, 1 );
+  QCOMPARE( invalid.size(), origins.size() * destinations.size() );
+  QVERIFY( std::isinf( invalid.at( 0 ) ) );
+
+  QVERIFY( compact.costMatrix( QVector<int>(), destinations, 0 ).isEmpty() );
+}
+
+QgsGraph *TestQgsNetworkAnalysis::createGridGraph( int size ) const
+{
+  QgsGraph *graph = new QgsGraph();
+  for ( int y = 0; y < size; ++y )
+  {
+    for ( int x = 0; x < size; ++x )
+    {
+      graph->addVertex( QgsPointXY( x, y ) );
+    }
+  }
+
+  int i = 0;
+  for ( int y = 0; y < size; ++y )
+  {
+    for ( int x = 0; x < size; ++x )
+    {
+      const int vertex = y * size + x;
+      if ( x + 1 < size )
+      {
+        graph->addEdge( vertex, vertex + 1, QVector< QVariant >() << 1.0 + ( i * 7 ) % 5 );
+        graph->addEdge( vertex + 1, vertex, QVector< QVariant >() << 1.0 + ( i * 3 ) % 4 );
+        ++i;
+      }
+      if ( y + 1 < size )
+      {
+        graph->addEdge( vertex, vertex + size, QVector< QVariant >() << 1.0 + ( i * 5 ) % 6 );
+        graph->addEdge( vertex + size, vertex, QVector< QVariant >() << 2.0 + ( i * 11 ) % 3 );
+        ++i;
+      }
+    }
+  }
+  // a one way shortcut and a parallel edge
+  graph->addEdge( 0, size * size - 1, QVector< QVariant >() << 3.0 * size );
+  graph->addEdge( 0, 1, QVector< QVariant >() << 0.5 );
+  // unreachable vertex
+  graph->addVertex( QgsPointXY( -10, -10 ) );
+  return graph;
+}
+
+void TestQgsNetworkAnalysis::compareWithDijkstra( const QgsGraph *graph, const QgsContractionHierarchy &hierarchy ) const
+{
+  QgsCompactGraph compact( graph );
+  QVector<int> tree;
+  QVector<double> costs;
+  for ( int from = 0; from < graph->vertexCount(); ++from )
+  {
+    compact.dijkstra( from, 0, tree, costs );
+    for ( int to = 0; to < graph->vertexCount(); ++to )
+    {
+      double cost = 0;
+      const QVector<int> path = hierarchy.shortestPath( from, to, cost );
+      if ( std::isinf( costs.at( to ) ) )
+      {
+        QVERIFY( std::isinf( hierarchy.shortestPathCost( from, to ) ) );
+        QVERIFY( std::isinf( cost ) );
+        QVERIFY( path.isEmpty() );
+        continue;
+      }
+
+      QCOMPARE( hierarchy.shortestPathCost( from, to ), costs.at( to ) );
+      QCOMPARE( cost, costs.at( to ) );
+      if ( from == to )
+      {
+        QVERIFY( path.isEmpty() );
+        continue;
+      }
+
+      // path must be connected and have the reported cost
+      int vertex = from;
+      double pathCost = 0;
+      Q_FOREACH ( int edgeId, path )
+      {
+        const QgsGraphEdge &edge = graph->edge( edgeId );
+        QCOMPARE( edge.outVertex(), vertex );
+        vertex = edge.inVertex();
+        pathCost += edge.cost( 0 ).toDouble();
+      }
+      QCOMPARE( vertex, to );
+      QGSCOMPARENEAR( pathCost, cost, 1e-9 );
+    }
+  }
+}
+
+void TestQgsNetworkAnalysis::contractionHierarchy()
+{
+  std::unique_ptr< QgsGraph > graph( createGridGraph( 8 ) );
+
+  QgsContractionHierarchy hierarchy;
+  QVERIFY( !hierarchy.isValid() );
+  QVERIFY( std::isinf( hierarchy.shortestPathCost( 0, 1 ) ) );
+
+  // invalid strategy
+  QVERIFY( !hierarchy.build( graph.get(), 1 ) );
+  QVERIFY( !hierarchy.isValid() );
+
+  QVERIFY( hierarchy.build( graph.get(), 0 ) );
+  QVERIFY( hierarchy.isValid() );
+  QCOMPARE( hierarchy.strategyIndex(), 0 );
+  QCOMPARE( hierarchy.vertexCount(), graph->vertexCount() );
+  compareWithDijkstra( graph.get(), hierarchy );
+
+  // invalid vertices
+  QVERIFY( std::isinf( hierarchy.shortestPathCost( -1, 1 ) ) );
+  QVERIFY( std::isinf( hierarchy.shortestPathCost( 1, graph->vertexCount() ) ) );
+
+  // canceled
+  QgsFeedback feedback;
+  feedback.cancel();
+  QVERIFY( !hierarchy.build( graph.get(), 0, &feedback ) );
+  QVERIFY( !hierarchy.isValid() );
+}
+
+void TestQgsNetworkAnalysis::contractionHierarchyFile()
+{
+  std::unique_ptr< QgsGraph > graph( createGridGraph( 6 ) );
+
+  QgsContractionHierarchy hierarchy;
+  QVERIFY( hierarchy.build( graph.get(), 0 ) );
+
+  QTemporaryFile file;
+  QVERIFY( file.open() );
+  file.close();
+  QVERIFY( hierarchy.writeToFile( file.fileName() ) );
+
+  QgsContractionHierarchy restored;
+  QVERIFY( restored.readFromFile( file.fileName() ) );
+  QVERIFY( restored.isValid() );
+  QCOMPARE( restored.strategyIndex(), 0 );
+  QCOMPARE( restored.vertexCount(), hierarchy.vertexCount() );
+  QCOMPARE( restored.shortcutCount(), hierarchy.shortcutCount() );
+  compareWithDijkstra( graph.get(), restored );
+
+  // not an index file
+  QTemporaryFile badFile;
+  QVERIFY( badFile.open() );
+  badFile.write( "not a contraction hierarchy" );
+  badFile.close();
+  QVERIFY( !restored.readFromFile( badFile.fileName() ) );
+  QVERIFY( !restored.isValid() );
+  QVERIFY( !restored.readFromFile( QStringLiteral( "/not/existing/file" ) ) );
+}
+
+bool TestQgsNetworkAnalysis::writeHierarchyFile( const QString &path, const QVector<int> &rank, const QList< QList<int> > &arcs ) const
+{
+  QFile file( path );
+  if ( !file.open( QIODevice::WriteOnly ) )
+    return false;
+
+  QDataStream out( &file );
+  out.setVersion( QDataStream::Qt_5_0 );
+  // "QGCH" magic number and version 1, strategy 0 and 2 source edges
+  out << static_cast< quint32 >( 0x51474348 ) << static_cast< quint32 >( 1 );
+  out << static_cast< qint32 >( 0 ) << static_cast< qint32 >( 2 );
+  out << rank;
+  out << static_cast< qint32 >( arcs.size() );
+  Q_FOREACH ( const QList<int> &arc, arcs )
+  {
+    out << static_cast< qint32 >( arc.at( 0 ) ) << static_cast< qint32 >( arc.at( 1 ) ) << ( arc.at( 2 ) >= 0 ? 1.0 : 2.0 )
+        << static_cast< qint32 >( arc.at( 2 ) ) << static_cast< qint32 >( arc.at( 3 ) ) << static_cast< qint32 >( arc.at( 4 ) );
+  }
+  return out.status() == QDataStream::Ok;
+}
+
+void TestQgsNetworkAnalysis::contractionHierarchyCorruptedFile()
+{
+  QTemporaryFile file;
+  QVERIFY( file.open() );
+  file.close();
+
+  // 0 -> 1 shortcut through vertex 2, which is contracted first
+  QVERIFY( writeHierarchyFile( file.fileName(), QVector<int>() << 1 << 2 << 0,
+                               QList< QList<int> >() << ( QList<int>() << 0 << 1 << -1 << 1 << 2 )
+                               << ( QList<int>() << 0 << 2 << 0 << -1 << -1 )
+                               << ( QList<int>() << 2 << 1 << 1 << -1 << -1 ) ) );
+  QgsContractionHierarchy hierarchy;
+  QVERIFY( hierarchy.readFromFile( file.fileName() ) );
+  QCOMPARE( hierarchy.shortcutCount(), 1 );
+  double cost;
+  QCOMPARE( hierarchy.shortestPath( 0, 1, cost ), QVector<int>() << 0 << 1 );
+  QCOMPARE( cost, 2.0 );
+
+  // shortcuts replacing each other, which would be unpacked forever
+  QVERIFY( writeHierarchyFile( file.fileName(), QVector<int>() << 1 << 2 << 0,
+                               QList< QList<int> >() << ( QList<int>() << 0 << 1 << -1 << 1 << 2 )
+                               << ( QList<int>() << 0 << 2 << -1 << 0 << 3 )
+                               << ( QList<int>() << 2 << 1 << 0 << -1 << -1 )
+                               << ( QList<int>() << 1 << 2 << 1 << -1 << -1 ) ) );
+  QVERIFY( !hierarchy.readFromFile( file.fileName() ) );
+  QVERIFY( !hierarchy.isValid() );
+
+  // shortcut replacing itself
+  QVERIFY( writeHierarchyFile( file.fileName(), QVector<int>() << 1 << 2 << 0,
+                               QList< QList<int> >() << ( QList<int>() << 0 << 1 << -1 << 0 << 0 ) ) );
+  QVERIFY( !hierarchy.readFromFile( file.fileName() ) );
+
+  // children which do not join the ends of the shortcut
+  QVERIFY( writeHierarchyFile( file.fileName(), QVector<int>() << 1 << 2 << 0,
+                               QList< QList<int> >() << ( QList<int>() << 0 << 1 << -1 << 2 << 1 )
+                               << ( QList<int>() << 0 << 2 << 0 << -1 << -1 )
+                               << ( QList<int>() << 2 << 1 << 1 << -1 << -1 ) ) );
+  QVERIFY( !hierarchy.readFromFile( file.fileName() ) );
+}
+
+void TestQgsNetworkAnalysis::vectorLayerDirector()
+{
+  QgsVectorLayer layer( QStringLiteral( "LineString?crs=EPSG:3857" ), QStringLiteral( "lines" ), QStringLiteral( "memory" ) );
+  QVERIFY( layer.isValid() );
+
+  // second line starts within the topology tolerance of the end of the first one
+  QgsFeature f1;
+  f1.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString (0 0, 10 0)" ) ) );
+  QgsFeature f2;
+  f2.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString (10 0.0005, 10 10)" ) ) );
+  QgsFeatureList features;
+  features << f1 << f2;
+  QVERIFY( layer.dataProvider()->addFeatures( features ) );
+
+  QgsVectorLayerDirector director( &layer, -1, QString(), QString(), QString(), QgsVectorLayerDirector::DirectionBoth );
+  director.addStrategy( new QgsNetworkDistanceStrategy() );
+  QgsGraphBuilder builder( layer.crs(), false, 0.001 );
+
+  QVector< QgsPointXY > additionalPoints;
+  additionalPoints << QgsPointXY( 5, 1 ) << QgsPointXY( 10.5, 5 ) << QgsPointXY( -3, 0 ) << QgsPointXY( 5, -2 );
+  QVector< QgsPointXY > snappedPoints;
+  director.makeGraph( &builder, additionalPoints, snappedPoints );
+
+  QCOMPARE( snappedPoints.size(), 4 );
+  QCOMPARE( snappedPoints.at( 0 ), QgsPointXY( 5, 0 ) );
+  QCOMPARE( snappedPoints.at( 1 ), QgsPointXY( 10, 5 ) );
+  QCOMPARE( snappedPoints.at( 2 ), QgsPointXY( 0, 0 ) );
+  // tied to the same point as the first one, merged into a single vertex
+  QCOMPARE( snappedPoints.at( 3 ), QgsPointXY( 5, 0 ) );
+
+  std::unique_ptr< QgsGraph > graph( builder.graph() );
+  // 0 0, 10 0, 10 10 and the tied points 5 0 and 10 5
+  QCOMPARE( graph->vertexCount(), 5 );
+  // four segments in both directions
+  QCOMPARE( graph->edgeCount(), 8 );
+
+  QgsCompactGraph compact( graph.get() );
+  QVector< int > tree;
+  QVector< double > cost;
+  compact.dijkstra( graph->findVertex( QgsPointXY( 0, 0 ) ), 0, tree, cost );
+  QVERIFY( !std::isinf( cost.at( graph->findVertex( QgsPointXY( 10, 10 ) ) ) ) );
+  QVERIFY( cost.at( graph->findVertex( QgsPointXY( 5, 0 ) ) ) < cost.at( graph->findVertex( QgsPointXY( 10, 5 ) ) ) );
+}
+
+QGSTEST_MAIN( TestQgsNetworkAnalysis )
+#include "testqgsnetworkanalysis.moc"
@@ -0,0 +1,205 @@
+/***************************************************************************
+                         testqgsninecellfilters.cpp
+                         --------------------------
+    Date                 : October 2017
+    Copyright            : (C) 2017 by QGIS Development Team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgsaspectfilter.h"
+#include "qgshillshadefilter.h"
+#include "qgsruggednessfilter.h"
+#include "qgsslopefilter.h"
+#include "qgstotalcurvaturefilter.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <gdal.h>
+
+#include <cmath>
+#include <vector>
+
+static QString _tempFile( const QString &name )
+{
+  return QStringLiteral( "%1/ninecelltest-%2.tif" ).arg( QDir::tempPath(), name );
+}
+
+/**
+ * Processes the raster one cell after the other with processNineCellWindow(),
+ * as filters which do not reimplement processBlock() do.
+ */
+template <class Filter>
+class SerialFilter : public Filter
+{
+  public:
+    SerialFilter( const QString &inputFile, const QString &outputFile )
+      : Filter( inputFile, outputFile, QStringLiteral( "GTiff" ) )
+    {}
+
+  protected:
+    void processBlock( const float *inputBlock, float *outputBlock, int columns, int rows ) override
+    {
+      QgsNineCellFilter::processBlock( inputBlock, outputBlock, columns, rows );
+    }
+
+    bool processBlocksInParallel() const override
+    {
+      return false;
+    }
+};
+
+/**
+ * \ingroup UnitTests
+ * Checks that the filters processing blocks in parallel give the same output
+ * as processNineCellWindow().
+ */
+class TestQgsNineCellFilters : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void slope();
+    void aspect();
+    void hillshade();
+    void ruggedness();
+    void totalCurvature();
+
+  private:
+    template <class Filter> void compareWithSerialOutput( const QString &name );
+    static std::vector< float > readRaster( const QString &fileName );
+
+    QString mDemFile;
+};
+
+// more rows than a single batch of blocks
+static const int DEM_COLUMNS = 300;
+static const int DEM_ROWS = 2000;
+
+void TestQgsNineCellFilters::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+  GDALAllRegister();
+
+  mDemFile = _tempFile( QStringLiteral( "dem" ) );
+  GDALDriverH driver = GDALGetDriverByName( "GTiff" );
+  QVERIFY( driver );
+  GDALDatasetH dataset = GDALCreate( driver, mDemFile.toUtf8().constData(), DEM_COLUMNS, DEM_ROWS, 1, GDT_Float32, nullptr );
+  QVERIFY( dataset );
+  double geoTransform[6] = { 0, 10, 0, DEM_ROWS * 10, 0, -10 };
+  GDALSetGeoTransform( dataset, geoTransform );
+  GDALRasterBandH band = GDALGetRasterBand( dataset, 1 );
+  GDALSetRasterNoDataValue( band, -9999 );
+
+  // smooth hills on a slope, with scattered nodata cells
+  std::vector< float > values( static_cast< size_t >( DEM_COLUMNS ) * DEM_ROWS );
+  for ( int row = 0; row < DEM_ROWS; ++row )
+  {
+    for ( int column = 0; column < DEM_COLUMNS; ++column )
+    {
+      float &value = values[static_cast< size_t >( row ) * DEM_COLUMNS + column];
+      if ( ( column * 7 + row * 13 ) % 97 == 0 )
+        value = -9999;
+      else
+        value = 100 + 50 * std::sin( column / 17.0 ) * std::cos( row / 23.0 ) + 0.3 * row;
+    }
+  }
+  QCOMPARE( GDALRasterIO( band, GF_Write, 0, 0, DEM_COLUMNS, DEM_ROWS, values.data(), DEM_COLUMNS, DEM_ROWS, GDT_Float32, 0, 0 ), CE_None );
+  GDALClose( dataset );
+}
+
+void TestQgsNineCellFilters::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+std::vector< float > TestQgsNineCellFilters::readRaster( const QString &fileName )
+{
+  std::vector< float > values;
+  GDALDatasetH dataset = GDALOpen( fileName.toUtf8().constData(), GA_ReadOnly );
+  if ( !dataset )
+    return values;
+
+  const int columns = GDALGetRasterXSize( dataset );
+  const int rows = GDALGetRasterYSize( dataset );
+  values.resize( static_cast< size_t >( columns ) * rows );
+  if ( GDALRasterIO( GDALGetRasterBand( dataset, 1 ), GF_Read, 0, 0, columns, rows, values.data(), columns, rows, GDT_Float32, 0, 0 ) != CE_None )
+    values.clear();
+  GDALClose( dataset );
+  return values;
+}
+
+template <class Filter>
+void TestQgsNineCellFilters::compareWithSerialOutput( const QString &name )
+{
+  const QString parallelFile = _tempFile( name + QStringLiteral( "-parallel" ) );
+  const QString serialFile = _tempFile( name + QStringLiteral( "-serial" ) );
+
+  Filter parallelFilter( mDemFile, parallelFile, QStringLiteral( "GTiff" ) );
+  QCOMPARE( parallelFilter.processRaster(), 0 );
+  SerialFilter< Filter > serialFilter( mDemFile, serialFile );
+  QCOMPARE( serialFilter.processRaster(), 0 );
+
+  const std::vector< float > parallelValues = readRaster( parallelFile );
+  const std::vector< float > serialValues = readRaster( serialFile );
+  QCOMPARE( parallelValues.size(), static_cast< size_t >( DEM_COLUMNS ) * DEM_ROWS );
+  QCOMPARE( serialValues.size(), parallelValues.size() );
+
+  int differences = 0;
+  for ( size_t i = 0; i < parallelValues.size(); ++i )
+  {
+    if ( !qgsDoubleNear( parallelValues[i], serialValues[i], 1e-3 ) )
+    {
+      if ( differences == 0 )
+        qDebug( "Cell %d: parallel %f, serial %f", static_cast< int >( i ), parallelValues[i], serialValues[i] );
+      ++differences;
+    }
+  }
+  QCOMPARE( differences, 0 );
+
+  QFile::remove( parallelFile );
+  QFile::remove( serialFile );
+}
+
+void TestQgsNineCellFilters::slope()
+{
+  compareWithSerialOutput< QgsSlopeFilter >( QStringLiteral( "slope" ) );
+}
+
+void TestQgsNineCellFilters::aspect()
+{
+  compareWithSerialOutput< QgsAspectFilter >( QStringLiteral( "aspect" ) );
+}
+
+void TestQgsNineCellFilters::hillshade()
+{
+  compareWithSerialOutput< QgsHillshadeFilter >( QStringLiteral( "hillshade" ) );
+}
+
+void TestQgsNineCellFilters::ruggedness()
+{
+  compareWithSerialOutput< QgsRuggednessFilter >( QStringLiteral( "ruggedness" ) );
+}
+
+void TestQgsNineCellFilters::totalCurvature()
+{
+  compareWithSerialOutput< QgsTotalCurvatureFilter >( QStringLiteral( "totalcurvature" ) );
+}
+
+QGSTEST_MAIN( TestQgsNineCellFilters )
+#include "testqgsninecellfilters.moc"
@@ -22,6 +22,8 @@ Email                : nyall dot dawson at gmail dot com
 #include "qgsapplication.h"
 #include "qgsproject.h"
 
+#include <memory>
+
 Q_DECLARE_METATYPE( QgsRasterCalcNode::Operator )
 
 class TestQgsRasterCalculator : public QObject
@@ -53,9 +55,11 @@ class TestQgsRasterCalculator : public QObject
 
     void rasterRefOp();
     void dualOpRasterRaster(); //test dual op on raster ref and raster ref
+    void compiledExpression(); //test expressions evaluated in chunks of cells
 
     void calcWithLayers();
     void calcWithReprojectedLayers();
+    void calcWithTiles();
 
   private:
 
@@ -420,6 +424,78 @@ void TestQgsRasterCalculator::dualOpRasterRaster()
   QCOMPARE( result.data()[5], -9999.0 );
 }
 
+void TestQgsRasterCalculator::compiledExpression()
+{
+  // more cells than evaluated at once, to test chunk boundaries
+  const int cols = 100;
+  const int rows = 30;
+  QgsRasterBlock m1( Qgis::Float64, cols, rows );
+  m1.setNoDataValue( -1.0 );
+  QgsRasterBlock m2( Qgis::Float64, cols, rows );
+  m2.setNoDataValue( -2.0 );
+  for ( int row = 0; row < rows; ++row )
+  {
+    for ( int col = 0; col < cols; ++col )
+    {
+      m1.setValue( row, col, ( row * cols + col ) % 7 - 1.0 );
+      m2.setValue( row, col, ( row * cols + col ) % 5 - 2.0 );
+    }
+  }
+  QMap<QString, QgsRasterBlock *> rasterData;
+  rasterData.insert( QStringLiteral( "raster1" ), &m1 );
+  rasterData.insert( QStringLiteral( "raster2" ), &m2 );
+
+  // sqrt( raster1 / raster2 ) + 2 * -raster1
+  QgsRasterCalcNode node( QgsRasterCalcNode::opPLUS,
+                          new QgsRasterCalcNode( QgsRasterCalcNode::opSQRT,
+                              new QgsRasterCalcNode( QgsRasterCalcNode::opDIV, new QgsRasterCalcNode( QStringLiteral( "raster1" ) ), new QgsRasterCalcNode( QStringLiteral( "raster2" ) ) ), 0 ),
+                          new QgsRasterCalcNode( QgsRasterCalcNode::opMUL, new QgsRasterCalcNode( 2.0 ),
+                              new QgsRasterCalcNode( QgsRasterCalcNode::opSIGN, new QgsRasterCalcNode( QStringLiteral( "raster1" ) ), 0 ) ) );
+
+  auto expected = [&]( int row, int col )
+  {
+    const double v1 = m1.value( row, col );
+    const double v2 = m2.value( row, col );
+    if ( v1 == -1.0 || v2 == -2.0 || v2 == 0.0 || v1 / v2 < 0 )
+      return -9999.0;
+    return std::sqrt( v1 / v2 ) - 2 * v1;
+  };
+
+  QgsRasterMatrix result;
+  result.setNodataValue( -9999 );
+  QVERIFY( node.calculate( rasterData, result ) );
+  QCOMPARE( result.nColumns(), cols );
+  QCOMPARE( result.nRows(), rows );
+  for ( int row = 0; row < rows; ++row )
+  {
+    for ( int col = 0; col < cols; ++col )
+    {
+      QCOMPARE( result.data()[ row * cols + col ], expected( row, col ) );
+    }
+  }
+
+  // single row
+  QVERIFY( node.calculate( rasterData, result, 17 ) );
+  QCOMPARE( result.nColumns(), cols );
+  QCOMPARE( result.nRows(), 1 );
+  for ( int col = 0; col < cols; ++col )
+  {
+    QCOMPARE( result.data()[ col ], expected( 17, col ) );
+  }
+
+  // numbers only result in a number
+  QgsRasterCalcNode numberNode( QgsRasterCalcNode::opMINUS, new QgsRasterCalcNode( 5.0 ), new QgsRasterCalcNode( QgsRasterCalcNode::opLOG10, new QgsRasterCalcNode( 100.0 ), 0 ) );
+  QVERIFY( numberNode.calculate( rasterData, result ) );
+  QVERIFY( result.isNumber() );
+  QCOMPARE( result.number(), 3.0 );
+
+  // blocks of different sizes can not be combined
+  QgsRasterBlock m3( Qgis::Float64, 2, 3 );
+  rasterData.insert( QStringLiteral( "raster3" ), &m3 );
+  QgsRasterCalcNode mismatchNode( QgsRasterCalcNode::opPLUS, new QgsRasterCalcNode( QStringLiteral( "raster1" ) ), new QgsRasterCalcNode( QStringLiteral( "raster3" ) ) );
+  QVERIFY( !mismatchNode.calculate( rasterData, result ) );
+}
+
 void TestQgsRasterCalculator::calcWithLayers()
 {
   QgsRasterCalculatorEntry entry1;
@@ -531,5 +607,67 @@ void TestQgsRasterCalculator::calcWithReprojectedLayers()
   delete block;
 }
 
+void TestQgsRasterCalculator::calcWithTiles()
+{
+  QgsRasterCalculatorEntry entry1;
+  entry1.bandNumber = 1;
+  entry1.raster = mpLandsatRasterLayer;
+  entry1.ref = QStringLiteral( "landsat@1" );
+
+  QgsRasterCalculatorEntry entry2;
+  entry2.bandNumber = 2;
+  entry2.raster = mpLandsatRasterLayer;
+  entry2.ref = QStringLiteral( "landsat@2" );
+
+  QVector<QgsRasterCalculatorEntry> entries;
+  entries << entry1 << entry2;
+
+  QgsRectangle extent = mpLandsatRasterLayer->extent();
+  const int columns = mpLandsatRasterLayer->width();
+  const int rows = mpLandsatRasterLayer->height();
+
+  QTemporaryFile wholeFile;
+  wholeFile.open(); // fileName is no avialable until open
+  QString wholeName = wholeFile.fileName();
+  wholeFile.close();
+
+  QgsRasterCalculator rc( QStringLiteral( "\"landsat@1\" * 2 + \"landsat@2\"" ),
+                          wholeName,
+                          QStringLiteral( "GTiff" ),
+                          extent, mpLandsatRasterLayer->crs(), columns, rows, entries );
+  QCOMPARE( rc.tileSize(), 1024 );
+  rc.setTileSize( 0 );
+  QCOMPARE( rc.processCalculation(), 0 );
+
+  QTemporaryFile tiledFile;
+  tiledFile.open();
+  QString tiledName = tiledFile.fileName();
+  tiledFile.close();
+
+  // tiny tiles, calculated by several threads
+  QgsRasterCalculator rc2( QStringLiteral( "\"landsat@1\" * 2 + \"landsat@2\"" ),
+                           tiledName,
+                           QStringLiteral( "GTiff" ),
+                           extent, mpLandsatRasterLayer->crs(), columns, rows, entries );
+  rc2.setTileSize( 3 );
+  QCOMPARE( rc2.processCalculation(), 0 );
+
+  QgsRasterLayer whole( wholeName, QStringLiteral( "whole" ) );
+  QgsRasterLayer tiled( tiledName, QStringLiteral( "tiled" ) );
+  QCOMPARE( tiled.width(), columns );
+  QCOMPARE( tiled.height(), rows );
+  std::unique_ptr< QgsRasterBlock > wholeBlock( whole.dataProvider()->block( 1, extent, columns, rows ) );
+  std::unique_ptr< QgsRasterBlock > tiledBlock( tiled.dataProvider()->block( 1, extent, columns, rows ) );
+  for ( int row = 0; row < rows; ++row )
+  {
+    for ( int column = 0; column < columns; ++column )
+    {
+      QCOMPARE( tiledBlock->isNoData( row, column ), wholeBlock->isNoData( row, column ) );
+      if ( !wholeBlock->isNoData( row, column ) )
+        QCOMPARE( tiledBlock->value( row, column ), wholeBlock->value( row, column ) );
+    }
+  }
+}
+
 QGSTEST_MAIN( TestQgsRasterCalculator )
 #include "testqgsrastercalculator.moc"
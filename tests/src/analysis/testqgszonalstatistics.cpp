@@ -95,6 +95,8 @@ void TestQgsZonalStatistics::testStatistics()
   QCOMPARE( f.attribute( "majority" ).toDouble(), 1.0 );
   QCOMPARE( f.attribute( "variety" ).toDouble(), 2.0 );
   QCOMPARE( f.attribute( "variance" ).toDouble(), 0.222222222222222 );
+  QCOMPARE( f.attribute( "q1" ).toDouble(), 0.0 );
+  QCOMPARE( f.attribute( "q3" ).toDouble(), 1.0 );
 
   request.setFilterFid( 1 );
   fetched = mVectorLayer->getFeatures( request ).nextFeature( f );
@@ -111,6 +113,8 @@ void TestQgsZonalStatistics::testStatistics()
   QCOMPARE( f.attribute( "majority" ).toDouble(), 1.0 );
   QCOMPARE( f.attribute( "variety" ).toDouble(), 2.0 );
   QCOMPARE( f.attribute( "variance" ).toDouble(), 0.24691358024691 );
+  QCOMPARE( f.attribute( "q1" ).toDouble(), 0.0 );
+  QCOMPARE( f.attribute( "q3" ).toDouble(), 1.0 );
 
   request.setFilterFid( 2 );
   fetched = mVectorLayer->getFeatures( request ).nextFeature( f );
@@ -127,6 +131,8 @@ void TestQgsZonalStatistics::testStatistics()
   QCOMPARE( f.attribute( "majority" ).toDouble(), 1.0 );
   QCOMPARE( f.attribute( "variety" ).toDouble(), 2.0 );
   QCOMPARE( f.attribute( "variance" ).toDouble(), 0.13888888888889 );
+  QCOMPARE( f.attribute( "q1" ).toDouble(), 1.0 );
+  QCOMPARE( f.attribute( "q3" ).toDouble(), 1.0 );
 
   // same with long prefix to ensure that field name truncation handled correctly
   QgsZonalStatistics zsl( mVectorLayer, mRasterLayer, QStringLiteral( "myqgis2_" ), 1, QgsZonalStatistics::All );
@@ -32,6 +32,7 @@ class TestQgsCoordinateTransform: public QObject
     void assignment();
     void isValid();
     void isShortCircuited();
+    void transformPolygon();
 
   private:
 
@@ -206,5 +207,35 @@ void TestQgsCoordinateTransform::transformBoundingBox()
   QGSCOMPARENEAR( resultRect.yMaximum(), expectedRect.yMaximum(), 0.001 );
 }
 
+void TestQgsCoordinateTransform::transformPolygon()
+{
+  // polygons are transformed in place, they must match the transform of single points
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 3857 );
+  QgsCoordinateTransform tr( sourceSrs, destSrs );
+
+  QPolygonF polygon;
+  polygon << QPointF( 0, 0 ) << QPointF( 10, 45 ) << QPointF( -120.5, -33.25 ) << QPointF( 179, 80 );
+  QPolygonF transformed = polygon;
+  tr.transformPolygon( transformed );
+  QCOMPARE( transformed.size(), polygon.size() );
+  for ( int i = 0; i < polygon.size(); ++i )
+  {
+    const QgsPointXY expected = tr.transform( QgsPointXY( polygon.at( i ) ) );
+    QGSCOMPARENEAR( transformed.at( i ).x(), expected.x(), 0.001 );
+    QGSCOMPARENEAR( transformed.at( i ).y(), expected.y(), 0.001 );
+  }
+
+  // and back
+  tr.transformPolygon( transformed, QgsCoordinateTransform::ReverseTransform );
+  for ( int i = 0; i < polygon.size(); ++i )
+  {
+    QGSCOMPARENEAR( transformed.at( i ).x(), polygon.at( i ).x(), 0.000001 );
+    QGSCOMPARENEAR( transformed.at( i ).y(), polygon.at( i ).y(), 0.000001 );
+  }
+}
+
 QGSTEST_MAIN( TestQgsCoordinateTransform )
 #include "testqgscoordinatetransform.moc"
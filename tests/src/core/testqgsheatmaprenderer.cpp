@@ -0,0 +1,163 @@
+/***************************************************************************
+                         testqgsheatmaprenderer.cpp
+                         --------------------------
+    Date                 : October 2017
+    Copyright            : (C) 2017 by QGIS Development Team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgsfeature.h"
+#include "qgsfields.h"
+#include "qgsgeometry.h"
+#include "qgsheatmaprenderer.h"
+#include "qgsmaptopixel.h"
+#include "qgsrendercontext.h"
+
+#include <QImage>
+#include <QObject>
+#include <QPainter>
+
+#include <cmath>
+
+/**
+ * \ingroup UnitTests
+ * Checks that the heatmap values accumulated in batches and in parallel bands
+ * are the same as the values of the points added one after the other.
+ */
+class TestQgsHeatmapRenderer : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void values_data();
+    void values();
+};
+
+void TestQgsHeatmapRenderer::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void TestQgsHeatmapRenderer::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsHeatmapRenderer::values_data()
+{
+  QTest::addColumn<int>( "radius" );
+  QTest::addColumn<int>( "featureCount" );
+  QTest::addColumn<int>( "pointsPerFeature" );
+
+  // no kernel at all
+  QTest::newRow( "radius 0" ) << 0 << 100 << 10;
+  // a single band, with kernels partly outside of the heatmap
+  QTest::newRow( "few points" ) << 10 << 50 << 10;
+  // more than 1000 pending points are split into bands filled in parallel
+  QTest::newRow( "bands" ) << 7 << 20 << 1000;
+  // more than QgsHeatmapRenderer::MAX_PENDING_POINTS, several batches are added
+  QTest::newRow( "batches" ) << 3 << 12 << 100000;
+}
+
+void TestQgsHeatmapRenderer::values()
+{
+  QFETCH( int, radius );
+  QFETCH( int, featureCount );
+  QFETCH( int, pointsPerFeature );
+
+  const int width = 200;
+  const int height = 150;
+  QImage image( width, height, QImage::Format_ARGB32_Premultiplied );
+  image.fill( Qt::transparent );
+  QPainter painter( &image );
+  QgsRenderContext context = QgsRenderContext::fromQPainter( &painter );
+  context.setMapToPixel( QgsMapToPixel( 1, width / 2.0, height / 2.0, width, height, 0 ) );
+
+  QgsHeatmapRenderer renderer;
+  renderer.setRadius( radius );
+  renderer.setRadiusUnit( QgsUnitTypes::RenderPixels );
+  renderer.setRenderQuality( 1 );
+  renderer.startRender( context, QgsFields() );
+
+  // expected values, with the points added to the heatmap one after the other
+  QVector<double> expected( width * height, 0 );
+  double expectedMax = 0;
+
+  // points spread beyond the heatmap by more than the radius, so that some kernels are partly
+  // or completely outside of it
+  quint32 seed = 12345;
+  int pointCount = 0;
+  for ( int i = 0; i < featureCount; ++i )
+  {
+    QgsMultiPoint multiPoint;
+    for ( int j = 0; j < pointsPerFeature; ++j )
+    {
+      seed = seed * 1103515245 + 12345;
+      const double x = static_cast< double >( seed % ( 100 * ( width + 4 * radius + 20 ) ) ) / 100 - 2 * radius - 10;
+      seed = seed * 1103515245 + 12345;
+      const double y = static_cast< double >( seed % ( 100 * ( height + 4 * radius + 20 ) ) ) / 100 - 2 * radius - 10;
+      multiPoint << QgsPointXY( x, y );
+
+      const QgsPointXY pixel = context.mapToPixel().transform( x, y );
+      const int pointX = pixel.x();
+      const int pointY = pixel.y();
+      for ( int row = std::max( pointY - radius, 0 ); row < std::min( pointY + radius, height ); ++row )
+      {
+        for ( int column = std::max( pointX - radius, 0 ); column < std::min( pointX + radius, width ); ++column )
+        {
+          const double distanceSquared = std::pow( pointX - column, 2.0 ) + std::pow( pointY - row, 2.0 );
+          if ( distanceSquared > radius * radius )
+            continue;
+
+          double &value = expected[ row * width + column ];
+          value += std::pow( 1. - std::pow( std::sqrt( distanceSquared ) / radius, 2 ), 2 );
+          expectedMax = std::max( expectedMax, value );
+        }
+      }
+    }
+    pointCount += multiPoint.size();
+
+    QgsFeature feature;
+    feature.setGeometry( QgsGeometry::fromMultiPoint( multiPoint ) );
+    QVERIFY( renderer.renderFeature( feature, context ) );
+  }
+
+  if ( pointCount > QgsHeatmapRenderer::MAX_PENDING_POINTS )
+  {
+    // some points were already added to the heatmap
+    QVERIFY( static_cast< int >( renderer.mPendingPoints.size() ) < pointCount );
+  }
+
+  renderer.stopRender( context );
+  painter.end();
+
+  QCOMPARE( renderer.mValues.size(), expected.size() );
+  int mismatchCount = 0;
+  for ( int i = 0; i < expected.size(); ++i )
+  {
+    if ( !qgsDoubleNear( renderer.mValues.at( i ), expected.at( i ), 1E-9 ) )
+      mismatchCount++;
+  }
+  QCOMPARE( mismatchCount, 0 );
+  QGSCOMPARENEAR( renderer.mCalculatedMaxValue, expectedMax, 1E-9 );
+  if ( radius > 0 )
+    QVERIFY( expectedMax > 0 );
+}
+
+QGSTEST_MAIN( TestQgsHeatmapRenderer )
+#include "testqgsheatmaprenderer.moc"
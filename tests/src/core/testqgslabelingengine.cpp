@@ -16,6 +16,7 @@
 #include "qgstest.h"
 
 #include <qgsapplication.h>
+#include <qgslabelingcache.h>
 #include <qgslabelingengine.h>
 #include <qgsproject.h>
 #include <qgsmaprenderersequentialjob.h>
@@ -48,6 +49,9 @@ class TestQgsLabelingEngine : public QObject
     void testCapitalization();
     void testParticipatingLayers();
     void testRegisterFeatureUnprojectible();
+    void testCacheReusesPlacements();
+    void testCacheLayerChanged();
+    void testCacheBorderZone();
 
   private:
     QgsVectorLayer *vl = nullptr;
@@ -57,6 +61,19 @@ class TestQgsLabelingEngine : public QObject
     void setDefaultLabelParams( QgsPalLayerSettings &settings );
     bool imageCheck( const QString &testName, QImage &image, int mismatchCount );
 
+    //! Labels the points over the point, moved by \a offset pixels
+    void setOffsetLabeling( double offset );
+    //! Renders \a extent and returns the label rectangles by feature id, and the visible extent
+    QHash< int, QgsRectangle > renderLabels( const QgsRectangle &extent, QgsLabelingCache *cache, QgsRectangle &visibleExtent );
+
+    /**
+     * Checks that the \a labels lying inside \a reuseArea are at their \a previous placement,
+     * and the other ones at their \a uncached placement.
+     */
+    void checkCachedLabels( const QHash< int, QgsRectangle > &labels, const QHash< int, QgsRectangle > &previous,
+                            const QHash< int, QgsRectangle > &uncached, const QgsRectangle &reuseArea, double margin,
+                            int &pinnedCount, int &placedCount );
+
 };
 
 void TestQgsLabelingEngine::initTestCase()
@@ -623,5 +640,186 @@ void TestQgsLabelingEngine::testRegisterFeatureUnprojectible()
   QCOMPARE( provider->mLabels.size(), 0 );
 }
 
+static bool sameRect( const QgsRectangle &rect1, const QgsRectangle &rect2 )
+{
+  return qgsDoubleNear( rect1.xMinimum(), rect2.xMinimum(), 1e-6 ) && qgsDoubleNear( rect1.yMinimum(), rect2.yMinimum(), 1e-6 ) &&
+         qgsDoubleNear( rect1.xMaximum(), rect2.xMaximum(), 1e-6 ) && qgsDoubleNear( rect1.yMaximum(), rect2.yMaximum(), 1e-6 );
+}
+
+void TestQgsLabelingEngine::setOffsetLabeling( double offset )
+{
+  QgsPalLayerSettings settings;
+  settings.fieldName = QStringLiteral( "Class" );
+  settings.placement = QgsPalLayerSettings::OverPoint;
+  settings.xOffset = offset;
+  settings.yOffset = offset;
+  settings.offsetUnits = QgsUnitTypes::RenderPixels;
+  setDefaultLabelParams( settings );
+  vl->setLabeling( new QgsVectorLayerSimpleLabeling( settings ) );
+}
+
+QHash< int, QgsRectangle > TestQgsLabelingEngine::renderLabels( const QgsRectangle &extent, QgsLabelingCache *cache, QgsRectangle &visibleExtent )
+{
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( QSize( 640, 480 ) );
+  mapSettings.setExtent( extent );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << vl );
+  mapSettings.setOutputDpi( 96 );
+  visibleExtent = mapSettings.visibleExtent();
+
+  QgsMapRendererSequentialJob job( mapSettings );
+  job.setLabelingCache( cache );
+  job.start();
+  job.waitForFinished();
+
+  QHash< int, QgsRectangle > rects;
+  std::unique_ptr< QgsLabelingResults > results( job.takeLabelingResults() );
+  if ( results )
+  {
+    Q_FOREACH ( const QgsLabelPosition &position, results->labelsWithinRect( visibleExtent ) )
+      rects.insert( position.featureId, position.labelRect );
+  }
+  return rects;
+}
+
+void TestQgsLabelingEngine::checkCachedLabels( const QHash< int, QgsRectangle > &labels, const QHash< int, QgsRectangle > &previous,
+    const QHash< int, QgsRectangle > &uncached, const QgsRectangle &reuseArea, double margin,
+    int &pinnedCount, int &placedCount )
+{
+  pinnedCount = 0;
+  placedCount = 0;
+
+  // labels on the edge of the reuse area may have a slightly different bounding box in the cache
+  QgsRectangle inner = reuseArea;
+  inner.grow( -margin );
+  QgsRectangle outer = reuseArea;
+  outer.grow( margin );
+
+  for ( auto it = labels.constBegin(); it != labels.constEnd(); ++it )
+  {
+    const bool pinned = previous.contains( it.key() ) && sameRect( it.value(), previous.value( it.key() ) );
+    const bool placed = uncached.contains( it.key() ) && sameRect( it.value(), uncached.value( it.key() ) );
+    QVERIFY( pinned || placed );
+
+    if ( previous.contains( it.key() ) && inner.contains( previous.value( it.key() ) ) )
+    {
+      QVERIFY( pinned );
+    }
+    else if ( !previous.contains( it.key() ) || !outer.contains( previous.value( it.key() ) ) )
+    {
+      QVERIFY( placed );
+    }
+
+    if ( pinned )
+      ++pinnedCount;
+    else
+      ++placedCount;
+  }
+}
+
+void TestQgsLabelingEngine::testCacheReusesPlacements()
+{
+  QgsLabelingCache cache;
+  cache.setBorderZone( 0 );
+
+  // first run fills the cache
+  setOffsetLabeling( 0 );
+  QgsRectangle visibleExtent;
+  const QHash< int, QgsRectangle > previous = renderLabels( vl->extent(), &cache, visibleExtent );
+  QVERIFY( !previous.isEmpty() );
+
+  // the labeling settings changed, but no signal told the cache
+  setOffsetLabeling( 20 );
+  QgsRectangle uncachedExtent;
+  const QHash< int, QgsRectangle > uncached = renderLabels( vl->extent(), nullptr, uncachedExtent );
+  const QHash< int, QgsRectangle > labels = renderLabels( vl->extent(), &cache, visibleExtent );
+
+  int pinnedCount = 0;
+  int placedCount = 0;
+  checkCachedLabels( labels, previous, uncached, visibleExtent, 5 * visibleExtent.width() / 640, pinnedCount, placedCount );
+  QVERIFY( pinnedCount > 0 );
+
+  // an empty cache does not pin anything
+  cache.clear();
+  const QHash< int, QgsRectangle > clearedLabels = renderLabels( vl->extent(), &cache, visibleExtent );
+  QCOMPARE( clearedLabels.keys().toSet(), uncached.keys().toSet() );
+  Q_FOREACH ( int id, clearedLabels.keys() )
+    QVERIFY( sameRect( clearedLabels.value( id ), uncached.value( id ) ) );
+
+  vl->setLabeling( nullptr );
+}
+
+void TestQgsLabelingEngine::testCacheLayerChanged()
+{
+  QgsLabelingCache cache;
+  cache.setBorderZone( 0 );
+
+  setOffsetLabeling( 0 );
+  QgsRectangle visibleExtent;
+  const QHash< int, QgsRectangle > previous = renderLabels( vl->extent(), &cache, visibleExtent );
+  QVERIFY( !previous.isEmpty() );
+
+  // a repaint request drops the placements of the layer
+  setOffsetLabeling( 20 );
+  vl->triggerRepaint();
+  QgsRectangle uncachedExtent;
+  const QHash< int, QgsRectangle > uncached = renderLabels( vl->extent(), nullptr, uncachedExtent );
+  const QHash< int, QgsRectangle > labels = renderLabels( vl->extent(), &cache, visibleExtent );
+
+  QCOMPARE( labels.keys().toSet(), uncached.keys().toSet() );
+  Q_FOREACH ( int id, labels.keys() )
+  {
+    QVERIFY( sameRect( labels.value( id ), uncached.value( id ) ) );
+    QVERIFY( !previous.contains( id ) || !sameRect( labels.value( id ), previous.value( id ) ) );
+  }
+
+  // so does a style change
+  setOffsetLabeling( 0 );
+  renderLabels( vl->extent(), &cache, visibleExtent );
+  setOffsetLabeling( 20 );
+  emit vl->styleChanged();
+  const QHash< int, QgsRectangle > styledLabels = renderLabels( vl->extent(), &cache, visibleExtent );
+  QCOMPARE( styledLabels.keys().toSet(), uncached.keys().toSet() );
+  Q_FOREACH ( int id, styledLabels.keys() )
+    QVERIFY( sameRect( styledLabels.value( id ), uncached.value( id ) ) );
+
+  vl->setLabeling( nullptr );
+}
+
+void TestQgsLabelingEngine::testCacheBorderZone()
+{
+  QgsLabelingCache cache;
+  cache.setBorderZone( 100 );
+
+  setOffsetLabeling( 0 );
+  QgsRectangle previousExtent;
+  const QHash< int, QgsRectangle > previous = renderLabels( vl->extent(), &cache, previousExtent );
+  QVERIFY( !previous.isEmpty() );
+
+  // pan by a quarter of the map width
+  QgsRectangle extent = previousExtent;
+  const double shift = previousExtent.width() / 4;
+  extent.setXMinimum( previousExtent.xMinimum() + shift );
+  extent.setXMaximum( previousExtent.xMaximum() + shift );
+
+  setOffsetLabeling( 20 );
+  QgsRectangle visibleExtent;
+  const QHash< int, QgsRectangle > uncached = renderLabels( extent, nullptr, visibleExtent );
+  const QHash< int, QgsRectangle > labels = renderLabels( extent, &cache, visibleExtent );
+
+  // labels are only reused inside the overlap of both extents, away from its border zone
+  const double mapUnitsPerPixel = visibleExtent.width() / 640;
+  QgsRectangle reuseArea = previousExtent.intersect( &visibleExtent );
+  reuseArea.grow( -100 * mapUnitsPerPixel );
+
+  int pinnedCount = 0;
+  int placedCount = 0;
+  checkCachedLabels( labels, previous, uncached, reuseArea, 5 * mapUnitsPerPixel, pinnedCount, placedCount );
+  QVERIFY( pinnedCount > 0 );
+  QVERIFY( placedCount > 0 );
+
+  vl->setLabeling( nullptr );
+}
+
 QGSTEST_MAIN( TestQgsLabelingEngine )
 #include "testqgslabelingengine.moc"
@@ -32,12 +32,19 @@
 #include <qgsfield.h>
 #include <qgis.h> //defines GEOWkt
 #include "qgsmaprenderersequentialjob.h"
+#include "qgsmaprendererparalleljob.h"
+#include "qgsmaprenderercache.h"
 #include <qgsmaplayer.h>
 #include <qgsreadwritecontext.h>
 #include <qgsvectorlayer.h>
 #include <qgsapplication.h>
 #include <qgsproviderregistry.h>
 #include <qgsproject.h>
+#include "qgsfillsymbollayer.h"
+#include "qgslinesymbollayer.h"
+#include "qgsmarkersymbollayer.h"
+#include "qgssinglesymbolrenderer.h"
+#include "qgssymbol.h"
 
 //qgs unit test utility class
 #include "qgsrenderchecker.h"
@@ -79,7 +86,24 @@ class TestQgsMapRendererJob : public QObject
     void testFourAdjacentTiles_data();
     void testFourAdjacentTiles();
 
+    /** This unit test checks that a layer rendered in parallel tiles by the parallel job
+     * looks the same as the layer rendered by the sequential job
+     */
+    void testParallelTiles_data();
+    void testParallelTiles();
+
+    /** This unit test checks that a layer image kept in the cache and only updated in the
+     * exposed and edited areas looks the same as the layer rendered without cache
+     */
+    void testPartialUpdate_data();
+    void testPartialUpdate();
+
   private:
+    //! Returns a symbol for the symbol types of the tiles and partial update tests
+    static QgsSymbol *createSymbol( const QString &symbolType );
+    //! Returns the number of pixels which differ between \a image1 and \a image2 by more than the antialiasing noise
+    static int mismatchCount( const QImage &image1, const QImage &image2 );
+
     QString mEncoding;
     QgsVectorFileWriter::WriterError mError;
     QgsCoordinateReferenceSystem mCRS;
@@ -332,6 +356,186 @@ void TestQgsMapRendererJob::testFourAdjacentTiles()
   QVERIFY( result );
 }
 
+void TestQgsMapRendererJob::testParallelTiles_data()
+{
+  QTest::addColumn<QString>( "shapeFile" );
+  QTest::addColumn<QString>( "symbolType" );
+
+  const QString polys = TEST_DATA_DIR + QStringLiteral( "/polys.shp" );
+  const QString lines = TEST_DATA_DIR + QStringLiteral( "/lines.shp" );
+
+  // symbols depending on where lines and rings start must not change at the edges of tiles
+  QTest::newRow( "simple_fill" ) << polys << QStringLiteral( "simple_fill" );
+  QTest::newRow( "centroid_fill" ) << polys << QStringLiteral( "centroid_fill" );
+  QTest::newRow( "dashed_line" ) << lines << QStringLiteral( "dashed_line" );
+  QTest::newRow( "marker_line" ) << lines << QStringLiteral( "marker_line" );
+}
+
+void TestQgsMapRendererJob::testParallelTiles()
+{
+  QFETCH( QString, shapeFile );
+  QFETCH( QString, symbolType );
+
+  QgsVectorLayer *vectorLayer = new QgsVectorLayer( shapeFile, QStringLiteral( "testshape" ), QStringLiteral( "ogr" ) );
+  QVERIFY( vectorLayer->isValid() );
+
+  vectorLayer->setRenderer( new QgsSingleSymbolRenderer( createSymbol( symbolType ) ) );
+
+  QgsProject::instance()->addMapLayers( QList<QgsMapLayer *>() << vectorLayer );
+
+  QgsMapSettings mapSettings( *mMapSettings );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << vectorLayer );
+  mapSettings.setExtent( vectorLayer->extent() );
+  mapSettings.setOutputSize( QSize( 512, 512 ) );
+  mapSettings.setFlag( QgsMapSettings::Antialiasing );
+
+  QgsMapRendererSequentialJob sequentialJob( mapSettings );
+  sequentialJob.start();
+  sequentialJob.waitForFinished();
+  QImage sequentialImage = sequentialJob.renderedImage();
+
+  QgsMapRendererParallelJob parallelJob( mapSettings );
+  parallelJob.start();
+  parallelJob.waitForFinished();
+  QImage parallelImage = parallelJob.renderedImage();
+
+  QgsProject::instance()->removeMapLayers( QStringList() << vectorLayer->id() );
+
+  QCOMPARE( parallelImage.size(), sequentialImage.size() );
+
+  // tiles overlap by the symbol size, so there must not be any seams between them
+  QCOMPARE( mismatchCount( sequentialImage, parallelImage ), 0 );
+}
+
+void TestQgsMapRendererJob::testPartialUpdate_data()
+{
+  QTest::addColumn<QString>( "symbolType" );
+  QTest::addColumn<bool>( "pan" );
+
+  // symbols depending on where lines start must not change at the edges of the updated areas
+  QTest::newRow( "dashed_line_pan" ) << QStringLiteral( "dashed_line" ) << true;
+  QTest::newRow( "dashed_line_edit" ) << QStringLiteral( "dashed_line" ) << false;
+  QTest::newRow( "marker_line_pan" ) << QStringLiteral( "marker_line" ) << true;
+  QTest::newRow( "marker_line_edit" ) << QStringLiteral( "marker_line" ) << false;
+}
+
+void TestQgsMapRendererJob::testPartialUpdate()
+{
+  QFETCH( QString, symbolType );
+  QFETCH( bool, pan );
+
+  QgsVectorLayer *vectorLayer = new QgsVectorLayer( TEST_DATA_DIR + QStringLiteral( "/lines.shp" ), QStringLiteral( "testshape" ), QStringLiteral( "ogr" ) );
+  QVERIFY( vectorLayer->isValid() );
+  vectorLayer->setRenderer( new QgsSingleSymbolRenderer( createSymbol( symbolType ) ) );
+  // edits stay in the edit buffer, they are rolled back at the end
+  QVERIFY( vectorLayer->startEditing() );
+
+  QgsProject::instance()->addMapLayers( QList<QgsMapLayer *>() << vectorLayer );
+
+  QgsMapSettings mapSettings( *mMapSettings );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << vectorLayer );
+  mapSettings.setExtent( vectorLayer->extent() );
+  mapSettings.setOutputSize( QSize( 512, 512 ) );
+  mapSettings.setFlag( QgsMapSettings::Antialiasing );
+
+  QgsMapRendererCache cache;
+  QgsMapRendererSequentialJob cachedJob( mapSettings );
+  cachedJob.setCache( &cache );
+  cachedJob.start();
+  cachedJob.waitForFinished();
+
+  if ( pan )
+  {
+    // shift the extent by whole pixels, so that the kept pixels can be copied
+    const double mapUnitsPerPixel = mapSettings.mapUnitsPerPixel();
+    QgsRectangle extent = mapSettings.visibleExtent();
+    extent.setXMinimum( extent.xMinimum() + 37 * mapUnitsPerPixel );
+    extent.setXMaximum( extent.xMaximum() + 37 * mapUnitsPerPixel );
+    extent.setYMinimum( extent.yMinimum() - 23 * mapUnitsPerPixel );
+    extent.setYMaximum( extent.yMaximum() - 23 * mapUnitsPerPixel );
+    mapSettings.setExtent( extent );
+  }
+  else
+  {
+    // move a line in the middle of the others
+    QgsFeature feature;
+    QVERIFY( vectorLayer->getFeatures().nextFeature( feature ) );
+    QgsGeometry geometry = feature.geometry();
+    geometry.translate( vectorLayer->extent().width() / 10, vectorLayer->extent().height() / 10 );
+    QVERIFY( vectorLayer->changeGeometry( feature.id(), geometry ) );
+  }
+
+  // the cached image can be updated for the new map settings
+  cache.init( mapSettings.visibleExtent(), mapSettings.scale() );
+  QVERIFY( !cache.hasCacheImage( vectorLayer->id() ) );
+  QgsMapToPixel cachedMapToPixel;
+  QList< QgsRectangle > dirtyExtents;
+  QVERIFY( !cache.layerCacheImage( vectorLayer->id(), cachedMapToPixel, dirtyExtents ).isNull() );
+  QCOMPARE( dirtyExtents.isEmpty(), pan );
+
+  QgsMapRendererSequentialJob updateJob( mapSettings );
+  updateJob.setCache( &cache );
+  updateJob.start();
+  updateJob.waitForFinished();
+  QImage updatedImage = updateJob.renderedImage();
+
+  QgsMapRendererSequentialJob fullJob( mapSettings );
+  fullJob.start();
+  fullJob.waitForFinished();
+  QImage fullImage = fullJob.renderedImage();
+
+  vectorLayer->rollBack();
+  QgsProject::instance()->removeMapLayers( QStringList() << vectorLayer->id() );
+
+  QCOMPARE( updatedImage.size(), fullImage.size() );
+
+  // symbols are clipped at the map extent like in a full render, so there must not be any seams
+  QCOMPARE( mismatchCount( fullImage, updatedImage ), 0 );
+}
+
+QgsSymbol *TestQgsMapRendererJob::createSymbol( const QString &symbolType )
+{
+  if ( symbolType == QLatin1String( "simple_fill" ) )
+  {
+    return new QgsFillSymbol( QgsSymbolLayerList() << new QgsSimpleFillSymbolLayer( QColor( 200, 100, 50 ) ) );
+  }
+  else if ( symbolType == QLatin1String( "centroid_fill" ) )
+  {
+    QgsCentroidFillSymbolLayer *centroidFill = new QgsCentroidFillSymbolLayer();
+    centroidFill->setSubSymbol( new QgsMarkerSymbol( QgsSymbolLayerList() << new QgsSimpleMarkerSymbolLayer( QgsSimpleMarkerSymbolLayerBase::Circle, 6 ) ) );
+    return new QgsFillSymbol( QgsSymbolLayerList() << new QgsSimpleFillSymbolLayer( QColor( 200, 100, 50 ) ) << centroidFill );
+  }
+  else if ( symbolType == QLatin1String( "dashed_line" ) )
+  {
+    QgsSimpleLineSymbolLayer *dashedLine = new QgsSimpleLineSymbolLayer( QColor( 0, 0, 0 ), 1, Qt::DashLine );
+    return new QgsLineSymbol( QgsSymbolLayerList() << dashedLine );
+  }
+  else
+  {
+    QgsMarkerLineSymbolLayer *markerLine = new QgsMarkerLineSymbolLayer( true, 7 );
+    markerLine->setSubSymbol( new QgsMarkerSymbol( QgsSymbolLayerList() << new QgsSimpleMarkerSymbolLayer( QgsSimpleMarkerSymbolLayerBase::Triangle, 3 ) ) );
+    return new QgsLineSymbol( QgsSymbolLayerList() << markerLine );
+  }
+}
+
+int TestQgsMapRendererJob::mismatchCount( const QImage &image1, const QImage &image2 )
+{
+  int count = 0;
+  for ( int y = 0; y < image1.height(); ++y )
+  {
+    const QRgb *line1 = reinterpret_cast< const QRgb * >( image1.constScanLine( y ) );
+    const QRgb *line2 = reinterpret_cast< const QRgb * >( image2.constScanLine( y ) );
+    for ( int x = 0; x < image1.width(); ++x )
+    {
+      if ( qAbs( qRed( line1[x] ) - qRed( line2[x] ) ) > 2
+           || qAbs( qGreen( line1[x] ) - qGreen( line2[x] ) ) > 2
+           || qAbs( qBlue( line1[x] ) - qBlue( line2[x] ) ) > 2
+           || qAbs( qAlpha( line1[x] ) - qAlpha( line2[x] ) ) > 2 )
+        count++;
+    }
+  }
+  return count;
+}
 
 QGSTEST_MAIN( TestQgsMapRendererJob )
 #include "testqgsmaprendererjob.moc"
@@ -29,6 +29,7 @@ class TestQgsMapToPixel: public QObject
     void getters();
     void fromScale();
     void toMapPoint();
+    void transformPolygon();
 };
 
 void TestQgsMapToPixel::rotation()
@@ -119,6 +120,32 @@ void TestQgsMapToPixel::toMapPoint()
   QCOMPARE( p, QgsPointXY( 20, 20 ) );
 }
 
+void TestQgsMapToPixel::transformPolygon()
+{
+  // the polygon transform must match the transform of single points, also with a rotation
+  QPolygonF polygon;
+  polygon << QPointF( 5, 5 ) << QPointF( 10, 0 ) << QPointF( -3.5, 12.25 ) << QPointF( 1e6, -1e6 );
+
+  const double rotations[] = { 0, 90, -45, 180 };
+  for ( double rotation : rotations )
+  {
+    QgsMapToPixel m2p( 0.1, 5, 5, 10, 10, rotation );
+    QPolygonF transformed = polygon;
+    m2p.transformInPlace( transformed );
+    QCOMPARE( transformed.size(), polygon.size() );
+    for ( int i = 0; i < polygon.size(); ++i )
+    {
+      const QgsPointXY expected = m2p.transform( QgsPointXY( polygon.at( i ) ) );
+      QGSCOMPARENEAR( transformed.at( i ).x(), expected.x(), 1e-6 );
+      QGSCOMPARENEAR( transformed.at( i ).y(), expected.y(), 1e-6 );
+    }
+  }
+
+  QPolygonF empty;
+  QgsMapToPixel( 1, 5, 5, 10, 10, 0 ).transformInPlace( empty );
+  QVERIFY( empty.isEmpty() );
+}
+
 QGSTEST_MAIN( TestQgsMapToPixel )
 #include "testqgsmaptopixel.moc"
 
@@ -56,6 +56,9 @@ class TestQgsOgcUtils : public QObject
 
     void testGeometryFromGML();
     void testGeometryToGML();
+    void testGeometryToGMLString_data();
+    void testGeometryToGMLString();
+    void testRectangleToGMLString();
 
     void testExpressionFromOgcFilter();
     void testExpressionFromOgcFilter_data();
@@ -264,6 +267,92 @@ void TestQgsOgcUtils::testGeometryToGML()
 }
 
 
+void TestQgsOgcUtils::testGeometryToGMLString_data()
+{
+  QTest::addColumn<QString>( "wkt" );
+
+  QTest::newRow( "point" ) << QStringLiteral( "Point(1.123456789 -2.5)" );
+  QTest::newRow( "point z" ) << QStringLiteral( "PointZ(1 2 3.25)" );
+  QTest::newRow( "linestring" ) << QStringLiteral( "LineString(0 0, 1.5 2, 3 -4)" );
+  QTest::newRow( "linestring z" ) << QStringLiteral( "LineStringZ(0 0 1, 1.5 2 2, 3 -4 3)" );
+  QTest::newRow( "polygon" ) << QStringLiteral( "Polygon((0 0, 10 0, 10 10, 0 10, 0 0),(2 2, 4 2, 4 4, 2 2),(6 6, 8 6, 8 8, 6 6))" );
+  QTest::newRow( "polygon z" ) << QStringLiteral( "PolygonZ((0 0 1, 10 0 2, 10 10 3, 0 0 1))" );
+  QTest::newRow( "multipoint" ) << QStringLiteral( "MultiPoint((1 2),(3 4))" );
+  QTest::newRow( "multipoint z" ) << QStringLiteral( "MultiPointZ((1 2 3),(4 5 6))" );
+  QTest::newRow( "multilinestring" ) << QStringLiteral( "MultiLineString((0 0, 1 1),(2 2, 3 3, 4 2))" );
+  QTest::newRow( "multilinestring z" ) << QStringLiteral( "MultiLineStringZ((0 0 1, 1 1 2),(2 2 3, 3 3 4))" );
+  QTest::newRow( "multipolygon" ) << QStringLiteral( "MultiPolygon(((0 0, 10 0, 10 10, 0 0),(2 1, 4 1, 4 3, 2 1)),((20 20, 30 20, 30 30, 20 20)))" );
+  QTest::newRow( "multipolygon z" ) << QStringLiteral( "MultiPolygonZ(((0 0 5, 10 0 5, 10 10 6, 0 0 5)))" );
+  // written by the geometries themselves
+  QTest::newRow( "circularstring" ) << QStringLiteral( "CircularString(0 0, 1 1, 2 0)" );
+  QTest::newRow( "collection" ) << QStringLiteral( "GeometryCollection(Point(1 2),LineString(0 0, 1 1))" );
+}
+
+void TestQgsOgcUtils::testGeometryToGMLString()
+{
+  QFETCH( QString, wkt );
+
+  const QString ns = QStringLiteral( "http://www.opengis.net/gml" );
+  const QString srsName = QStringLiteral( "EPSG:4326" );
+  QgsGeometry geometry = QgsGeometry::fromWkt( wkt );
+  QVERIFY( geometry.geometry() );
+
+  Q_FOREACH ( QgsOgcUtils::GMLVersion gmlVersion, QList<QgsOgcUtils::GMLVersion>() << QgsOgcUtils::GML_2_1_2 << QgsOgcUtils::GML_3_1_0 )
+  {
+    // same elements as the DOM of asGML2() / asGML3()
+    QDomDocument doc;
+    QDomElement geometryElem = gmlVersion == QgsOgcUtils::GML_2_1_2 ? geometry.geometry()->asGML2( doc, 6, ns )
+                               : geometry.geometry()->asGML3( doc, 6, ns );
+    geometryElem.setAttribute( QStringLiteral( "srsName" ), srsName );
+    doc.appendChild( geometryElem );
+    const QString domGml = doc.toString( 1 );
+
+    QDomElement expectedElem = comparableElement( domGml );
+    QDomElement resultElem = comparableElement( QgsOgcUtils::geometryToGMLString( geometry.geometry(), gmlVersion, 6, ns, srsName ) );
+    QVERIFY( compareElements( expectedElem, resultElem ) );
+
+    // same lines, indented
+    const QStringList domLines = domGml.split( '\n', QString::SkipEmptyParts );
+    const QStringList lines = QgsOgcUtils::geometryToGMLString( geometry.geometry(), gmlVersion, 6, ns, srsName, 3 ).split( '\n', QString::SkipEmptyParts );
+    QCOMPARE( lines.count(), domLines.count() );
+    for ( int i = 0; i < lines.count(); ++i )
+    {
+      QCOMPARE( lines.at( i ).indexOf( '<' ), domLines.at( i ).indexOf( '<' ) + 3 );
+    }
+  }
+
+  QVERIFY( QgsOgcUtils::geometryToGMLString( nullptr, QgsOgcUtils::GML_2_1_2 ).isEmpty() );
+}
+
+void TestQgsOgcUtils::testRectangleToGMLString()
+{
+  QgsRectangle rect( 1.123456789, -2, 3.5, 4 );
+  // escaped as the DOM escapes attributes
+  const QString srsName = QStringLiteral( "urn:a&b<\"c\">" );
+
+  QDomDocument doc;
+  QDomElement boxElem = QgsOgcUtils::rectangleToGMLBox( &rect, doc, srsName, false, 6 );
+  doc.appendChild( boxElem );
+  QDomElement expectedElem = comparableElement( doc.toString( 1 ) );
+  QDomElement resultElem = comparableElement( QgsOgcUtils::rectangleToGMLBoxString( rect, 6, srsName ) );
+  QVERIFY( compareElements( expectedElem, resultElem ) );
+  doc.removeChild( boxElem );
+
+  QDomElement envElem = QgsOgcUtils::rectangleToGMLEnvelope( &rect, doc, srsName, false, 6 );
+  doc.appendChild( envElem );
+  expectedElem = comparableElement( doc.toString( 1 ) );
+  resultElem = comparableElement( QgsOgcUtils::rectangleToGMLEnvelopeString( rect, 6, srsName ) );
+  QVERIFY( compareElements( expectedElem, resultElem ) );
+  doc.removeChild( envElem );
+
+  // without srsName
+  QCOMPARE( QgsOgcUtils::rectangleToGMLBoxString( rect, 2, QString(), 1 ),
+            QStringLiteral( " <gml:Box>\n  <gml:coordinates cs=\",\" ts=\" \">1.12,-2 3.5,4</gml:coordinates>\n </gml:Box>\n" ) );
+  QCOMPARE( QgsOgcUtils::rectangleToGMLEnvelopeString( rect, 2 ),
+            QStringLiteral( "<gml:Envelope>\n <gml:lowerCorner>1.12 -2</gml:lowerCorner>\n <gml:upperCorner>3.5 4</gml:upperCorner>\n</gml:Envelope>\n" ) );
+}
+
+
 void TestQgsOgcUtils::testExpressionFromOgcFilter_data()
 {
   QTest::addColumn<QString>( "xmlText" );
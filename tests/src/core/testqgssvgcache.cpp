@@ -0,0 +1,105 @@
+/***************************************************************************
+  testqgssvgcache.cpp
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#include "qgstest.h"
+#include <QObject>
+#include <QImage>
+
+#include "qgsapplication.h"
+#include "qgssvgcache.h"
+
+class TestQgsSvgCache : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+
+    void lookup();
+    void maximumSize();
+
+  private:
+    QString mSvgPath;
+};
+
+void TestQgsSvgCache::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mSvgPath = QStringLiteral( TEST_DATA_DIR ) + "/sample_svg.svg";
+}
+
+void TestQgsSvgCache::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsSvgCache::lookup()
+{
+  QgsSvgCache cache;
+  bool fitsInCache = false;
+
+  QImage image = cache.svgAsImage( mSvgPath, 50, QColor( 255, 0, 0 ), QColor( 0, 0, 255 ), 1, 1, fitsInCache );
+  QVERIFY( fitsInCache );
+  QCOMPARE( image.width(), 50 );
+  QCOMPARE( cache.missCount(), 1 );
+  QCOMPARE( cache.hitCount(), 0 );
+
+  // same parameters
+  QImage cachedImage = cache.svgAsImage( mSvgPath, 50, QColor( 255, 0, 0 ), QColor( 0, 0, 255 ), 1, 1, fitsInCache );
+  QCOMPARE( cachedImage, image );
+  QCOMPARE( cache.missCount(), 1 );
+  QCOMPARE( cache.hitCount(), 1 );
+
+  // any different parameter needs a new entry
+  cache.svgAsImage( mSvgPath, 60, QColor( 255, 0, 0 ), QColor( 0, 0, 255 ), 1, 1, fitsInCache );
+  cache.svgAsImage( mSvgPath, 50, QColor( 0, 255, 0 ), QColor( 0, 0, 255 ), 1, 1, fitsInCache );
+  cache.svgAsImage( mSvgPath, 50, QColor( 255, 0, 0 ), QColor( 0, 255, 0 ), 1, 1, fitsInCache );
+  cache.svgAsImage( mSvgPath, 50, QColor( 255, 0, 0 ), QColor( 0, 0, 255 ), 2, 1, fitsInCache );
+  cache.svgAsImage( mSvgPath, 50, QColor( 255, 0, 0 ), QColor( 0, 0, 255 ), 1, 2, fitsInCache );
+  QCOMPARE( cache.missCount(), 6 );
+  QCOMPARE( cache.hitCount(), 1 );
+
+  cache.svgAsImage( mSvgPath, 50, QColor( 255, 0, 0 ), QColor( 0, 0, 255 ), 1, 1, fitsInCache );
+  QCOMPARE( cache.missCount(), 6 );
+  QCOMPARE( cache.hitCount(), 2 );
+}
+
+void TestQgsSvgCache::maximumSize()
+{
+  QgsSvgCache cache;
+  cache.setMaximumSize( 200000 );
+  QCOMPARE( cache.maximumSize(), 200000L );
+
+  bool fitsInCache = false;
+  for ( int i = 0; i < 20; ++i )
+  {
+    cache.svgAsImage( mSvgPath, 100, QColor( i, 0, 0 ), QColor( 0, 0, 255 ), 1, 1, fitsInCache );
+    QVERIFY( fitsInCache );
+    QVERIFY( cache.totalSize() <= cache.maximumSize() );
+  }
+  QVERIFY( cache.totalSize() >= 100 * 100 * 4 );
+
+  // the least recently used entries were removed
+  cache.svgAsImage( mSvgPath, 100, QColor( 19, 0, 0 ), QColor( 0, 0, 255 ), 1, 1, fitsInCache );
+  QCOMPARE( cache.hitCount(), 1 );
+  cache.svgAsImage( mSvgPath, 100, QColor( 0, 0, 0 ), QColor( 0, 0, 255 ), 1, 1, fitsInCache );
+  QCOMPARE( cache.hitCount(), 1 );
+  QCOMPARE( cache.missCount(), 21 );
+}
+
+QGSTEST_MAIN( TestQgsSvgCache )
+#include "testqgssvgcache.moc"
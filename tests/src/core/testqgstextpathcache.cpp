@@ -0,0 +1,153 @@
+/***************************************************************************
+                         testqgstextpathcache.cpp
+                         ------------------------
+    Date                 : October 2017
+    Copyright            : (C) 2017 by QGIS Development Team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgsfontutils.h"
+#include "qgsrendercontext.h"
+#include "qgstextrenderer.h"
+#include "qgstextrenderer_p.h"
+
+#include <QImage>
+#include <QObject>
+#include <QPainter>
+
+/**
+ * \ingroup UnitTests
+ * Checks that the outlines of text drawn again with the same format are
+ * taken from QgsTextPathCache.
+ */
+class TestQgsTextPathCache : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+
+    void paths();
+    void drawText();
+
+  private:
+    // draws text with a buffer, as outlines
+    static void draw( const QgsTextFormat &format, const QString &text );
+};
+
+void TestQgsTextPathCache::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void TestQgsTextPathCache::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsTextPathCache::init()
+{
+  QgsTextPathCache::instance()->clear();
+}
+
+void TestQgsTextPathCache::draw( const QgsTextFormat &format, const QString &text )
+{
+  QImage image( 400, 200, QImage::Format_ARGB32_Premultiplied );
+  image.fill( Qt::transparent );
+  QPainter painter( &image );
+  QgsRenderContext context = QgsRenderContext::fromQPainter( &painter );
+  QgsTextRenderer::drawText( QPointF( 20, 100 ), 0, QgsTextRenderer::AlignLeft, QStringList() << text, context, format );
+  painter.end();
+}
+
+void TestQgsTextPathCache::paths()
+{
+  QgsTextPathCache *cache = QgsTextPathCache::instance();
+  QFont font = QgsFontUtils::getStandardTestFont( QStringLiteral( "Bold" ), 20 );
+
+  const QPainterPath path = cache->path( font, QStringLiteral( "cached" ) );
+  QCOMPARE( cache->hits(), 0 );
+  QCOMPARE( cache->misses(), 1 );
+  QVERIFY( path.elementCount() > 0 );
+
+  // copies of the cached path
+  QPainterPath expected;
+  expected.setFillRule( Qt::WindingFill );
+  expected.addText( 0, 0, font, QStringLiteral( "cached" ) );
+  QCOMPARE( cache->path( font, QStringLiteral( "cached" ) ), expected );
+  QCOMPARE( cache->path( font, QStringLiteral( "cached" ) ), path );
+  QCOMPARE( cache->hits(), 2 );
+  QCOMPARE( cache->misses(), 1 );
+
+  // properties missing from QFont::key()
+  font.setLetterSpacing( QFont::AbsoluteSpacing, 3 );
+  cache->path( font, QStringLiteral( "cached" ) );
+  QCOMPARE( cache->misses(), 2 );
+  font.setCapitalization( QFont::AllUppercase );
+  cache->path( font, QStringLiteral( "cached" ) );
+  QCOMPARE( cache->misses(), 3 );
+
+  cache->path( font, QStringLiteral( "other text" ) );
+  QCOMPARE( cache->hits(), 2 );
+  QCOMPARE( cache->misses(), 4 );
+
+  cache->clear();
+  QCOMPARE( cache->hits(), 0 );
+  QCOMPARE( cache->misses(), 0 );
+  cache->path( font, QStringLiteral( "cached" ) );
+  QCOMPARE( cache->misses(), 1 );
+}
+
+void TestQgsTextPathCache::drawText()
+{
+  QgsTextPathCache *cache = QgsTextPathCache::instance();
+
+  QgsTextFormat format;
+  format.setFont( QgsFontUtils::getStandardTestFont( QStringLiteral( "Bold" ) ) );
+  format.setSize( 20 );
+  QgsTextBufferSettings buffer;
+  buffer.setEnabled( true );
+  buffer.setSize( 1 );
+  format.setBuffer( buffer );
+
+  draw( format, QStringLiteral( "text" ) );
+  const int misses = cache->misses();
+  QVERIFY( misses > 0 );
+
+  // the buffer and the text of the same draw share the path
+  const int hits = cache->hits();
+  QVERIFY( hits > 0 );
+
+  // the same text and format are taken from the cache
+  draw( format, QStringLiteral( "text" ) );
+  QCOMPARE( cache->misses(), misses );
+  QVERIFY( cache->hits() > hits );
+
+  // another size
+  format.setSize( 30 );
+  draw( format, QStringLiteral( "text" ) );
+  QVERIFY( cache->misses() > misses );
+
+  // another font
+  const int sizeMisses = cache->misses();
+  format.setFont( QgsFontUtils::getStandardTestFont( QStringLiteral( "Oblique" ) ) );
+  draw( format, QStringLiteral( "text" ) );
+  QVERIFY( cache->misses() > sizeMisses );
+}
+
+QGSTEST_MAIN( TestQgsTextPathCache )
+#include "testqgstextpathcache.moc"
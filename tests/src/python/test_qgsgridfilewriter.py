@@ -0,0 +1,91 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for QgsGridFileWriter.
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+__author__ = 'QGIS Development Team'
+__date__ = '18/10/2017'
+__copyright__ = 'Copyright 2017, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import qgis  # NOQA
+
+import os
+import tempfile
+import shutil
+
+from qgis.core import (QgsFeature,
+                       QgsGeometry,
+                       QgsPointXY,
+                       QgsRasterLayer,
+                       QgsRectangle,
+                       QgsVectorLayer)
+from qgis.analysis import (QgsGridFileWriter,
+                           QgsIDWInterpolator,
+                           QgsInterpolator)
+
+from qgis.testing import start_app, unittest
+
+start_app()
+
+
+class TestQgsGridFileWriter(unittest.TestCase):
+
+    """Tests for the grid file writer with interpolators created from Python"""
+
+    def setUp(self):
+        self.dir = tempfile.mkdtemp()
+
+        self.layer = QgsVectorLayer("Point?crs=EPSG:3857&field=value:double", "points", "memory")
+        features = []
+        for x, y, value in [(0, 0, 1), (10, 0, 2), (0, 10, 3), (10, 10, 4)]:
+            f = QgsFeature(self.layer.fields())
+            f.setGeometry(QgsGeometry.fromPoint(QgsPointXY(x, y)))
+            f.setAttributes([value])
+            features.append(f)
+        self.assertTrue(self.layer.dataProvider().addFeatures(features)[0])
+
+    def tearDown(self):
+        shutil.rmtree(self.dir, True)
+
+    def layerData(self):
+        data = QgsInterpolator.LayerData()
+        data.vectorLayer = self.layer
+        data.zCoordInterpolation = False
+        data.interpolationAttribute = 0
+        data.mInputType = QgsInterpolator.POINTS
+        return [data]
+
+    def testIdw(self):
+        """Interpolators created from Python, as by Processing, are written on several threads"""
+        path = os.path.join(self.dir, 'idw.tif')
+        interpolator = QgsIDWInterpolator(self.layerData())
+
+        # more rows than a single band
+        columns = 1500
+        rows = 100
+        extent = QgsRectangle(-5, -5, 15, 15)
+        writer = QgsGridFileWriter(interpolator, path, extent, columns, rows, extent.width() / columns, extent.height() / rows)
+        writer.setFormat(QgsGridFileWriter.GeoTiff)
+        self.assertEqual(writer.writeFile(), 0)
+
+        layer = QgsRasterLayer(path, "grid", "gdal")
+        self.assertTrue(layer.isValid())
+        self.assertEqual(layer.width(), columns)
+        self.assertEqual(layer.height(), rows)
+        block = layer.dataProvider().block(1, layer.extent(), columns, rows)
+
+        # the center is at the same distance of all data points
+        self.assertAlmostEqual(block.value(rows // 2, columns // 2), 2.5, delta=0.1)
+        for row in range(0, rows, 7):
+            for column in range(0, columns, 13):
+                self.assertGreaterEqual(block.value(row, column), 1)
+                self.assertLessEqual(block.value(row, column), 4)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -17,7 +17,11 @@ import qgis  # NOQA
 from qgis.core import (QgsMapRendererCache,
                        QgsRectangle,
                        QgsVectorLayer,
-                       QgsProject)
+                       QgsProject,
+                       QgsFeature,
+                       QgsGeometry,
+                       QgsPointXY,
+                       QgsMapToPixel)
 from qgis.testing import start_app, unittest
 from qgis.PyQt.QtCore import QCoreApplication
 from qgis.PyQt.QtGui import QImage
@@ -97,6 +101,82 @@ class TestQgsMapRendererCache(unittest.TestCase):
         self.assertTrue(cache.cacheImage('layer').isNull())
         self.assertFalse(cache.hasCacheImage('layer'))
 
+    def testLayerImageExtentShift(self):
+        """ test that layer images are kept when the extent is shifted """
+        layer = QgsVectorLayer("Point?field=fldtxt:string",
+                               "layer", "memory")
+        cache = QgsMapRendererCache()
+        extent = QgsRectangle(0, 0, 200, 200)
+        self.assertFalse(cache.init(extent, 1000))
+
+        im = QImage(200, 200, QImage.Format_ARGB32_Premultiplied)
+        map_to_pixel = QgsMapToPixel(1, 100, 100, 200, 200, 0)
+        cache.setLayerCacheImage(layer, im, map_to_pixel)
+        cache.setCacheImage('labels', im, [layer])
+        self.assertTrue(cache.hasCacheImage(layer.id()))
+        self.assertTrue(cache.hasCacheImage('labels'))
+
+        # shift extent at the same scale
+        self.assertFalse(cache.init(QgsRectangle(50, 0, 250, 200), 1000))
+        self.assertFalse(cache.hasCacheImage(layer.id()))
+        self.assertTrue(cache.cacheImage(layer.id()).isNull())
+        # the layer image can still be updated, other images are cleared
+        image, cached_map_to_pixel, dirty_extents = cache.layerCacheImage(layer.id())
+        self.assertFalse(image.isNull())
+        self.assertEqual(cached_map_to_pixel.xCenter(), 100)
+        self.assertEqual(dirty_extents, [])
+        self.assertFalse(cache.hasCacheImage('labels'))
+
+        # images set with setCacheImage can not be updated
+        self.assertTrue(cache.layerCacheImage('labels')[0].isNull())
+
+        # change scale
+        self.assertFalse(cache.init(QgsRectangle(50, 0, 250, 200), 2000))
+        self.assertTrue(cache.layerCacheImage(layer.id())[0].isNull())
+
+    def testLayerImageEdits(self):
+        """ test that edits of features only mark their area as dirty """
+        layer = QgsVectorLayer("Point?field=fldtxt:string",
+                               "layer", "memory")
+        f = QgsFeature()
+        f.setGeometry(QgsGeometry.fromPoint(QgsPointXY(10, 20)))
+        self.assertTrue(layer.dataProvider().addFeatures([f]))
+        fid = next(layer.getFeatures()).id()
+        self.assertTrue(layer.startEditing())
+
+        cache = QgsMapRendererCache()
+        cache.init(QgsRectangle(0, 0, 200, 200), 1000)
+        im = QImage(200, 200, QImage.Format_ARGB32_Premultiplied)
+        cache.setLayerCacheImage(layer, im, QgsMapToPixel(1, 100, 100, 200, 200, 0))
+        self.assertTrue(cache.hasCacheImage(layer.id()))
+
+        # move the feature: both the previous and the new location are dirty
+        self.assertTrue(layer.changeGeometry(fid, QgsGeometry.fromPoint(QgsPointXY(30, 40))))
+        self.assertFalse(cache.hasCacheImage(layer.id()))
+        image, map_to_pixel, dirty_extents = cache.layerCacheImage(layer.id())
+        self.assertFalse(image.isNull())
+        self.assertEqual(dirty_extents, [QgsRectangle(10, 20, 10, 20), QgsRectangle(30, 40, 30, 40)])
+
+        # the repaint requested after the edit keeps the image, a later one removes it
+        layer.triggerRepaint()
+        self.assertFalse(cache.layerCacheImage(layer.id())[0].isNull())
+        layer.triggerRepaint()
+        self.assertTrue(cache.layerCacheImage(layer.id())[0].isNull())
+
+        # moving the feature again uses its edited location
+        cache.setLayerCacheImage(layer, im, QgsMapToPixel(1, 100, 100, 200, 200, 0))
+        self.assertTrue(layer.changeGeometry(fid, QgsGeometry.fromPoint(QgsPointXY(50, 60))))
+        self.assertEqual(cache.layerCacheImage(layer.id())[2], [QgsRectangle(30, 40, 30, 40), QgsRectangle(50, 60, 50, 60)])
+
+        # selection changes are dirty too
+        cache.setLayerCacheImage(layer, im, QgsMapToPixel(1, 100, 100, 200, 200, 0))
+        layer.selectByIds([fid])
+        self.assertEqual(cache.layerCacheImage(layer.id())[2], [QgsRectangle(50, 60, 50, 60)])
+
+        # stopping editing removes the image, vertex markers are not drawn anymore
+        layer.rollBack()
+        self.assertTrue(cache.layerCacheImage(layer.id())[0].isNull())
+
     def testRequestRepaintSimple(self):
         """ test requesting repaint with a single dependent layer """
         layer = QgsVectorLayer("Point?field=fldtxt:string",
@@ -39,7 +39,7 @@ import email
 
 from io import StringIO
 from qgis.server import QgsServer, QgsServerRequest, QgsBufferServerRequest, QgsBufferServerResponse
-from qgis.core import QgsRenderChecker, QgsApplication, QgsFontUtils
+from qgis.core import QgsRenderChecker, QgsApplication, QgsFontUtils, QgsProject, QgsVectorLayer
 from qgis.testing import unittest
 from qgis.PyQt.QtCore import QSize
 from utilities import unitTestDataPath
@@ -47,6 +47,8 @@ from utilities import unitTestDataPath
 import osgeo.gdal  # NOQA
 import tempfile
 import base64
+import json
+import xml.etree.ElementTree as ET
 
 
 # Strip path and content length because path may vary
@@ -405,6 +407,62 @@ class TestQgsServer(QgsServerTestBase):
         for id, req in tests:
             self.wfs_getfeature_post_compare(id, req)
 
+    def test_getfeature_gml3(self):
+        """Test GML3 GetFeature of multi geometries with Z values and of attribute values to escape"""
+        tmp_dir = tempfile.mkdtemp()
+        name = 'a < b & c > "d" ]]> \'e\''
+        layers = {
+            'polygons': {'type': 'MultiPolygon',
+                         'coordinates': [[[[0, 0, 1], [10, 0, 2], [10, 10, 3], [0, 0, 1]],
+                                          [[2, 1, 4], [4, 1, 5], [4, 3, 6], [2, 1, 4]]],
+                                         [[[20, 20, 7], [30, 20, 8], [30, 30, 9], [20, 20, 7]]]]},
+            'lines': {'type': 'MultiLineString',
+                      'coordinates': [[[0, 0], [1, 1]], [[2, 2], [3, 3], [4, 2]]]},
+        }
+        project = QgsProject()
+        for layer_name, geometry in layers.items():
+            path = os.path.join(tmp_dir, layer_name + '.geojson')
+            with open(path, 'w') as f:
+                json.dump({'type': 'FeatureCollection',
+                           'features': [{'type': 'Feature', 'properties': {'name': name}, 'geometry': geometry}]}, f)
+            layer = QgsVectorLayer(path, layer_name, 'ogr')
+            self.assertTrue(layer.isValid())
+            project.addMapLayer(layer)
+        project.writeEntry('WFSLayers', '/', list(project.mapLayers().keys()))
+        project_path = os.path.join(tmp_dir, 'project.qgs')
+        self.assertTrue(project.write(project_path))
+
+        query_string = '?MAP=%s&SERVICE=WFS&VERSION=1.0.0&REQUEST=GetFeature&TYPENAME=polygons,lines&OUTPUTFORMAT=GML3' % urllib.parse.quote(project_path)
+        header, body = self._execute_request(query_string)
+        root = ET.fromstring(body)
+
+        gml = '{http://www.opengis.net/gml}'
+        qgs = '{http://www.qgis.org/gml}'
+        features = {}
+        for member in root.findall(gml + 'featureMember'):
+            feature = member[0]
+            features[feature.tag] = feature
+        self.assertEqual(sorted(features.keys()), [qgs + 'lines', qgs + 'polygons'])
+
+        for feature in features.values():
+            self.assertEqual(feature.find(qgs + 'name').text, name)
+            self.assertTrue(feature.get(gml + 'id').startswith(feature.tag[len(qgs):] + '.'))
+            self.assertIsNotNone(feature.find(gml + 'boundedBy/' + gml + 'Envelope/' + gml + 'lowerCorner'))
+
+        polygons = features[qgs + 'polygons'].find(qgs + 'geometry/' + gml + 'MultiPolygon')
+        self.assertEqual(polygons.get('srsName'), 'EPSG:4326')
+        self.assertEqual(len(polygons.findall(gml + 'polygonMember')), 2)
+        self.assertEqual(len(polygons.findall('.//' + gml + 'interior')), 1)
+        self.assertEqual([(p.get('srsDimension'), p.text) for p in polygons.iter(gml + 'posList')],
+                         [('3', '0 0 1 10 0 2 10 10 3 0 0 1'),
+                          ('3', '2 1 4 4 1 5 4 3 6 2 1 4'),
+                          ('3', '20 20 7 30 20 8 30 30 9 20 20 7')])
+
+        lines = features[qgs + 'lines'].find(qgs + 'geometry/' + gml + 'MultiCurve')
+        self.assertEqual(lines.get('srsName'), 'EPSG:4326')
+        self.assertEqual([(p.get('srsDimension'), p.text) for p in lines.iter(gml + 'posList')],
+                         [('2', '0 0 1 1'), ('2', '2 2 3 3 4 2')])
+
     # WCS tests
     def wcs_request_compare(self, request):
         project = self.projectPath
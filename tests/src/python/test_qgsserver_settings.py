@@ -125,6 +125,36 @@ class TestQgsServerSettings(unittest.TestCase):
         self.assertEqual(self.settings.cacheSize(), 1024)
         os.environ.pop(env)
 
+    def test_env_wms_tiles(self):
+        self.assertEqual(self.settings.wmsMetatileSize(), 0)
+        self.assertEqual(self.settings.wmsTileSize(), 256)
+        self.assertEqual(self.settings.wmsTileCacheDirectory(), "")
+        self.assertEqual(self.settings.wmsTileCacheSize(), 64 * 1024 * 1024)
+
+        os.environ["QGIS_SERVER_WMS_METATILE_SIZE"] = "4"
+        os.environ["QGIS_SERVER_WMS_TILE_SIZE"] = "512"
+        os.environ["QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY"] = "/tmp/tiles"
+        os.environ["QGIS_SERVER_WMS_TILE_CACHE_SIZE"] = "1024"
+        self.settings.load()
+        self.assertEqual(self.settings.wmsMetatileSize(), 4)
+        self.assertEqual(self.settings.wmsTileSize(), 512)
+        self.assertEqual(self.settings.wmsTileCacheDirectory(), "/tmp/tiles")
+        self.assertEqual(self.settings.wmsTileCacheSize(), 1024)
+        os.environ.pop("QGIS_SERVER_WMS_METATILE_SIZE")
+        os.environ.pop("QGIS_SERVER_WMS_TILE_SIZE")
+        os.environ.pop("QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY")
+        os.environ.pop("QGIS_SERVER_WMS_TILE_CACHE_SIZE")
+
+    def test_env_wms_palette_iterations(self):
+        env = "QGIS_SERVER_WMS_PALETTE_ITERATIONS"
+
+        self.assertEqual(self.settings.wmsPaletteIterations(), 0)
+
+        os.environ[env] = "3"
+        self.settings.load()
+        self.assertEqual(self.settings.wmsPaletteIterations(), 3)
+        os.environ.pop(env)
+
     def test_env_cache_directory(self):
         env = "QGIS_SERVER_CACHE_DIRECTORY"
 
@@ -0,0 +1,181 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for the tile cache of QgsServer WMS.
+
+From build dir, run: ctest -R PyQgsServerWMSTileCache -V
+
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+"""
+__author__ = 'QGIS Development Team'
+__date__ = '18/10/2017'
+__copyright__ = 'Copyright 2017, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import os
+
+# Needed on Qt 5 so that the serialization of XML is consistent among all executions
+os.environ['QT_HASH_SEED'] = '1'
+
+import glob
+import shutil
+import tempfile
+import urllib.parse
+
+from qgis.testing import unittest
+from qgis.server import QgsAccessControlFilter, QgsConfigCache
+from qgis.PyQt.QtGui import QImage
+
+import osgeo.gdal  # NOQA
+
+from test_qgsserver import QgsServerTestBase
+
+METATILE_SIZE = 2
+TILE_SIZE = 256
+# gutter rendered around metatiles by the tile cache, in pixels
+METATILE_GUTTER = 64
+# tile size in EPSG:3857 units, a power of two keeps the BBOX values exact
+TILE_EXTENT = 64
+
+
+class RenderCounter(QgsAccessControlFilter):
+
+    """Counts the layers read by the renderer, which does not run for cached tiles"""
+
+    def __init__(self, server_iface):
+        super(QgsAccessControlFilter, self).__init__(server_iface)
+        self.count = 0
+
+    def layerPermissions(self, layer):
+        self.count += 1
+        return super(RenderCounter, self).layerPermissions(layer)
+
+    def cacheKey(self):
+        return "tiles"
+
+
+class TestQgsServerWMSTileCache(QgsServerTestBase):
+
+    """QGIS Server WMS tile cache tests"""
+
+    _counter = None
+
+    def setUp(self):
+        super(TestQgsServerWMSTileCache, self).setUp()
+        if TestQgsServerWMSTileCache._counter is None:
+            TestQgsServerWMSTileCache._counter = RenderCounter(self.server.serverInterface())
+            self.server.serverInterface().registerAccessControl(self._counter, 100)
+
+        self.project = self.testdata_path + "test_project.qgs"
+        self.cache_dir = tempfile.mkdtemp()
+        self.server.putenv('QGIS_SERVER_WMS_METATILE_SIZE', str(METATILE_SIZE))
+        self.server.putenv('QGIS_SERVER_WMS_TILE_SIZE', str(TILE_SIZE))
+        self.server.putenv('QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY', '')
+        # start without the tiles cached by other tests
+        QgsConfigCache.instance().removeEntry(self.project)
+
+    def tearDown(self):
+        self.server.putenv('QGIS_SERVER_WMS_METATILE_SIZE', '')
+        self.server.putenv('QGIS_SERVER_WMS_TILE_SIZE', '')
+        self.server.putenv('QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY', '')
+        shutil.rmtree(self.cache_dir, True)
+
+    def get_map(self, bbox, size):
+        qs = "?" + "&".join(["%s=%s" % i for i in list({
+            "MAP": urllib.parse.quote(self.project),
+            "SERVICE": "WMS",
+            "VERSION": "1.3.0",
+            "REQUEST": "GetMap",
+            "LAYERS": urllib.parse.quote("testlayer èé"),
+            "STYLES": "",
+            "FORMAT": "image/png",
+            "TRANSPARENT": "true",
+            "BBOX": ",".join([repr(v) for v in bbox]),
+            "HEIGHT": str(size),
+            "WIDTH": str(size),
+            "CRS": "EPSG:3857"
+        }.items())])
+
+        r, h = self._result(self._execute_request(qs))
+        self.assertEqual(h.get("Content-Type"), "image/png", r)
+        image = QImage.fromData(r, "PNG")
+        self.assertFalse(image.isNull())
+        return image.convertToFormat(QImage.Format_ARGB32)
+
+    def get_tile(self, column, row):
+        return self.get_map([column * TILE_EXTENT, row * TILE_EXTENT,
+                             (column + 1) * TILE_EXTENT, (row + 1) * TILE_EXTENT], TILE_SIZE)
+
+    def check_cropped_tiles(self):
+        # tiles around the features of the test layer, in two metatiles
+        for column, row in [(14268, 87593), (14268, 87592), (14269, 87593), (14270, 87593)]:
+            tile = self.get_tile(column, row)
+
+            metatile_column = column // METATILE_SIZE
+            metatile_row = row // METATILE_SIZE
+            gutter = METATILE_GUTTER * TILE_EXTENT / TILE_SIZE
+            metatile = self.get_map([metatile_column * METATILE_SIZE * TILE_EXTENT - gutter,
+                                     metatile_row * METATILE_SIZE * TILE_EXTENT - gutter,
+                                     (metatile_column + 1) * METATILE_SIZE * TILE_EXTENT + gutter,
+                                     (metatile_row + 1) * METATILE_SIZE * TILE_EXTENT + gutter],
+                                    METATILE_SIZE * TILE_SIZE + 2 * METATILE_GUTTER)
+
+            # rows of the grid go up, rows of the image go down
+            x = METATILE_GUTTER + (column - metatile_column * METATILE_SIZE) * TILE_SIZE
+            y = METATILE_GUTTER + (METATILE_SIZE - 1 - (row - metatile_row * METATILE_SIZE)) * TILE_SIZE
+            self.assertEqual(tile, metatile.copy(x, y, TILE_SIZE, TILE_SIZE),
+                             "Tile %s,%s differs from its metatile" % (column, row))
+
+    def check_cached_tiles(self):
+        self.get_tile(14268, 87593)
+        count = self._counter.count
+        self.assertGreater(count, 0)
+
+        # the other tile of the metatile is cached too
+        self.get_tile(14268, 87593)
+        self.get_tile(14268, 87592)
+        self.assertEqual(self._counter.count, count)
+
+        # tiles of the project are removed with its configuration
+        QgsConfigCache.instance().removeEntry(self.project)
+        self.get_tile(14268, 87592)
+        self.assertGreater(self._counter.count, count)
+
+    def test_memory_cache_crop(self):
+        self.check_cropped_tiles()
+
+    def test_disk_cache_crop(self):
+        self.server.putenv('QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY', self.cache_dir)
+        self.check_cropped_tiles()
+
+    def test_memory_cache(self):
+        self.check_cached_tiles()
+
+    def test_disk_cache(self):
+        self.server.putenv('QGIS_SERVER_WMS_TILE_CACHE_DIRECTORY', self.cache_dir)
+        self.check_cached_tiles()
+        self.assertEqual(len(glob.glob(os.path.join(self.cache_dir, '*', '*.png'))), METATILE_SIZE * METATILE_SIZE)
+
+        QgsConfigCache.instance().removeEntry(self.project)
+        self.assertEqual(glob.glob(os.path.join(self.cache_dir, '*', '*.png')), [])
+
+    def test_not_tiles(self):
+        """Requests which are not tiles are rendered"""
+        self.get_tile(14268, 87593)
+        count = self._counter.count
+
+        self.get_map([913152, 5605952, 913216, 5606016], 300)
+        self.assertGreater(self._counter.count, count)
+        count = self._counter.count
+
+        # not aligned on the grid
+        self.get_map([913160, 5605952, 913224, 5606016], TILE_SIZE)
+        self.assertGreater(self._counter.count, count)
+
+
+if __name__ == '__main__':
+    unittest.main()
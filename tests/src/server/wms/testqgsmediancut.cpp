@@ -0,0 +1,138 @@
+/***************************************************************************
+                         testqgsmediancut.cpp
+                         --------------------
+    Date                 : October 2017
+    Copyright            : (C) 2017 by QGIS Development Team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+#include "qgsmediancut.h"
+
+#include <QImage>
+#include <QLinearGradient>
+#include <QObject>
+#include <QPainter>
+#include <QRadialGradient>
+
+/**
+ * \ingroup UnitTests
+ * Checks that the 8 bit images written by the WMS service are the ones
+ * median cut and QImage::convertToFormat() used to produce.
+ */
+class TestQgsMedianCut : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void quantizeImage_data();
+    void quantizeImage();
+    void refinedPalette();
+
+  private:
+    // more than 100000 pixels, the image is processed by several threads
+    static QImage testImage( QImage::Format format, bool transparent, bool gradients );
+
+    // 8 bit image produced before quantizeImage(), from the ARGB32 colors of the image
+    static QImage medianCutImage( const QImage &image );
+};
+
+QImage TestQgsMedianCut::testImage( QImage::Format format, bool transparent, bool gradients )
+{
+  QImage image( 400, 300, format );
+  image.fill( transparent ? Qt::transparent : Qt::white );
+
+  QPainter painter( &image );
+  painter.setRenderHint( QPainter::Antialiasing, true );
+  painter.setPen( Qt::NoPen );
+
+  if ( gradients )
+  {
+    QLinearGradient linear( 0, 0, 400, 300 );
+    linear.setColorAt( 0, QColor( 255, 0, 0, transparent ? 40 : 255 ) );
+    linear.setColorAt( 0.5, QColor( 0, 200, 50, transparent ? 200 : 255 ) );
+    linear.setColorAt( 1, QColor( 20, 20, 255, transparent ? 120 : 255 ) );
+    painter.setBrush( linear );
+    painter.drawRect( 0, 0, 400, 150 );
+
+    QRadialGradient radial( 200, 220, 120 );
+    radial.setColorAt( 0, QColor( 255, 255, 0 ) );
+    radial.setColorAt( 1, QColor( 80, 0, 120, transparent ? 0 : 255 ) );
+    painter.setBrush( radial );
+    painter.drawEllipse( QPointF( 200, 220 ), 190, 75 );
+  }
+
+  // antialiased edges of flat shapes, as drawn by the map renderer
+  painter.setBrush( QColor( 30, 120, 200, transparent ? 128 : 255 ) );
+  painter.drawEllipse( QPointF( 80, 80 ), 60, 45 );
+  painter.setBrush( QColor( 250, 170, 20 ) );
+  painter.drawEllipse( QPointF( 320, 230 ), 50, 35 );
+  painter.end();
+
+  return image;
+}
+
+QImage TestQgsMedianCut::medianCutImage( const QImage &image )
+{
+  const QImage argbImage = image.convertToFormat( QImage::Format_ARGB32 );
+  QVector<QRgb> colorTable;
+  QgsWms::medianCut( colorTable, 256, argbImage );
+  return argbImage.convertToFormat( QImage::Format_Indexed8, colorTable,
+                                    Qt::ColorOnly | Qt::ThresholdDither |
+                                    Qt::ThresholdAlphaDither | Qt::NoOpaqueDetection );
+}
+
+void TestQgsMedianCut::quantizeImage_data()
+{
+  QTest::addColumn<QImage>( "image" );
+
+  QTest::newRow( "opaque" ) << testImage( QImage::Format_ARGB32, false, true );
+  QTest::newRow( "opaque rgb32" ) << testImage( QImage::Format_RGB32, false, true );
+  QTest::newRow( "transparent" ) << testImage( QImage::Format_ARGB32, true, true );
+  // transparent GetMap images are rendered premultiplied
+  QTest::newRow( "transparent premultiplied" ) << testImage( QImage::Format_ARGB32_Premultiplied, true, true );
+  QTest::newRow( "flat shapes" ) << testImage( QImage::Format_ARGB32, true, false );
+}
+
+void TestQgsMedianCut::quantizeImage()
+{
+  QFETCH( QImage, image );
+
+  const QImage result = QgsWms::quantizeImage( image, 256 );
+  const QImage expected = medianCutImage( image );
+
+  QCOMPARE( result.format(), QImage::Format_Indexed8 );
+  QCOMPARE( result.size(), image.size() );
+  QVERIFY( result.colorCount() <= 256 );
+  QCOMPARE( result.colorTable(), expected.colorTable() );
+  QVERIFY( result == expected );
+}
+
+void TestQgsMedianCut::refinedPalette()
+{
+  const QImage image = testImage( QImage::Format_ARGB32_Premultiplied, true, true );
+  const QImage argbImage = image.convertToFormat( QImage::Format_ARGB32 );
+
+  const QImage result = QgsWms::quantizeImage( image, 256, 5 );
+  QCOMPARE( result.format(), QImage::Format_Indexed8 );
+  QCOMPARE( result.size(), image.size() );
+  QVERIFY( result.colorCount() <= 256 );
+
+  // each pixel is given the closest color of the refined palette
+  const QVector<QRgb> colorTable = result.colorTable();
+  const QImage expected = argbImage.convertToFormat( QImage::Format_Indexed8, colorTable,
+                          Qt::ColorOnly | Qt::ThresholdDither |
+                          Qt::ThresholdAlphaDither | Qt::NoOpaqueDetection );
+  QVERIFY( result == expected );
+}
+
+QGSTEST_MAIN( TestQgsMedianCut )
+#include "testqgsmediancut.moc"